@@ -0,0 +1,220 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NV_BENCHMARK_ALLOC_REPORT_H
+#define NV_BENCHMARK_ALLOC_REPORT_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "novaphysics/novaphysics.h"
+
+#ifndef NV_WINDOWS
+    #include <sys/resource.h>
+#endif
+
+
+/**
+ * @file alloc_report.h
+ *
+ * @brief Memory usage of the benchmarked steps.
+ *
+ * Per-subsystem numbers need the engine built with allocation tracking
+ * (nova_builder's --track-alloc), peak RSS is reported in every build.
+ *
+ * Setting NV_ALLOC_BASELINE to a file path turns the report into a regression
+ * gate: the first run writes the per-step numbers into the file, later runs
+ * compare against it and exit with failure if a subsystem allocates more
+ * often or more bytes per step than the baseline allows.
+ */
+
+
+// Allowed growth over the baseline before a subsystem counts as a regression
+#define ALLOC_BASELINE_TOLERANCE 0.10
+// Absolute slack so subsystems that barely allocate don't fail on noise
+#define ALLOC_BASELINE_SLACK_ALLOCS 2.0
+#define ALLOC_BASELINE_SLACK_BYTES 256.0
+
+
+typedef struct {
+    nv_uint64 begin_allocated[nvAllocCategory_COUNT + 1];
+    nv_uint64 begin_allocations[nvAllocCategory_COUNT + 1];
+    nv_uint64 step_allocated[nvAllocCategory_COUNT + 1]; // Summed over all steps
+    nv_uint64 step_allocations[nvAllocCategory_COUNT + 1];
+    size_t steps;
+    double body_steps; // Body count summed over all steps
+} AllocReport;
+
+
+/**
+ * @brief Peak resident set size of the process in KB, 0 if it's unknown.
+ */
+size_t AllocReport_peak_rss() {
+    #ifdef NV_WINDOWS
+
+        return 0;
+
+    #else
+
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+
+        #if defined(__APPLE__) || defined(__MACH__)
+            return (size_t)usage.ru_maxrss / 1024; // Bytes on OSX
+        #else
+            return (size_t)usage.ru_maxrss;
+        #endif
+
+    #endif
+}
+
+/**
+ * @brief Snapshot the counters before a step.
+ */
+static inline void AllocReport_begin(AllocReport *report) {
+    if (!nvAllocTracker_is_enabled()) return;
+
+    for (size_t i = 0; i <= nvAllocCategory_COUNT; i++) {
+        nvAllocStats stats = nvAllocTracker_get((nvAllocCategory)i);
+        report->begin_allocated[i] = stats.allocated;
+        report->begin_allocations[i] = stats.allocations;
+    }
+}
+
+/**
+ * @brief Accumulate what the step allocated since the snapshot.
+ */
+static inline void AllocReport_end(AllocReport *report, nvSpace *space) {
+    if (!nvAllocTracker_is_enabled()) return;
+
+    for (size_t i = 0; i <= nvAllocCategory_COUNT; i++) {
+        nvAllocStats stats = nvAllocTracker_get((nvAllocCategory)i);
+        report->step_allocated[i] += stats.allocated - report->begin_allocated[i];
+        report->step_allocations[i] += stats.allocations - report->begin_allocations[i];
+    }
+
+    report->steps++;
+    if (space) report->body_steps += (double)space->bodies->size;
+}
+
+static inline double _AllocReport_per_step(AllocReport *report, nv_uint64 total) {
+    return (report->steps == 0) ? 0.0 : (double)total / (double)report->steps;
+}
+
+/**
+ * @brief Compare against or write the baseline file, returns false on regression.
+ */
+bool _AllocReport_baseline(AllocReport *report, const char *path) {
+    FILE *file = fopen(path, "r");
+
+    if (!file) {
+        file = fopen(path, "w");
+        if (!file) {
+            printf("Couldn't write allocation baseline '%s'.\n", path);
+            return true;
+        }
+
+        for (size_t i = 0; i <= nvAllocCategory_COUNT; i++) {
+            fprintf(
+                file,
+                "%s %f %f\n",
+                nvAllocCategory_name((nvAllocCategory)i),
+                _AllocReport_per_step(report, report->step_allocations[i]),
+                _AllocReport_per_step(report, report->step_allocated[i])
+            );
+        }
+
+        fclose(file);
+        printf("\nAllocation baseline written to '%s'.\n", path);
+        return true;
+    }
+
+    bool passed = true;
+    char name[32];
+    double base_allocs, base_bytes;
+
+    printf("\nAllocation baseline '%s':\n", path);
+
+    while (fscanf(file, "%31s %lf %lf", name, &base_allocs, &base_bytes) == 3) {
+        for (size_t i = 0; i <= nvAllocCategory_COUNT; i++) {
+            if (strcmp(name, nvAllocCategory_name((nvAllocCategory)i))) continue;
+
+            double allocs = _AllocReport_per_step(report, report->step_allocations[i]);
+            double bytes = _AllocReport_per_step(report, report->step_allocated[i]);
+
+            double max_allocs = base_allocs * (1.0 + ALLOC_BASELINE_TOLERANCE) + ALLOC_BASELINE_SLACK_ALLOCS;
+            double max_bytes = base_bytes * (1.0 + ALLOC_BASELINE_TOLERANCE) + ALLOC_BASELINE_SLACK_BYTES;
+
+            if (allocs > max_allocs) {
+                printf("  REGRESSION %s: %.1f allocs/step, baseline %.1f\n", name, allocs, base_allocs);
+                passed = false;
+            }
+            if (bytes > max_bytes) {
+                printf("  REGRESSION %s: %.0f bytes/step, baseline %.0f\n", name, bytes, base_bytes);
+                passed = false;
+            }
+        }
+    }
+
+    fclose(file);
+
+    if (passed) printf("  No regressions.\n");
+
+    return passed;
+}
+
+/**
+ * @brief Print peak RSS and per-subsystem allocation statistics.
+ *
+ * Exits with failure if NV_ALLOC_BASELINE is set and a regression is found.
+ */
+void AllocReport_print(AllocReport *report) {
+    size_t rss = AllocReport_peak_rss();
+
+    printf("\nMemory:\n---------------------\n");
+
+    if (rss) printf("Peak RSS: %.1f MB\n", (double)rss / 1024.0);
+    else printf("Peak RSS: n/a\n");
+
+    if (!nvAllocTracker_is_enabled()) {
+        printf("Build with allocation tracking (--track-alloc) for per-subsystem numbers.\n");
+        return;
+    }
+
+    double bodies = (report->steps == 0) ? 0.0 : report->body_steps / (double)report->steps;
+
+    printf(
+        "\n%-12s %-10s %-10s %-12s %-12s %-10s\n",
+        "subsystem", "live KB", "peak KB", "bytes/step", "allocs/step", "bytes/body"
+    );
+
+    for (size_t i = 0; i <= nvAllocCategory_COUNT; i++) {
+        nvAllocStats stats = nvAllocTracker_get((nvAllocCategory)i);
+
+        printf(
+            "%-12s %-10.1f %-10.1f %-12.0f %-12.1f %-10.1f\n",
+            nvAllocCategory_name((nvAllocCategory)i),
+            (double)stats.current / 1024.0,
+            (double)stats.peak / 1024.0,
+            _AllocReport_per_step(report, report->step_allocated[i]),
+            _AllocReport_per_step(report, report->step_allocations[i]),
+            (bodies < 1.0) ? 0.0 : (double)stats.current / bodies
+        );
+    }
+
+    char *baseline = getenv("NV_ALLOC_BASELINE");
+    if (baseline && !_AllocReport_baseline(report, baseline)) {
+        printf("Allocation regression gate failed.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+#endif
\ No newline at end of file
@@ -16,6 +16,8 @@
 #include <stdio.h>
 #include <time.h>
 #include "novaphysics/novaphysics.h"
+#include "perf_counters.h"
+#include "alloc_report.h"
 
 
 /**
@@ -134,6 +136,10 @@ void print_stats(Stats stats) {
 }
 
 
+// Events the timeline tracer can hold, later ones are dropped
+#define BENCHMARK_TRACE_CAPACITY (1 << 18)
+
+
 /**
  * @brief Base benchmark struct.
  */
@@ -154,6 +160,9 @@ typedef struct {
     double *bvh_build;
     double *bvh_traverse;
     double *bvh_destroy;
+    PerfCounters *perf; // Hardware counters, NULL unless NV_PERF_COUNTERS environment variable is set
+    AllocReport alloc;
+    nvTracer *tracer; // Timeline tracer, NULL unless NV_TRACE environment variable is set to an output path
     size_t _index;
     FILE *output;
 } Benchmark;
@@ -183,6 +192,17 @@ Benchmark Benchmark_new(size_t iters, nvSpace *space) {
     bench.bvh_destroy = (double *)malloc(sizeof(double) * bench.iters);
     bench._index = 0;
 
+    bench.perf = NULL;
+    if (space && getenv("NV_PERF_COUNTERS")) bench.perf = PerfCounters_open(space);
+
+    memset(&bench.alloc, 0, sizeof(AllocReport));
+
+    bench.tracer = NULL;
+    if (space && getenv("NV_TRACE")) {
+        bench.tracer = nvTracer_new(BENCHMARK_TRACE_CAPACITY);
+        nvSpace_set_tracer(space, bench.tracer);
+    }
+
     srand(time(NULL));
 
     bench.output = fopen("bench_out.txt", "a");
@@ -191,6 +211,7 @@ Benchmark Benchmark_new(size_t iters, nvSpace *space) {
 }
 
 static inline void Benchmark_start(Benchmark *bench) {
+    AllocReport_begin(&bench->alloc);
     nvPrecisionTimer_start(bench->timer);
 }
 
@@ -200,6 +221,8 @@ static inline void Benchmark_stop(Benchmark *bench) {
     nvPrecisionTimer_stop(bench->timer);
     nvPrecisionTimer_stop(bench->global_timer);
 
+    AllocReport_end(&bench->alloc, space);
+
     bench->times[bench->_index] = bench->timer->elapsed;
 
     if (space) {
@@ -360,6 +383,30 @@ void Benchmark_results(Benchmark *bench) {
     printf("\nBVH-tree destroy:\n---------------------\n");
     print_stats(stats9);
 
+    PerfCounters_print(bench->perf);
+    PerfCounters_close(bench->perf);
+
+    AllocReport_print(&bench->alloc);
+
+    if (bench->tracer) {
+        nvSpace_set_tracer(bench->space, NULL);
+
+        char *trace_path = getenv("NV_TRACE");
+        if (nvTracer_save(bench->tracer, trace_path)) {
+            printf(
+                "\nTimeline of %u events saved to '%s' (%u dropped).\n",
+                nvTracer_get_count(bench->tracer),
+                trace_path,
+                bench->tracer->dropped
+            );
+        }
+        else {
+            printf("\nCouldn't save the timeline to '%s'.\n", trace_path);
+        }
+
+        nvTracer_free(bench->tracer);
+    }
+
     free(bench->timer);
     free(bench->times);
     free(bench->integrate_accelerations);
@@ -95,7 +95,7 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    if (space->broadphase_algorithm == nvBroadPhaseAlg_SPATIAL_HASH_GRID) {
+    if (space->broadphase_algorithm == nvBroadPhaseAlg_SHG) {
         nvSpace_set_SHG(space, space->shg->bounds, 1.9, 1.9);
         nvSpace_enable_multithreading(space, 0);
     }
@@ -0,0 +1,91 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdio.h>
+#include "benchmark_base.h"
+#include "novaphysics/novaphysics.h"
+
+
+/**
+ * @file cloth.c
+ * 
+ * @brief Cloth benchmark. 64x64 soft body cloth hanging from its top corners
+ *        and draping over a ball.
+ */
+
+
+enum {
+    BENCHMARK_ITERS = 1000,
+    BENCHMARK_HERTZ = 60,
+    BENCHMARK_VELOCITY_ITERATIONS = 10,
+    BENCHMARK_POSITION_ITERATIONS = 10,
+    BENCHMARK_CONSTRAINT_ITERATIONS = 5,
+    BENCHMARK_COLUMNS = 64,
+    BENCHMARK_ROWS = 64
+};
+
+
+int main(int argc, char *argv[]) {
+    // Setup benchmark
+
+    nvSpace *space = nvSpace_new();
+
+    Benchmark bench = Benchmark_new(BENCHMARK_ITERS, space);
+
+    nvBody *ball = nvBody_new(
+        nvBodyType_STATIC,
+        nvCircleShape_new(8.0),
+        NV_VEC2(64.0, 50.0),
+        0.0,
+        (nvMaterial){1.0, 0.0, 0.5}
+    );
+
+    nvSpace_add(space, ball);
+
+    nv_float spacing = 0.5;
+
+    nvSoftBody *cloth = nvSoftBody_new_cloth(
+        NV_VEC2(64.0 - spacing * (nv_float)(BENCHMARK_COLUMNS - 1) / 2.0, 20.0),
+        BENCHMARK_COLUMNS,
+        BENCHMARK_ROWS,
+        spacing,
+        0.05,
+        0.0,
+        (nvMaterial){1.0, 0.0, 0.5}
+    );
+
+    nvSoftBody_set_mass(cloth, 0, 0.0);
+    nvSoftBody_set_mass(cloth, BENCHMARK_COLUMNS - 1, 0.0);
+
+    nvSpace_add_soft_body(space, cloth);
+
+    // Run benchmark
+    for (size_t i = 0; i < bench.iters; i++) {
+        nv_float dt = 1.0 / (nv_float)BENCHMARK_HERTZ;
+
+        Benchmark_start(&bench);
+
+        nvSpace_step(
+            space,
+            dt,
+            BENCHMARK_VELOCITY_ITERATIONS,
+            BENCHMARK_POSITION_ITERATIONS,
+            BENCHMARK_CONSTRAINT_ITERATIONS,
+            1
+        );
+
+        Benchmark_stop(&bench);
+    }
+    
+    Benchmark_results(&bench);
+
+
+    nvSpace_free(space);
+}
\ No newline at end of file
@@ -0,0 +1,509 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchmark_base.h"
+#include "novaphysics/novaphysics.h"
+#include "novaphysics/space_step.h"
+
+
+/**
+ * @file micro.c
+ *
+ * @brief Microbenchmarks of the hot kernels in isolation.
+ *
+ * Usage: micro [name filter] [--samples N]
+ *
+ * Every kernel runs a batch of operations per sample. Batches are first run
+ * a few times to warm up the caches and the branch predictors, then timed
+ * over a number of samples. Median and minimum time per operation are
+ * reported in nanoseconds, the spread between the quartiles shows how noisy
+ * the measurement was.
+ */
+
+
+enum {
+    MICRO_WARMUP = 5,
+    MICRO_SAMPLES = 31,
+    MICRO_CALLS = 10000 // Calls per sample of single-pair kernels
+};
+
+
+typedef struct {
+    const char *name;
+    void (*setup)(void *data); // Called before every batch, not timed. Can be NULL.
+    void (*run)(void *data); // Runs one batch
+    void *data;
+    size_t ops; // Operations in one batch
+} Kernel;
+
+static const char *filter = NULL;
+static size_t sample_count = MICRO_SAMPLES;
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void run_kernel(Kernel kernel) {
+    if (filter && !strstr(kernel.name, filter)) return;
+
+    for (size_t i = 0; i < MICRO_WARMUP; i++) {
+        if (kernel.setup) kernel.setup(kernel.data);
+        kernel.run(kernel.data);
+    }
+
+    double *samples = malloc(sizeof(double) * sample_count);
+    nvPrecisionTimer timer;
+
+    for (size_t i = 0; i < sample_count; i++) {
+        if (kernel.setup) kernel.setup(kernel.data);
+
+        nvPrecisionTimer_start(&timer);
+        kernel.run(kernel.data);
+        samples[i] = nvPrecisionTimer_stop(&timer) / (double)kernel.ops * 1e9;
+    }
+
+    qsort(samples, sample_count, sizeof(double), compare_doubles);
+
+    double median = samples[sample_count / 2];
+    double q1 = samples[sample_count / 4];
+    double q3 = samples[sample_count * 3 / 4];
+
+    printf(
+        "%-40s %-10.2f %-10.2f %-6.1f\n",
+        kernel.name,
+        median,
+        samples[0],
+        (median > 0.0) ? (q3 - q1) / median * 100.0 : 0.0
+    );
+
+    free(samples);
+}
+
+
+/******************************************************************************
+
+                                    Hash map
+
+******************************************************************************/
+
+typedef struct {
+    nv_uint64 key;
+    nv_uint64 value;
+} MicroEntry;
+
+static nv_uint64 micro_entry_hash(void *item) {
+    nv_uint64 x = ((MicroEntry *)item)->key;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+typedef struct {
+    nvHashMap *map;
+    MicroEntry *entries;
+    size_t count;
+    nv_uint64 checksum; // Keeps the compiler from dropping the lookups
+} HashMapBench;
+
+static void hashmap_clear(void *data) {
+    HashMapBench *bench = data;
+    nvHashMap_clear(bench->map);
+}
+
+static void hashmap_set(void *data) {
+    HashMapBench *bench = data;
+    for (size_t i = 0; i < bench->count; i++)
+        nvHashMap_set(bench->map, &bench->entries[i]);
+}
+
+static void hashmap_get(void *data) {
+    HashMapBench *bench = data;
+    for (size_t i = 0; i < bench->count; i++) {
+        MicroEntry *entry = nvHashMap_get(bench->map, &bench->entries[i]);
+        bench->checksum += entry->value;
+    }
+}
+
+static void hashmap_iter(void *data) {
+    HashMapBench *bench = data;
+    size_t index = 0;
+    void *item;
+    while (nvHashMap_iter(bench->map, &index, &item))
+        bench->checksum += ((MicroEntry *)item)->value;
+}
+
+static void bench_hashmap() {
+    // Map isn't allowed to grow, so the load factor stays where it is set
+    const size_t buckets = 1 << 16;
+    const double load_factors[4] = {0.1, 0.25, 0.4, 0.55};
+
+    for (size_t l = 0; l < 4; l++) {
+        HashMapBench bench;
+        bench.map = nvHashMap_new(sizeof(MicroEntry), buckets, micro_entry_hash);
+        bench.count = (size_t)(load_factors[l] * (double)buckets);
+        bench.entries = malloc(sizeof(MicroEntry) * bench.count);
+        bench.checksum = 0;
+
+        nv_uint64 state = 0x9E3779B97F4A7C15ULL;
+        for (size_t i = 0; i < bench.count; i++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            bench.entries[i] = (MicroEntry){.key = state, .value = i};
+        }
+
+        char name[3][64];
+        sprintf(name[0], "nvHashMap_set (load %.2f)", load_factors[l]);
+        sprintf(name[1], "nvHashMap_get (load %.2f)", load_factors[l]);
+        sprintf(name[2], "nvHashMap_iter (load %.2f)", load_factors[l]);
+
+        run_kernel((Kernel){name[0], hashmap_clear, hashmap_set, &bench, bench.count});
+
+        hashmap_set(&bench);
+        run_kernel((Kernel){name[1], NULL, hashmap_get, &bench, bench.count});
+        run_kernel((Kernel){name[2], NULL, hashmap_iter, &bench, bench.count});
+
+        nvHashMap_free(bench.map);
+        free(bench.entries);
+    }
+}
+
+
+/******************************************************************************
+
+                               Broad-phase structures
+
+******************************************************************************/
+
+typedef struct {
+    nvArray *bodies;
+    nvSHG *shg;
+    nvBVHNode *tree;
+    size_t checksum;
+} BroadPhaseBench;
+
+static void invalidate_aabbs(void *data) {
+    BroadPhaseBench *bench = data;
+    for (size_t i = 0; i < bench->bodies->size; i++)
+        ((nvBody *)bench->bodies->data[i])->_cache_aabb = false;
+}
+
+static void shg_place(void *data) {
+    BroadPhaseBench *bench = data;
+    nvSHG_place(bench->shg, bench->bodies);
+}
+
+static void bvh_free_tree(void *data) {
+    BroadPhaseBench *bench = data;
+    if (bench->tree) nvBVHTree_free(bench->tree);
+    bench->tree = NULL;
+}
+
+static void bvh_new(void *data) {
+    BroadPhaseBench *bench = data;
+    bench->tree = nvBVHTree_new(bench->bodies);
+}
+
+static void bvh_collide(void *data) {
+    BroadPhaseBench *bench = data;
+
+    for (size_t i = 0; i < bench->bodies->size; i++) {
+        nvBody *body = bench->bodies->data[i];
+
+        bool is_combined;
+        nvArray *collided = nvBVHNode_collide(bench->tree, nvBody_get_aabb(body), &is_combined);
+        if (!collided) continue;
+
+        bench->checksum += collided->size;
+        if (is_combined) nvArray_free(collided);
+    }
+}
+
+static void bench_broadphase() {
+    const size_t count = 5000;
+
+    BroadPhaseBench bench;
+    bench.bodies = nvArray_new();
+    bench.tree = NULL;
+    bench.checksum = 0;
+
+    srand(1);
+    for (size_t i = 0; i < count; i++) {
+        nvShape *shape = (i % 2) ? nvCircleShape_new(frand(0.5, 1.0)) : nvRectShape_new(frand(1.0, 2.0), frand(1.0, 2.0));
+        nvArray_add(bench.bodies, nvBody_new(
+            nvBodyType_DYNAMIC,
+            shape,
+            NV_VEC2(frand(0.0, 256.0), frand(0.0, 144.0)),
+            frand(0.0, NV_PI),
+            nvMaterial_WOOD
+        ));
+    }
+
+    bench.shg = nvSHG_new((nvAABB){0.0, 0.0, 256.0, 144.0}, 3.0, 3.0);
+
+    run_kernel((Kernel){"nvSHG_place (per body)", invalidate_aabbs, shg_place, &bench, count});
+    run_kernel((Kernel){"nvBVHTree_new (per body)", bvh_free_tree, bvh_new, &bench, count});
+
+    bvh_free_tree(&bench);
+    bvh_new(&bench);
+    run_kernel((Kernel){"nvBVHNode_collide (per query)", NULL, bvh_collide, &bench, count});
+    bvh_free_tree(&bench);
+
+    nvSHG_free(bench.shg);
+    nvArray_free_each(bench.bodies, nvBody_free);
+    nvArray_free(bench.bodies);
+}
+
+
+/******************************************************************************
+
+                                   Narrow-phase
+
+******************************************************************************/
+
+typedef struct {
+    nvBody *a;
+    nvBody *b;
+    size_t checksum;
+} PairBench;
+
+static void circle_x_circle(void *data) {
+    PairBench *bench = data;
+    for (size_t i = 0; i < MICRO_CALLS; i++) {
+        nvResolution res = nv_collide_circle_x_circle(bench->a, bench->b);
+        if (res.collision) nv_contact_circle_x_circle(&res);
+        bench->checksum += res.contact_count;
+    }
+}
+
+static void polygon_x_circle(void *data) {
+    PairBench *bench = data;
+    for (size_t i = 0; i < MICRO_CALLS; i++) {
+        nvResolution res = nv_collide_polygon_x_circle(bench->a, bench->b);
+        if (res.collision) nv_contact_polygon_x_circle(&res);
+        bench->checksum += res.contact_count;
+    }
+}
+
+static void polygon_x_polygon(void *data) {
+    PairBench *bench = data;
+    for (size_t i = 0; i < MICRO_CALLS; i++) {
+        nvResolution res;
+        res.collision = false;
+        res.a = bench->a;
+        res.b = bench->b;
+        nv_contact_polygon_x_polygon(&res);
+        bench->checksum += res.contact_count;
+    }
+}
+
+static nvBody *micro_body(nvShape *shape, nvVector2 position, nv_float angle) {
+    return nvBody_new(nvBodyType_DYNAMIC, shape, position, angle, nvMaterial_WOOD);
+}
+
+static void bench_narrowphase() {
+    // Overlapping pairs, transforms are cached after the first call like in a step
+    PairBench bench = {0};
+
+    bench.a = micro_body(nvCircleShape_new(1.0), NV_VEC2(0.0, 0.0), 0.0);
+    bench.b = micro_body(nvCircleShape_new(1.0), NV_VEC2(1.5, 0.2), 0.0);
+    run_kernel((Kernel){"circle x circle", NULL, circle_x_circle, &bench, MICRO_CALLS});
+    nvBody_free(bench.a);
+    nvBody_free(bench.b);
+
+    const size_t vertex_counts[5] = {3, 4, 6, 8, 16};
+
+    for (size_t v = 0; v < 5; v++) {
+        size_t n = vertex_counts[v];
+        char name[64];
+
+        bench.a = micro_body(nvNGonShape_new(n, 2.0), NV_VEC2(0.0, 0.0), 0.1);
+        bench.b = micro_body(nvCircleShape_new(1.0), NV_VEC2(1.6, 0.3), 0.0);
+        sprintf(name, "polygon x circle (%lu vertices)", (unsigned long)n);
+        run_kernel((Kernel){name, NULL, polygon_x_circle, &bench, MICRO_CALLS});
+        nvBody_free(bench.b);
+
+        bench.b = micro_body(nvNGonShape_new(n, 2.0), NV_VEC2(1.5, 0.3), 0.4);
+        sprintf(name, "polygon x polygon (%lu vertices)", (unsigned long)n);
+        run_kernel((Kernel){name, NULL, polygon_x_polygon, &bench, MICRO_CALLS});
+        nvBody_free(bench.a);
+        nvBody_free(bench.b);
+    }
+}
+
+
+/******************************************************************************
+
+                                Solver & integrators
+
+******************************************************************************/
+
+typedef struct {
+    nvSpace *space;
+    nvArray *manifolds;
+} SpaceBench;
+
+static void solve_velocity(void *data) {
+    SpaceBench *bench = data;
+    for (size_t i = 0; i < bench->manifolds->size; i++)
+        nv_solve_velocity(bench->manifolds->data[i]);
+}
+
+static void bench_solver() {
+    SpaceBench bench;
+    bench.space = nvSpace_new();
+    bench.manifolds = nvArray_new();
+
+    nvSpace_add(bench.space, nvBody_new(
+        nvBodyType_STATIC, nvRectShape_new(120.0, 5.0), NV_VEC2(64.0, 70.0), 0.0, nvMaterial_WOOD
+    ));
+
+    // Pyramid of boxes resting on the ground, almost every manifold has 2 contacts
+    const size_t base = 40;
+    for (size_t y = 0; y < base; y++) {
+        for (size_t x = 0; x < base - y; x++) {
+            nvSpace_add(bench.space, nvBody_new(
+                nvBodyType_DYNAMIC,
+                nvRectShape_new(1.0, 1.0),
+                NV_VEC2(64.0 - (nv_float)(base - y) * 0.5 + (nv_float)x + 0.5, 67.0 - (nv_float)y),
+                0.0,
+                nvMaterial_WOOD
+            ));
+        }
+    }
+
+    for (size_t i = 0; i < 60; i++)
+        nvSpace_step(bench.space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    size_t contacts = 0;
+    size_t index = 0;
+    void *item;
+    while (nvHashMap_iter(bench.space->res, &index, &item)) {
+        nvResolution *res = item;
+        if (res->contact_count == 0) continue;
+
+        contacts += res->contact_count;
+        nvArray_add(bench.manifolds, res);
+    }
+
+    if (bench.manifolds->size > 0) {
+        char name[64];
+        sprintf(
+            name,
+            "nv_solve_velocity (%.2f contacts)",
+            (double)contacts / (double)bench.manifolds->size
+        );
+        run_kernel((Kernel){name, NULL, solve_velocity, &bench, bench.manifolds->size});
+    }
+
+    nvArray_free(bench.manifolds);
+    nvSpace_free(bench.space);
+}
+
+static void integrate_accelerations(void *data) {
+    nvSpace *space = ((SpaceBench *)data)->space;
+    for (size_t i = 0; i < space->awake_bodies->size; i++)
+        _nvSpace_integrate_accelerations(space, 1.0 / 60.0, i);
+}
+
+static void integrate_velocities(void *data) {
+    nvSpace *space = ((SpaceBench *)data)->space;
+    for (size_t i = 0; i < space->awake_bodies->size; i++)
+        _nvSpace_integrate_velocities(space, 1.0 / 60.0, i);
+}
+
+#ifdef NV_AVX
+
+    static void integrate_accelerations_avx(void *data) {
+        _nvSpace_integrate_accelerations_AVX(((SpaceBench *)data)->space, 1.0 / 60.0);
+    }
+
+    static void integrate_velocities_avx(void *data) {
+        _nvSpace_integrate_velocities_AVX(((SpaceBench *)data)->space, 1.0 / 60.0);
+    }
+
+#endif
+
+static void bench_integrators() {
+    SpaceBench bench;
+    bench.space = nvSpace_new();
+    bench.space->use_kill_bounds = false;
+
+    // Bodies far apart from each other, only the integrators have work to do
+    const size_t count = 4096;
+    for (size_t i = 0; i < count; i++) {
+        nvSpace_add(bench.space, nvBody_new(
+            nvBodyType_DYNAMIC,
+            nvCircleShape_new(0.5),
+            NV_VEC2((nv_float)(i % 64) * 4.0, (nv_float)(i / 64) * 4.0),
+            0.0,
+            nvMaterial_WOOD
+        ));
+    }
+
+    // One step fills the awake bodies array
+    nvSpace_step(bench.space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    nvSpace *space = bench.space;
+    size_t n = space->awake_bodies->size;
+
+    run_kernel((Kernel){"integrate accelerations (scalar)", NULL, integrate_accelerations, &bench, n});
+
+    #ifdef NV_AVX
+        run_kernel((Kernel){"integrate accelerations (AVX)", NULL, integrate_accelerations_avx, &bench, n});
+    #endif
+
+    run_kernel((Kernel){"integrate velocities (scalar)", NULL, integrate_velocities, &bench, n});
+
+    #ifdef NV_AVX
+        run_kernel((Kernel){"integrate velocities (AVX)", NULL, integrate_velocities_avx, &bench, n});
+    #endif
+
+    nvSpace_free(bench.space);
+}
+
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--samples") && i + 1 < argc) {
+            sample_count = (size_t)strtoul(argv[++i], NULL, 10);
+            if (sample_count < 4) sample_count = 4;
+        }
+        else filter = argv[i];
+    }
+
+    printf(
+        "Nova Physics microbenchmarks\n"
+        "Nova version: %d.%d.%d\n"
+        "Compiled with %s\n"
+        "Platform: %s\n"
+        "Samples: %lu (+%d warmup)\n\n",
+        NV_VERSION_MAJOR, NV_VERSION_MINOR, NV_VERSION_PATCH,
+        BENCHMARK_COMPILER_STR,
+        BENCHMARK_PLATFORM_STR,
+        (unsigned long)sample_count,
+        MICRO_WARMUP
+    );
+
+    printf("%-40s %-10s %-10s %-6s\n", "kernel", "ns/op", "min", "IQR %");
+    printf("--------------------------------------------------------------------\n");
+
+    bench_hashmap();
+    bench_broadphase();
+    bench_narrowphase();
+    bench_solver();
+    bench_integrators();
+}
\ No newline at end of file
@@ -0,0 +1,298 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NV_BENCHMARK_PERF_COUNTERS_H
+#define NV_BENCHMARK_PERF_COUNTERS_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "novaphysics/novaphysics.h"
+
+
+/**
+ * @file perf_counters.h
+ *
+ * @brief Hardware performance counters around the profiled phases of the step.
+ *
+ * Counters are read with perf_event_open on Linux, through the space's
+ * profiler hook, so the engine has to be built with the profiler. Only the
+ * thread calling nvSpace_step is counted, work done by the task executor's
+ * worker threads isn't included.
+ */
+
+
+typedef enum {
+    PerfCounter_CYCLES,
+    PerfCounter_INSTRUCTIONS,
+    PerfCounter_L1D_MISSES,
+    PerfCounter_LLC_MISSES,
+    PerfCounter_BRANCH_MISSES,
+    PerfCounter_COUNT
+} PerfCounter;
+
+static const char *perf_counter_names[PerfCounter_COUNT] = {
+    "cycles",
+    "instructions",
+    "L1D read misses",
+    "LLC misses",
+    "branch misses"
+};
+
+// Whether misses of a phase are reported per resolution instead of per body
+static inline bool perf_phase_per_pair(nvProfilerPhase phase) {
+    switch (phase) {
+        case nvProfilerPhase_UPDATE_RESOLUTIONS:
+        case nvProfilerPhase_NARROWPHASE:
+        case nvProfilerPhase_PRESOLVE_COLLISIONS:
+        case nvProfilerPhase_SOLVE_VELOCITIES:
+        case nvProfilerPhase_SOLVE_POSITIONS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+typedef struct {
+    nvSpace *space;
+    int leader; // Group leader's file descriptor, all counters are read at once through it
+    int fds[PerfCounter_COUNT]; // -1 if the counter couldn't be opened
+    size_t slots[PerfCounter_COUNT]; // Position of the counter in group reads
+    size_t open_count;
+    nv_uint64 begin[nvProfilerPhase_COUNT][PerfCounter_COUNT];
+    nv_uint64 totals[nvProfilerPhase_COUNT][PerfCounter_COUNT];
+    size_t steps;
+    double body_steps; // Body count summed over all steps
+    double pair_steps; // Resolution count summed over all steps
+} PerfCounters;
+
+
+#if defined(__linux__) && defined(NV_PROFILE)
+
+    #include <errno.h>
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <linux/perf_event.h>
+
+    static int _perf_event_open(nv_uint32 type, nv_uint64 config, int group_fd) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = (group_fd == -1);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+    }
+
+    static bool _PerfCounters_read(PerfCounters *perf, nv_uint64 *values) {
+        nv_uint64 data[1 + PerfCounter_COUNT];
+
+        if (read(perf->leader, data, sizeof(data)) < (ssize_t)sizeof(nv_uint64))
+            return false;
+
+        for (size_t i = 0; i < PerfCounter_COUNT; i++)
+            values[i] = (perf->fds[i] == -1) ? 0 : data[1 + perf->slots[i]];
+
+        return true;
+    }
+
+#else
+
+    static bool _PerfCounters_read(PerfCounters *perf, nv_uint64 *values) {
+        return false;
+    }
+
+#endif
+
+
+void _PerfCounters_hook(nvProfilerPhase phase, bool begin, void *user_data) {
+    PerfCounters *perf = (PerfCounters *)user_data;
+
+    nv_uint64 values[PerfCounter_COUNT];
+    if (!_PerfCounters_read(perf, values)) return;
+
+    if (begin) {
+        for (size_t i = 0; i < PerfCounter_COUNT; i++)
+            perf->begin[phase][i] = values[i];
+        return;
+    }
+
+    for (size_t i = 0; i < PerfCounter_COUNT; i++)
+        perf->totals[phase][i] += values[i] - perf->begin[phase][i];
+
+    if (phase == nvProfilerPhase_STEP) {
+        perf->steps++;
+        perf->body_steps += (double)perf->space->bodies->size;
+        perf->pair_steps += (double)perf->space->res->count;
+    }
+}
+
+/**
+ * @brief Open the counters and attach them to the space.
+ *
+ * Returns NULL and prints the reason if the counters aren't available, like
+ * when perf_event_paranoid doesn't allow them or on other platforms.
+ */
+PerfCounters *PerfCounters_open(nvSpace *space) {
+    #ifndef NV_PROFILE
+
+        printf("Hardware counters need the profiler, they are disabled.\n");
+        return NULL;
+
+    #elif !defined(__linux__)
+
+        printf("Hardware counters are only supported on Linux, they are disabled.\n");
+        return NULL;
+
+    #else
+
+        PerfCounters *perf = (PerfCounters *)calloc(1, sizeof(PerfCounters));
+        if (!perf) return NULL;
+
+        perf->space = space;
+
+        const nv_uint32 types[PerfCounter_COUNT] = {
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE
+        };
+
+        const nv_uint64 configs[PerfCounter_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D |
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        // Cycles lead the group, without them nothing else is worth reading
+        perf->leader = _perf_event_open(types[0], configs[0], -1);
+        if (perf->leader == -1) {
+            printf(
+                "Hardware counters are not available (%s), they are disabled.\n"
+                "Check /proc/sys/kernel/perf_event_paranoid.\n",
+                strerror(errno)
+            );
+            free(perf);
+            return NULL;
+        }
+
+        perf->fds[0] = perf->leader;
+        perf->slots[0] = 0;
+        perf->open_count = 1;
+
+        for (size_t i = 1; i < PerfCounter_COUNT; i++) {
+            perf->fds[i] = _perf_event_open(types[i], configs[i], perf->leader);
+
+            if (perf->fds[i] == -1) {
+                printf("Hardware counter '%s' is not available (%s).\n", perf_counter_names[i], strerror(errno));
+                continue;
+            }
+
+            perf->slots[i] = perf->open_count++;
+        }
+
+        ioctl(perf->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(perf->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+        nvSpace_set_profiler_hook(space, _PerfCounters_hook, perf);
+
+        return perf;
+
+    #endif
+}
+
+/**
+ * @brief Detach the counters from the space and close them.
+ */
+void PerfCounters_close(PerfCounters *perf) {
+    if (!perf) return;
+
+    if (perf->space->profiler_hook_data == perf)
+        nvSpace_set_profiler_hook(perf->space, NULL, NULL);
+
+    #if defined(__linux__) && defined(NV_PROFILE)
+        for (size_t i = PerfCounter_COUNT; i > 0; i--) {
+            if (perf->fds[i - 1] != -1) close(perf->fds[i - 1]);
+        }
+    #endif
+
+    free(perf);
+}
+
+/**
+ * @brief Print per-step counter averages, IPC and misses per body or resolution of each phase.
+ */
+void PerfCounters_print(PerfCounters *perf) {
+    if (!perf || perf->steps == 0) return;
+
+    double steps = (double)perf->steps;
+    double bodies = perf->body_steps / steps;
+    double pairs = perf->pair_steps / steps;
+
+    printf(
+        "\nHardware counters (per step, stepping thread only):\n---------------------\n"
+        "Average bodies: %.1f, resolutions: %.1f\n\n",
+        bodies,
+        pairs
+    );
+
+    printf(
+        "%-24s %-11s %-6s %-10s %-10s %-10s %-5s %-9s %-9s %-9s\n",
+        "phase", "cycles", "IPC", "L1D miss", "LLC miss", "br miss",
+        "per", "L1D/per", "LLC/per", "br/per"
+    );
+
+    for (size_t p = 0; p < nvProfilerPhase_COUNT; p++) {
+        nv_uint64 *totals = perf->totals[p];
+        if (totals[PerfCounter_CYCLES] == 0) continue;
+
+        double cycles = (double)totals[PerfCounter_CYCLES] / steps;
+        double instructions = (double)totals[PerfCounter_INSTRUCTIONS] / steps;
+        double l1d = (double)totals[PerfCounter_L1D_MISSES] / steps;
+        double llc = (double)totals[PerfCounter_LLC_MISSES] / steps;
+        double branch = (double)totals[PerfCounter_BRANCH_MISSES] / steps;
+
+        double units = perf_phase_per_pair((nvProfilerPhase)p) ? pairs : bodies;
+        if (units < 1.0) units = 1.0;
+
+        printf(
+            "%-24s %-11.0f %-6.2f %-10.0f %-10.0f %-10.0f %-5s %-9.2f %-9.2f %-9.2f\n",
+            nvProfilerPhase_name((nvProfilerPhase)p),
+            cycles,
+            instructions / cycles,
+            l1d,
+            llc,
+            branch,
+            perf_phase_per_pair((nvProfilerPhase)p) ? "res" : "body",
+            l1d / units,
+            llc / units,
+            branch / units
+        );
+    }
+
+    for (size_t i = 1; i < PerfCounter_COUNT; i++) {
+        if (perf->fds[i] == -1) printf("('%s' wasn't available and reads as 0)\n", perf_counter_names[i]);
+    }
+}
+
+
+#endif
\ No newline at end of file
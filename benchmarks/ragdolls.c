@@ -0,0 +1,162 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "benchmark_base.h"
+#include "novaphysics/novaphysics.h"
+
+
+/**
+ * @file ragdolls.c
+ *
+ * @brief Ragdolls benchmark. 200 ten-part ragdolls falling into a pile,
+ *        connected with articulations or with hinge joints if "hinge" is
+ *        passed as an argument.
+ */
+
+
+enum {
+    BENCHMARK_ITERS = 1000,
+    BENCHMARK_HERTZ = 60,
+    BENCHMARK_VELOCITY_ITERATIONS = 10,
+    BENCHMARK_POSITION_ITERATIONS = 10,
+    BENCHMARK_CONSTRAINT_ITERATIONS = 5,
+    BENCHMARK_RAGDOLLS = 200
+};
+
+
+typedef struct {
+    nv_float width; // 0 for the head circle
+    nv_float height;
+    nvVector2 offset; // Offset from the torso
+    int parent; // -1 for the torso
+    nvVector2 anchor; // Joint offset from the torso
+    nv_float lower;
+    nv_float upper;
+} RagdollPart;
+
+static const RagdollPart parts[] = {
+    {3.0, 4.0, {0.0, 0.0}, -1, {0.0, 0.0}, 0.0, 0.0},
+    {0.0, 1.0, {0.0, -3.0}, 0, {0.0, -2.0}, -NV_PI / 4.0, NV_PI / 4.0},
+    {3.0, 1.0, {-2.5, -1.5}, 0, {-1.5, -1.5}, -NV_PI / 2.0, NV_PI / 2.0},
+    {3.0, 1.0, {-4.5, -1.5}, 2, {-3.5, -1.5}, -NV_PI / 2.0, NV_PI / 2.0},
+    {3.0, 1.0, {2.5, -1.5}, 0, {1.5, -1.5}, -NV_PI / 2.0, NV_PI / 2.0},
+    {3.0, 1.0, {4.5, -1.5}, 4, {3.5, -1.5}, -NV_PI / 2.0, NV_PI / 2.0},
+    {1.0, 3.0, {-1.0, 3.0}, 0, {-1.0, 2.0}, -NV_PI / 2.0 + 0.3, NV_PI / 2.0 - 0.3},
+    {1.0, 3.0, {-1.0, 5.0}, 6, {-1.0, 4.0}, -NV_PI / 2.0, 0.0},
+    {1.0, 3.0, {1.0, 3.0}, 0, {1.0, 2.0}, -NV_PI / 2.0 + 0.3, NV_PI / 2.0 - 0.3},
+    {1.0, 3.0, {1.0, 5.0}, 8, {1.0, 4.0}, 0.0, NV_PI / 2.0 - 0.3}
+};
+
+
+void create_ragdoll(nvSpace *space, nvVector2 position, nv_uint32 group, bool hinge) {
+    size_t n = sizeof(parts) / sizeof(RagdollPart);
+    nvBody *bodies[sizeof(parts) / sizeof(RagdollPart)];
+    nvArticulation *ragdoll = NULL;
+
+    for (size_t i = 0; i < n; i++) {
+        const RagdollPart *part = &parts[i];
+
+        nvShape *shape;
+        if (part->width == 0.0) shape = nvCircleShape_new(part->height);
+        else shape = nvRectShape_new(part->width, part->height);
+
+        bodies[i] = nvBody_new(
+            nvBodyType_DYNAMIC,
+            shape,
+            nvVector2_add(position, part->offset),
+            0.0,
+            nvMaterial_BASIC
+        );
+        bodies[i]->collision_group = group;
+        nvSpace_add(space, bodies[i]);
+
+        if (part->parent < 0) {
+            if (!hinge) ragdoll = nvArticulation_new(bodies[i]);
+            continue;
+        }
+
+        nvBody *parent = bodies[part->parent];
+        nvVector2 anchor = nvVector2_add(position, part->anchor);
+
+        if (hinge) {
+            nvConstraint *link = nvHingeJoint_new(parent, bodies[i], anchor);
+            nvHingeJoint *link_def = (nvHingeJoint *)link->def;
+            nvSpace_add_constraint(space, link);
+            link_def->enable_limits = true;
+            link_def->lower_limit = part->lower;
+            link_def->upper_limit = part->upper;
+        }
+        else {
+            nvArticulation_add_link(ragdoll, parent, bodies[i], anchor);
+            nvArticulation_set_limits(ragdoll, ragdoll->count - 1, part->lower, part->upper);
+        }
+    }
+
+    if (!hinge) nvSpace_add_articulation(space, ragdoll);
+}
+
+
+int main(int argc, char *argv[]) {
+    // Setup benchmark
+
+    bool hinge = argc > 1 && !strcmp(argv[1], "hinge");
+
+    nvSpace *space = nvSpace_new();
+    space->position_correction = nvPositionCorrection_NGS;
+
+    Benchmark bench = Benchmark_new(BENCHMARK_ITERS, space);
+
+    nvBody *ground = nvBody_new(
+        nvBodyType_STATIC,
+        nvRectShape_new(128.0, 5.0),
+        NV_VEC2(64.0, 72.0 - 2.5),
+        0.0,
+        nvMaterial_CONCRETE
+    );
+
+    nvSpace_add(space, ground);
+
+    for (size_t i = 0; i < BENCHMARK_RAGDOLLS; i++) {
+        create_ragdoll(
+            space,
+            NV_VEC2(64.0 + frand(-40.0, 40.0), 36.0 + frand(-260.0, 25.0)),
+            i + 1,
+            hinge
+        );
+    }
+
+    if (space->broadphase_algorithm == nvBroadPhaseAlg_SHG)
+        nvSpace_set_SHG(space, space->shg->bounds, 2.0, 2.0);
+
+    // Run benchmark
+    for (size_t i = 0; i < bench.iters; i++) {
+        nv_float dt = 1.0 / (nv_float)BENCHMARK_HERTZ;
+
+        Benchmark_start(&bench);
+
+        nvSpace_step(
+            space,
+            dt,
+            BENCHMARK_VELOCITY_ITERATIONS,
+            BENCHMARK_POSITION_ITERATIONS,
+            BENCHMARK_CONSTRAINT_ITERATIONS,
+            1
+        );
+
+        Benchmark_stop(&bench);
+    }
+
+    Benchmark_results(&bench);
+
+
+    nvSpace_free(space);
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "benchmark_base.h"
+#include "novaphysics/novaphysics.h"
+
+
+/**
+ * @file replay.c
+ *
+ * @brief Headless replay of a recording saved with nvRecorder_save.
+ *
+ * Usage: replay <recording file> [slowest steps to list]
+ *
+ * Every recorded step is re-executed and profiled, then the usual benchmark
+ * statistics and the slowest steps with their phase timings are printed.
+ */
+
+
+enum {
+    BENCHMARK_SLOWEST_STEPS = 10
+};
+
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <recording file> [slowest steps to list]\n", argv[0]);
+        return 1;
+    }
+
+    size_t slowest_count = BENCHMARK_SLOWEST_STEPS;
+    if (argc >= 3) slowest_count = (size_t)strtoul(argv[2], NULL, 10);
+
+    // Setup benchmark
+
+    nvReplay *replay = nvReplay_open(argv[1]);
+    if (!replay) {
+        printf("Couldn't open recording file '%s'.\n", argv[1]);
+        return 1;
+    }
+
+    if (replay->step_count == 0) {
+        printf("Recording doesn't have any steps.\n");
+        nvReplay_free(replay);
+        return 1;
+    }
+
+    printf(
+        "Recording: %s\n"
+        "Bodies: %lu, steps: %lu\n",
+        argv[1],
+        (unsigned long)replay->space->bodies->size,
+        (unsigned long)replay->step_count
+    );
+
+    if (!replay->complete)
+        printf("Warning: some mutations couldn't be recorded, the replay might diverge.\n");
+
+    printf("\n");
+
+    Benchmark bench = Benchmark_new(replay->step_count, replay->space);
+    nvProfiler *profilers = malloc(sizeof(nvProfiler) * replay->step_count);
+
+    // Run benchmark
+    size_t steps = 0;
+    while (steps < bench.iters) {
+        Benchmark_start(&bench);
+
+        if (!nvReplay_step(replay)) break;
+
+        Benchmark_stop(&bench);
+
+        profilers[steps] = replay->space->profiler;
+        steps++;
+    }
+
+    if (replay->error) printf("Replay stopped at a malformed event.\n");
+
+    // Statistics are calculated over all the iterations
+    bench.iters = steps;
+    if (steps == 0) {
+        printf("No steps were replayed.\n");
+        return 1;
+    }
+
+    double *step_times = malloc(sizeof(double) * steps);
+    for (size_t i = 0; i < steps; i++) step_times[i] = bench.times[i];
+
+    Benchmark_results(&bench);
+
+    // List the slowest steps, these are the ones worth looking into
+    if (slowest_count > steps) slowest_count = steps;
+
+    printf("\nSlowest steps (ms):\n---------------------\n");
+    printf("step     total    broad    narrow   presolve velocity position\n");
+
+    for (size_t n = 0; n < slowest_count; n++) {
+        size_t slowest = 0;
+        for (size_t i = 1; i < steps; i++) {
+            if (step_times[i] > step_times[slowest]) slowest = i;
+        }
+
+        nvProfiler p = profilers[slowest];
+        printf(
+            "%-8lu %-8.3f %-8.3f %-8.3f %-8.3f %-8.3f %-8.3f\n",
+            (unsigned long)slowest,
+            step_times[slowest] * 1e3,
+            p.broadphase * 1e3,
+            p.narrowphase * 1e3,
+            p.presolve_collisions * 1e3,
+            p.solve_velocities * 1e3,
+            p.solve_positions * 1e3
+        );
+
+        step_times[slowest] = -1.0;
+    }
+
+    free(step_times);
+    free(profilers);
+    nvReplay_free(replay);
+}
\ No newline at end of file
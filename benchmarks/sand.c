@@ -0,0 +1,131 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdio.h>
+#include "benchmark_base.h"
+#include "novaphysics/novaphysics.h"
+
+
+/**
+ * @file sand.c
+ * 
+ * @brief Sand benchmark. 100000 particles poured into the ball pool's container
+ *        with boxes falling into them.
+ */
+
+
+enum {
+    BENCHMARK_ITERS = 1000,
+    BENCHMARK_HERTZ = 60,
+    BENCHMARK_VELOCITY_ITERATIONS = 10,
+    BENCHMARK_POSITION_ITERATIONS = 10,
+    BENCHMARK_CONSTRAINT_ITERATIONS = 5,
+    BENCHMARK_PARTICLES = 100000
+};
+
+
+int main(int argc, char *argv[]) {
+    // Setup benchmark
+
+    nvSpace *space = nvSpace_new();
+
+    Benchmark bench = Benchmark_new(BENCHMARK_ITERS, space);
+
+    nvMaterial ground_mat = (nvMaterial){1.0, 0.0, 0.7};
+
+    nvBody *ground = nvBody_new(
+        nvBodyType_STATIC,
+        nvRectShape_new(128.0, 5.0),
+        NV_VEC2(64.0, 74.0),
+        0.0,
+        ground_mat
+    );
+
+    nvSpace_add(space, ground);
+
+    nvBody *wall_left = nvBody_new(
+        nvBodyType_STATIC,
+        nvRectShape_new(5.0, 100.0),
+        NV_VEC2(64.0 - 50.0, 36.0),
+        0.0,
+        ground_mat
+    );
+
+    nvSpace_add(space, wall_left);
+
+    nvBody *wall_right = nvBody_new(
+        nvBodyType_STATIC,
+        nvRectShape_new(5.0, 100.0),
+        NV_VEC2(64.0 + 50.0, 36.0),
+        0.0,
+        ground_mat
+    );
+
+    nvSpace_add(space, wall_right);
+
+    for (size_t i = 0; i < 8; i++) {
+        nvBody *box = nvBody_new(
+            nvBodyType_DYNAMIC,
+            nvRectShape_new(4.0, 4.0),
+            NV_VEC2(64.0 - 42.0 + (nv_float)i * 12.0, -10.0 - (nv_float)(i % 3) * 6.0),
+            0.0,
+            (nvMaterial){1.0, 0.0, 0.5}
+        );
+
+        nvSpace_add(space, box);
+    }
+
+    nv_float radius = 0.1;
+    nv_float spacing = radius * 2.2;
+    size_t cols = (size_t)(94.0 / spacing);
+
+    nvParticleSystem *sand = nvParticleSystem_new(radius, (nvMaterial){1.0, 0.0, 0.5});
+
+    for (size_t i = 0; i < BENCHMARK_PARTICLES; i++) {
+        size_t x = i % cols;
+        size_t y = i / cols;
+
+        nvParticleSystem_add(
+            sand,
+            NV_VEC2(
+                64.0 - 47.0 + ((nv_float)x + (nv_float)(y % 2) * 0.5) * spacing,
+                71.0 - ((nv_float)y) * spacing
+            ),
+            nvVector2_zero
+        );
+    }
+
+    nvSpace_add_particles(space, sand);
+
+    nvSpace_enable_multithreading(space, 0);
+
+    // Run benchmark
+    for (size_t i = 0; i < bench.iters; i++) {
+        nv_float dt = 1.0 / (nv_float)BENCHMARK_HERTZ;
+
+        Benchmark_start(&bench);
+
+        nvSpace_step(
+            space,
+            dt,
+            BENCHMARK_VELOCITY_ITERATIONS,
+            BENCHMARK_POSITION_ITERATIONS,
+            BENCHMARK_CONSTRAINT_ITERATIONS,
+            1
+        );
+
+        Benchmark_stop(&bench);
+    }
+    
+    Benchmark_results(&bench);
+
+
+    nvSpace_free(space);
+}
\ No newline at end of file
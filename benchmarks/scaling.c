@@ -0,0 +1,352 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchmark_base.h"
+#include "novaphysics/novaphysics.h"
+
+
+/**
+ * @file scaling.c
+ *
+ * @brief Thread-scaling sweep over scene files saved with nvScene_save.
+ *
+ * Usage: scaling [--steps N] [--warmup N] [--max-threads N] [--json FILE] <scene files...>
+ *
+ * Every scene is run once for each thread count from 1 to max threads. One
+ * thread is the serial baseline with multi-threading disabled, the rest use
+ * the built-in task executor. For each phase the speedup against the serial
+ * run, parallel efficiency and the Karp-Flatt serial fraction are reported,
+ * along with the load imbalance between workers in parallel phases.
+ */
+
+
+enum {
+    SCALING_STEPS = 600,
+    SCALING_WARMUP = 60
+};
+
+
+typedef enum {
+    Phase_STEP,
+    Phase_INTEGRATE_ACCELERATIONS,
+    Phase_BROADPHASE,
+    Phase_UPDATE_RESOLUTIONS,
+    Phase_NARROWPHASE,
+    Phase_PRESOLVE_COLLISIONS,
+    Phase_SOLVE_VELOCITIES,
+    Phase_SOLVE_POSITIONS,
+    Phase_INTEGRATE_VELOCITIES,
+    Phase_COUNT
+} Phase;
+
+static const char *phase_names[Phase_COUNT] = {
+    "step",
+    "integrate_accelerations",
+    "broadphase",
+    "update_resolutions",
+    "narrowphase",
+    "presolve_collisions",
+    "solve_velocities",
+    "solve_positions",
+    "integrate_velocities"
+};
+
+static void get_phases(nvProfiler *profiler, double *phases) {
+    phases[Phase_STEP] = profiler->step;
+    phases[Phase_INTEGRATE_ACCELERATIONS] = profiler->integrate_accelerations;
+    phases[Phase_BROADPHASE] = profiler->broadphase;
+    phases[Phase_UPDATE_RESOLUTIONS] = profiler->update_resolutions;
+    phases[Phase_NARROWPHASE] = profiler->narrowphase;
+    phases[Phase_PRESOLVE_COLLISIONS] = profiler->presolve_collisions;
+    phases[Phase_SOLVE_VELOCITIES] = profiler->solve_velocities;
+    phases[Phase_SOLVE_POSITIONS] = profiler->solve_positions;
+    phases[Phase_INTEGRATE_VELOCITIES] = profiler->integrate_velocities;
+}
+
+
+/**
+ * @brief Averaged measurements of one thread count.
+ */
+typedef struct {
+    size_t threads;
+    double phases[Phase_COUNT]; // Average time of each phase
+    double parallel_wall; // Average time spent in parallel phases
+    double parallel_work; // Average time summed over workers in parallel phases
+    double worker_times[NV_PROFILER_MAX_WORKERS]; // Average busy time of each worker
+    size_t worker_count;
+} Run;
+
+static void run_scene(
+    nvScene *scene,
+    size_t threads,
+    size_t steps,
+    size_t warmup,
+    Run *run
+) {
+    nvSpace *space = nvSpace_new();
+    nvScene_instantiate(scene, space);
+
+    if (threads > 1) nvSpace_enable_multithreading(space, threads);
+
+    memset(run, 0, sizeof(Run));
+    run->threads = threads;
+
+    const nvSceneHeader *header = scene->header;
+
+    for (size_t i = 0; i < warmup + steps; i++) {
+        nvSpace_step(
+            space,
+            header->dt,
+            header->velocity_iters,
+            header->position_iters,
+            header->constraint_iters,
+            header->substeps
+        );
+
+        if (i < warmup) continue;
+
+        nvProfiler *profiler = &space->profiler;
+
+        double phases[Phase_COUNT];
+        get_phases(profiler, phases);
+        for (size_t p = 0; p < Phase_COUNT; p++)
+            run->phases[p] += phases[p];
+
+        run->parallel_wall += profiler->parallel_wall;
+        run->parallel_work += profiler->parallel_work;
+
+        for (size_t w = 0; w < profiler->worker_count; w++)
+            run->worker_times[w] += profiler->worker_times[w];
+
+        if (profiler->worker_count > run->worker_count)
+            run->worker_count = profiler->worker_count;
+    }
+
+    for (size_t p = 0; p < Phase_COUNT; p++)
+        run->phases[p] /= (double)steps;
+
+    run->parallel_wall /= (double)steps;
+    run->parallel_work /= (double)steps;
+
+    for (size_t w = 0; w < run->worker_count; w++)
+        run->worker_times[w] /= (double)steps;
+
+    nvSpace_free(space);
+}
+
+
+static double speedup(Run *serial, Run *run, Phase phase) {
+    if (run->phases[phase] <= 0.0) return 0.0;
+    return serial->phases[phase] / run->phases[phase];
+}
+
+/**
+ * @brief Karp-Flatt metric, experimentally determined serial fraction.
+ */
+static double serial_fraction(double speedup, size_t threads) {
+    if (threads < 2 || speedup <= 0.0) return 1.0;
+
+    double n = (double)threads;
+    return (1.0 / speedup - 1.0 / n) / (1.0 - 1.0 / n);
+}
+
+/**
+ * @brief Ratio of the busiest worker's time to the average worker time.
+ */
+static double imbalance(Run *run) {
+    if (run->worker_count == 0) return 1.0;
+
+    double max = 0.0;
+    double sum = 0.0;
+    for (size_t w = 0; w < run->worker_count; w++) {
+        if (run->worker_times[w] > max) max = run->worker_times[w];
+        sum += run->worker_times[w];
+    }
+
+    if (sum <= 0.0) return 1.0;
+    return max / (sum / (double)run->worker_count);
+}
+
+
+static void print_table(const char *filename, Run *runs, size_t run_count) {
+    Run *serial = &runs[0];
+
+    printf("\nScene: %s\n", filename);
+    printf("==================================================================\n");
+    printf("threads  step ms  speedup  efficiency  serial frac  parallel %%  imbalance\n");
+
+    for (size_t i = 0; i < run_count; i++) {
+        Run *run = &runs[i];
+        double s = speedup(serial, run, Phase_STEP);
+
+        printf(
+            "%-8lu %-8.3f %-8.2f %-11.2f %-12.3f %-11.1f %-8.2f\n",
+            (unsigned long)run->threads,
+            run->phases[Phase_STEP] * 1e3,
+            s,
+            s / (double)run->threads,
+            serial_fraction(s, run->threads),
+            run->phases[Phase_STEP] > 0.0 ? run->parallel_wall / run->phases[Phase_STEP] * 100.0 : 0.0,
+            imbalance(run)
+        );
+    }
+
+    printf("\nPer-phase speedup:\n");
+    printf("%-24s", "threads");
+    for (size_t i = 0; i < run_count; i++) printf(" %-7lu", (unsigned long)runs[i].threads);
+    printf("\n");
+
+    for (size_t p = 1; p < Phase_COUNT; p++) {
+        printf("%-24s", phase_names[p]);
+        for (size_t i = 0; i < run_count; i++) printf(" %-7.2f", speedup(serial, &runs[i], (Phase)p));
+        printf("\n");
+    }
+}
+
+static void write_json(FILE *file, const char *filename, Run *runs, size_t run_count, bool last) {
+    Run *serial = &runs[0];
+
+    fprintf(file, "    {\n      \"scene\": \"");
+    for (const char *c = filename; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', file);
+        fputc(*c, file);
+    }
+    fprintf(file, "\",\n      \"runs\": [\n");
+
+    for (size_t i = 0; i < run_count; i++) {
+        Run *run = &runs[i];
+        double s = speedup(serial, run, Phase_STEP);
+
+        fprintf(file, "        {\n");
+        fprintf(file, "          \"threads\": %lu,\n", (unsigned long)run->threads);
+        fprintf(file, "          \"speedup\": %f,\n", s);
+        fprintf(file, "          \"efficiency\": %f,\n", s / (double)run->threads);
+        fprintf(file, "          \"serial_fraction\": %f,\n", serial_fraction(s, run->threads));
+        fprintf(file, "          \"parallel_wall_ms\": %f,\n", run->parallel_wall * 1e3);
+        fprintf(file, "          \"parallel_work_ms\": %f,\n", run->parallel_work * 1e3);
+        fprintf(file, "          \"imbalance\": %f,\n", imbalance(run));
+
+        fprintf(file, "          \"phases_ms\": {");
+        for (size_t p = 0; p < Phase_COUNT; p++)
+            fprintf(file, "%s\"%s\": %f", p ? ", " : "", phase_names[p], run->phases[p] * 1e3);
+        fprintf(file, "},\n");
+
+        fprintf(file, "          \"phase_speedup\": {");
+        for (size_t p = 0; p < Phase_COUNT; p++)
+            fprintf(file, "%s\"%s\": %f", p ? ", " : "", phase_names[p], speedup(serial, run, (Phase)p));
+        fprintf(file, "},\n");
+
+        fprintf(file, "          \"worker_ms\": [");
+        for (size_t w = 0; w < run->worker_count; w++)
+            fprintf(file, "%s%f", w ? ", " : "", run->worker_times[w] * 1e3);
+        fprintf(file, "]\n");
+
+        fprintf(file, "        }%s\n", (i + 1 < run_count) ? "," : "");
+    }
+
+    fprintf(file, "      ]\n    }%s\n", last ? "" : ",");
+}
+
+
+int main(int argc, char *argv[]) {
+    #ifndef NV_PROFILE
+        printf("Thread-scaling benchmark needs the profiler, build without --no-profiler.\n");
+        return 1;
+    #endif
+
+    size_t steps = SCALING_STEPS;
+    size_t warmup = SCALING_WARMUP;
+    size_t max_threads = nv_get_cpu_count();
+    const char *json_path = NULL;
+
+    const char **scenes = malloc(sizeof(char *) * argc);
+    size_t scene_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--steps") && i + 1 < argc)
+            steps = (size_t)strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--warmup") && i + 1 < argc)
+            warmup = (size_t)strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--max-threads") && i + 1 < argc)
+            max_threads = (size_t)strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc)
+            json_path = argv[++i];
+        else
+            scenes[scene_count++] = argv[i];
+    }
+
+    if (scene_count == 0) {
+        printf("Usage: %s [--steps N] [--warmup N] [--max-threads N] [--json FILE] <scene files...>\n", argv[0]);
+        free(scenes);
+        return 1;
+    }
+
+    if (steps == 0) steps = SCALING_STEPS;
+    if (max_threads == 0) max_threads = 1;
+
+    printf(
+        "Nova Physics thread-scaling benchmark\n"
+        "Nova version: %d.%d.%d\n"
+        "Compiled with %s\n"
+        "Platform: %s\n"
+        "CPU count: %lu\n"
+        "Steps: %lu (+%lu warmup)\n",
+        NV_VERSION_MAJOR, NV_VERSION_MINOR, NV_VERSION_PATCH,
+        BENCHMARK_COMPILER_STR,
+        BENCHMARK_PLATFORM_STR,
+        (unsigned long)nv_get_cpu_count(),
+        (unsigned long)steps,
+        (unsigned long)warmup
+    );
+
+    FILE *json = NULL;
+    if (json_path) {
+        json = fopen(json_path, "w");
+        if (!json) printf("Couldn't open '%s' for writing.\n", json_path);
+    }
+
+    if (json) {
+        fprintf(json, "{\n  \"cpu_count\": %lu,\n", (unsigned long)nv_get_cpu_count());
+        fprintf(json, "  \"steps\": %lu,\n  \"scenes\": [\n", (unsigned long)steps);
+    }
+
+    Run *runs = malloc(sizeof(Run) * max_threads);
+    int status = 0;
+
+    for (size_t s = 0; s < scene_count; s++) {
+        nvScene *scene = nvScene_open(scenes[s]);
+        if (!scene) {
+            printf("\nCouldn't open scene file '%s'.\n", scenes[s]);
+            status = 1;
+            continue;
+        }
+
+        for (size_t t = 1; t <= max_threads; t++)
+            run_scene(scene, t, steps, warmup, &runs[t - 1]);
+
+        nvScene_close(scene);
+
+        print_table(scenes[s], runs, max_threads);
+        if (json) write_json(json, scenes[s], runs, max_threads, s + 1 == scene_count);
+    }
+
+    if (json) {
+        fprintf(json, "  ]\n}\n");
+        fclose(json);
+    }
+
+    free(runs);
+    free(scenes);
+
+    return status;
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "benchmark_base.h"
+#include "novaphysics/novaphysics.h"
+
+
+/**
+ * @file scene.c
+ *
+ * @brief Generic benchmark that runs a scene file saved with nvScene_save.
+ *
+ * Usage: scene <scene file> [steps] [threads]
+ *
+ * Step size and iteration counts are read from the scene file. Threads
+ * enables multi-threading, 0 uses all the cores.
+ */
+
+
+enum {
+    BENCHMARK_ITERS = 5000
+};
+
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <scene file> [steps] [threads]\n", argv[0]);
+        return 1;
+    }
+
+    size_t iters = BENCHMARK_ITERS;
+    if (argc >= 3) iters = (size_t)strtoul(argv[2], NULL, 10);
+    if (iters == 0) iters = BENCHMARK_ITERS;
+
+    // Setup benchmark
+
+    nvScene *scene = nvScene_open(argv[1]);
+    if (!scene) {
+        printf("Couldn't open scene file '%s'.\n", argv[1]);
+        return 1;
+    }
+
+    nvSpace *space = nvSpace_new();
+
+    nvScene_instantiate(scene, space);
+
+    nv_float dt = scene->header->dt;
+    size_t velocity_iters = scene->header->velocity_iters;
+    size_t position_iters = scene->header->position_iters;
+    size_t constraint_iters = scene->header->constraint_iters;
+    size_t substeps = scene->header->substeps;
+
+    printf(
+        "Scene: %s\n"
+        "Bodies: %lu, constraints: %lu\n\n",
+        argv[1],
+        (unsigned long)scene->header->body_count,
+        (unsigned long)scene->header->constraint_count
+    );
+
+    nvScene_close(scene);
+
+    if (argc >= 4 && space->broadphase_algorithm == nvBroadPhaseAlg_SHG)
+        nvSpace_enable_multithreading(space, (size_t)strtoul(argv[3], NULL, 10));
+
+    Benchmark bench = Benchmark_new(iters, space);
+
+    // Run benchmark
+    for (size_t i = 0; i < bench.iters; i++) {
+        Benchmark_start(&bench);
+
+        nvSpace_step(
+            space,
+            dt,
+            velocity_iters,
+            position_iters,
+            constraint_iters,
+            substeps
+        );
+
+        Benchmark_stop(&bench);
+    }
+
+    Benchmark_results(&bench);
+
+
+    nvSpace_free(space);
+}
\ No newline at end of file
@@ -0,0 +1,748 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "benchmark_base.h"
+#include "novaphysics/novaphysics.h"
+
+
+/**
+ * @file stress.c
+ *
+ * @brief Broad-phase stress sweep over procedurally generated scenes.
+ *
+ * Usage: stress [--bodies LIST] [--shapes LIST] [--packing LIST] [--extent LIST]
+ *               [--sleeping LIST] [--joints LIST] [--broadphase LIST] [--cells LIST]
+ *               [--steps N] [--warmup N] [--threads N] [--bf-limit N]
+ *               [--json FILE] [--save-dir DIR]
+ *
+ * Lists are comma separated. Every combination of the scene parameters is
+ * generated and run with every broad-phase algorithm, SHG once for each cell
+ * size. Scenes are zero gravity boxes with bodies moving in random directions,
+ * so the density stays the same during the run.
+ *
+ * Shapes are circles, boxes, ngons, mixed (all three of the same size) and
+ * mixed-sizes (all three, sizes spread over 16x). Packing is the fraction of
+ * the world covered by bodies, the world extent is derived from it unless
+ * extents are given. Sleeping is the fraction of bodies that start asleep.
+ *
+ * After the results, the scaling exponent of each series over body counts is
+ * reported along with the best broad-phase of each scene.
+ */
+
+
+enum {
+    STRESS_STEPS = 120,
+    STRESS_WARMUP = 20,
+    STRESS_BF_LIMIT = 4000, // Brute-force is skipped above this body count
+    STRESS_MAX_LIST = 16,
+    // Body IDs are 16-bit, 4 IDs are left for the walls
+    STRESS_MAX_BODIES = 65531
+};
+
+
+typedef enum {
+    ShapeMix_CIRCLES,
+    ShapeMix_BOXES,
+    ShapeMix_NGONS,
+    ShapeMix_MIXED,
+    ShapeMix_MIXED_SIZES,
+    ShapeMix_COUNT
+} ShapeMix;
+
+static const char *shape_mix_names[ShapeMix_COUNT] = {
+    "circles",
+    "boxes",
+    "ngons",
+    "mixed",
+    "mixed-sizes"
+};
+
+static const char *broadphase_names[3] = {
+    "bf",
+    "shg",
+    "bvh"
+};
+
+
+/**
+ * @brief Parameters of one run.
+ */
+typedef struct {
+    size_t bodies;
+    ShapeMix shapes;
+    double packing; // Fraction of the world covered by bodies
+    double extent; // Side length of the world, 0 derives it from packing
+    double sleeping; // Fraction of bodies that start asleep
+    size_t joints;
+    nvBroadPhaseAlg broadphase;
+    double cell_size; // SHG cell size, 0 for other algorithms
+} Config;
+
+/**
+ * @brief Averaged measurements of one run.
+ */
+typedef struct {
+    Config config;
+    double extent; // Actual side length of the world
+    double packing; // Actual packing
+    double step; // Average step time
+    double broadphase; // Average broad-phase time
+    double narrowphase; // Average narrow-phase time
+    double pairs; // Average number of broad-phase pairs
+    double contacts; // Average number of resolutions with contacts
+} Result;
+
+
+/*
+    Generation uses its own generator, every run of the same scene parameters
+    generates the same scene regardless of the broad-phase.
+*/
+
+static nv_uint64 random_state;
+
+static double random_double(double lower, double higher) {
+    random_state = random_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    double normal = (double)(random_state >> 11) / 9007199254740992.0;
+    return lower + normal * (higher - lower);
+}
+
+
+/**
+ * @brief Generate the scene of the config into the space.
+ *
+ * Returns the side length of the world and sets the actual packing.
+ */
+static double generate(nvSpace *space, Config *config, double *packing) {
+    random_state = 0x9E3779B97F4A7C15ULL;
+
+    size_t n = config->bodies;
+
+    // Pick shapes and sizes first, the extent depends on their total area
+    int *kinds = malloc(sizeof(int) * n);
+    double *sizes = malloc(sizeof(double) * n);
+    int *sides = malloc(sizeof(int) * n);
+    double area = 0.0;
+
+    for (size_t i = 0; i < n; i++) {
+        int kind;
+        switch (config->shapes) {
+            case ShapeMix_CIRCLES: kind = 0; break;
+            case ShapeMix_BOXES: kind = 1; break;
+            case ShapeMix_NGONS: kind = 2; break;
+            default: kind = (int)random_double(0.0, 3.0); if (kind > 2) kind = 2; break;
+        }
+
+        double size = 1.0;
+        if (config->shapes == ShapeMix_MIXED_SIZES) size = pow(2.0, random_double(-2.0, 2.0));
+
+        int n_sides = 5 + (int)random_double(0.0, 4.0);
+
+        kinds[i] = kind;
+        sizes[i] = size;
+        sides[i] = n_sides;
+
+        if (kind == 0) area += NV_PI * size * size / 4.0;
+        else if (kind == 1) area += size * size;
+        else area += (double)n_sides / 2.0 * (size / 2.0) * (size / 2.0) * sin(2.0 * NV_PI / (double)n_sides);
+    }
+
+    double extent = config->extent;
+    if (extent <= 0.0) extent = sqrt(area / config->packing);
+    *packing = area / (extent * extent);
+
+    // Jittered grid, every body stays inside its own cell if it fits
+    size_t cols = (size_t)ceil(sqrt((double)n));
+    double cell = extent / (double)cols;
+
+    nvBody **bodies = malloc(sizeof(nvBody *) * n);
+
+    for (size_t i = 0; i < n; i++) {
+        double size = sizes[i];
+        double jitter = (cell > size) ? (cell - size) / 2.0 : 0.0;
+
+        nvVector2 position = NV_VEC2(
+            ((double)(i % cols) + 0.5) * cell + random_double(-jitter, jitter),
+            ((double)(i / cols) + 0.5) * cell + random_double(-jitter, jitter)
+        );
+
+        nvShape *shape;
+        if (kinds[i] == 0) shape = nvCircleShape_new(size / 2.0);
+        else if (kinds[i] == 1) shape = nvRectShape_new(size, size);
+        else shape = nvNGonShape_new(sides[i], size);
+
+        nvBody *body = nvBody_new(
+            nvBodyType_DYNAMIC,
+            shape,
+            position,
+            random_double(0.0, 2.0 * NV_PI),
+            nvMaterial_WOOD
+        );
+
+        double direction = random_double(0.0, 2.0 * NV_PI);
+        double speed = random_double(0.0, 2.0);
+        body->linear_velocity = NV_VEC2(cos(direction) * speed, sin(direction) * speed);
+
+        nvSpace_add(space, body);
+        bodies[i] = body;
+    }
+
+    if (config->sleeping > 0.0) {
+        nvSpace_enable_sleeping(space);
+
+        for (size_t i = 0; i < n; i++) {
+            if (random_double(0.0, 1.0) < config->sleeping) nvBody_sleep(bodies[i]);
+        }
+    }
+
+    // Join neighbors in the same row, spread evenly over the bodies
+    size_t joints = 0;
+    size_t stride = (config->joints > 0) ? n / config->joints : 0;
+    if (stride == 0) stride = 1;
+
+    for (size_t i = 0; joints < config->joints && i + 1 < n; i += stride) {
+        if ((i + 1) % cols == 0) continue;
+
+        nvBody *a = bodies[i];
+        nvBody *b = bodies[i + 1];
+
+        nvSpace_add_constraint(space, nvDistanceJoint_new(
+            a,
+            b,
+            nvVector2_zero,
+            nvVector2_zero,
+            nvVector2_len(nvVector2_sub(b->position, a->position))
+        ));
+
+        joints++;
+    }
+
+    // Walls keep the bodies in the world
+    double wall = 2.0;
+    nvVector2 wall_positions[4] = {
+        NV_VEC2(extent / 2.0, -wall / 2.0),
+        NV_VEC2(extent / 2.0, extent + wall / 2.0),
+        NV_VEC2(-wall / 2.0, extent / 2.0),
+        NV_VEC2(extent + wall / 2.0, extent / 2.0)
+    };
+
+    for (size_t i = 0; i < 4; i++) {
+        nv_float width = (i < 2) ? extent + 2.0 * wall : wall;
+        nv_float height = (i < 2) ? wall : extent + 2.0 * wall;
+
+        nvSpace_add(space, nvBody_new(
+            nvBodyType_STATIC,
+            nvRectShape_new(width, height),
+            wall_positions[i],
+            0.0,
+            nvMaterial_WOOD
+        ));
+    }
+
+    space->gravity = nvVector2_zero;
+
+    free(bodies);
+    free(kinds);
+    free(sizes);
+    free(sides);
+
+    return extent;
+}
+
+static void set_broadphase(nvSpace *space, Config *config, double extent) {
+    nvSpace_set_broadphase(space, config->broadphase);
+
+    if (config->broadphase == nvBroadPhaseAlg_SHG) {
+        double margin = 4.0;
+        nvAABB bounds = {
+            .min_x = -margin,
+            .min_y = -margin,
+            .max_x = extent + margin,
+            .max_y = extent + margin
+        };
+
+        nvSpace_set_SHG(space, bounds, config->cell_size, config->cell_size);
+    }
+}
+
+static void run_config(
+    Config *config,
+    size_t steps,
+    size_t warmup,
+    size_t threads,
+    Result *result
+) {
+    nvSpace *space = nvSpace_new();
+
+    memset(result, 0, sizeof(Result));
+    result->config = *config;
+    result->extent = generate(space, config, &result->packing);
+
+    set_broadphase(space, config, result->extent);
+
+    if (threads > 1) nvSpace_enable_multithreading(space, threads);
+
+    for (size_t i = 0; i < warmup + steps; i++) {
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+        if (i < warmup) continue;
+
+        result->step += space->profiler.step;
+        result->broadphase += space->profiler.broadphase;
+        result->narrowphase += space->profiler.narrowphase;
+        result->pairs += (double)space->broadphase_pairs->count;
+
+        size_t iter = 0;
+        void *item;
+        while (nvHashMap_iter(space->res, &iter, &item)) {
+            nvResolution *res = (nvResolution *)item;
+            if (res->contact_count > 0) result->contacts += 1.0;
+        }
+    }
+
+    result->step /= (double)steps;
+    result->broadphase /= (double)steps;
+    result->narrowphase /= (double)steps;
+    result->pairs /= (double)steps;
+    result->contacts /= (double)steps;
+
+    nvSpace_free(space);
+}
+
+static void save_scene(Config *config, const char *dir) {
+    nvSpace *space = nvSpace_new();
+
+    double packing;
+    double extent = generate(space, config, &packing);
+    set_broadphase(space, config, extent);
+
+    char path[1024];
+    snprintf(
+        path,
+        sizeof(path),
+        "%s/stress_%lu_%s_p%.2f_e%.0f_s%.2f_j%lu.nvscene",
+        dir,
+        (unsigned long)config->bodies,
+        shape_mix_names[config->shapes],
+        packing,
+        extent,
+        config->sleeping,
+        (unsigned long)config->joints
+    );
+
+    if (!nvScene_save(space, path, 1.0 / 60.0, 8, 4, 4, 1))
+        printf("Couldn't save scene '%s'.\n", path);
+
+    nvSpace_free(space);
+}
+
+
+static char *config_label(Config *config, char *buffer, size_t size) {
+    snprintf(
+        buffer,
+        size,
+        "%s %s%.1f sleep %.2f joints %lu",
+        shape_mix_names[config->shapes],
+        config->extent > 0.0 ? "extent " : "packing ",
+        config->extent > 0.0 ? config->extent : config->packing,
+        config->sleeping,
+        (unsigned long)config->joints
+    );
+    return buffer;
+}
+
+static char *broadphase_label(Config *config, char *buffer, size_t size) {
+    if (config->broadphase == nvBroadPhaseAlg_SHG)
+        snprintf(buffer, size, "shg %.2f", config->cell_size);
+    else
+        snprintf(buffer, size, "%s", broadphase_names[config->broadphase]);
+    return buffer;
+}
+
+static bool same_scene(Config *a, Config *b) {
+    return a->shapes == b->shapes &&
+           a->packing == b->packing &&
+           a->extent == b->extent &&
+           a->sleeping == b->sleeping &&
+           a->joints == b->joints;
+}
+
+static bool same_series(Config *a, Config *b) {
+    return same_scene(a, b) && a->broadphase == b->broadphase && a->cell_size == b->cell_size;
+}
+
+/**
+ * @brief Least squares slope of log(time) over log(bodies).
+ *
+ * 1 is linear scaling, 2 is quadratic.
+ */
+static double scaling_exponent(Result *results, size_t count, size_t first, bool broadphase) {
+    double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    double n = 0.0;
+
+    for (size_t i = first; i < count; i++) {
+        if (!same_series(&results[i].config, &results[first].config)) continue;
+
+        double t = broadphase ? results[i].broadphase : results[i].step;
+        if (t <= 0.0) continue;
+
+        double x = log((double)results[i].config.bodies);
+        double y = log(t);
+        sx += x; sy += y; sxx += x * x; sxy += x * y;
+        n += 1.0;
+    }
+
+    double denominator = n * sxx - sx * sx;
+    if (n < 2.0 || denominator <= 0.0) return 0.0;
+
+    return (n * sxy - sx * sy) / denominator;
+}
+
+
+static void print_results(Result *results, size_t count) {
+    char label[128];
+    char bp_label[32];
+
+    printf(
+        "\n%-7s %-48s %-7s %-10s %-9s %-8s %-8s %-8s %-8s %-10s %-9s\n",
+        "bodies", "scene", "extent", "broadphase", "step ms", "bp ms", "np ms",
+        "us/body", "pairs/b", "contact %", "packing"
+    );
+
+    for (size_t i = 0; i < count; i++) {
+        Result *r = &results[i];
+
+        printf(
+            "%-7lu %-48s %-7.1f %-10s %-9.3f %-8.3f %-8.3f %-8.3f %-8.2f %-10.1f %-9.3f\n",
+            (unsigned long)r->config.bodies,
+            config_label(&r->config, label, sizeof(label)),
+            r->extent,
+            broadphase_label(&r->config, bp_label, sizeof(bp_label)),
+            r->step * 1e3,
+            r->broadphase * 1e3,
+            r->narrowphase * 1e3,
+            r->step * 1e6 / (double)r->config.bodies,
+            r->pairs / (double)r->config.bodies,
+            r->pairs > 0.0 ? r->contacts / r->pairs * 100.0 : 0.0,
+            r->packing
+        );
+    }
+}
+
+static void print_scaling(Result *results, size_t count) {
+    char label[128];
+    char bp_label[32];
+
+    printf("\nScaling over body count (1 is linear, 2 is quadratic):\n");
+    printf("==================================================================\n");
+    printf("%-48s %-10s %-10s %-10s\n", "scene", "broadphase", "step exp", "bp exp");
+
+    for (size_t i = 0; i < count; i++) {
+        // Only the first result of each series reports it
+        bool first = true;
+        for (size_t j = 0; j < i; j++) {
+            if (same_series(&results[j].config, &results[i].config)) first = false;
+        }
+        if (!first) continue;
+
+        double step_exp = scaling_exponent(results, count, i, false);
+        double bp_exp = scaling_exponent(results, count, i, true);
+        if (step_exp == 0.0) continue;
+
+        printf(
+            "%-48s %-10s %-10.2f %-10.2f%s\n",
+            config_label(&results[i].config, label, sizeof(label)),
+            broadphase_label(&results[i].config, bp_label, sizeof(bp_label)),
+            step_exp,
+            bp_exp,
+            bp_exp > 1.5 ? "  <- broad-phase breaks down" : ""
+        );
+    }
+
+    printf("\nBest broad-phase of each scene:\n");
+    printf("==================================================================\n");
+    printf("%-7s %-48s %-10s %-8s %-10s %-8s\n", "bodies", "scene", "best", "bp ms", "worst", "bp ms");
+
+    for (size_t i = 0; i < count; i++) {
+        bool first = true;
+        for (size_t j = 0; j < i; j++) {
+            if (same_scene(&results[j].config, &results[i].config) &&
+                results[j].config.bodies == results[i].config.bodies) first = false;
+        }
+        if (!first) continue;
+
+        Result *best = &results[i];
+        Result *worst = &results[i];
+
+        for (size_t j = i; j < count; j++) {
+            if (!same_scene(&results[j].config, &results[i].config) ||
+                results[j].config.bodies != results[i].config.bodies) continue;
+
+            if (results[j].broadphase < best->broadphase) best = &results[j];
+            if (results[j].broadphase > worst->broadphase) worst = &results[j];
+        }
+
+        char worst_label[32];
+        printf(
+            "%-7lu %-48s %-10s %-8.3f %-10s %-8.3f\n",
+            (unsigned long)results[i].config.bodies,
+            config_label(&results[i].config, label, sizeof(label)),
+            broadphase_label(&best->config, bp_label, sizeof(bp_label)),
+            best->broadphase * 1e3,
+            broadphase_label(&worst->config, worst_label, sizeof(worst_label)),
+            worst->broadphase * 1e3
+        );
+    }
+}
+
+static void write_json(const char *path, Result *results, size_t count, size_t steps, size_t threads) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        printf("Couldn't open '%s' for writing.\n", path);
+        return;
+    }
+
+    fprintf(file, "{\n  \"steps\": %lu,\n  \"threads\": %lu,\n  \"results\": [\n", (unsigned long)steps, (unsigned long)threads);
+
+    for (size_t i = 0; i < count; i++) {
+        Result *r = &results[i];
+
+        fprintf(
+            file,
+            "    {\"bodies\": %lu, \"shapes\": \"%s\", \"packing\": %f, \"extent\": %f, "
+            "\"sleeping\": %f, \"joints\": %lu, \"broadphase\": \"%s\", \"cell_size\": %f, "
+            "\"step_ms\": %f, \"broadphase_ms\": %f, \"narrowphase_ms\": %f, "
+            "\"pairs\": %f, \"contacts\": %f}%s\n",
+            (unsigned long)r->config.bodies,
+            shape_mix_names[r->config.shapes],
+            r->packing,
+            r->extent,
+            r->config.sleeping,
+            (unsigned long)r->config.joints,
+            broadphase_names[r->config.broadphase],
+            r->config.cell_size,
+            r->step * 1e3,
+            r->broadphase * 1e3,
+            r->narrowphase * 1e3,
+            r->pairs,
+            r->contacts,
+            (i + 1 < count) ? "," : ""
+        );
+    }
+
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+
+
+static size_t parse_list(const char *arg, double *values) {
+    size_t count = 0;
+    const char *c = arg;
+
+    while (*c && count < STRESS_MAX_LIST) {
+        char *end;
+        values[count++] = strtod(c, &end);
+        if (end == c) return count - 1;
+        c = (*end == ',') ? end + 1 : end;
+    }
+
+    return count;
+}
+
+static size_t parse_names(const char *arg, const char **names, size_t name_count, int *values) {
+    size_t count = 0;
+    const char *c = arg;
+
+    while (*c && count < STRESS_MAX_LIST) {
+        size_t length = strcspn(c, ",");
+
+        for (size_t i = 0; i < name_count; i++) {
+            if (strlen(names[i]) == length && !strncmp(c, names[i], length)) {
+                values[count++] = (int)i;
+                break;
+            }
+        }
+
+        c += length;
+        if (*c == ',') c++;
+    }
+
+    return count;
+}
+
+
+int main(int argc, char *argv[]) {
+    #ifndef NV_PROFILE
+        printf("Stress benchmark needs the profiler, build without --no-profiler.\n");
+        return 1;
+    #endif
+
+    double bodies[STRESS_MAX_LIST] = {1000, 4000, 16000, 64000};
+    size_t body_count = 4;
+    int shapes[STRESS_MAX_LIST] = {ShapeMix_MIXED, ShapeMix_MIXED_SIZES};
+    size_t shape_count = 2;
+    double packings[STRESS_MAX_LIST] = {0.3};
+    size_t packing_count = 1;
+    double extents[STRESS_MAX_LIST] = {0.0};
+    size_t extent_count = 1;
+    double sleepings[STRESS_MAX_LIST] = {0.0};
+    size_t sleeping_count = 1;
+    double joints[STRESS_MAX_LIST] = {0.0};
+    size_t joint_count = 1;
+    int broadphases[STRESS_MAX_LIST] = {nvBroadPhaseAlg_BRUTE_FORCE, nvBroadPhaseAlg_SHG, nvBroadPhaseAlg_BVH};
+    size_t broadphase_count = 3;
+    double cells[STRESS_MAX_LIST] = {1.75, 3.5, 7.0};
+    size_t cell_count = 3;
+
+    size_t steps = STRESS_STEPS;
+    size_t warmup = STRESS_WARMUP;
+    size_t threads = 1;
+    size_t bf_limit = STRESS_BF_LIMIT;
+    const char *json_path = NULL;
+    const char *save_dir = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if (!strcmp(argv[i], "--bodies") && has_value)
+            body_count = parse_list(argv[++i], bodies);
+        else if (!strcmp(argv[i], "--shapes") && has_value)
+            shape_count = parse_names(argv[++i], shape_mix_names, ShapeMix_COUNT, shapes);
+        else if (!strcmp(argv[i], "--packing") && has_value)
+            packing_count = parse_list(argv[++i], packings);
+        else if (!strcmp(argv[i], "--extent") && has_value)
+            extent_count = parse_list(argv[++i], extents);
+        else if (!strcmp(argv[i], "--sleeping") && has_value)
+            sleeping_count = parse_list(argv[++i], sleepings);
+        else if (!strcmp(argv[i], "--joints") && has_value)
+            joint_count = parse_list(argv[++i], joints);
+        else if (!strcmp(argv[i], "--broadphase") && has_value)
+            broadphase_count = parse_names(argv[++i], broadphase_names, 3, broadphases);
+        else if (!strcmp(argv[i], "--cells") && has_value)
+            cell_count = parse_list(argv[++i], cells);
+        else if (!strcmp(argv[i], "--steps") && has_value)
+            steps = (size_t)strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--warmup") && has_value)
+            warmup = (size_t)strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--threads") && has_value)
+            threads = (size_t)strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--bf-limit") && has_value)
+            bf_limit = (size_t)strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--json") && has_value)
+            json_path = argv[++i];
+        else if (!strcmp(argv[i], "--save-dir") && has_value)
+            save_dir = argv[++i];
+        else {
+            printf(
+                "Usage: %s [--bodies LIST] [--shapes LIST] [--packing LIST] [--extent LIST]\n"
+                "       [--sleeping LIST] [--joints LIST] [--broadphase LIST] [--cells LIST]\n"
+                "       [--steps N] [--warmup N] [--threads N] [--bf-limit N]\n"
+                "       [--json FILE] [--save-dir DIR]\n"
+                "Shapes: circles, boxes, ngons, mixed, mixed-sizes\n"
+                "Broad-phases: bf, shg, bvh\n",
+                argv[0]
+            );
+            return 1;
+        }
+    }
+
+    if (steps == 0) steps = STRESS_STEPS;
+
+    // Extents given on the command line replace packing
+    bool use_extent = false;
+    for (size_t i = 0; i < extent_count; i++) {
+        if (extents[i] > 0.0) use_extent = true;
+    }
+    if (use_extent) packing_count = 1;
+    else extent_count = 1;
+
+    for (size_t i = 0; i < body_count; i++) {
+        if (bodies[i] > STRESS_MAX_BODIES) {
+            printf("%.0f bodies is over the limit of 16-bit body IDs, using %d.\n", bodies[i], STRESS_MAX_BODIES);
+            bodies[i] = STRESS_MAX_BODIES;
+        }
+        if (bodies[i] < 1) bodies[i] = 1;
+    }
+
+    printf(
+        "Nova Physics broad-phase stress benchmark\n"
+        "Nova version: %d.%d.%d\n"
+        "Compiled with %s\n"
+        "Platform: %s\n"
+        "Threads: %lu\n"
+        "Steps: %lu (+%lu warmup)\n",
+        NV_VERSION_MAJOR, NV_VERSION_MINOR, NV_VERSION_PATCH,
+        BENCHMARK_COMPILER_STR,
+        BENCHMARK_PLATFORM_STR,
+        (unsigned long)threads,
+        (unsigned long)steps,
+        (unsigned long)warmup
+    );
+
+    size_t max_results = body_count * shape_count * packing_count * extent_count *
+                         sleeping_count * joint_count * broadphase_count * cell_count;
+    Result *results = malloc(sizeof(Result) * (max_results ? max_results : 1));
+    size_t result_count = 0;
+
+    // Body count is the innermost scene parameter so series are next to each other
+    for (size_t sh = 0; sh < shape_count; sh++)
+    for (size_t pk = 0; pk < packing_count; pk++)
+    for (size_t ex = 0; ex < extent_count; ex++)
+    for (size_t sl = 0; sl < sleeping_count; sl++)
+    for (size_t jo = 0; jo < joint_count; jo++)
+    for (size_t bp = 0; bp < broadphase_count; bp++)
+    for (size_t ce = 0; ce < cell_count; ce++)
+    for (size_t bo = 0; bo < body_count; bo++) {
+        Config config = {
+            .bodies = (size_t)bodies[bo],
+            .shapes = (ShapeMix)shapes[sh],
+            .packing = packings[pk],
+            .extent = use_extent ? extents[ex] : 0.0,
+            .sleeping = sleepings[sl],
+            .joints = (size_t)joints[jo],
+            .broadphase = (nvBroadPhaseAlg)broadphases[bp],
+            .cell_size = (broadphases[bp] == nvBroadPhaseAlg_SHG) ? cells[ce] : 0.0
+        };
+
+        // Cell sizes only matter for SHG
+        if (config.broadphase != nvBroadPhaseAlg_SHG && ce > 0) continue;
+        if (config.broadphase == nvBroadPhaseAlg_BRUTE_FORCE && config.bodies > bf_limit) continue;
+        if (!use_extent && config.packing <= 0.0) continue;
+
+        char label[128];
+        char bp_label[32];
+        printf(
+            "Running %lu bodies, %s, %s...\n\033[1A",
+            (unsigned long)config.bodies,
+            config_label(&config, label, sizeof(label)),
+            broadphase_label(&config, bp_label, sizeof(bp_label))
+        );
+        fflush(stdout);
+
+        run_config(&config, steps, warmup, threads, &results[result_count++]);
+
+        // Scenes are saved once, with the first broad-phase they are run with
+        if (save_dir && bp == 0 && ce == 0) save_scene(&config, save_dir);
+    }
+
+    printf("\033[2K");
+
+    print_results(results, result_count);
+    print_scaling(results, result_count);
+
+    if (json_path) write_json(json_path, results, result_count, steps, threads);
+
+    free(results);
+
+    return 0;
+}
\ No newline at end of file
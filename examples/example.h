@@ -2745,45 +2745,20 @@ void draw_SHG(Example *example, TTF_Font *font) {
         for (size_t i = 0; i < example->space->bodies->size; i++) {
             nvBody *body = example->space->bodies->data[i];
             if (body->type == nvBodyType_STATIC) continue;
-            nvAABB aabb = nvBody_get_aabb(body);
             nvVector2 p = world_to_screen(example, body->position);
 
-            for (size_t j = 0; j < example->space->thread_count; j++) {
-
-                nv_float s = (nv_float)j / (nv_float)example->space->thread_count * 256.0;
-                SDL_Color color = hsv_to_rgb((SDL_Color){(nv_uint8)s, 255, 255});
-                SDL_SetRenderDrawColor(example->renderer, color.r, color.g, color.b, 255);
-
-                if (j == 0) {
-                    if (
-                        aabb.max_x >= dyn_aabb.min_x &&
-                        body->position.x <= q + dyn_aabb.min_x
-                    ) {
-                        draw_circle(example->renderer, p.x, p.y, 0.2 * example->zoom);
-                        break;
-                    }
-                }
+            size_t bin = nvBroadPhase_SHG_bin(
+                body->position.x,
+                dyn_aabb.min_x,
+                dyn_aabb.max_x,
+                example->space->thread_count
+            );
 
-                else if (j == (example->space->thread_count - 1)) {
-                    if (
-                        aabb.min_x <= dyn_aabb.max_x &&
-                        body->position.x > q * (nv_float)(example->space->thread_count - 1) + dyn_aabb.min_x
-                    ) {
-                        draw_circle(example->renderer, p.x, p.y, 0.2 * example->zoom);
-                        break;
-                    }
-                }
+            nv_float s = (nv_float)bin / (nv_float)example->space->thread_count * 256.0;
+            SDL_Color color = hsv_to_rgb((SDL_Color){(nv_uint8)s, 255, 255});
+            SDL_SetRenderDrawColor(example->renderer, color.r, color.g, color.b, 255);
 
-                else {
-                    if (
-                        body->position.x > q * (nv_float)(j) + dyn_aabb.min_x &&
-                        body->position.x <= q * (nv_float)(j + 1) + dyn_aabb.min_x
-                    ) {
-                        draw_circle(example->renderer, p.x, p.y, 0.2 * example->zoom);
-                        break;
-                    }
-                }
-            }
+            draw_circle(example->renderer, p.x, p.y, 0.2 * example->zoom);
         }
 
         for (size_t j = 0; j < example->space->thread_count; j++) {
@@ -3720,8 +3695,7 @@ void Example_run(Example *example) {
 
         example->camera = nvVector2_add(example->camera, nvVector2_sub(example->mouse.before_zoom, example->mouse.after_zoom));
 
-        mouse_body->position = example->mouse.before_zoom;
-        mouse_body->_cache_aabb = false;
+        nvBody_set_position(mouse_body, example->mouse.before_zoom);
 
         // Call example callback if there is one
         if (!frame_by_frame || (frame_by_frame && next_frame)) {
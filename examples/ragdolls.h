@@ -22,6 +22,8 @@ void create_ragdoll(nvSpace *space, nvVector2 position, nv_float scale, nv_uint3
     nvSpace_add(space, torso);
     torso->collision_group = group;
 
+    nvArticulation *ragdoll = nvArticulation_new(torso);
+
     nvBody *head = nvBody_new(
         nvBodyType_DYNAMIC,
         nvCircleShape_new(1.0 * scale),
@@ -32,12 +34,8 @@ void create_ragdoll(nvSpace *space, nvVector2 position, nv_float scale, nv_uint3
     nvSpace_add(space, head);
     head->collision_group = group;
 
-    nvConstraint *head_link = nvHingeJoint_new(torso, head, NV_VEC2(position.x, position.y - 2.0 * scale));
-    nvHingeJoint *head_link_def = (nvHingeJoint *)head_link->def;
-    nvSpace_add_constraint(space, head_link);
-    head_link_def->enable_limits = true;
-    head_link_def->lower_limit = -NV_PI / 4.0;
-    head_link_def->upper_limit = NV_PI / 4.0;
+    nvArticulation_add_link(ragdoll, torso, head, NV_VEC2(position.x, position.y - 2.0 * scale));
+    nvArticulation_set_limits(ragdoll, ragdoll->count - 1, -NV_PI / 4.0, NV_PI / 4.0);
 
     nvBody *larm1 = nvBody_new(
         nvBodyType_DYNAMIC,
@@ -49,12 +47,8 @@ void create_ragdoll(nvSpace *space, nvVector2 position, nv_float scale, nv_uint3
     nvSpace_add(space, larm1);
     larm1->collision_group = group;
 
-    nvConstraint *larm1_link = nvHingeJoint_new(torso, larm1, NV_VEC2(position.x - 1.5 * scale, position.y - 2.0 * scale + 0.5 * scale));
-    nvHingeJoint *larm1_link_def = (nvHingeJoint *)larm1_link->def;
-    nvSpace_add_constraint(space, larm1_link);
-    larm1_link_def->enable_limits = true;
-    larm1_link_def->lower_limit = -NV_PI / 2.0;
-    larm1_link_def->upper_limit = NV_PI / 2.0;
+    nvArticulation_add_link(ragdoll, torso, larm1, NV_VEC2(position.x - 1.5 * scale, position.y - 2.0 * scale + 0.5 * scale));
+    nvArticulation_set_limits(ragdoll, ragdoll->count - 1, -NV_PI / 2.0, NV_PI / 2.0);
 
     nvBody *larm2 = nvBody_new(
         nvBodyType_DYNAMIC,
@@ -66,12 +60,8 @@ void create_ragdoll(nvSpace *space, nvVector2 position, nv_float scale, nv_uint3
     nvSpace_add(space, larm2);
     larm2->collision_group = group;
 
-    nvConstraint *larm2_link = nvHingeJoint_new(larm1, larm2, NV_VEC2(position.x - 1.5 * scale - 2.0 * scale, position.y - 2.0 * scale + 0.5 * scale));
-    nvHingeJoint *larm2_link_def = (nvHingeJoint *)larm2_link->def;
-    nvSpace_add_constraint(space, larm2_link);
-    larm2_link_def->enable_limits = true;
-    larm2_link_def->lower_limit = -NV_PI / 2.0;
-    larm2_link_def->upper_limit = NV_PI / 2.0;
+    nvArticulation_add_link(ragdoll, larm1, larm2, NV_VEC2(position.x - 1.5 * scale - 2.0 * scale, position.y - 2.0 * scale + 0.5 * scale));
+    nvArticulation_set_limits(ragdoll, ragdoll->count - 1, -NV_PI / 2.0, NV_PI / 2.0);
 
     nvBody *rarm1 = nvBody_new(
         nvBodyType_DYNAMIC,
@@ -83,12 +73,8 @@ void create_ragdoll(nvSpace *space, nvVector2 position, nv_float scale, nv_uint3
     nvSpace_add(space, rarm1);
     rarm1->collision_group = group;
 
-    nvConstraint *rarm1_link = nvHingeJoint_new(torso, rarm1, NV_VEC2(position.x + 1.5 * scale, position.y - 2.0 * scale + 0.5 * scale));
-    nvHingeJoint *rarm1_link_def = (nvHingeJoint *)rarm1_link->def;
-    nvSpace_add_constraint(space, rarm1_link);
-    rarm1_link_def->enable_limits = true;
-    rarm1_link_def->lower_limit = -NV_PI / 2.0;
-    rarm1_link_def->upper_limit = NV_PI / 2.0;
+    nvArticulation_add_link(ragdoll, torso, rarm1, NV_VEC2(position.x + 1.5 * scale, position.y - 2.0 * scale + 0.5 * scale));
+    nvArticulation_set_limits(ragdoll, ragdoll->count - 1, -NV_PI / 2.0, NV_PI / 2.0);
 
     nvBody *rarm2 = nvBody_new(
         nvBodyType_DYNAMIC,
@@ -100,12 +86,8 @@ void create_ragdoll(nvSpace *space, nvVector2 position, nv_float scale, nv_uint3
     nvSpace_add(space, rarm2);
     rarm2->collision_group = group;
 
-    nvConstraint *rarm2_link = nvHingeJoint_new(rarm1, rarm2, NV_VEC2(position.x + 1.5 * scale + 2.0 * scale, position.y - 2.0 * scale + 0.5 * scale));
-    nvHingeJoint *rarm2_link_def = (nvHingeJoint *)rarm2_link->def;
-    nvSpace_add_constraint(space, rarm2_link);
-    rarm2_link_def->enable_limits = true;
-    rarm2_link_def->lower_limit = -NV_PI / 2.0;
-    rarm2_link_def->upper_limit = NV_PI / 2.0;
+    nvArticulation_add_link(ragdoll, rarm1, rarm2, NV_VEC2(position.x + 1.5 * scale + 2.0 * scale, position.y - 2.0 * scale + 0.5 * scale));
+    nvArticulation_set_limits(ragdoll, ragdoll->count - 1, -NV_PI / 2.0, NV_PI / 2.0);
 
     nvBody *lleg1 = nvBody_new(
         nvBodyType_DYNAMIC,
@@ -117,12 +99,8 @@ void create_ragdoll(nvSpace *space, nvVector2 position, nv_float scale, nv_uint3
     nvSpace_add(space, lleg1);
     lleg1->collision_group = group;
 
-    nvConstraint *lleg1_link = nvHingeJoint_new(torso, lleg1, NV_VEC2(position.x - 1.5 * scale + 0.5 * scale, position.y + 2.0 * scale));
-    nvHingeJoint *lleg1_link_def = (nvHingeJoint *)lleg1_link->def;
-    nvSpace_add_constraint(space, lleg1_link);
-    lleg1_link_def->enable_limits = true;
-    lleg1_link_def->lower_limit = -NV_PI / 2.0 + 0.3;
-    lleg1_link_def->upper_limit = NV_PI / 2.0 - 0.3;
+    nvArticulation_add_link(ragdoll, torso, lleg1, NV_VEC2(position.x - 1.5 * scale + 0.5 * scale, position.y + 2.0 * scale));
+    nvArticulation_set_limits(ragdoll, ragdoll->count - 1, -NV_PI / 2.0 + 0.3, NV_PI / 2.0 - 0.3);
 
     nvBody *lleg2 = nvBody_new(
         nvBodyType_DYNAMIC,
@@ -134,12 +112,8 @@ void create_ragdoll(nvSpace *space, nvVector2 position, nv_float scale, nv_uint3
     nvSpace_add(space, lleg2);
     lleg2->collision_group = group;
 
-    nvConstraint *lleg2_link = nvHingeJoint_new(lleg1, lleg2, NV_VEC2(position.x - 1.5 * scale + 0.5 * scale, position.y + 2.0 * scale + 2.0 * scale));
-    nvHingeJoint *lleg2_link_def = (nvHingeJoint *)lleg2_link->def;
-    nvSpace_add_constraint(space, lleg2_link);
-    lleg2_link_def->enable_limits = true;
-    lleg2_link_def->lower_limit = -NV_PI / 2.0 + 0.0;
-    lleg2_link_def->upper_limit = 0.0;
+    nvArticulation_add_link(ragdoll, lleg1, lleg2, NV_VEC2(position.x - 1.5 * scale + 0.5 * scale, position.y + 2.0 * scale + 2.0 * scale));
+    nvArticulation_set_limits(ragdoll, ragdoll->count - 1, -NV_PI / 2.0 + 0.0, 0.0);
 
     nvBody *rleg1 = nvBody_new(
         nvBodyType_DYNAMIC,
@@ -151,12 +125,8 @@ void create_ragdoll(nvSpace *space, nvVector2 position, nv_float scale, nv_uint3
     nvSpace_add(space, rleg1);
     rleg1->collision_group = group;
 
-    nvConstraint *rleg1_link = nvHingeJoint_new(torso, rleg1, NV_VEC2(position.x + 1.5 * scale - 0.5 * scale, position.y + 2.0 * scale));
-    nvHingeJoint *rleg1_link_def = (nvHingeJoint *)rleg1_link->def;
-    nvSpace_add_constraint(space, rleg1_link);
-    rleg1_link_def->enable_limits = true;
-    rleg1_link_def->lower_limit = -NV_PI / 2.0 + 0.3;
-    rleg1_link_def->upper_limit = NV_PI / 2.0 - 0.3;
+    nvArticulation_add_link(ragdoll, torso, rleg1, NV_VEC2(position.x + 1.5 * scale - 0.5 * scale, position.y + 2.0 * scale));
+    nvArticulation_set_limits(ragdoll, ragdoll->count - 1, -NV_PI / 2.0 + 0.3, NV_PI / 2.0 - 0.3);
 
     nvBody *rleg2 = nvBody_new(
         nvBodyType_DYNAMIC,
@@ -168,12 +138,10 @@ void create_ragdoll(nvSpace *space, nvVector2 position, nv_float scale, nv_uint3
     nvSpace_add(space, rleg2);
     rleg2->collision_group = group;
 
-    nvConstraint *rleg2_link = nvHingeJoint_new(rleg1, rleg2, NV_VEC2(position.x + 1.5 * scale - 0.5 * scale, position.y + 2.0 * scale + 2.0 * scale));
-    nvHingeJoint *rleg2_link_def = (nvHingeJoint *)rleg2_link->def;
-    nvSpace_add_constraint(space, rleg2_link);
-    rleg2_link_def->enable_limits = true;
-    rleg2_link_def->lower_limit = 0.0;
-    rleg2_link_def->upper_limit = NV_PI / 2.0 - 0.3;
+    nvArticulation_add_link(ragdoll, rleg1, rleg2, NV_VEC2(position.x + 1.5 * scale - 0.5 * scale, position.y + 2.0 * scale + 2.0 * scale));
+    nvArticulation_set_limits(ragdoll, ragdoll->count - 1, 0.0, NV_PI / 2.0 - 0.3);
+
+    nvSpace_add_articulation(space, ragdoll);
 }
 
 
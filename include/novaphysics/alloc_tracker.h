@@ -0,0 +1,77 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_ALLOC_TRACKER_H
+#define NOVAPHYSICS_ALLOC_TRACKER_H
+
+#include "novaphysics/internal.h"
+
+
+/**
+ * @file alloc_tracker.h
+ *
+ * @brief Allocation statistics of allocation-tracking builds.
+ *
+ * When the library is built with NV_TRACK_ALLOCATIONS, every allocation it
+ * makes goes through the tracker and is attributed to a subsystem, see
+ * @ref nvAllocCategory. Live allocations are kept in a side table, so
+ * pointers allocated by the library can still be freed with free() by the
+ * application and vice versa, they just go out of the statistics.
+ *
+ * Allocations made while stepping asynchronously and from the application at
+ * the same time can be attributed to the wrong category.
+ *
+ * In other builds the tracker is disabled and all statistics are zero.
+ */
+
+
+/**
+ * @brief Allocation statistics of one category.
+ */
+typedef struct {
+    size_t current; /**< Bytes currently allocated. */
+    size_t peak; /**< Highest number of bytes allocated at once since the last peak reset. */
+    nv_uint64 allocated; /**< Total bytes requested, reallocations count with their new size. */
+    nv_uint64 allocations; /**< Number of allocations and reallocations. */
+    nv_uint64 frees; /**< Number of frees. */
+} nvAllocStats;
+
+/**
+ * @brief Is the library built with allocation tracking?
+ *
+ * @return bool
+ */
+bool nvAllocTracker_is_enabled();
+
+/**
+ * @brief Get statistics of one category.
+ *
+ * Pass nvAllocCategory_COUNT to get the statistics of all categories combined.
+ *
+ * @param category Category
+ * @return nvAllocStats
+ */
+nvAllocStats nvAllocTracker_get(nvAllocCategory category);
+
+/**
+ * @brief Set peaks of all categories to their current values.
+ */
+void nvAllocTracker_reset_peaks();
+
+/**
+ * @brief Get the name of a category.
+ *
+ * @param category Category
+ * @return const char *
+ */
+const char *nvAllocCategory_name(nvAllocCategory category);
+
+
+#endif
\ No newline at end of file
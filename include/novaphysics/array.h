@@ -61,6 +61,16 @@ void nvArray_free_each(nvArray *array, void (free_func)(void *));
  */
 void nvArray_add(nvArray *array, void *elem);
 
+/**
+ * @brief Grow the array's capacity to at least the given number of elements.
+ * 
+ * Use this before adding many elements at once to avoid reallocating on every add.
+ * 
+ * @param array Array
+ * @param capacity Number of elements to make room for
+ */
+void nvArray_reserve(nvArray *array, size_t capacity);
+
 /**
  * @brief Remove element by index from array and return the element. Returns `NULL` if failed.
  * 
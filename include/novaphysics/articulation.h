@@ -0,0 +1,225 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_ARTICULATION_H
+#define NOVAPHYSICS_ARTICULATION_H
+
+#include "novaphysics/internal.h"
+#include "novaphysics/body.h"
+#include "novaphysics/vector.h"
+
+
+/**
+ * @file articulation.h
+ *
+ * @brief Articulated bodies solved in reduced coordinates.
+ */
+
+
+/**
+ * @brief 2D spatial vector.
+ *
+ * A motion (angular velocity and linear velocity) or a force (torque and
+ * linear force), both measured at the articulation's reference point.
+ */
+typedef struct {
+    nv_float w; /**< Angular component. */
+    nv_float x; /**< X component of the linear part. */
+    nv_float y; /**< Y component of the linear part. */
+} nvSpatialVector;
+
+/**
+ * @brief Symmetric 3x3 spatial inertia, rows and columns in the order of the spatial vector components.
+ */
+typedef struct {
+    nv_float ww;
+    nv_float wx;
+    nv_float wy;
+    nv_float xx;
+    nv_float xy;
+    nv_float yy;
+} nvSpatialInertia;
+
+
+/**
+ * @brief Link of an articulation.
+ *
+ * Every link except the root is connected to its parent with a hinge at the
+ * anchor. Joint angles follow the same convention as @ref nvHingeJoint, so
+ * limits of hinge joints can be used as they are.
+ */
+typedef struct {
+    nvBody *body; /**< Body of the link. */
+    size_t parent; /**< Index of the parent link. The root link is its own parent. */
+
+    nvVector2 parent_anchor; /**< Joint position local to the parent body. */
+    nvVector2 anchor; /**< Joint position local to the link's body. */
+    nv_float reference_angle; /**< Angle of the body relative to its parent when they were linked. */
+
+    nv_float angle; /**< Joint angle relative to the reference angle. */
+    nv_float speed; /**< Angular velocity of the joint. */
+
+    bool enable_limits; /**< Enable angular limits or not. */
+    nv_float lower_limit; /**< Lower angle limit. */
+    nv_float upper_limit; /**< Upper angle limit. */
+
+    nvVector2 _r; /**< Internal center of mass relative to the reference point. */
+    nvVector2 _axis; /**< Internal linear part of the joint's motion, the angular part is 1. */
+    nvSpatialInertia _inertia; /**< Internal spatial inertia of the body. */
+    nvSpatialInertia _articulated; /**< Internal articulated inertia of the subtree. */
+    nvSpatialVector _u; /**< Internal articulated inertia times the joint motion. */
+    nv_float _inv_d; /**< Internal inverse of the joint's articulated inertia, 0 if the joint can't move. */
+    nv_float _limit_mass; /**< Internal effective mass of the joint for joint impulses. */
+    nv_float _lower_impulse; /**< Internal accumulated lower limit impulse. */
+    nv_float _upper_impulse; /**< Internal accumulated upper limit impulse. */
+
+    nvSpatialVector _velocity; /**< Internal spatial velocity of the body the articulation expects. */
+    nvSpatialVector _coriolis; /**< Internal velocity-product acceleration of the joint. */
+    nvSpatialVector _force; /**< Internal bias force or impulse of the subtree, propagated to the parent. */
+    nv_float _torque; /**< Internal joint torque or impulse minus what the subtree takes. */
+    nvSpatialVector _delta; /**< Internal acceleration or velocity change of the body from the propagated forces. */
+    nv_float _delta_speed; /**< Internal acceleration or velocity change of the joint from the propagated forces. */
+
+    nvVector2 _linear_velocity; /**< Internal linear velocity the body was given. */
+    nv_float _angular_velocity; /**< Internal angular velocity the body was given. */
+    nvVector2 _position; /**< Internal position the body was given. */
+    nv_float _angle; /**< Internal angle the body was given. */
+} nvArticulationLink;
+
+
+/**
+ * @brief Articulation struct.
+ *
+ * An articulation is a tree of bodies connected with hinges that is solved in
+ * reduced (joint) coordinates with the articulated body algorithm. Joints are
+ * exact: the bodies are placed from the joint angles every substep, so they
+ * never drift apart, no matter how long the chain is or how few iterations
+ * are used.
+ *
+ * Link bodies are regular bodies in the space. They collide, sleep and are
+ * queried like any other body and they can be used in constraints. Contact
+ * and constraint impulses applied to them are turned into joint impulses after
+ * every solver iteration. Links of the same articulation aren't kept from
+ * colliding with each other, use the bodies' collision groups for that.
+ *
+ * Bodies have to be added to the space on their own. Removing or killing one
+ * of them leaves the articulation empty and its remaining bodies are simulated
+ * on their own. Links should be in the same simulation tier as the root.
+ */
+typedef struct nvArticulation {
+    struct nvSpace *space; /**< Space instance the articulation is in. */
+
+    nvArticulationLink *links; /**< Links, parents always come before their children. */
+    size_t count; /**< Number of links. */
+    size_t capacity; /**< Allocated number of links. */
+
+    nvSpatialInertia _root_inverse; /**< Internal inverse articulated inertia of the root, 0 if the root is static. */
+    nv_float _dt; /**< Internal time step size of the substep. */
+    bool _active; /**< Internal flag reporting if the articulation is simulated in the substep. */
+} nvArticulation;
+
+/**
+ * @brief Create a new articulation.
+ *
+ * The root body can be static to attach the articulation to the world.
+ * Returns NULL if the articulation couldn't be allocated.
+ *
+ * @param root Root body
+ * @return nvArticulation *
+ */
+nvArticulation *nvArticulation_new(nvBody *root);
+
+/**
+ * @brief Free articulation.
+ *
+ * Link bodies are owned by the space, they are not freed.
+ *
+ * @param art Articulation
+ */
+void nvArticulation_free(void *art);
+
+/**
+ * @brief Add a link.
+ *
+ * The body is connected to a body that is already in the articulation with a
+ * hinge at the given world position. The new link's index is the link count
+ * before adding. Returns false if the link couldn't be allocated.
+ *
+ * @param art Articulation
+ * @param parent Parent body
+ * @param body Dynamic body to add
+ * @param anchor Joint position in world space
+ * @return bool
+ */
+bool nvArticulation_add_link(
+    nvArticulation *art,
+    nvBody *parent,
+    nvBody *body,
+    nvVector2 anchor
+);
+
+/**
+ * @brief Enable angular limits of a joint.
+ *
+ * @param art Articulation
+ * @param link Index of the link, not the root
+ * @param lower Lower angle limit
+ * @param upper Upper angle limit
+ */
+void nvArticulation_set_limits(
+    nvArticulation *art,
+    size_t link,
+    nv_float lower,
+    nv_float upper
+);
+
+/**
+ * Solve the forward dynamics of the substep. Gravity, forces and any velocity
+ * changes applied to the bodies since the last substep are turned into joint
+ * accelerations, then the bodies are given the resulting velocities.
+ */
+void _nvArticulation_integrate_accelerations(struct nvSpace *space, nvArticulation *art, nv_float dt);
+
+/**
+ * Turn the velocity changes contacts and constraints applied to the bodies
+ * into joint impulses and solve the joint limits. Called after every solver
+ * iteration.
+ */
+void _nvArticulation_solve_velocities(nvArticulation *art);
+
+/**
+ * Integrate joint angles and place the bodies from them.
+ */
+void _nvArticulation_integrate_velocities(nvArticulation *art);
+
+/**
+ * Turn the position corrections applied to the bodies into joint
+ * displacements and place the bodies again.
+ */
+void _nvArticulation_solve_positions(nvArticulation *art);
+
+/**
+ * Wake all links if one of them is awake. Returns true if any link was woken.
+ */
+bool _nvArticulation_wake(nvArticulation *art);
+
+/**
+ * Sleep all links once all of them have been resting for long enough.
+ */
+void _nvArticulation_rest(nvArticulation *art, unsigned int timer_threshold);
+
+/**
+ * Leave the articulation without links, called when one of its bodies leaves
+ * the space.
+ */
+void _nvArticulation_detach(nvArticulation *art);
+
+
+#endif
\ No newline at end of file
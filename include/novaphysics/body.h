@@ -21,6 +21,7 @@
 #include "novaphysics/math.h"
 #include "novaphysics/matrix.h"
 #include "novaphysics/shape.h"
+#include "novaphysics/shg.h"
 
 
 /**
@@ -97,14 +98,28 @@ typedef struct {
     bool is_sleeping; /**< Flag reporting if the body is sleeping. */
     unsigned int sleep_timer; /**< Internal sleep counter of the body. */
 
+    nv_uint8 sim_tier; /**< Simulation rate tier of the body, it is simulated once every 2^tier steps.
+                            0 (full rate) by default. See @ref nvBody_set_sim_tier. */
+    nv_uint32 _sim_steps; /**< Internal number of steps the body hasn't been simulated for yet. */
+    bool _sim_active; /**< Internal flag reporting if the body is simulated in the current step. */
+
     bool is_attractor; /**< Flag reporting if the body is an attractor. */
 
+    struct nvArticulation *articulation; /**< Articulation the body is a link of, NULL if it isn't. */
+
     bool enable_collision; /**< Whether to collide this body with other bodies or not. */
     nv_uint32 collision_group; /**< Collision group of the body.
                                     Bodies that share the same non-zero group do not collide. */
     nv_uint32 collision_category; /**< Bitmask defining this body's collision category. */
     nv_uint32 collision_mask; /**< Bitmask defining this body's collision mask. */
 
+    bool _shg_placed; /**< Internal flag reporting if the body is in the SHG's cells of moving bodies. */
+    bool _shg_parked; /**< Internal flag reporting if the body is parked in the SHG's cells of resting bodies. */
+    nvSHGRange _shg_range; /**< Internal range of SHG cells the body is in. */
+    bool _shg_dirty; /**< Internal flag reporting if the body is waiting to be placed again in the SHG. */
+
+    nvVector2 _cache_position; /**< Internal position the caches were computed at. */
+    nv_float _cache_angle; /**< Internal angle the caches were computed at. */
     bool _cache_aabb; /** Internal flag reporting whether to cache AABB or not. */
     bool _cache_transform; /** Internal flag reporting whether to cache vertices or not. */
     nvAABB _cached_aabb; /** Internal cached AABB. */
@@ -245,6 +260,20 @@ void nvBody_sleep(nvBody *body);
  */
 void nvBody_awake(nvBody *body);
 
+/**
+ * @brief Set simulation rate tier of the body.
+ * 
+ * Bodies in tier N are simulated once every 2^N steps of the space with the
+ * time they missed, so distant bodies can be stepped at a fraction of the
+ * full rate. Bodies in contact or joined with a body simulated in the step are
+ * pulled into the step with it, so pairs across tiers are always solved
+ * together.
+ * 
+ * @param body Body
+ * @param tier Tier, between 0 (full rate) and NV_SIM_TIERS - 1
+ */
+void nvBody_set_sim_tier(nvBody *body, nv_uint8 tier);
+
 /**
  * @brief Get AABB (Axis-Aligned Bounding Box) of the body.
  * 
@@ -285,6 +314,58 @@ void nvBody_set_is_attractor(nvBody *body, bool is_attractor);
  */
 bool nvBody_get_is_attractor(nvBody *body);
 
+/**
+ * @brief Place a parked body in the SHG again at the next broad-phase.
+ * 
+ * Parked bodies are skipped by the broad-phase until they wake up or move,
+ * this is called internally whenever that happens.
+ * 
+ * @param body Body
+ */
+void _nvBody_mark_moved(nvBody *body);
+
+/**
+ * @brief Set position of the body.
+ * 
+ * Unlike writing the field directly, this is seen by the space's recorder
+ * and by the broad-phase if the body is static or sleeping.
+ * 
+ * @param body Body
+ * @param position Position
+ */
+void nvBody_set_position(nvBody *body, nvVector2 position);
+
+/**
+ * @brief Set rotation of the body.
+ * 
+ * Unlike writing the field directly, this is seen by the space's recorder
+ * and by the broad-phase if the body is static or sleeping.
+ * 
+ * @param body Body
+ * @param angle Angle in radians
+ */
+void nvBody_set_angle(nvBody *body, nv_float angle);
+
+/**
+ * @brief Set linear velocity of the body.
+ * 
+ * Unlike writing the field directly, this is seen by the space's recorder.
+ * 
+ * @param body Body
+ * @param velocity Linear velocity
+ */
+void nvBody_set_linear_velocity(nvBody *body, nvVector2 velocity);
+
+/**
+ * @brief Set angular velocity of the body.
+ * 
+ * Unlike writing the field directly, this is seen by the space's recorder.
+ * 
+ * @param body Body
+ * @param velocity Angular velocity in radians/s
+ */
+void nvBody_set_angular_velocity(nvBody *body, nv_float velocity);
+
 /**
  * @brief Transform body's polygon shape's vertices from local space to world space.
  * 
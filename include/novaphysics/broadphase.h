@@ -61,6 +61,32 @@ void nvBroadPhase_SHG(struct nvSpace *space);
  */
 void nvBroadPhase_SHG_parallel(struct nvSpace *space);
 
+/**
+ * @brief Get the bin a body is assigned to in the multi-threaded SHG algorithm.
+ * 
+ * The range [min_x, max_x] is split into equal bins on the X axis and the
+ * index is clamped, so every body belongs to exactly one bin regardless of
+ * the bin count.
+ * 
+ * @param x X coordinate of the body
+ * @param min_x Start of the range
+ * @param max_x End of the range
+ * @param bin_count Number of bins
+ * @return size_t
+ */
+size_t nvBroadPhase_SHG_bin(nv_float x, nv_float min_x, nv_float max_x, size_t bin_count);
+
+/**
+ * @brief Measure how many cells the awake bodies moved out of the ranges the
+ *        SHG placed them in.
+ * 
+ * The space calls this after bodies are moved in a substep, AABB queries read
+ * that many more cells around their ranges.
+ * 
+ * @param space Space
+ */
+void nvBroadPhase_SHG_measure_drift(struct nvSpace *space);
+
 /**
  * @brief BVH tree algorithm.
  * 
@@ -68,6 +94,24 @@ void nvBroadPhase_SHG_parallel(struct nvSpace *space);
  */
 void nvBroadPhase_BVH(struct nvSpace *space);
 
+/**
+ * @brief Find the bodies whose AABB overlaps an AABB.
+ * 
+ * With SHG, only the cells the last broad-phase placed bodies into are read.
+ * The AABB is widened by the cells the bodies drifted out of their ranges in
+ * the last step, so bodies are found however far they moved since the
+ * broad-phase. Bodies moved by the user between steps are found after the
+ * next step. BVH trees don't outlive the broad-phase, so other algorithms
+ * test every body.
+ * 
+ * Found bodies are appended to the output in ID order.
+ * 
+ * @param space Space
+ * @param aabb AABB to query
+ * @param output Array the bodies are appended to
+ */
+void nvBroadPhase_query_aabb(struct nvSpace *space, nvAABB aabb, nvArray *output);
+
 /**
  * @brief Multi-hreaded BVH tree algorithm.
  * 
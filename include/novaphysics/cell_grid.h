@@ -0,0 +1,174 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_CELL_GRID_H
+#define NOVAPHYSICS_CELL_GRID_H
+
+#include "novaphysics/internal.h"
+#include "novaphysics/aabb.h"
+
+
+/**
+ * @file cell_grid.h
+ *
+ * @brief Uniform grid of points sorted by cells, shared by particles and soft bodies.
+ */
+
+
+/*
+    Grid cells are laid out in rows covering the points if there are less
+    than this many cells per point, otherwise the cells are hashed.
+*/
+#define NV_CELL_GRID_DENSE_CELLS 8
+
+// Hashing multipliers of the grid cell coordinates
+#define NV_CELL_GRID_HASH_X 73856093u
+#define NV_CELL_GRID_HASH_Y 19349663u
+
+
+/**
+ * @brief Uniform grid of points sorted by cells with a counting sort.
+ *
+ * Cells are laid out in rows when the points are packed and hashed when they
+ * are spread out. Points of a cell are contiguous in the order, so the 3x3
+ * cells around a point are three ranges of the order when the cells are in
+ * rows.
+ *
+ * The grid is embedded in its owner, which is responsible for the allocation
+ * category of its buffers.
+ */
+typedef struct {
+    nv_float inv_cell; /**< Inverse of the cell size. */
+
+    bool dense; /**< Are cells laid out in rows covering the points, instead of being hashed? */
+    nv_int32 origin_x; /**< Coordinates of the first cell of the rows. */
+    nv_int32 origin_y;
+    nv_int32 width; /**< Number of cells in a row. */
+    nv_int32 height; /**< Number of rows. */
+    nv_uint32 cell_mask; /**< Number of hashed cells - 1. */
+
+    nv_uint32 *cells; /**< Cell of each point. */
+    nv_uint32 *order; /**< Point indices sorted by cells. */
+    nv_uint32 *starts; /**< Points of cell i are in [starts[i], starts[i + 1]) of the order. */
+    size_t point_capacity; /**< Allocated number of points. */
+    size_t cell_capacity; /**< Allocated number of cells. */
+} nvCellGrid;
+
+/**
+ * @brief Ranges of the order in a rectangle of cells.
+ */
+typedef struct {
+    nv_uint32 begins[9];
+    nv_uint32 ends[9];
+    size_t count;
+} nvCellRanges;
+
+/**
+ * @brief Free the buffers of the grid, the grid itself isn't freed.
+ *
+ * @param grid Grid
+ */
+void nvCellGrid_release(nvCellGrid *grid);
+
+/**
+ * @brief Lay out the cells over the bounds of the points and sort the points.
+ *
+ * Returns false if the buffers couldn't be allocated.
+ *
+ * @param grid Grid
+ * @param space Space to run the binning on
+ * @param x X positions of the points
+ * @param y Y positions of the points
+ * @param count Number of points
+ * @param bounds Bounding box of the points
+ * @param cell_size Size of the cells
+ * @param min_range Minimum number of points in one parallel range
+ * @return bool
+ */
+bool nvCellGrid_sort(
+    nvCellGrid *grid,
+    struct nvSpace *space,
+    const nv_float *x,
+    const nv_float *y,
+    size_t count,
+    nvAABB bounds,
+    nv_float cell_size,
+    size_t min_range
+);
+
+/**
+ * @brief Cell coordinate of a position component.
+ */
+static inline nv_int32 nvCellGrid_coord(const nvCellGrid *grid, nv_float x) {
+    return (nv_int32)nv_floor(x * grid->inv_cell);
+}
+
+/**
+ * @brief Index of the cell or bucket at cell coordinates.
+ */
+static inline nv_uint32 nvCellGrid_cell(const nvCellGrid *grid, nv_int32 x, nv_int32 y) {
+    if (grid->dense)
+        return (nv_uint32)((y - grid->origin_y) * grid->width + (x - grid->origin_x));
+
+    return (((nv_uint32)x * NV_CELL_GRID_HASH_X) ^ ((nv_uint32)y * NV_CELL_GRID_HASH_Y)) & grid->cell_mask;
+}
+
+/**
+ * @brief Find the ranges of the order in the 3x3 cells around a cell.
+ *
+ * Rows are contiguous in the dense grid. Hashed cells can share buckets, so
+ * every bucket is only added once.
+ */
+static inline void nvCellGrid_neighbour_ranges(
+    const nvCellGrid *grid,
+    nv_int32 cx,
+    nv_int32 cy,
+    nvCellRanges *ranges
+) {
+    const nv_uint32 *starts = grid->starts;
+    ranges->count = 0;
+
+    if (grid->dense) {
+        nv_int32 x0 = cx - 1 - grid->origin_x;
+        nv_int32 x1 = cx + 1 - grid->origin_x;
+        if (x0 < 0) x0 = 0;
+        if (x1 > grid->width - 1) x1 = grid->width - 1;
+        if (x0 > x1) return;
+
+        for (nv_int32 y = cy - 1 - grid->origin_y; y <= cy + 1 - grid->origin_y; y++) {
+            if (y < 0 || y >= grid->height) continue;
+
+            nv_uint32 row = (nv_uint32)(y * grid->width);
+            ranges->begins[ranges->count] = starts[row + x0];
+            ranges->ends[ranges->count] = starts[row + x1 + 1];
+            ranges->count++;
+        }
+
+        return;
+    }
+
+    for (nv_int32 y = cy - 1; y <= cy + 1; y++) {
+        for (nv_int32 x = cx - 1; x <= cx + 1; x++) {
+            nv_uint32 bucket = nvCellGrid_cell(grid, x, y);
+
+            bool added = false;
+            for (size_t i = 0; i < ranges->count; i++)
+                if (ranges->begins[i] == starts[bucket] && ranges->ends[i] == starts[bucket + 1]) added = true;
+            if (added || starts[bucket] == starts[bucket + 1]) continue;
+
+            ranges->begins[ranges->count] = starts[bucket];
+            ranges->ends[ranges->count] = starts[bucket + 1];
+            ranges->count++;
+        }
+    }
+}
+
+
+#endif
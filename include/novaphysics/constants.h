@@ -74,4 +74,30 @@
 #define NV_BVH_LEAF_THRESHOLD 1
 
 
+/*
+    Minimum number of bodies for the parallel phases of a step to run on
+    multiple threads. Below this, dispatching work to the threads costs
+    more than the work itself so the step runs serially.
+*/
+#define NV_PARALLEL_BODY_THRESHOLD 256
+
+/*
+    Number of simulation rate tiers bodies can be assigned to.
+    Bodies in tier N are simulated once every 2^N steps.
+*/
+#define NV_SIM_TIERS 4
+
+/*
+    Minimum cosine between the normals of a collision in two substeps for the
+    contact data prepared in the first one to be reused in the second one.
+*/
+#define NV_PRESOLVE_REUSE_NORMAL_COS 0.999
+
+/*
+    Maximum distance a contact point can move relative to the bodies since
+    the contact data was prepared for the data to be reused.
+*/
+#define NV_PRESOLVE_REUSE_ARM_TOLERANCE 0.05
+
+
 #endif
\ No newline at end of file
@@ -43,6 +43,35 @@ typedef enum {
 } nvPositionCorrection;
 
 
+/**
+ * @brief How contact data is prepared when a step is divided into substeps.
+ * 
+ * Effective masses and mixed coefficients of a contact barely change within
+ * one step. With substep reuse they are prepared in the first substep a
+ * contact exists in and only the contact arms and biases are updated in the
+ * later substeps. Data is prepared again when the contact count changes, the
+ * normal turns more than @ref NV_PRESOLVE_REUSE_NORMAL_COS allows or a contact
+ * point moves further than @ref NV_PRESOLVE_REUSE_ARM_TOLERANCE from where the
+ * data was prepared.
+ */
+typedef enum {
+    nvPresolveReuse_NONE, /**< Prepare all contact data in every substep. */
+    nvPresolveReuse_SUBSTEPS, /**< Reuse effective masses and mixed coefficients across the substeps of a step. */
+    nvPresolveReuse_MEASURE /**< Same as substep reuse, but also prepare the data again to measure how far the reused data drifted. */
+} nvPresolveReuse;
+
+/**
+ * @brief Drift of the reused contact data in the last step.
+ * 
+ * Only measured with @ref nvPresolveReuse_MEASURE.
+ */
+typedef struct {
+    size_t contacts; /**< Number of contacts that reused data. */
+    nv_float max_error; /**< Largest relative error of a reused effective mass. */
+    nv_float mean_error; /**< Mean relative error of reused effective masses. */
+} nvPresolveDrift;
+
+
 /**
  * @brief Prepare for solving contact constraints.
  * 
@@ -71,6 +100,18 @@ void nv_warmstart(struct nvSpace *space, nvResolution *res);
  */
 void nv_solve_velocity(nvResolution *res);
 
+/**
+ * @brief Solve contact velocity constraints with one body treated as having infinite mass.
+ * 
+ * Used in the last velocity iterations by shock propagation, impulses only
+ * move the body that isn't fixed.
+ * They are accumulated separately and aren't warm-started in the next step.
+ * 
+ * @param res Collision resolution
+ * @param fixed Body that isn't moved, NULL to move both bodies
+ */
+void nv_solve_velocity_shock(nvResolution *res, nvBody *fixed);
+
 /**
  * @brief Solve position error (pseudo-velocities / NGS).
  * 
@@ -49,6 +49,7 @@
     #define nv_sin sinf
     #define nv_cos cosf
     #define nv_floor floorf
+    #define nv_round roundf
 
 #else
 
@@ -63,6 +64,7 @@
     #define nv_sin sin
     #define nv_cos cos
     #define nv_floor floor
+    #define nv_round round
 
 #endif
 
@@ -145,6 +147,75 @@ typedef uint64_t nv_uint64;
 #endif
 
 
+/*
+    Atomic operations on 32-bit integers, used by the task executor.
+
+    All of them are sequentially consistent. nv_atomic_add returns the new value.
+*/
+
+#if defined(NV_COMPILER_GCC)
+
+    #define nv_atomic_load(ptr) __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+    #define nv_atomic_store(ptr, x) __atomic_store_n((ptr), (x), __ATOMIC_SEQ_CST)
+    #define nv_atomic_add(ptr, x) __atomic_add_fetch((ptr), (x), __ATOMIC_SEQ_CST)
+    #define nv_atomic_fence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+    #if defined(__i386__) || defined(__x86_64__)
+        #define nv_cpu_relax() __builtin_ia32_pause()
+    #elif defined(__aarch64__) || defined(__arm__)
+        #define nv_cpu_relax() __asm__ __volatile__("yield")
+    #else
+        #define nv_cpu_relax()
+    #endif
+
+#elif defined(NV_COMPILER_MSVC)
+
+    #include <intrin.h>
+
+    #define nv_atomic_load(ptr) ((nv_uint32)_InterlockedOr((volatile long *)(ptr), 0))
+    #define nv_atomic_store(ptr, x) _InterlockedExchange((volatile long *)(ptr), (long)(x))
+    #define nv_atomic_add(ptr, x) ((nv_uint32)(_InterlockedExchangeAdd((volatile long *)(ptr), (long)(x)) + (long)(x)))
+    #define nv_atomic_fence() do { volatile long _nv_fence = 0; _InterlockedOr(&_nv_fence, 0); } while (0)
+    #if defined(_M_IX86) || defined(_M_X64)
+        #define nv_cpu_relax() _mm_pause()
+    #else
+        #define nv_cpu_relax() __yield()
+    #endif
+
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+
+    #include <stdatomic.h>
+
+    // Counters are plain integers, they are accessed through atomic pointers of the same size
+    #define nv_atomic_load(ptr) atomic_load((_Atomic nv_uint32 *)(ptr))
+    #define nv_atomic_store(ptr, x) atomic_store((_Atomic nv_uint32 *)(ptr), (x))
+    #define nv_atomic_add(ptr, x) (atomic_fetch_add((_Atomic nv_uint32 *)(ptr), (x)) + (x))
+    #define nv_atomic_fence() atomic_thread_fence(memory_order_seq_cst)
+    #define nv_cpu_relax()
+
+#else
+
+    #error "Nova Physics needs GCC/Clang or MSVC atomic builtins, or C11 <stdatomic.h>"
+
+#endif
+
+
+// Thread-local storage specifier
+#if defined(NV_COMPILER_GCC)
+
+    #define NV_THREAD_LOCAL __thread
+
+#elif defined(NV_COMPILER_MSVC)
+
+    #define NV_THREAD_LOCAL __declspec(thread)
+
+#else
+
+    #define NV_THREAD_LOCAL _Thread_local
+
+#endif
+
+
 /*
     Profiling macros.
 */
@@ -165,8 +236,78 @@ typedef uint64_t nv_uint64;
 struct nvSpace;
 
 
+/*
+    Allocation macros.
+
+    Builds with NV_TRACK_ALLOCATIONS route every allocation of the library
+    through the allocation tracker, which keeps statistics per subsystem.
+    Allocations are attributed to the category that is current when they
+    are made. NV_ALLOC_SCOPE_BEGIN & NV_ALLOC_SCOPE_END push and pop the
+    current category, every BEGIN must be matched by an END.
+*/
+
+/**
+ * @brief Subsystems allocations are attributed to.
+ */
+typedef enum {
+    nvAllocCategory_OTHER, /**< Anything outside of the other categories. */
+    nvAllocCategory_BODIES, /**< Bodies. */
+    nvAllocCategory_SHAPES, /**< Shapes and their vertices. */
+    nvAllocCategory_CONSTRAINTS, /**< Constraints. */
+    nvAllocCategory_RESOLUTIONS, /**< Collision resolutions and narrow-phase. */
+    nvAllocCategory_BROADPHASE, /**< Broad-phase pairs and structures. */
+    nvAllocCategory_THREADING, /**< Task executor and threads. */
+    nvAllocCategory_PARTICLES, /**< Particle systems. */
+    nvAllocCategory_SOFT_BODIES, /**< Soft bodies. */
+    nvAllocCategory_ARTICULATIONS, /**< Articulations. */
+    nvAllocCategory_COUNT
+} nvAllocCategory;
+
+#ifdef NV_TRACK_ALLOCATIONS
+
+    void *_nv_tracked_malloc(size_t size);
+    void *_nv_tracked_calloc(size_t count, size_t size);
+    void *_nv_tracked_realloc(void *ptr, size_t size);
+    void _nv_tracked_free(void *ptr);
+    void _nv_alloc_push_category(nvAllocCategory category);
+    void _nv_alloc_pop_category();
+    nvAllocCategory _nv_alloc_current_category();
+
+    #define NV_MALLOC(size) _nv_tracked_malloc(size)
+    #define NV_CALLOC(count, size) _nv_tracked_calloc(count, size)
+    #define NV_REALLOC(ptr, size) _nv_tracked_realloc(ptr, size)
+    #define NV_FREE(ptr) _nv_tracked_free(ptr)
+    #define NV_FREE_FUNC _nv_tracked_free
+
+    #define NV_ALLOC_SCOPE_BEGIN(category) _nv_alloc_push_category(category)
+    #define NV_ALLOC_SCOPE_END _nv_alloc_pop_category()
+
+#else
+
+    #define NV_MALLOC(size) malloc(size)
+    #define NV_CALLOC(count, size) calloc(count, size)
+    #define NV_REALLOC(ptr, size) realloc(ptr, size)
+    #define NV_FREE(ptr) free(ptr)
+    #define NV_FREE_FUNC free
+
+    #define NV_ALLOC_SCOPE_BEGIN(category)
+    #define NV_ALLOC_SCOPE_END
+
+#endif
+
 // Utility macro to allocate on HEAP
-#define NV_NEW(type) ((type *)malloc(sizeof(type)))
+#define NV_NEW(type) ((type *)NV_MALLOC(sizeof(type)))
+
+/**
+ * Internal function to resize an array, the array is left untouched on failure.
+ */
+static inline bool _nv_reserve(void **array, size_t item_size, size_t count) {
+    void *new_array = NV_REALLOC(*array, item_size * count);
+    if (!new_array) return false;
+
+    *array = new_array;
+    return true;
+}
 
 
 /**
@@ -488,7 +488,7 @@ static inline nvArray *nv_generate_convex_hull(nvArray *points) {
 
     #ifdef NV_COMPILER_MSVC
 
-        nvVector2 *tmp_points = (nvVector2 *)malloc(sizeof(nvVector2) * points->size);
+        nvVector2 *tmp_points = (nvVector2 *)NV_MALLOC(sizeof(nvVector2) * points->size);
 
     #else
 
@@ -511,11 +511,11 @@ static inline nvArray *nv_generate_convex_hull(nvArray *points) {
 
     #ifdef NV_COMPILER_MSVC
 
-        free(tmp_points);
+        NV_FREE(tmp_points);
 
     #endif
 
-    nvVector2 *hull = (nvVector2 *)malloc(sizeof(nvVector2) * n);
+    nvVector2 *hull = (nvVector2 *)NV_MALLOC(sizeof(nvVector2) * n);
     size_t hull_size = 3;
     hull[0] = NV_TO_VEC2(points->data[0]);
     hull[1] = NV_TO_VEC2(points->data[1]);
@@ -541,7 +541,7 @@ static inline nvArray *nv_generate_convex_hull(nvArray *points) {
         nvArray_add(ret_hull, NV_VEC2_NEW(hull[i].x, hull[i].y));
     }
 
-    free(hull);
+    NV_FREE(hull);
 
     return ret_hull;
 }
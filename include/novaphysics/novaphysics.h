@@ -45,6 +45,11 @@
 #include "novaphysics/material.h"
 #include "novaphysics/broadphase.h"
 #include "novaphysics/space.h"
+#include "novaphysics/space_view.h"
+#include "novaphysics/replication.h"
+#include "novaphysics/shm.h"
+#include "novaphysics/scene.h"
+#include "novaphysics/recorder.h"
 #include "novaphysics/body.h"
 #include "novaphysics/constraint.h"
 #include "novaphysics/spring.h"
@@ -53,12 +58,21 @@
 #include "novaphysics/collision.h"
 #include "novaphysics/contact.h"
 #include "novaphysics/contact_solver.h"
+#include "novaphysics/position_solver.h"
+#include "novaphysics/shock_propagation.h"
+#include "novaphysics/cell_grid.h"
+#include "novaphysics/particle.h"
+#include "novaphysics/soft_body.h"
+#include "novaphysics/articulation.h"
 #include "novaphysics/resolution.h"
 #include "novaphysics/hashmap.h"
 #include "novaphysics/shg.h"
 #include "novaphysics/bvh.h"
 #include "novaphysics/threading.h"
 #include "novaphysics/debug.h"
+#include "novaphysics/alloc_tracker.h"
+#include "novaphysics/tracer.h"
+#include "novaphysics/step_budget.h"
 
 
 #endif
\ No newline at end of file
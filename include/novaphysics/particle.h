@@ -0,0 +1,183 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_PARTICLE_H
+#define NOVAPHYSICS_PARTICLE_H
+
+#include "novaphysics/internal.h"
+#include "novaphysics/array.h"
+#include "novaphysics/aabb.h"
+#include "novaphysics/body.h"
+#include "novaphysics/cell_grid.h"
+#include "novaphysics/material.h"
+#include "novaphysics/vector.h"
+
+
+/**
+ * @file particle.h
+ *
+ * @brief Particle system for granular material and debris.
+ */
+
+
+/*
+    Default number of substeps particle systems divide each space substep into.
+    Particles are much stiffer with more substeps than with more iterations
+    that cost the same.
+*/
+#define NV_PARTICLE_SUBSTEPS 4
+
+// Default number of position iterations in each particle substep
+#define NV_PARTICLE_ITERATIONS 1
+
+
+/**
+ * @brief How particles and bodies affect each other.
+ */
+typedef enum {
+    nvParticleCoupling_ONE_WAY, /**< Bodies push particles, particles don't push bodies back. */
+    nvParticleCoupling_TWO_WAY /**< Particles also apply impulses to the dynamic bodies they hit. */
+} nvParticleCoupling;
+
+
+/**
+ * @brief Particle system struct.
+ *
+ * Particles are circles that all share the same radius and material. They
+ * don't rotate and they aren't bodies, so they have no shapes, resolutions or
+ * entries in the broad-phase. Particle-particle and particle-body collisions
+ * are solved with position projections (position based dynamics) after the
+ * bodies are stepped.
+ *
+ * Particles are stored as separate arrays of components and they are sorted
+ * by grid cells every substep, so the order of the particles, and thus their
+ * indices, change while stepping.
+ *
+ * Sleeping bodies are treated as static until particles hit them fast enough
+ * to wake them up with two-way coupling.
+ */
+typedef struct nvParticleSystem {
+    struct nvSpace *space; /**< Space instance the particle system is in. */
+
+    nv_float *position_x; /**< X positions of the particles. */
+    nv_float *position_y; /**< Y positions of the particles. */
+    nv_float *velocity_x; /**< X components of the particle velocities. */
+    nv_float *velocity_y; /**< Y components of the particle velocities. */
+    size_t count; /**< Number of particles. */
+    size_t capacity; /**< Allocated number of particles. */
+
+    nv_float radius; /**< Radius of the particles. */
+    nv_float mass; /**< Mass of one particle, calculated from the material's density. */
+    nvMaterial material; /**< Material of the particles. Restitution isn't used, collisions are inelastic. */
+    nv_float gravity_scale; /**< Scale multiplier to the gravity applied to the particles. 1.0 by default. */
+    nv_float linear_damping; /**< Amount of damping applied to the particle velocities. */
+    size_t substeps; /**< Number of substeps particles are advanced in every space substep. */
+    size_t iterations; /**< Number of position iterations in each particle substep. */
+    nvParticleCoupling coupling; /**< How particles and bodies affect each other. */
+
+    bool collide_particles; /**< Whether particles collide with each other or not. True by default. */
+    nv_uint32 collision_category; /**< Bitmask defining the particles' collision category. */
+    nv_uint32 collision_mask; /**< Bitmask defining the particles' collision mask. */
+
+    nvAABB bounds; /**< Bounding box of the particles in the last substep, before collisions were solved. */
+
+    nv_float *_prev_x; /**< Internal X positions at the beginning of the substep. */
+    nv_float *_prev_y; /**< Internal Y positions at the beginning of the substep. */
+    nv_float *_delta_x; /**< Internal X components of the particle-particle corrections. */
+    nv_float *_delta_y; /**< Internal Y components of the particle-particle corrections. */
+    nv_uint32 *_visits; /**< Internal last body pass each particle was visited in. */
+    nv_float *_sorted[6]; /**< Internal buffers particle components are sorted into. */
+    nvVector2 *_normals; /**< Internal edge normals of the polygon body being solved. */
+    size_t _normal_capacity; /**< Internal allocated number of normals. */
+
+    nvArray *_bodies; /**< Internal bodies near the particles in the current substep. */
+    nvCellGrid _grid; /**< Internal grid the particles are sorted by, starts index the sorted particles. */
+    nv_uint32 _visit; /**< Internal body pass counter. */
+} nvParticleSystem;
+
+/**
+ * @brief Create a new particle system.
+ *
+ * @param radius Radius of the particles
+ * @param material Material of the particles
+ * @return nvParticleSystem *
+ */
+nvParticleSystem *nvParticleSystem_new(nv_float radius, nvMaterial material);
+
+/**
+ * @brief Free particle system.
+ *
+ * @param ps Particle system
+ */
+void nvParticleSystem_free(void *ps);
+
+/**
+ * @brief Add a particle.
+ *
+ * Returns false if the particle couldn't be allocated.
+ *
+ * @param ps Particle system
+ * @param position Position of the particle
+ * @param velocity Velocity of the particle
+ * @return bool
+ */
+bool nvParticleSystem_add(nvParticleSystem *ps, nvVector2 position, nvVector2 velocity);
+
+/**
+ * @brief Remove all particles.
+ *
+ * @param ps Particle system
+ */
+void nvParticleSystem_clear(nvParticleSystem *ps);
+
+/**
+ * @brief Advance the particles by one substep.
+ *
+ * This is called by the space after the bodies are stepped, it is only
+ * public for stepping particles on their own.
+ *
+ * @param space Space, used for gravity, bodies and threading
+ * @param ps Particle system
+ * @param dt Time step size of the substep
+ */
+void nvParticleSystem_step(struct nvSpace *space, nvParticleSystem *ps, nv_float dt);
+
+/**
+ * Find the contact between a circle of radius r at p and a body. Normal points
+ * from the body to the circle and point is on the body's surface. Polygons
+ * need their outward edge normals from _nvParticle_polygon_normals.
+ */
+bool _nvParticle_collide_body(
+    nvBody *body,
+    nvArray *vertices,
+    const nvVector2 *normals,
+    nv_float r,
+    nvVector2 p,
+    nvVector2 *normal,
+    nv_float *depth,
+    nvVector2 *point
+);
+
+/**
+ * Transform a polygon body's vertices and compute its outward edge normals
+ * into a buffer that grows as needed. Returns false if the buffer couldn't be
+ * allocated.
+ */
+bool _nvParticle_polygon_normals(nvBody *body, nvVector2 **normals, size_t *capacity);
+
+/**
+ * Wake a sleeping dynamic body up if a contact moved a circle by correction in
+ * a substep of dt fast enough, the same way awake bodies wake the bodies they
+ * touch. Returns true if the body was woken up.
+ */
+bool _nvParticle_wake_body(struct nvSpace *space, nvBody *body, nvVector2 correction, nv_float dt);
+
+
+#endif
\ No newline at end of file
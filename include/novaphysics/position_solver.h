@@ -0,0 +1,149 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_POSITION_SOLVER_H
+#define NOVAPHYSICS_POSITION_SOLVER_H
+
+#include "novaphysics/internal.h"
+#include "novaphysics/array.h"
+#include "novaphysics/body.h"
+#include "novaphysics/resolution.h"
+
+
+/**
+ * @file position_solver.h
+ *
+ * @brief Batched NGS position solver.
+ */
+
+
+// Number of colours contacts are distributed into, contacts that don't fit are solved serially
+#define NV_POSITION_SOLVER_COLORS 32
+
+// Minimum number of contacts in a colour to solve it on multiple threads
+#define NV_POSITION_SOLVER_PARALLEL_THRESHOLD 2048
+
+
+/**
+ * @brief Solver for NGS (Non-Linear Gauss-Seidel) position correction.
+ *
+ * Bodies and contacts are copied into flat arrays once per substep, so the
+ * position iterations don't chase resolution and body pointers. Rotations of
+ * the bodies are tracked as cosine & sine pairs that are updated with the
+ * small angle corrections, no trigonometric functions are evaluated while
+ * iterating.
+ *
+ * Contacts are coloured so that no two contacts of the same colour move the
+ * same body. Contacts of a colour are solved on multiple threads and in AVX
+ * batches, colours themselves are solved one after another.
+ *
+ * Poses of single bodies can be stored and loaded between iterations, so
+ * articulations can correct their links while the rest stays in the solver.
+ */
+typedef struct {
+    nvBody **bodies; /**< Bodies in the solver. */
+    nv_float *position_x; /**< X positions of the bodies. */
+    nv_float *position_y; /**< Y positions of the bodies. */
+    nv_float *angle; /**< Angles of the bodies. */
+    nv_float *rotation_c; /**< Cosines of the rotations since presolve. */
+    nv_float *rotation_s; /**< Sines of the rotations since presolve. */
+    nv_float *invmass; /**< Inverse masses of the bodies. */
+    nv_float *invinertia; /**< Inverse inertias of the bodies. */
+    bool *is_static; /**< Static bodies are read but never written. */
+    nv_uint32 *_color_masks; /**< Internal colours the bodies are used in. */
+    size_t body_count; /**< Number of bodies. */
+    size_t body_capacity; /**< Allocated number of bodies. */
+
+    nv_uint32 *a; /**< Indices of the first bodies of the contacts. */
+    nv_uint32 *b; /**< Indices of the second bodies of the contacts. */
+    nv_float *ra_x; /**< X components of the contact positions relative to body A at presolve. */
+    nv_float *ra_y; /**< Y components of the contact positions relative to body A at presolve. */
+    nv_float *rb_x; /**< X components of the contact positions relative to body B at presolve. */
+    nv_float *rb_y; /**< Y components of the contact positions relative to body B at presolve. */
+    nv_float *normal_x; /**< X components of the collision normals. */
+    nv_float *normal_y; /**< Y components of the collision normals. */
+    nv_float *depth; /**< Penetration depths at presolve. */
+    size_t contact_count; /**< Number of contacts. */
+    size_t contact_capacity; /**< Allocated number of contacts. */
+
+    size_t color_starts[NV_POSITION_SOLVER_COLORS + 2]; /**< Contacts of colour i are in [color_starts[i], color_starts[i + 1]).
+                                                              The last colour holds the contacts solved serially. */
+
+    nvResolution **_staged_res; /**< Internal resolutions of the contacts before they are sorted by colour. */
+    nv_uint8 *_staged_index; /**< Internal contact indices in the resolutions. */
+    nv_uint8 *_staged_color; /**< Internal colours of the contacts. */
+
+    nv_uint32 *_id_map; /**< Internal body ID -> solver body index lookup table. */
+    size_t _id_map_size; /**< Length of the lookup table. */
+} nvPositionSolver;
+
+/**
+ * @brief Create new position solver.
+ *
+ * @return nvPositionSolver *
+ */
+nvPositionSolver *nvPositionSolver_new();
+
+/**
+ * @brief Free position solver.
+ *
+ * @param solver Position solver
+ */
+void nvPositionSolver_free(nvPositionSolver *solver);
+
+/**
+ * @brief Gather the bodies and contacts of the resolutions and colour the contacts.
+ *
+ * Contacts must be presolved with NGS position correction. Returns false if
+ * the buffers couldn't be allocated.
+ *
+ * @param solver Position solver
+ * @param resolutions Array of resolutions, contacts keep their order in a colour
+ * @return bool
+ */
+bool nvPositionSolver_prepare(nvPositionSolver *solver, nvArray *resolutions);
+
+/**
+ * @brief Do one position iteration.
+ *
+ * @param space Space, used to run colours on multiple threads
+ * @param solver Position solver
+ */
+void nvPositionSolver_solve(struct nvSpace *space, nvPositionSolver *solver);
+
+/**
+ * @brief Write the corrected pose of one body back to it between iterations.
+ *
+ * Does nothing if the body isn't in the solver.
+ *
+ * @param solver Position solver
+ * @param body Body
+ */
+void nvPositionSolver_store_body(nvPositionSolver *solver, nvBody *body);
+
+/**
+ * @brief Read the pose of one body back into the solver after it was moved between iterations.
+ *
+ * Does nothing if the body isn't in the solver.
+ *
+ * @param solver Position solver
+ * @param body Body
+ */
+void nvPositionSolver_load_body(nvPositionSolver *solver, nvBody *body);
+
+/**
+ * @brief Write the corrected positions and angles back to the bodies.
+ *
+ * @param solver Position solver
+ */
+void nvPositionSolver_finish(nvPositionSolver *solver);
+
+
+#endif
\ No newline at end of file
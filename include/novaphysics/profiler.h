@@ -12,6 +12,7 @@
 #define NOVAPHYSICS_PROFILER_H
 
 #include "novaphysics/internal.h"
+#include "novaphysics/tracer.h"
 
 
 /**
@@ -21,6 +22,10 @@
  */
 
 
+// Maximum number of workers the profiler keeps separate times for
+#define NV_PROFILER_MAX_WORKERS 64
+
+
 typedef struct {
     double step;
     double integrate_accelerations;
@@ -33,13 +38,124 @@ typedef struct {
     double presolve_constraints;
     double solve_constraints;
     double integrate_velocities;
+    double step_particles;
+    double step_soft_bodies;
+    double solve_articulations;
     double remove_bodies;
     double bvh_build;
     double bvh_traverse;
     double bvh_destroy;
+
+    double parallel_wall; /**< Time spent waiting on parallel phases in the step. */
+    double parallel_work; /**< Time ranges of parallel phases took, summed over all workers. */
+    double worker_times[NV_PROFILER_MAX_WORKERS]; /**< Time each worker spent on ranges in the step.
+                                                       Ranges are ordered by their position in the
+                                                       items, with the built-in executor that is the
+                                                       thread index. */
+    size_t worker_count; /**< Highest number of workers that ran ranges of one parallel phase. */
 } nvProfiler;
 
 
+/**
+ * @brief Profiled phases of the step.
+ */
+typedef enum {
+    nvProfilerPhase_STEP, /**< Whole step. */
+    nvProfilerPhase_INTEGRATE_ACCELERATIONS, /**< Integrating accelerations. */
+    nvProfilerPhase_BROADPHASE, /**< Broad-phase. */
+    nvProfilerPhase_UPDATE_RESOLUTIONS, /**< Updating and removing cached resolutions. */
+    nvProfilerPhase_NARROWPHASE, /**< Narrow-phase. */
+    nvProfilerPhase_PRESOLVE_COLLISIONS, /**< Preparing contacts. */
+    nvProfilerPhase_SOLVE_VELOCITIES, /**< Solving contact velocities. */
+    nvProfilerPhase_PRESOLVE_CONSTRAINTS, /**< Preparing constraints. */
+    nvProfilerPhase_SOLVE_CONSTRAINTS, /**< Solving constraints. */
+    nvProfilerPhase_INTEGRATE_VELOCITIES, /**< Integrating velocities. */
+    nvProfilerPhase_SOLVE_POSITIONS, /**< Solving contact positions. */
+    nvProfilerPhase_STEP_PARTICLES, /**< Stepping particle systems. */
+    nvProfilerPhase_STEP_SOFT_BODIES, /**< Stepping soft bodies. */
+    nvProfilerPhase_SOLVE_ARTICULATIONS, /**< Solving forward dynamics of articulations. */
+    nvProfilerPhase_REMOVE_BODIES, /**< Removing and freeing bodies. */
+    nvProfilerPhase_COUNT
+} nvProfilerPhase;
+
+/**
+ * @brief Hook called at the beginning and the end of every profiled phase.
+ *
+ * The hook is called outside of the phase timers, so the time it takes isn't
+ * included in the profiler's timings. Phases inside the substep loop are
+ * reported once for every substep.
+ */
+typedef void (*nvProfilerHook)(nvProfilerPhase phase, bool begin, void *user_data);
+
+/**
+ * @brief Get the name of a profiled phase.
+ *
+ * @param phase Phase
+ * @return const char *
+ */
+static inline const char *nvProfilerPhase_name(nvProfilerPhase phase) {
+    switch (phase) {
+        case nvProfilerPhase_STEP: return "Step";
+        case nvProfilerPhase_INTEGRATE_ACCELERATIONS: return "Integrate accelerations";
+        case nvProfilerPhase_BROADPHASE: return "Broad-phase";
+        case nvProfilerPhase_UPDATE_RESOLUTIONS: return "Update resolutions";
+        case nvProfilerPhase_NARROWPHASE: return "Narrow-phase";
+        case nvProfilerPhase_PRESOLVE_COLLISIONS: return "Presolve collisions";
+        case nvProfilerPhase_SOLVE_VELOCITIES: return "Solve velocities";
+        case nvProfilerPhase_PRESOLVE_CONSTRAINTS: return "Presolve constraints";
+        case nvProfilerPhase_SOLVE_CONSTRAINTS: return "Solve constraints";
+        case nvProfilerPhase_INTEGRATE_VELOCITIES: return "Integrate velocities";
+        case nvProfilerPhase_SOLVE_POSITIONS: return "Solve positions";
+        case nvProfilerPhase_STEP_PARTICLES: return "Step particles";
+        case nvProfilerPhase_STEP_SOFT_BODIES: return "Step soft bodies";
+        case nvProfilerPhase_SOLVE_ARTICULATIONS: return "Solve articulations";
+        case nvProfilerPhase_REMOVE_BODIES: return "Remove bodies";
+        default: return "Unknown";
+    }
+}
+
+#ifdef NV_PROFILE
+
+    #define _NV_PROFILER_HOOK(space, phase, begin) \
+        if ((space)->profiler_hook) (space)->profiler_hook(phase, begin, (space)->profiler_hook_data)
+
+#else
+
+    #define _NV_PROFILER_HOOK(space, phase, begin)
+
+#endif
+
+/*
+    Phase markers, they call the profiler hook and record the phase to the
+    space's tracer. Tracing doesn't need NV_PROFILE. Phases other than the
+    step don't nest, so the current phase is what parallel ranges are named after.
+*/
+
+#define NV_PROFILER_PHASE_BEGIN(space, phase) do { \
+    _NV_PROFILER_HOOK(space, phase, true); \
+    if ((space)->tracer) { \
+        (space)->_trace_phase = (phase); \
+        (space)->_trace_begins[phase] = nvTracer_now(); \
+    } \
+} while (0)
+
+#define NV_PROFILER_PHASE_END(space, phase) do { \
+    if ((space)->tracer) { \
+        nvTracer_record((space)->tracer, nvProfilerPhase_name(phase), (space)->_trace_begins[phase], nvTracer_now(), 0); \
+        (space)->_trace_phase = nvProfilerPhase_STEP; \
+    } \
+    _NV_PROFILER_HOOK(space, phase, false); \
+} while (0)
+
+
+static inline void nvProfiler_reset_workers(nvProfiler *profiler) {
+    profiler->parallel_wall = 0.0;
+    profiler->parallel_work = 0.0;
+    for (size_t i = 0; i < NV_PROFILER_MAX_WORKERS; i++)
+        profiler->worker_times[i] = 0.0;
+    profiler->worker_count = 0;
+}
+
 static inline void nvProfiler_reset(nvProfiler *profiler) {
     profiler->step = 0.0;
     profiler->integrate_accelerations = 0.0;
@@ -52,10 +168,14 @@ static inline void nvProfiler_reset(nvProfiler *profiler) {
     profiler->presolve_constraints = 0.0;
     profiler->solve_constraints = 0.0;
     profiler->integrate_velocities = 0.0;
+    profiler->step_particles = 0.0;
+    profiler->step_soft_bodies = 0.0;
+    profiler->solve_articulations = 0.0;
     profiler->remove_bodies = 0.0;
     profiler->bvh_build = 0.0;
     profiler->bvh_traverse = 0.0;
     profiler->bvh_destroy = 0.0;
+    nvProfiler_reset_workers(profiler);
 }
 
 
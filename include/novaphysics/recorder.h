@@ -0,0 +1,274 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_RECORDER_H
+#define NOVAPHYSICS_RECORDER_H
+
+#include "novaphysics/internal.h"
+#include "novaphysics/space.h"
+#include "novaphysics/scene.h"
+
+
+/**
+ * @file recorder.h
+ *
+ * @brief Recording external mutations of a space and replaying them.
+ *
+ * A recorder attached to a space takes a snapshot of it in the scene format
+ * and then logs every mutation made through the API: adding, removing and
+ * killing bodies, clearing the space, adding constraints, applying forces
+ * and impulses, setting body transforms and velocities with the body setters,
+ * and the parameters of every step. Mutations made by the step itself aren't
+ * recorded. Mutations made in collision callbacks are recorded with the
+ * callback they were made in and replayed at the same point of the step.
+ * Changes made by writing struct fields directly can't be seen by the
+ * recorder.
+ *
+ * Replaying the recording re-executes the log on a new space, so the same
+ * steps can be profiled again and again. To capture rare slow frames, restart
+ * the recorder every few seconds and save it right after a slow step, the
+ * recording then ends with that step.
+ *
+ * File layout:
+ *  - @ref nvRecordingHeader
+ *  - scene_size bytes of the snapshot in scene file layout
+ *  - body_count x 16-bit IDs of the snapshot's bodies
+ *  - events until the end of the file, each one is an 8-bit
+ *    @ref nvRecordEvent followed by its payload. Body IDs and counts are
+ *    varints, real numbers are 64-bit doubles.
+ */
+
+
+// Magic number at the start of recordings ("NVRE")
+#define NV_RECORDING_MAGIC 0x4552564E
+
+// Increased every time the file layout changes
+#define NV_RECORDING_VERSION 2
+
+
+/**
+ * @brief Recorded event types.
+ */
+typedef enum {
+    nvRecordEvent_STEP, /**< dt, velocity, position, constraint iterations and substeps. */
+    nvRecordEvent_ADD_BODY, /**< ID, @ref nvSceneBody and polygon vertices. */
+    nvRecordEvent_REMOVE_BODY, /**< ID. */
+    nvRecordEvent_KILL_BODY, /**< ID. */
+    nvRecordEvent_ADD_CONSTRAINT, /**< @ref nvSceneConstraint, a and b are body IDs. */
+    nvRecordEvent_APPLY_FORCE, /**< ID and force. */
+    nvRecordEvent_APPLY_FORCE_AT, /**< ID, force and local position. */
+    nvRecordEvent_APPLY_IMPULSE, /**< ID, impulse and local position. */
+    nvRecordEvent_SET_POSITION, /**< ID and position. */
+    nvRecordEvent_SET_ANGLE, /**< ID and angle. */
+    nvRecordEvent_SET_LINEAR_VELOCITY, /**< ID and linear velocity. */
+    nvRecordEvent_SET_ANGULAR_VELOCITY, /**< ID and angular velocity. */
+    nvRecordEvent_CLEAR, /**< No payload. */
+    nvRecordEvent_SET_SIM_TIER, /**< ID and simulation tier. */
+    nvRecordEvent_CALLBACK, /**< Index of the collision callback in the step, events until
+                                 @ref nvRecordEvent_CALLBACK_END were made in it. Before collision
+                                 callback of substep k is 2k, after collision callback is 2k + 1. */
+    nvRecordEvent_CALLBACK_END /**< No payload. */
+} nvRecordEvent;
+
+
+/**
+ * @brief Header at the start of a recording.
+ */
+typedef struct {
+    nv_uint32 magic; /**< Always NV_RECORDING_MAGIC. */
+    nv_uint32 version; /**< Layout version, NV_RECORDING_VERSION. */
+    nv_uint64 scene_size; /**< Size of the snapshot in bytes. */
+    nv_uint32 body_count; /**< Number of bodies in the snapshot. */
+    nv_uint32 step_count; /**< Number of step events. */
+    nv_uint32 id_counter; /**< ID the space was going to give to the next body. */
+    nv_uint32 complete; /**< 0 if some mutations couldn't be recorded faithfully. */
+} nvRecordingHeader;
+
+
+/**
+ * @brief Space mutation recorder.
+ */
+typedef struct nvRecorder {
+    nvSpace *space; /**< Space being recorded. NULL if the space was freed. */
+
+    nv_uint8 *scene; /**< Snapshot of the space when the recording started. */
+    size_t scene_size; /**< Size of the snapshot in bytes. */
+    nv_uint16 *ids; /**< IDs of the snapshot's bodies. */
+    size_t body_count; /**< Number of bodies in the snapshot. */
+    nv_uint16 id_counter; /**< Space's ID counter when the recording started. */
+
+    nv_uint8 *events; /**< Event log. */
+    size_t size; /**< Size of the event log in bytes. */
+    size_t capacity; /**< Allocated size of the event log. */
+    size_t step_count; /**< Number of recorded steps. */
+
+    bool complete; /**< False if a mutation couldn't be recorded faithfully,
+                        like a constraint linked to a body outside the space. */
+
+    size_t _callback_start; /**< Internal offset of the current callback's marker. */
+    size_t _callback_events; /**< Internal offset of the current callback's first event. */
+} nvRecorder;
+
+/**
+ * @brief Create a recorder and attach it to the space.
+ *
+ * Returns NULL if the space can't be snapshotted.
+ *
+ * @param space Space to record
+ * @return nvRecorder *
+ */
+nvRecorder *nvRecorder_new(nvSpace *space);
+
+/**
+ * @brief Detach the recorder from its space and free it.
+ *
+ * @param recorder Recorder
+ */
+void nvRecorder_free(nvRecorder *recorder);
+
+/**
+ * @brief Discard the recorded events and take a new snapshot of the space.
+ *
+ * Returns false if the space can't be snapshotted, the old recording is kept
+ * in that case.
+ *
+ * @param recorder Recorder
+ * @return bool
+ */
+bool nvRecorder_restart(nvRecorder *recorder);
+
+/**
+ * @brief Save the recording to a file.
+ *
+ * @param recorder Recorder
+ * @param filename Path of the recording file
+ * @return bool
+ */
+bool nvRecorder_save(nvRecorder *recorder, const char *filename);
+
+/**
+ * @brief Record a step. This is called internally by the space.
+ *
+ * @param recorder Recorder
+ * @param dt Time step size
+ * @param velocity_iters Velocity solving iteration count
+ * @param position_iters Position solving iteration count
+ * @param constraint_iters Constraint solving iteration count
+ * @param substeps Substep count
+ */
+void _nvRecorder_record_step(
+    nvRecorder *recorder,
+    nv_float dt,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+);
+
+/**
+ * @brief Record a body being added to the space. This is called internally by the space.
+ *
+ * @param recorder Recorder
+ * @param body Body
+ */
+void _nvRecorder_record_add(nvRecorder *recorder, nvBody *body);
+
+/**
+ * @brief Record a constraint being added to the space. This is called internally by the space.
+ *
+ * @param recorder Recorder
+ * @param cons Constraint
+ */
+void _nvRecorder_record_constraint(nvRecorder *recorder, nvConstraint *cons);
+
+/**
+ * @brief Record an event on a body. This is called internally.
+ *
+ * @param recorder Recorder
+ * @param event Event type
+ * @param body Body, NULL if the event doesn't have a body
+ * @param values Payload values of the event
+ * @param count Number of values
+ */
+void _nvRecorder_record_body(
+    nvRecorder *recorder,
+    nvRecordEvent event,
+    nvBody *body,
+    const nv_float *values,
+    size_t count
+);
+
+/**
+ * @brief Start recording the mutations of a collision callback. This is called internally by the space.
+ *
+ * @param recorder Recorder
+ * @param index Index of the callback in the step
+ */
+void _nvRecorder_begin_callback(nvRecorder *recorder, size_t index);
+
+/**
+ * @brief Stop recording the mutations of a collision callback. This is called internally by the space.
+ *
+ * Nothing is left in the log if the callback didn't mutate the space.
+ *
+ * @param recorder Recorder
+ */
+void _nvRecorder_end_callback(nvRecorder *recorder);
+
+
+/**
+ * @brief Replay of a recording.
+ */
+typedef struct {
+    nvSpace *space; /**< Space the recording is replayed on. */
+
+    nv_uint8 *data; /**< Contents of the recording file. */
+    size_t size; /**< Size of the recording in bytes. */
+    size_t offset; /**< Offset of the next event. */
+
+    nvBody **bodies; /**< Bodies by their recorded IDs. */
+    size_t step_count; /**< Number of steps in the recording. */
+    size_t step; /**< Number of steps replayed so far. */
+    bool complete; /**< Was the recording complete? */
+    bool error; /**< Was a malformed event found? */
+
+    size_t _substep; /**< Internal substep of the step being replayed. */
+} nvReplay;
+
+/**
+ * @brief Load a recording and create the space it starts from.
+ *
+ * Returns NULL if the file can't be read or isn't a valid recording.
+ *
+ * @param filename Path of the recording file
+ * @return nvReplay *
+ */
+nvReplay *nvReplay_open(const char *filename);
+
+/**
+ * @brief Free the replay and its space.
+ *
+ * @param replay Replay
+ */
+void nvReplay_free(nvReplay *replay);
+
+/**
+ * @brief Apply the recorded mutations up to the next step and run the step.
+ *
+ * Profiler of the replay's space holds the timings of the step afterwards.
+ * Returns false when there are no steps left or a malformed event is found.
+ *
+ * @param replay Replay
+ * @return bool
+ */
+bool nvReplay_step(nvReplay *replay);
+
+
+#endif
\ No newline at end of file
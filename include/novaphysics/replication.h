@@ -0,0 +1,209 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_REPLICATION_H
+#define NOVAPHYSICS_REPLICATION_H
+
+#include "novaphysics/internal.h"
+#include "novaphysics/space.h"
+
+
+/**
+ * @file replication.h
+ *
+ * @brief Quantized, delta-compressed body state replication.
+ *
+ * The encoder runs on the server. Every packet it writes contains the
+ * quantized states of the bodies that changed since a baseline snapshot the
+ * client has acknowledged, packed at bit level. Bodies whose quantized state
+ * is the same as in the baseline cost zero bits, so sleeping bodies are free
+ * once the client acknowledged the packet they fell asleep in.
+ *
+ * The decoder runs on the client, it keeps the same snapshot history and
+ * applies decoded states to the client space by body ID. Bodies must be
+ * created on the client by the application with matching IDs, replication
+ * only carries body states.
+ *
+ * Packet layout:
+ *  - 32 bits: sequence of the packet
+ *  - 32 bits: sequence of the baseline, @ref NV_REPLICATION_NO_BASELINE if none
+ *  - 17 bits: number of changed bodies, then for each one:
+ *    - 16 bits: body ID
+ *    - 5 bits: field mask (position, angle, linear velocity, angular velocity, sleeping)
+ *    - delta of each changed field against the baseline
+ *  - 17 bits: number of removed bodies, then 16 bits ID for each one
+ */
+
+
+// Number of snapshots kept for delta compression
+#define NV_REPLICATION_HISTORY 32
+
+// Baseline sequence used when packet is delta-compressed against nothing
+#define NV_REPLICATION_NO_BASELINE 0xFFFFFFFF
+
+
+/**
+ * @brief Quantization settings.
+ *
+ * Encoder and decoder must use the same settings.
+ */
+typedef struct {
+    nv_float position_precision; /**< Smallest representable position difference. */
+    nv_uint8 angle_bits; /**< Number of bits a full turn is quantized to. At most 31. */
+    nv_float linear_velocity_precision; /**< Smallest representable linear velocity difference. */
+    nv_float angular_velocity_precision; /**< Smallest representable angular velocity difference. */
+} nvReplicationSettings;
+
+/**
+ * @brief Default quantization settings.
+ *
+ * 1/512 units of position, 14-bit angles and 1/256 units of velocity.
+ */
+static const nvReplicationSettings nvReplicationSettings_DEFAULT = {
+    .position_precision = 1.0 / 512.0,
+    .angle_bits = 14,
+    .linear_velocity_precision = 1.0 / 256.0,
+    .angular_velocity_precision = 1.0 / 256.0
+};
+
+
+/**
+ * @brief Quantized state of a body.
+ */
+typedef struct {
+    bool present; /**< Is the body in the snapshot? */
+    bool is_sleeping; /**< Is the body sleeping? */
+    nv_int32 position[2]; /**< Quantized position. */
+    nv_int32 angle; /**< Quantized angle. */
+    nv_int32 linear_velocity[2]; /**< Quantized linear velocity. */
+    nv_int32 angular_velocity; /**< Quantized angular velocity. */
+} nvReplicatedState;
+
+/**
+ * @brief Quantized states of all bodies at one packet, indexed by body ID.
+ */
+typedef struct {
+    nv_uint32 sequence; /**< Sequence of the packet this snapshot belongs to. */
+    nvReplicatedState *states; /**< States indexed by body ID. */
+    size_t size; /**< Length of the states array. */
+} nvReplicationSnapshot;
+
+
+/**
+ * @brief Replication encoder.
+ */
+typedef struct {
+    nvSpace *space; /**< Space the states are read from. */
+    nvReplicationSettings settings; /**< Quantization settings. */
+
+    nvReplicationSnapshot history[NV_REPLICATION_HISTORY]; /**< Ring of the last sent snapshots. */
+    nv_uint32 sequence; /**< Sequence of the next packet. */
+    nv_uint32 acked; /**< Last sequence acknowledged by the client. */
+} nvReplicationEncoder;
+
+/**
+ * @brief Create new replication encoder.
+ *
+ * @param space Space to replicate
+ * @param settings Quantization settings
+ * @return nvReplicationEncoder *
+ */
+nvReplicationEncoder *nvReplicationEncoder_new(nvSpace *space, nvReplicationSettings settings);
+
+/**
+ * @brief Free replication encoder.
+ *
+ * @param encoder Replication encoder
+ */
+void nvReplicationEncoder_free(nvReplicationEncoder *encoder);
+
+/**
+ * @brief Encode the current state of the space into a packet.
+ *
+ * The packet is delta-compressed against the last acknowledged snapshot if it
+ * is still in the history, otherwise all bodies are written.
+ *
+ * Returns the number of bytes written, or 0 if the buffer is too small.
+ *
+ * @param encoder Replication encoder
+ * @param buffer Output buffer
+ * @param capacity Size of the output buffer in bytes
+ * @return size_t
+ */
+size_t nvReplicationEncoder_encode(
+    nvReplicationEncoder *encoder,
+    nv_uint8 *buffer,
+    size_t capacity
+);
+
+/**
+ * @brief Acknowledge that the client received a packet.
+ *
+ * The packet's snapshot is used as the baseline of the next packets.
+ *
+ * @param encoder Replication encoder
+ * @param sequence Sequence of the received packet
+ */
+void nvReplicationEncoder_ack(nvReplicationEncoder *encoder, nv_uint32 sequence);
+
+
+/**
+ * @brief Replication decoder.
+ */
+typedef struct {
+    nvReplicationSettings settings; /**< Quantization settings. */
+
+    nvReplicationSnapshot history[NV_REPLICATION_HISTORY]; /**< Ring of the last received snapshots. */
+    nv_uint32 latest; /**< Sequence of the latest applied packet. */
+    bool has_latest; /**< Was any packet applied yet? */
+} nvReplicationDecoder;
+
+/**
+ * @brief Create new replication decoder.
+ *
+ * @param settings Quantization settings
+ * @return nvReplicationDecoder *
+ */
+nvReplicationDecoder *nvReplicationDecoder_new(nvReplicationSettings settings);
+
+/**
+ * @brief Free replication decoder.
+ *
+ * @param decoder Replication decoder
+ */
+void nvReplicationDecoder_free(nvReplicationDecoder *decoder);
+
+/**
+ * @brief Decode a packet and apply the states to the bodies of the space.
+ *
+ * Bodies are matched by their IDs, states of IDs that aren't in the space are
+ * only kept for later deltas. Packets older than the latest applied one are
+ * stored but not applied.
+ *
+ * Returns false if the packet is malformed or its baseline isn't in the
+ * history anymore, nothing is applied in that case.
+ *
+ * @param decoder Replication decoder
+ * @param space Client space
+ * @param data Packet data
+ * @param size Size of the packet in bytes
+ * @param sequence Sequence of the decoded packet is written here, acknowledge it to the server
+ * @return bool
+ */
+bool nvReplicationDecoder_decode(
+    nvReplicationDecoder *decoder,
+    nvSpace *space,
+    const nv_uint8 *data,
+    size_t size,
+    nv_uint32 *sequence
+);
+
+
+#endif
\ No newline at end of file
@@ -40,6 +40,8 @@ typedef struct {
     nvVector2 position; /**< Position of the contact point. */
     nvVector2 ra; /**< Contact position relative to body A. */
     nvVector2 rb; /**< Contact position relative to body B. */
+    nvVector2 _presolve_ra; /**< Internal contact position relative to body A the reusable contact data was prepared with. */
+    nvVector2 _presolve_rb; /**< Internal contact position relative to body B the reusable contact data was prepared with. */
     nv_float adjusted_depth;
     nv_float a_angle0;
     nv_float b_angle0;
@@ -52,6 +54,8 @@ typedef struct {
 
     nv_float jn; /**< Accumulated normal impulse. */
     nv_float jt; /**< Accumulated tangential impulse. */
+    nv_float shock_jn; /**< Normal impulse accumulated in shock propagation passes, not warm-started. */
+    nv_float shock_jt; /**< Tangential impulse accumulated in shock propagation passes, not warm-started. */
 } nvContact;
 
 
@@ -74,6 +78,11 @@ typedef struct {
     
     nvContact contacts[2]; /**< Contact points. */
     nv_uint8 contact_count; /**< Contact point count. */
+
+    nv_uint64 _presolve_step; /**< Internal step the reusable contact data was prepared in, 0 if never. */
+    nvVector2 _presolve_normal; /**< Internal normal the reusable contact data was prepared with. */
+    nv_uint8 _presolve_count; /**< Internal contact count the reusable contact data was prepared with. */
+    nv_float _restitution; /**< Internal mixed restitution coefficient. */
 } nvResolution;
 
 
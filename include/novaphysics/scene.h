@@ -0,0 +1,303 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_SCENE_H
+#define NOVAPHYSICS_SCENE_H
+
+#include "novaphysics/internal.h"
+#include "novaphysics/space.h"
+
+
+/**
+ * @file scene.h
+ *
+ * @brief Binary scene files.
+ *
+ * A scene file stores the settings of a space, its bodies with their shapes
+ * and materials, and its constraints. It is made of fixed-size little-endian
+ * records so it can be memory-mapped and instantiated without parsing.
+ * Values are always stored as doubles, regardless of NV_USE_FLOAT.
+ *
+ * File layout:
+ *  - @ref nvSceneHeader
+ *  - body_count x @ref nvSceneBody
+ *  - vertex_count x 2 doubles, polygon vertices of all bodies
+ *  - constraint_count x @ref nvSceneConstraint
+ */
+
+
+// Magic number at the start of scene files ("NVSC")
+#define NV_SCENE_MAGIC 0x4353564E
+
+// Increased every time the file layout changes
+#define NV_SCENE_VERSION 1
+
+// Body index of a constraint end that is linked to the world
+#define NV_SCENE_NO_BODY 0xFFFFFFFF
+
+
+/**
+ * @brief Header at the start of a scene file.
+ *
+ * Step parameters aren't part of the space, they are stored so the scene can
+ * be replayed the way it was captured.
+ */
+typedef struct {
+    nv_uint32 magic; /**< Always NV_SCENE_MAGIC. */
+    nv_uint32 version; /**< Layout version, NV_SCENE_VERSION. */
+    nv_uint32 body_count; /**< Number of body records. */
+    nv_uint32 vertex_count; /**< Number of polygon vertices. */
+    nv_uint32 constraint_count; /**< Number of constraint records. */
+
+    nv_uint32 broadphase_algorithm; /**< Broad-phase algorithm. */
+    nv_uint32 position_correction; /**< Position correction algorithm. */
+    nv_uint32 mix_restitution; /**< Restitution mixing method. */
+    nv_uint32 mix_friction; /**< Friction mixing method. */
+    nv_uint32 sleep_timer_threshold; /**< Sleep timer threshold. */
+    nv_int32 collision_persistence; /**< Number of frames resolutions are kept cached. */
+    nv_uint8 sleeping; /**< Is sleeping allowed? */
+    nv_uint8 warmstarting; /**< Is warm-starting enabled? */
+    nv_uint8 use_kill_bounds; /**< Are kill bounds used? */
+    nv_uint8 _pad;
+
+    double gravity[2]; /**< Gravity. */
+    double sleep_energy_threshold; /**< Sleep energy threshold. */
+    double wake_energy_threshold; /**< Wake energy threshold. */
+    double kill_bounds[4]; /**< Kill bounds as min x, min y, max x, max y. */
+    double shg_bounds[4]; /**< SHG bounds as min x, min y, max x, max y. */
+    double shg_cell_size[2]; /**< SHG cell width and height. */
+
+    double dt; /**< Time step size. */
+    nv_uint32 velocity_iters; /**< Velocity solving iteration count. */
+    nv_uint32 position_iters; /**< Position solving iteration count. */
+    nv_uint32 constraint_iters; /**< Constraint solving iteration count. */
+    nv_uint32 substeps; /**< Substep count. */
+} nvSceneHeader;
+
+/**
+ * @brief Body record.
+ */
+typedef struct {
+    double position[2]; /**< Position. */
+    double angle; /**< Angle in radians. */
+    double linear_velocity[2]; /**< Linear velocity. */
+    double angular_velocity; /**< Angular velocity. */
+    double linear_damping; /**< Linear damping. */
+    double angular_damping; /**< Angular damping. */
+    double gravity_scale; /**< Gravity scale. */
+    double density; /**< Material density. */
+    double restitution; /**< Material restitution. */
+    double friction; /**< Material friction. */
+    double mass; /**< Mass, it might differ from the one calculated from density. */
+    double inertia; /**< Moment of inertia. */
+    double radius; /**< Radius if the shape is a circle. */
+
+    nv_uint32 first_vertex; /**< Index of the first vertex in the vertex pool if the shape is a polygon. */
+    nv_uint32 vertex_count; /**< Number of vertices if the shape is a polygon. */
+    nv_uint32 collision_group; /**< Collision group. */
+    nv_uint32 collision_category; /**< Collision category bitmask. */
+    nv_uint32 collision_mask; /**< Collision mask bitmask. */
+    nv_uint8 type; /**< Body type. */
+    nv_uint8 shape_type; /**< Shape type. */
+    nv_uint8 enable_collision; /**< Is collision enabled? */
+    nv_uint8 is_attractor; /**< Is the body an attractor? */
+} nvSceneBody;
+
+/**
+ * @brief Constraint record.
+ *
+ * Only the fields of the constraint's type are meaningful.
+ */
+typedef struct {
+    nv_uint32 type; /**< Constraint type. */
+    nv_uint32 a; /**< Index of the first body, NV_SCENE_NO_BODY if linked to world. */
+    nv_uint32 b; /**< Index of the second body, NV_SCENE_NO_BODY if linked to world. */
+    nv_uint8 enable_limits; /**< Hinge joint: are angle limits enabled? */
+    nv_uint8 _pad[3];
+
+    double anchor[2]; /**< Hinge joint: anchor in world space. */
+    double anchor_a[2]; /**< Anchor on body A. */
+    double anchor_b[2]; /**< Anchor on body B. */
+    double length; /**< Spring & distance joint: length. */
+    double stiffness; /**< Spring: stiffness. */
+    double damping; /**< Spring: damping. */
+    double reference_angle; /**< Hinge joint: reference angle. */
+    double lower_limit; /**< Hinge joint: lower angle limit. */
+    double upper_limit; /**< Hinge joint: upper angle limit. */
+} nvSceneConstraint;
+
+
+/**
+ * @brief Create a record of the body.
+ *
+ * Polygon vertices aren't part of the record, first_vertex is left 0.
+ *
+ * @param body Body
+ * @return nvSceneBody
+ */
+nvSceneBody nvSceneBody_from_body(nvBody *body);
+
+/**
+ * @brief Check that the body record describes a body that can be created.
+ *
+ * @param record Body record
+ * @return bool
+ */
+bool nvSceneBody_is_valid(const nvSceneBody *record);
+
+/**
+ * @brief Create a new body from a valid record.
+ *
+ * @param record Body record
+ * @param vertices Polygon vertices of the body, x and y of each one. Ignored for circles.
+ * @return nvBody *
+ */
+nvBody *nvSceneBody_create(const nvSceneBody *record, const double *vertices);
+
+/**
+ * @brief Create a record of the constraint.
+ *
+ * @param cons Constraint
+ * @param a Value stored to refer to the first body
+ * @param b Value stored to refer to the second body
+ * @return nvSceneConstraint
+ */
+nvSceneConstraint nvSceneConstraint_from_constraint(
+    nvConstraint *cons,
+    nv_uint32 a,
+    nv_uint32 b
+);
+
+/**
+ * @brief Create a new constraint from a record.
+ *
+ * @param record Constraint record
+ * @param a First body, NULL if linked to world
+ * @param b Second body, NULL if linked to world
+ * @return nvConstraint *
+ */
+nvConstraint *nvSceneConstraint_create(
+    const nvSceneConstraint *record,
+    nvBody *a,
+    nvBody *b
+);
+
+
+/**
+ * @brief Scene file opened for instantiating.
+ */
+typedef struct {
+    void *memory; /**< Mapped (or read) file contents. */
+    size_t size; /**< Size of the file in bytes. */
+    bool mapped; /**< Is the memory mapped or allocated? */
+
+    const nvSceneHeader *header; /**< Header of the scene. */
+    const nvSceneBody *bodies; /**< Body records. */
+    const double *vertices; /**< Vertex pool, x and y of each vertex. */
+    const nvSceneConstraint *constraints; /**< Constraint records. */
+} nvScene;
+
+/**
+ * @brief Save the space with its bodies and constraints to a scene file.
+ *
+ * Step parameters are stored in the header along with the space settings.
+ * Returns false if the file can't be written or a constraint is linked to
+ * a body that isn't in the space.
+ *
+ * @param space Space
+ * @param filename Path of the scene file
+ * @param dt Time step size
+ * @param velocity_iters Velocity solving iteration count
+ * @param position_iters Position solving iteration count
+ * @param constraint_iters Constraint solving iteration count
+ * @param substeps Substep count
+ * @return bool
+ */
+bool nvScene_save(
+    nvSpace *space,
+    const char *filename,
+    nv_float dt,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+);
+
+/**
+ * @brief Serialize the space into a newly allocated buffer in the scene file layout.
+ *
+ * The buffer must be freed by the caller. Returns 0 if the space can't be
+ * serialized, nothing is allocated in that case.
+ *
+ * @param space Space
+ * @param data Pointer to the buffer is written here
+ * @param dt Time step size
+ * @param velocity_iters Velocity solving iteration count
+ * @param position_iters Position solving iteration count
+ * @param constraint_iters Constraint solving iteration count
+ * @param substeps Substep count
+ * @return size_t Size of the buffer in bytes
+ */
+size_t nvScene_serialize(
+    nvSpace *space,
+    nv_uint8 **data,
+    nv_float dt,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+);
+
+/**
+ * @brief Open a scene file.
+ *
+ * The file is memory-mapped on POSIX systems and read into memory elsewhere.
+ * All records are validated here. Returns NULL if the file can't be read or
+ * isn't a valid scene.
+ *
+ * @param filename Path of the scene file
+ * @return nvScene *
+ */
+nvScene *nvScene_open(const char *filename);
+
+/**
+ * @brief Open a scene from a buffer in the scene file layout.
+ *
+ * The data is copied, so the buffer can be freed afterwards. Returns NULL if
+ * the data isn't a valid scene.
+ *
+ * @param data Scene data
+ * @param size Size of the data in bytes
+ * @return nvScene *
+ */
+nvScene *nvScene_open_memory(const void *data, size_t size);
+
+/**
+ * @brief Close a scene file.
+ *
+ * Bodies and constraints instantiated from the scene don't depend on it.
+ *
+ * @param scene Scene
+ */
+void nvScene_close(nvScene *scene);
+
+/**
+ * @brief Apply the scene's settings to the space and add its bodies and constraints.
+ *
+ * Bodies are added in the order they were saved in, so they get the same IDs
+ * when the space is empty.
+ *
+ * @param scene Scene
+ * @param space Space
+ */
+void nvScene_instantiate(const nvScene *scene, nvSpace *space);
+
+
+#endif
\ No newline at end of file
@@ -30,6 +30,16 @@ typedef struct {
     nvArray *cell;
 } nvSHGEntry;
 
+/**
+ * @brief Range of cells an AABB covers, bounds are inclusive.
+ */
+typedef struct {
+    nv_int16 min_x;
+    nv_int16 min_y;
+    nv_int16 max_x;
+    nv_int16 max_y;
+} nvSHGRange;
+
 
 /**
  * @brief Spatial Hash Grid struct.
@@ -40,7 +50,8 @@ typedef struct {
     nv_uint32 rows; /**< Rows of the grid (cells on Y axis). */
     nv_float cell_width; /**< Width of one cell. */
     nv_float cell_height; /**< Height of one cell. */
-    nvHashMap *map; /**< Hashmap used internally to store cells. */
+    nvHashMap *map; /**< Hashmap used internally to store cells of moving bodies. */
+    nvHashMap *parked_map; /**< Hashmap of cells resting bodies are parked in. */
 } nvSHG;
 
 /**
@@ -80,6 +91,79 @@ nvArray *nvSHG_get(nvSHG *shg, nv_uint32 key);
  */
 void nvSHG_place(nvSHG *shg, nvArray *bodies);
 
+/**
+ * @brief Get range of cells an AABB covers.
+ * 
+ * @param shg Spatial Hash Grid
+ * @param aabb AABB
+ * @return nvSHGRange 
+ */
+nvSHGRange nvSHG_get_range(nvSHG *shg, nvAABB aabb);
+
+/**
+ * @brief Insert a body into the cells of a range.
+ * 
+ * Unlike @ref nvSHG_place, this doesn't touch any other body. The body stays
+ * in its cells until it is removed with the same range.
+ * 
+ * @param shg Spatial Hash Grid
+ * @param body Body
+ * @param range Cells the body covers
+ */
+void nvSHG_insert(nvSHG *shg, void *body, nvSHGRange range);
+
+/**
+ * @brief Remove a body from the cells of a range.
+ * 
+ * @param shg Spatial Hash Grid
+ * @param body Body
+ * @param range Cells the body was inserted into
+ */
+void nvSHG_remove(nvSHG *shg, void *body, nvSHGRange range);
+
+/**
+ * @brief Remove all bodies from the cells, parked bodies are kept.
+ * 
+ * @param shg Spatial Hash Grid
+ */
+void nvSHG_clear(nvSHG *shg);
+
+/**
+ * @brief Get content of one parked cell.
+ * 
+ * @param shg Spatial Hash Grid
+ * @param key Cell key
+ * @return nvArray * 
+ */
+nvArray *nvSHG_get_parked(nvSHG *shg, nv_uint32 key);
+
+/**
+ * @brief Park a body in the persistent cells of a range.
+ * 
+ * Parked bodies stay in their cells until they are unparked with the same range.
+ * 
+ * @param shg Spatial Hash Grid
+ * @param body Body
+ * @param range Cells the body covers
+ */
+void nvSHG_park(nvSHG *shg, void *body, nvSHGRange range);
+
+/**
+ * @brief Remove a parked body from the persistent cells of a range.
+ * 
+ * @param shg Spatial Hash Grid
+ * @param body Body
+ * @param range Cells the body was parked in
+ */
+void nvSHG_unpark(nvSHG *shg, void *body, nvSHGRange range);
+
+/**
+ * @brief Remove all parked bodies.
+ * 
+ * @param shg Spatial Hash Grid
+ */
+void nvSHG_clear_parked(nvSHG *shg);
+
 /**
  * @brief Get neighboring cell information.
  * 
@@ -0,0 +1,193 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_SHM_H
+#define NOVAPHYSICS_SHM_H
+
+#include "novaphysics/internal.h"
+#include "novaphysics/space.h"
+#include "novaphysics/profiler.h"
+
+
+/**
+ * @file shm.h
+ *
+ * @brief Shared-memory state export for out-of-process viewers.
+ *
+ * The exporter writes packed body transforms, AABBs, contact points and
+ * profiler data of every frame into a ring of slots in a POSIX shared-memory
+ * object. Each slot is guarded by a seqlock: the sequence is odd while the
+ * slot is being written, readers copy the slot and retry if the sequence
+ * changed in the meantime. So the simulation thread never waits on a reader.
+ *
+ * Shared memory is only supported on POSIX systems, on other platforms the
+ * exporter and reader can't be created.
+ *
+ * Memory layout:
+ *  - @ref nvShmHeader
+ *  - slot_count slots, slot_size bytes each:
+ *    - @ref nvShmFrame
+ *    - max_bodies x @ref nvShmBody
+ *    - max_contacts x @ref nvShmContact
+ */
+
+
+// Magic number at the start of the shared memory ("NVSH")
+#define NV_SHM_MAGIC 0x4853564E
+
+// Increased every time the memory layout changes
+#define NV_SHM_VERSION 2
+
+
+/**
+ * @brief Header at the start of the shared memory.
+ */
+typedef struct {
+    nv_uint32 magic; /**< Always NV_SHM_MAGIC. */
+    nv_uint32 version; /**< Layout version, NV_SHM_VERSION. */
+    nv_uint32 slot_count; /**< Number of frame slots in the ring. */
+    nv_uint32 slot_size; /**< Size of a slot in bytes. */
+    nv_uint32 max_bodies; /**< Number of body records in a slot. */
+    nv_uint32 max_contacts; /**< Number of contact records in a slot. */
+    nv_uint32 profiler_size; /**< Size of the profiler data, to detect mismatching builds. */
+    nv_uint32 latest_frame; /**< Number of the last completely written frame, 0 if none.
+                                 Frame N is stored in slot N % slot_count. */
+} nvShmHeader;
+
+/**
+ * @brief Header of a frame slot.
+ */
+typedef struct {
+    nv_uint32 sequence; /**< Seqlock sequence, odd while the slot is being written. */
+    nv_uint32 frame; /**< Number of the frame. */
+    nv_uint32 body_count; /**< Number of bodies written. */
+    nv_uint32 contact_count; /**< Number of contacts written. */
+    nv_uint32 total_bodies; /**< Number of bodies in the space, might exceed max_bodies. */
+    nv_uint32 total_contacts; /**< Number of contacts in the space, might exceed max_contacts. */
+    nvProfiler profiler; /**< Profiler data of the step. */
+} nvShmFrame;
+
+/**
+ * @brief Packed body record.
+ */
+typedef struct {
+    nv_uint16 id; /**< Body ID. */
+    nv_uint8 type; /**< Body type. */
+    nv_uint8 is_sleeping; /**< Is the body sleeping? */
+    float position[2]; /**< Position. */
+    float angle; /**< Angle in radians. */
+    float aabb[4]; /**< AABB as min x, min y, max x, max y. */
+} nvShmBody;
+
+/**
+ * @brief Packed contact point record.
+ */
+typedef struct {
+    float position[2]; /**< Contact point. */
+    float normal[2]; /**< Collision normal. */
+} nvShmContact;
+
+
+/**
+ * @brief Shared-memory state exporter.
+ */
+typedef struct {
+    char *name; /**< Name of the shared-memory object. */
+    void *memory; /**< Mapped memory. */
+    size_t size; /**< Size of the mapped memory. */
+    nvShmHeader *header; /**< Header at the start of the memory. */
+    nv_uint32 frame; /**< Number of the last written frame. */
+} nvShmExporter;
+
+/**
+ * @brief Create a shared-memory object and an exporter writing to it.
+ *
+ * Name should start with a slash, like "/nova_physics". Returns NULL if the
+ * shared memory can't be created or the platform doesn't support it.
+ *
+ * @param name Name of the shared-memory object
+ * @param max_bodies Maximum number of bodies written per frame
+ * @param max_contacts Maximum number of contact points written per frame
+ * @param slot_count Number of frames kept in the ring
+ * @return nvShmExporter *
+ */
+nvShmExporter *nvShmExporter_new(
+    const char *name,
+    size_t max_bodies,
+    size_t max_contacts,
+    size_t slot_count
+);
+
+/**
+ * @brief Free the exporter and remove the shared-memory object.
+ *
+ * @param exporter Exporter
+ */
+void nvShmExporter_free(nvShmExporter *exporter);
+
+/**
+ * @brief Write the current state of the space as a new frame.
+ *
+ * Call this after stepping the space, from the thread that steps it.
+ *
+ * @param exporter Exporter
+ * @param space Space
+ */
+void nvShmExporter_write(nvShmExporter *exporter, nvSpace *space);
+
+
+/**
+ * @brief Shared-memory state reader.
+ */
+typedef struct {
+    void *memory; /**< Mapped memory. */
+    size_t size; /**< Size of the mapped memory. */
+    nvShmHeader *header; /**< Header at the start of the memory. */
+} nvShmReader;
+
+/**
+ * @brief Map an exporter's shared memory for reading.
+ *
+ * Returns NULL if the object doesn't exist or its layout doesn't match.
+ *
+ * @param name Name of the shared-memory object
+ * @return nvShmReader *
+ */
+nvShmReader *nvShmReader_open(const char *name);
+
+/**
+ * @brief Unmap the shared memory and free the reader.
+ *
+ * @param reader Reader
+ */
+void nvShmReader_close(nvShmReader *reader);
+
+/**
+ * @brief Copy the latest frame out of the shared memory.
+ *
+ * Bodies and contacts buffers must have room for header's max_bodies and
+ * max_contacts records. Returns false if no frame was written yet or a
+ * consistent copy couldn't be taken because the writer kept overwriting it.
+ *
+ * @param reader Reader
+ * @param frame Frame header output
+ * @param bodies Body records output
+ * @param contacts Contact records output
+ * @return bool
+ */
+bool nvShmReader_read(
+    nvShmReader *reader,
+    nvShmFrame *frame,
+    nvShmBody *bodies,
+    nvShmContact *contacts
+);
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_SHOCK_PROPAGATION_H
+#define NOVAPHYSICS_SHOCK_PROPAGATION_H
+
+#include "novaphysics/internal.h"
+#include "novaphysics/array.h"
+#include "novaphysics/body.h"
+#include "novaphysics/resolution.h"
+#include "novaphysics/vector.h"
+
+
+/**
+ * @file shock_propagation.h
+ *
+ * @brief Contact graph layering for shock propagation.
+ */
+
+
+// Minimum |cos| between a contact normal and gravity for the contact to support a body
+#define NV_SHOCK_SUPPORT_COS 0.5
+
+// Level of bodies that aren't supported by any static body
+#define NV_SHOCK_NO_LEVEL 0xFFFFFFFF
+
+
+/**
+ * @brief Contact graph layered from static bodies upward.
+ *
+ * Static bodies are on level 0 and every other body is one level above the
+ * lowest body supporting it. A contact supports a body if its normal is
+ * aligned with gravity, so bodies side by side aren't stacked on top of each
+ * other. Without gravity every contact supports.
+ *
+ * Resolutions are ordered from the bottom level up, so impulses travel up a
+ * stack in one iteration. In the last velocity iterations the lower body of a
+ * supporting contact is treated as having infinite mass, so the upper body
+ * can't push it down into the bodies below.
+ */
+typedef struct {
+    nvResolution **order; /**< Resolutions ordered by level. */
+    nvBody **fixed; /**< Body treated as having infinite mass for each ordered resolution, NULL if none. */
+    size_t count; /**< Number of ordered resolutions. */
+    size_t capacity; /**< Allocated number of resolutions. */
+
+    nv_uint32 *levels; /**< Body ID -> level lookup table. */
+    nv_uint32 *_heads; /**< Internal body ID -> first edge of the body. */
+    size_t _id_capacity; /**< Internal length of the lookup tables. */
+
+    nv_uint32 *_next; /**< Internal next edge of the same body, every resolution has two edges. */
+    nv_uint32 *_queue; /**< Internal body IDs waiting to be visited. */
+    nv_uint32 *_buckets; /**< Internal number of resolutions on each level. */
+    size_t _bucket_capacity; /**< Internal allocated number of levels. */
+} nvShockGraph;
+
+/**
+ * @brief Create new shock graph.
+ *
+ * @return nvShockGraph *
+ */
+nvShockGraph *nvShockGraph_new();
+
+/**
+ * @brief Free shock graph.
+ *
+ * @param graph Shock graph
+ */
+void nvShockGraph_free(nvShockGraph *graph);
+
+/**
+ * @brief Compute levels of the bodies and order the resolutions.
+ *
+ * Resolutions on the same level keep their order. Returns false if the
+ * buffers couldn't be allocated.
+ *
+ * @param graph Shock graph
+ * @param resolutions Array of resolutions
+ * @param gravity Gravity of the space
+ * @return bool
+ */
+bool nvShockGraph_build(nvShockGraph *graph, nvArray *resolutions, nvVector2 gravity);
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,214 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_SOFT_BODY_H
+#define NOVAPHYSICS_SOFT_BODY_H
+
+#include "novaphysics/internal.h"
+#include "novaphysics/array.h"
+#include "novaphysics/aabb.h"
+#include "novaphysics/cell_grid.h"
+#include "novaphysics/material.h"
+#include "novaphysics/particle.h"
+#include "novaphysics/vector.h"
+
+
+/**
+ * @file soft_body.h
+ *
+ * @brief Mass-spring soft bodies and cloth.
+ */
+
+
+// Default number of substeps soft bodies divide each space substep into
+#define NV_SOFT_BODY_SUBSTEPS 4
+
+// Default number of link iterations in each soft body substep
+#define NV_SOFT_BODY_ITERATIONS 1
+
+// Number of colours links are distributed into, links that don't fit are solved serially
+#define NV_SOFT_BODY_COLORS 32
+
+// Minimum number of links in a colour to solve it on multiple threads
+#define NV_SOFT_BODY_PARALLEL_THRESHOLD 4096
+
+
+/**
+ * @brief Soft body struct.
+ *
+ * A soft body is a set of point masses connected with distance links, solved
+ * with XPBD (extended position based dynamics). It is stepped as one unit
+ * after the bodies: it has no bodies, constraints or resolutions of its own
+ * and it takes one bounding box test per body in the space to find the
+ * bodies it can touch.
+ *
+ * Links are coloured so that no two links of the same colour move the same
+ * point. Links of a colour are solved on multiple threads and in AVX
+ * batches, colours are solved one after another (Gauss-Seidel). Links are
+ * reordered by colour when the soft body is stepped after links were added,
+ * so link indices aren't stable.
+ *
+ * Points collide with the bodies as circles with the soft body's radius. With
+ * self collision enabled they also collide with each other, so the radius
+ * should be less than half the rest length of the links. Sleeping bodies are
+ * treated as static until points hit them fast enough to wake them up with
+ * two-way coupling.
+ */
+typedef struct nvSoftBody {
+    struct nvSpace *space; /**< Space instance the soft body is in. */
+
+    nv_float *position_x; /**< X positions of the points. */
+    nv_float *position_y; /**< Y positions of the points. */
+    nv_float *velocity_x; /**< X components of the point velocities. */
+    nv_float *velocity_y; /**< Y components of the point velocities. */
+    nv_float *invmass; /**< Inverse masses of the points, 0 for pinned points. */
+    size_t count; /**< Number of points. */
+    size_t capacity; /**< Allocated number of points. */
+
+    nv_uint32 *link_a; /**< First points of the links. */
+    nv_uint32 *link_b; /**< Second points of the links. */
+    nv_float *rest_length; /**< Rest lengths of the links. */
+    nv_float *compliance; /**< Compliances (inverse stiffnesses) of the links, 0 is rigid. */
+    size_t link_count; /**< Number of links. */
+    size_t link_capacity; /**< Allocated number of links. */
+
+    size_t color_starts[NV_SOFT_BODY_COLORS + 2]; /**< Links of colour i are in [color_starts[i], color_starts[i + 1]).
+                                                        The last colour holds the links solved serially. */
+
+    nv_float radius; /**< Collision radius of the points. */
+    nvMaterial material; /**< Material of the points, density isn't used. Restitution isn't used, collisions are inelastic. */
+    nv_float gravity_scale; /**< Scale multiplier to the gravity applied to the points. 1.0 by default. */
+    nv_float linear_damping; /**< Amount of damping applied to the point velocities. */
+    size_t substeps; /**< Number of substeps the soft body is advanced in every space substep. */
+    size_t iterations; /**< Number of link iterations in each substep. */
+    nvParticleCoupling coupling; /**< How the points and bodies affect each other. */
+
+    bool self_collision; /**< Whether points collide with each other or not. False by default. */
+    nv_uint32 collision_category; /**< Bitmask defining the soft body's collision category. */
+    nv_uint32 collision_mask; /**< Bitmask defining the soft body's collision mask. */
+
+    nvAABB bounds; /**< Bounding box of the points in the last substep, before collisions were solved. */
+
+    nv_float *_prev_x; /**< Internal X positions at the beginning of the substep. */
+    nv_float *_prev_y; /**< Internal Y positions at the beginning of the substep. */
+    nv_float *_delta_x; /**< Internal X components of the self collision corrections, in grid order. */
+    nv_float *_delta_y; /**< Internal Y components of the self collision corrections, in grid order. */
+    nv_float *_sorted_x; /**< Internal X positions in grid order. */
+    nv_float *_sorted_y; /**< Internal Y positions in grid order. */
+    nv_float *_sorted_w; /**< Internal inverse masses in grid order. */
+    nv_uint32 *_color_masks; /**< Internal colours the points are used in. */
+    nvArray *_bodies; /**< Internal bodies near the points in the current substep. */
+    nvCellGrid _grid; /**< Internal self collision grid, points aren't moved into grid order. */
+
+    nv_float *_lambda; /**< Internal accumulated link multipliers of the substep. */
+    nv_uint8 *_link_colors; /**< Internal colours of the links. */
+    nv_uint32 *_staged_a; /**< Internal buffer first points of the links are sorted into. */
+    nv_uint32 *_staged_b; /**< Internal buffer second points of the links are sorted into. */
+    nv_float *_staged_rest; /**< Internal buffer rest lengths of the links are sorted into. */
+    nv_float *_staged_compliance; /**< Internal buffer compliances of the links are sorted into. */
+    bool _dirty; /**< Internal flag telling links need to be coloured again. */
+
+    nvVector2 *_normals; /**< Internal edge normals of the polygon body being solved. */
+    size_t _normal_capacity; /**< Internal allocated number of normals. */
+} nvSoftBody;
+
+/**
+ * @brief Create a new soft body without any points.
+ *
+ * @param radius Collision radius of the points
+ * @param material Material of the points
+ * @return nvSoftBody *
+ */
+nvSoftBody *nvSoftBody_new(nv_float radius, nvMaterial material);
+
+/**
+ * @brief Create a cloth.
+ *
+ * Points are laid out in a grid, row by row, with the top-left point at the
+ * given position. Neighbouring points are connected with structural links and
+ * diagonal neighbours with shear links. Collision radius of the points is
+ * 0.4 times the spacing. Returns NULL if the cloth couldn't be allocated.
+ *
+ * @param position Position of the first point
+ * @param columns Number of points in a row
+ * @param rows Number of rows
+ * @param spacing Distance between neighbouring points
+ * @param mass Mass of each point
+ * @param compliance Compliance of the links
+ * @param material Material of the points
+ * @return nvSoftBody *
+ */
+nvSoftBody *nvSoftBody_new_cloth(
+    nvVector2 position,
+    size_t columns,
+    size_t rows,
+    nv_float spacing,
+    nv_float mass,
+    nv_float compliance,
+    nvMaterial material
+);
+
+/**
+ * @brief Free soft body.
+ *
+ * @param sb Soft body
+ */
+void nvSoftBody_free(void *sb);
+
+/**
+ * @brief Add a point.
+ *
+ * The new point's index is the point count before adding. Returns false if the
+ * point couldn't be allocated.
+ *
+ * @param sb Soft body
+ * @param position Position of the point
+ * @param mass Mass of the point, 0 pins the point in place
+ * @return bool
+ */
+bool nvSoftBody_add_point(nvSoftBody *sb, nvVector2 position, nv_float mass);
+
+/**
+ * @brief Link two points.
+ *
+ * Rest length is the current distance between the points. Returns false if
+ * the link couldn't be allocated.
+ *
+ * @param sb Soft body
+ * @param a Index of the first point
+ * @param b Index of the second point
+ * @param compliance Compliance (inverse stiffness) of the link, 0 is rigid
+ * @return bool
+ */
+bool nvSoftBody_add_link(nvSoftBody *sb, size_t a, size_t b, nv_float compliance);
+
+/**
+ * @brief Set mass of a point.
+ *
+ * @param sb Soft body
+ * @param i Index of the point
+ * @param mass Mass, 0 pins the point in place
+ */
+void nvSoftBody_set_mass(nvSoftBody *sb, size_t i, nv_float mass);
+
+/**
+ * @brief Advance the soft body by one substep.
+ *
+ * This is called by the space after the bodies are stepped, it is only
+ * public for stepping soft bodies on their own.
+ *
+ * @param space Space, used for gravity, bodies and threading
+ * @param sb Soft body
+ * @param dt Time step size of the substep
+ */
+void nvSoftBody_step(struct nvSpace *space, nvSoftBody *sb, nv_float dt);
+
+
+#endif
\ No newline at end of file
@@ -19,10 +19,17 @@
 #include "novaphysics/contact.h"
 #include "novaphysics/constraint.h"
 #include "novaphysics/contact_solver.h"
+#include "novaphysics/position_solver.h"
+#include "novaphysics/shock_propagation.h"
+#include "novaphysics/particle.h"
+#include "novaphysics/soft_body.h"
+#include "novaphysics/articulation.h"
 #include "novaphysics/hashmap.h"
 #include "novaphysics/shg.h"
 #include "novaphysics/threading.h"
 #include "novaphysics/profiler.h"
+#include "novaphysics/space_view.h"
+#include "novaphysics/step_budget.h"
 
 
 /**
@@ -36,6 +43,19 @@
 typedef void ( *nvSpace_callback)(struct nvSpace *space, void *user_data);
 
 
+/**
+ * @brief Parameters of a step that is running asynchronously.
+ */
+typedef struct {
+    struct nvSpace *space; /**< Space that is being stepped. */
+    nv_float dt; /**< Time step size. */
+    size_t velocity_iters; /**< Velocity solving iteration count. */
+    size_t position_iters; /**< Position solving iteration count. */
+    size_t constraint_iters; /**< Constraint solving iteration count. */
+    size_t substeps; /**< Substep count. */
+} nvSpaceStepArgs;
+
+
 /**
  * @brief Space struct.
  * 
@@ -47,6 +67,9 @@ struct nvSpace {
     nvArray *awake_bodies;
     nvArray *attractors; /**< Array of attractive bodies in the space. */
     nvArray *constraints; /**< Array of constraints in the space. */
+    nvArray *particle_systems; /**< Array of particle systems in the space. */
+    nvArray *soft_bodies; /**< Array of soft bodies in the space. */
+    nvArray *articulations; /**< Array of articulations in the space. */
 
     nvArray *_removed_bodies; /**< Bodies that are waiting to be removed.
                                     You shouldn't access this directly, instead use @ref nvSpace_remove method. */
@@ -66,11 +89,22 @@ struct nvSpace {
     bool warmstarting; /**< Flag that specifies if solvers use warm-starting for accumulated impulses. */
     int collision_persistence; /**< Number of frames the collision resolutions kept cached. */
     nvPositionCorrection position_correction; /**< Position correction algorithm used. */
+    nvPresolveReuse presolve_reuse; /**< How contact data is prepared across substeps. */
+    nvPresolveDrift presolve_drift; /**< Drift of the reused contact data in the last step. */
+    size_t shock_propagation_iters; /**< Number of last velocity iterations that use shock propagation, 0 disables it.
+                                         Contacts are also solved from the bottom of stacks up while enabled. */
 
     nvBroadPhaseAlg broadphase_algorithm; /**< Broad-phase algorithm used to detect possible collisions. */
     nvHashMap *broadphase_pairs;
+    nvArray *_pair_order; /**< Broad-phase pairs sorted by body IDs, narrow-phase runs in this order. */
+    nvArray *_res_order; /**< Resolutions sorted by body IDs, contact solver runs in this order. */
+    nvPositionSolver *_position_solver; /**< Solver used for NGS position correction. */
+    nvShockGraph *_shock_graph; /**< Contact graph layers used by shock propagation. */
     nvSHG *shg; /**< Spatial Hash Grid object.
                      @warning Should be only accessed if the used broad-phase algorithm is SHG. */
+    nvArray *_shg_moving; /**< Bodies in the SHG's cells of moving bodies, kept across broad-phases. */
+    nvArray *_shg_dirty; /**< New, woken up or moved parked bodies to place again at the next broad-phase. */
+    nv_int16 _shg_drift; /**< Most cells a body moved out of its SHG range since the broad-phase. */
 
     nvAABB kill_bounds; /**< Boundary where bodies get deleted if they go out of. */
     bool use_kill_bounds; /**< Whether to use the kill bounds or not. True by default. */
@@ -83,14 +117,39 @@ struct nvSpace {
     nvSpace_callback after_collision; /**< Callback function called after solving collisions. */
 
     nvProfiler profiler; /**< Profiler. */
+    nvProfilerHook profiler_hook; /**< Hook called around profiled phases, NULL by default.
+                                       Only called in builds with NV_PROFILE. */
+    void *profiler_hook_data; /**< User data passed to the profiler hook. */
+    nvTracer *tracer; /**< Tracer recording step phases and parallel ranges, NULL by default. */
+    nvProfilerPhase _trace_phase; /**< Phase parallel ranges are currently traced under. */
+    nv_uint64 _trace_begins[nvProfilerPhase_COUNT]; /**< Begin times of the traced phases. */
 
     bool multithreading; /**< Whether multi-threading is enabled or not. */
     size_t thread_count; /**< Number of threads Nova Physics utilizes.
                               0 if multithreading is disabled. */
-    nvTaskExecutor *task_executor; /**< Task executor. */
+    nvTaskExecutor *task_executor; /**< Built-in task executor.
+                                        NULL if multithreading is disabled or a host task interface is used. */
+    nvTaskInterface task_interface; /**< Task interface used to run parallel phases of the step. */
+    nvTaskExecutorSettings task_executor_settings; /**< Settings used to create the built-in task executor. */
+    size_t parallel_body_threshold; /**< Minimum number of bodies to run parallel phases on multiple threads. */
     nvArray *mt_shg_pairs;
     nvArray *mt_shg_bins;
 
+    bool capture_views; /**< Whether to capture read-only body views at the end of each step.
+                             Enabled automatically by @ref nvSpace_step_async. */
+    nvSpaceView *_views[2]; /**< Double-buffered views. */
+    nv_uint8 _front_view; /**< Index of the view that belongs to the last finished step. */
+    nv_uint64 _step_count; /**< Number of finished steps. */
+    bool _multirate; /**< Are bodies simulated at different rates in the current step? */
+
+    nvTaskExecutor *_step_executor; /**< Executor that runs asynchronous steps. */
+    nvSpaceStepArgs _async_args; /**< Parameters of the running asynchronous step. */
+    bool _async_running; /**< Is there an asynchronous step running? */
+
+    nvStepCostModel step_cost_model; /**< Cost model used by @ref nvSpace_step_budget. */
+
+    struct nvRecorder *recorder; /**< Recorder attached to the space, NULL if not recording. */
+
     nv_uint16 _id_counter; /**< Internal ID counter. */
 };
 
@@ -180,6 +239,76 @@ void nvSpace_kill(nvSpace *space, nvBody *body);
  */
 void nvSpace_add_constraint(nvSpace *space, nvConstraint *cons);
 
+/**
+ * @brief Add particle system to space.
+ * 
+ * Particle systems are stepped after the bodies in every substep. Like bodies,
+ * they are freed with the space.
+ * 
+ * @param space Space
+ * @param ps Particle system to add
+ */
+void nvSpace_add_particles(nvSpace *space, nvParticleSystem *ps);
+
+/**
+ * @brief Remove particle system from the space.
+ * 
+ * Unlike bodies, the removal is immediate so it shouldn't be called from
+ * collision callbacks. After removing, managing the particle system's memory
+ * belongs to user.
+ * 
+ * @param space Space
+ * @param ps Particle system to remove
+ */
+void nvSpace_remove_particles(nvSpace *space, nvParticleSystem *ps);
+
+/**
+ * @brief Add soft body to space.
+ * 
+ * Soft bodies are stepped after the particle systems in every substep. Like
+ * bodies, they are freed with the space.
+ * 
+ * @param space Space
+ * @param sb Soft body to add
+ */
+void nvSpace_add_soft_body(nvSpace *space, nvSoftBody *sb);
+
+/**
+ * @brief Remove soft body from the space.
+ * 
+ * Unlike bodies, the removal is immediate so it shouldn't be called from
+ * collision callbacks. After removing, managing the soft body's memory
+ * belongs to user.
+ * 
+ * @param space Space
+ * @param sb Soft body to remove
+ */
+void nvSpace_remove_soft_body(nvSpace *space, nvSoftBody *sb);
+
+/**
+ * @brief Add articulation to space.
+ * 
+ * Link bodies have to be added to the space separately. Like bodies,
+ * articulations are freed with the space.
+ * 
+ * @param space Space
+ * @param art Articulation to add
+ */
+void nvSpace_add_articulation(nvSpace *space, nvArticulation *art);
+
+/**
+ * @brief Remove articulation from the space.
+ * 
+ * Unlike bodies, the removal is immediate so it shouldn't be called from
+ * collision callbacks. Link bodies stay in the space and they aren't moved by
+ * the articulation until it is added again. After removing, managing the
+ * articulation's memory belongs to user.
+ * 
+ * @param space Space
+ * @param art Articulation to remove
+ */
+void nvSpace_remove_articulation(nvSpace *space, nvArticulation *art);
+
 /**
  * @brief Advance the simulation.
  * 
@@ -211,6 +340,134 @@ void nvSpace_step(
     size_t substeps
 );
 
+/**
+ * @brief Advance the simulation within a time budget.
+ * 
+ * Iteration and substep counts are the highest quality the step may use.
+ * Before stepping, the space's cost model predicts the step time and the
+ * step runs with the highest quality that fits into the budget. Iterations
+ * are reduced first and substeps after them. Under heavy load sleep thresholds
+ * are also coarsened for the step so more bodies can rest. After stepping the
+ * cost model learns from the measured times.
+ * 
+ * The budget can still be missed on the first steps while the model is
+ * learning, if even a single substep with one iteration doesn't fit, or on
+ * steps where many bodies that weren't near each other collide at once. See
+ * @ref nvStepCostModel for what the prediction is based on.
+ * 
+ * @param space Space instance
+ * @param dt Time step size (delta time)
+ * @param budget_ms Time budget of the step in milliseconds
+ * @param velocity_iters Maximum velocity solving iteration count
+ * @param position_iters Maximum position solving iteration count
+ * @param constraint_iters Maximum constraint solving iteration count
+ * @param substeps Maximum substep count
+ * @return nvStepQuality
+ */
+nvStepQuality nvSpace_step_budget(
+    nvSpace *space,
+    nv_float dt,
+    double budget_ms,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+);
+
+/**
+ * @brief Predict how long a step would take with the space's cost model.
+ * 
+ * @param space Space instance
+ * @param velocity_iters Velocity solving iteration count
+ * @param position_iters Position solving iteration count
+ * @param constraint_iters Constraint solving iteration count
+ * @param substeps Substep count
+ * @return double Predicted time in milliseconds
+ */
+double nvSpace_predict_step_time(
+    nvSpace *space,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+);
+
+/**
+ * @brief Set simulation rate tier of the dynamic bodies inside a region.
+ * 
+ * Bodies are tested by their positions. See @ref nvBody_set_sim_tier.
+ * 
+ * @param space Space instance
+ * @param region Region in world space
+ * @param tier Tier, between 0 (full rate) and NV_SIM_TIERS - 1
+ */
+void nvSpace_set_sim_tier_region(nvSpace *space, nvAABB region, nv_uint8 tier);
+
+/**
+ * @brief Set simulation rate tiers of all dynamic bodies by their distance to focus points.
+ * 
+ * Bodies within the radius of the nearest focus point (like the players) are
+ * simulated at full rate. Each following tier covers a ring twice as far out,
+ * so bodies within 2x radius are in tier 1, within 4x radius in tier 2 and so on.
+ * 
+ * @param space Space instance
+ * @param points Focus points
+ * @param count Number of focus points
+ * @param radius Radius of the full rate region
+ */
+void nvSpace_set_sim_tiers_by_distance(
+    nvSpace *space,
+    nvVector2 *points,
+    size_t count,
+    nv_float radius
+);
+
+/**
+ * @brief Start advancing the simulation in the background and return immediately.
+ * 
+ * The step runs on a separate thread with the same parameters as @ref nvSpace_step.
+ * Until @ref nvSpace_step_wait is called, the space and its bodies must not be
+ * accessed or modified. Use the view returned by @ref nvSpace_get_view to read
+ * the state of the previous step while the asynchronous step is running.
+ * 
+ * Calling this enables view capturing.
+ * 
+ * @param space Space instance
+ * @param dt Time step size (delta time)
+ * @param velocity_iters Velocity solving iteration count
+ * @param position_iters Position solving iteration count
+ * @param constraint_iters Constraint solving iteration count
+ * @param substeps Substep count
+ */
+void nvSpace_step_async(
+    nvSpace *space,
+    nv_float dt,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+);
+
+/**
+ * @brief Wait for the asynchronous step to finish.
+ * 
+ * This publishes the new view, views obtained before this call shouldn't be used after.
+ * Does nothing if there isn't an asynchronous step running.
+ * 
+ * @param space Space
+ */
+void nvSpace_step_wait(nvSpace *space);
+
+/**
+ * @brief Get the read-only view of the last finished step.
+ * 
+ * Returns `NULL` if view capturing is disabled.
+ * 
+ * @param space Space
+ * @return const nvSpaceView *
+ */
+const nvSpaceView *nvSpace_get_view(nvSpace *space);
+
 /**
  * @brief Enable sleeping.
  * 
@@ -230,6 +487,10 @@ void nvSpace_disable_sleeping(nvSpace *space);
  * 
  * If the given number of threads is 0, system's CPU core count is used.
  * 
+ * The task executor is created with space's task_executor_settings, so set
+ * it beforehand to adjust spinning and thread pinning. Spaces with fewer
+ * bodies than parallel_body_threshold are still stepped serially.
+ * 
  * @param space Space
  * @param threads Number of threads
  */
@@ -242,5 +503,45 @@ void nvSpace_enable_multithreading(nvSpace *space, size_t threads);
  */
 void nvSpace_disable_multithreading(nvSpace *space);
 
+/**
+ * @brief Enable multithreading using a task interface supplied by the application.
+ * 
+ * Every parallel phase of the step is submitted to the given interface instead
+ * of Nova's own task executor, so the simulation runs inside the application's
+ * job system without spawning any threads. Number of threads is set to the
+ * interface's worker count.
+ * 
+ * Use @ref nvSpace_disable_multithreading to detach the interface.
+ * 
+ * @param space Space
+ * @param task_interface Task interface
+ */
+void nvSpace_set_task_interface(nvSpace *space, nvTaskInterface task_interface);
+
+/**
+ * @brief Set the hook called at the beginning and the end of profiled phases.
+ * 
+ * This is meant for external profilers, like reading hardware performance
+ * counters around each phase. The hook is only called in builds with
+ * NV_PROFILE defined. Pass NULL to remove it.
+ * 
+ * @param space Space
+ * @param hook Hook
+ * @param user_data User data passed to the hook
+ */
+void nvSpace_set_profiler_hook(nvSpace *space, nvProfilerHook hook, void *user_data);
+
+/**
+ * @brief Set the tracer that records the timeline of the step.
+ * 
+ * Every step phase is recorded on the stepping thread and every parallel
+ * range on the thread that runs it, with the built-in executor or a host
+ * task interface. The space doesn't own the tracer. Pass NULL to stop tracing.
+ * 
+ * @param space Space
+ * @param tracer Tracer
+ */
+void nvSpace_set_tracer(nvSpace *space, nvTracer *tracer);
+
 
 #endif
\ No newline at end of file
@@ -12,6 +12,8 @@
 #define NOVAPHYSICS_SPACE_STEP_H
 
 #include "novaphysics/internal.h"
+#include "novaphysics/threading.h"
+#include "novaphysics/body.h"
 
 
 /**
@@ -28,6 +30,78 @@ nv_uint64 _nvSpace_resolution_hash(void *item);
 nv_uint64 _nvSpace_broadphase_pair_hash(void *item);
 
 
+/**
+ * Fill space's pair order with broad-phase pairs sorted by body IDs.
+ */
+void _nvSpace_sort_pairs(struct nvSpace *space);
+
+/**
+ * Fill space's resolution order with non-cached resolutions sorted by body IDs.
+ */
+void _nvSpace_sort_resolutions(struct nvSpace *space);
+
+
+/**
+ * Should the parallel phases of the step run on multiple threads?
+ */
+bool _nvSpace_is_parallel(struct nvSpace *space);
+
+
+/**
+ * Decide which bodies are simulated in this step.
+ */
+void _nvSpace_begin_sim_tiers(struct nvSpace *space);
+
+/**
+ * Pull idle bodies that came into contact with simulated bodies into the step.
+ */
+void _nvSpace_pull_in_broadphase_pairs(struct nvSpace *space);
+
+/**
+ * Reset the missed steps of bodies simulated in this step.
+ */
+void _nvSpace_end_sim_tiers(struct nvSpace *space);
+
+/**
+ * Time step of a body, bodies simulated at lower rates catch up with the steps they missed.
+ */
+nv_float _nvSpace_body_dt(struct nvSpace *space, nvBody *body, nv_float dt);
+
+/**
+ * Inverse time step of a body pair, the slower of the two is used.
+ */
+nv_float _nvSpace_pair_inv_dt(struct nvSpace *space, nvBody *a, nvBody *b, nv_float inv_dt);
+
+/**
+ * Does a pair involve a body simulated in this step?
+ */
+bool _nvSpace_is_pair_simulated(struct nvSpace *space, nvBody *a, nvBody *b);
+
+/**
+ * Run a parallel-for over items in range [0, count) using space's task interface
+ * and wait for it. Runs on the calling thread if the step isn't parallel.
+ */
+void _nvSpace_parallel_for(
+    struct nvSpace *space,
+    nvParallelForCallback callback,
+    void *data,
+    size_t count,
+    size_t min_range
+);
+
+/**
+ * Run a parallel-for like _nvSpace_parallel_for, but use multiple threads
+ * depending on the number of items instead of the number of bodies.
+ */
+void _nvSpace_parallel_for_items(
+    struct nvSpace *space,
+    nvParallelForCallback callback,
+    void *data,
+    size_t count,
+    size_t min_range
+);
+
+
 /**
  * Apply forces, gravity, integrate accelerations (update velocities) and apply damping.
  */
@@ -0,0 +1,150 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_SPACE_VIEW_H
+#define NOVAPHYSICS_SPACE_VIEW_H
+
+#include "novaphysics/internal.h"
+#include "novaphysics/array.h"
+#include "novaphysics/aabb.h"
+#include "novaphysics/vector.h"
+#include "novaphysics/body.h"
+
+
+/**
+ * @file space_view.h
+ *
+ * @brief Read-only snapshot of body states captured at the end of a step.
+ */
+
+
+/**
+ * @brief State of one body captured at the end of a step.
+ */
+typedef struct {
+    nvBody *body; /**< Body this state belongs to.
+                       The body is being stepped while an asynchronous step is running, it must not
+                       be dereferenced until @ref nvSpace_step_wait returns. */
+    nv_uint16 id; /**< ID of the body. */
+    nvBodyType type; /**< Type of the body. */
+    nvVector2 position; /**< Position of the body. */
+    nv_float angle; /**< Rotation of the body in radians. */
+    nvVector2 linear_velocity; /**< Linear velocity of the body. */
+    nv_float angular_velocity; /**< Angular velocity of the body. */
+    nvAABB aabb; /**< AABB of the body. */
+    bool is_sleeping; /**< Was the body sleeping? */
+} nvBodyState;
+
+
+/*
+    States covering more than this many cells of the query grid aren't binned,
+    they are checked by every query instead.
+*/
+#define NV_SPACE_VIEW_MAX_CELLS 16
+
+// Number of query grid cells per state
+#define NV_SPACE_VIEW_CELLS_PER_STATE 4
+
+
+/**
+ * @brief Read-only view of the space.
+ *
+ * Space keeps two views and swaps them every time a step is finished, so the
+ * view returned by @ref nvSpace_get_view always belongs to the last finished
+ * step and stays valid while an asynchronous step is running.
+ *
+ * States are binned into a uniform grid over their AABBs when they are
+ * captured, so queries only check the states in the cells they touch.
+ */
+typedef struct {
+    nvBodyState *states; /**< Body states in the same order as space's bodies. */
+    size_t size; /**< Number of body states. */
+    size_t capacity; /**< Allocated number of body states. */
+    nv_uint64 step; /**< Index of the step this view was captured at. */
+
+    nv_uint32 *_id_map; /**< Body ID -> state index lookup table. */
+    size_t _id_map_size; /**< Length of the lookup table. */
+
+    bool _indexed; /**< Was the query grid built? Queries check every state otherwise. */
+    nvAABB _bounds; /**< Bounds of the query grid. */
+    nv_float _inv_cell; /**< Inverse of the query grid cell size. */
+    nv_int32 _width; /**< Number of cells in a row of the query grid. */
+    nv_int32 _height; /**< Number of rows of the query grid. */
+    nv_uint32 *_cell_starts; /**< States of cell i are in [_cell_starts[i], _cell_starts[i + 1]) of the cell states. */
+    nv_uint32 *_cell_states; /**< State indices sorted by cells, a state is in every cell its AABB covers. */
+    nv_uint32 *_large; /**< Indices of the states that cover too many cells. */
+    size_t _large_count; /**< Number of large states. */
+    size_t _cell_capacity; /**< Allocated number of cells. */
+    size_t _entry_capacity; /**< Allocated number of cell states. */
+    size_t _large_capacity; /**< Allocated number of large states. */
+} nvSpaceView;
+
+/**
+ * @brief Create new space view.
+ *
+ * @return nvSpaceView *
+ */
+nvSpaceView *nvSpaceView_new();
+
+/**
+ * @brief Free space view.
+ *
+ * @param view Space view
+ */
+void nvSpaceView_free(nvSpaceView *view);
+
+/**
+ * @brief Capture states of the bodies into the view.
+ *
+ * This is called internally at the end of each step.
+ *
+ * @param view Space view
+ * @param bodies Array of bodies
+ * @param step Step index
+ */
+void nvSpaceView_capture(nvSpaceView *view, nvArray *bodies, nv_uint64 step);
+
+/**
+ * @brief Get captured state of a body by its ID. Returns `NULL` if the body isn't in the view.
+ *
+ * @param view Space view
+ * @param id Body ID
+ * @return const nvBodyState *
+ */
+const nvBodyState *nvSpaceView_get(const nvSpaceView *view, nv_uint16 id);
+
+/**
+ * @brief Query body states whose AABBs overlap the given AABB.
+ *
+ * Pointers to the overlapping states are appended to the output array in
+ * the order of the states.
+ *
+ * @param view Space view
+ * @param aabb AABB to query
+ * @param output Array to append states to
+ * @return size_t Number of states found
+ */
+size_t nvSpaceView_query_aabb(const nvSpaceView *view, nvAABB aabb, nvArray *output);
+
+/**
+ * @brief Query body states whose AABBs contain the given point.
+ *
+ * Pointers to the containing states are appended to the output array in
+ * the order of the states.
+ *
+ * @param view Space view
+ * @param point Point to query
+ * @param output Array to append states to
+ * @return size_t Number of states found
+ */
+size_t nvSpaceView_query_point(const nvSpaceView *view, nvVector2 point, nvArray *output);
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,89 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_STEP_BUDGET_H
+#define NOVAPHYSICS_STEP_BUDGET_H
+
+#include "novaphysics/internal.h"
+
+
+/**
+ * @file step_budget.h
+ *
+ * @brief Cost model and quality report of time-budgeted steps.
+ */
+
+
+// Fraction of the budget steps are planned to take, the rest absorbs misprediction
+#define NV_STEP_BUDGET_HEADROOM 0.9
+
+// Quality below which sleep thresholds are coarsened under load
+#define NV_STEP_BUDGET_COARSE_SLEEP 0.5
+
+
+/**
+ * @brief Quality a time-budgeted step ran with.
+ */
+typedef struct {
+    size_t velocity_iters; /**< Velocity iterations used. */
+    size_t position_iters; /**< Position iterations used. */
+    size_t constraint_iters; /**< Constraint iterations used. */
+    size_t substeps; /**< Substeps used. */
+    nv_float quality; /**< Fraction of the requested solver work that was done, 1 is full quality. */
+    double predicted; /**< Predicted step time in milliseconds. */
+    double elapsed; /**< Measured step time in milliseconds. */
+    bool degraded; /**< Were iterations or substeps reduced to fit the budget? */
+    bool coarse_sleep; /**< Were sleep thresholds coarsened for the step? */
+    bool over_budget; /**< Did the step take longer than the budget? */
+} nvStepQuality;
+
+/**
+ * @brief Learned cost of the step.
+ *
+ * Costs are in seconds and per unit of work. Resolutions are predicted from
+ * the pairs of the last broad-phase, which include bodies that are close
+ * enough for their bounding boxes to overlap, so contacts that are about to
+ * appear are priced in before the step runs. Contacts of bodies that were
+ * further apart before the step, like fast bodies hitting a pile, are only
+ * absorbed by the budget headroom. Costs are calibrated after every budgeted
+ * step from the profiler's phase times in builds with NV_PROFILE, and the
+ * prediction as a whole is corrected by the measured step time in all builds.
+ * Estimates rise quickly and fall slowly, so load spikes are never
+ * underestimated for long.
+ */
+typedef struct {
+    double step; /**< Fixed cost of a step. */
+    double element; /**< Cost of a body or resolution in one substep, apart from solver iterations. */
+    double velocity_iter; /**< Cost of one velocity iteration of one resolution. */
+    double position_iter; /**< Cost of one position iteration of one resolution. */
+    double constraint_iter; /**< Cost of one constraint iteration of one constraint. */
+    double scale; /**< Correction applied to predictions, ratio of measured to predicted step times. */
+    double rise; /**< Smoothing factor used when a cost is higher than its estimate. */
+    double fall; /**< Smoothing factor used when a cost is lower than its estimate. */
+    nv_uint32 samples; /**< Number of steps the model learned from. */
+} nvStepCostModel;
+
+/**
+ * @brief Initial cost model, roughly matching a desktop CPU.
+ */
+static const nvStepCostModel nvStepCostModel_DEFAULT = {
+    .step = 20e-6,
+    .element = 0.3e-6,
+    .velocity_iter = 0.05e-6,
+    .position_iter = 0.08e-6,
+    .constraint_iter = 0.05e-6,
+    .scale = 1.0,
+    .rise = 0.5,
+    .fall = 0.2,
+    .samples = 0
+};
+
+
+#endif
\ No newline at end of file
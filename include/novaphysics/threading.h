@@ -159,15 +159,77 @@ void nvThread_join(nvThread *thread);
 void nvThread_join_multiple(nvThread **threads, size_t length);
 
 
+/**
+ * @brief Pin the thread to a CPU core.
+ * 
+ * Returns false if setting the affinity failed or isn't supported on the platform.
+ * 
+ * @param thread Thread
+ * @param core Index of the core
+ * @return bool
+ */
+bool nvThread_set_affinity(nvThread *thread, size_t core);
+
+
+// Parallel-for callback function type, processes items in range [start, end)
+typedef void ( *nvParallelForCallback)(void *data, size_t start, size_t end);
+
+/**
+ * @brief Range of a parallel-for assigned to one executor thread.
+ */
+typedef struct {
+    nvParallelForCallback callback; /**< Callback processing the range. */
+    void *data; /**< Data that is passed to the callback. */
+    size_t start; /**< First item of the range. */
+    size_t end; /**< One past the last item of the range. */
+} nvTaskRange;
+
+/**
+ * @brief Task executor settings.
+ */
+typedef struct {
+    nv_uint32 spin_count; /**< Maximum number of times an idle thread polls for new work
+                               before parking. Spinning threads pick up work without an OS
+                               wakeup, 0 parks immediately. Each thread adapts its own
+                               budget up to this to twice the latency it observes between
+                               tasks. Ignored if there are fewer cores than executor
+                               threads plus the dispatching thread. */
+    bool pin_threads; /**< Pin each thread to its own CPU core. */
+    size_t first_core; /**< Core index the first thread is pinned to, others follow it.
+                            Cores wrap around the system's core count. */
+} nvTaskExecutorSettings;
+
+/**
+ * @brief Default task executor settings.
+ */
+static const nvTaskExecutorSettings nvTaskExecutorSettings_DEFAULT = {
+    .spin_count = 4000,
+    .pin_threads = false,
+    .first_core = 0
+};
+
 /**
  * @brief Task executor.
  * 
  * The task executor is a background thread pool that continuously runs,
  * ready to execute tasks whenever they are assigned.
+ * 
+ * Tasks are published to threads through atomic epoch counters. Idle threads
+ * spin on their epoch for a while before parking on a condition, and the
+ * dispatching thread only pays for an OS wakeup if the thread is parked.
+ * Waiting for tasks works the same way on a fork-join counter.
  */
 typedef struct {
     nvArray *threads; /**< Array of threads. */
     nvArray *data; /**< Array of thread data. */
+    nvTaskRange *ranges; /**< Ranges of the current parallel-for, one per thread. */
+    nvTaskExecutorSettings settings; /**< Settings. */
+
+    nv_uint32 pending; /**< Number of dispatched tasks that are not finished yet. */
+    nv_uint32 join_spin; /**< Current spin budget of the waiting thread. */
+    nv_uint32 join_parked; /**< Is the waiting thread parked? */
+    nvMutex *join_mutex; /**< Join mutex. */
+    nvCondition *join_event; /**< Signaled when the last pending task finishes. */
 } nvTaskExecutor;
 
 // Task executor task callback function type
@@ -176,8 +238,8 @@ typedef int ( *nvTaskCallback)(void *);
 /**
  * @brief Task struct.
  * 
- * You don't manually create this. It is created when tasks are added using
- * @ref nvTaskExecutor_add_task or @ref nvTaskExecutor_add_task_to functions.
+ * You don't manually create this. It is stored in the thread data when tasks
+ * are added using @ref nvTaskExecutor_add_task or @ref nvTaskExecutor_add_task_to.
  */
 typedef struct {
     nvTaskCallback task_func;
@@ -190,25 +252,35 @@ typedef struct {
  * This struct is passed to main pool threads of the task executor.
  */
 typedef struct {
-    bool is_active; /**< Is this thread still running? */
-    bool is_busy; /**< Is this thread currently executing a task? */
-    bool task_arrived; /**< Did the task arrive to thread? */
-    nvTask *task; /**< Task assigned to this thread. */
+    nvTaskExecutor *executor; /**< Task executor this thread belongs to. */
+    nv_uint32 is_active; /**< Is this thread still running? */
+    nv_uint32 epoch; /**< Incremented every time a task is assigned. */
+    nv_uint32 done_epoch; /**< Epoch of the last finished task. */
+    nv_uint32 parked; /**< Is this thread parked on the task event? */
+    nv_uint32 spin; /**< Current spin budget, adapted to how long tasks take to arrive. */
+    nvTask task; /**< Task assigned to this thread. */
     nvMutex *task_mutex; /**< Task mutex. */
-    nvCondition *task_event; /**< Signaled when a new task is assigned.
+    nvCondition *task_event; /**< Signaled when a new task is assigned to a parked thread.
                                   Listened by the executor thread. */
-    nvCondition *done_event; /**< Signaled when the thread finishes executing task.
-                                  Should be listened by other threads. */
 } nvTaskExecutorData;
 
 /**
- * @brief Create new task executor.
+ * @brief Create new task executor with default settings.
  * 
  * @param size Number of executor threads to initialize
  * @return nvTaskExecutor *
  */
 nvTaskExecutor *nvTaskExecutor_new(size_t size);
 
+/**
+ * @brief Create new task executor.
+ * 
+ * @param size Number of executor threads to initialize
+ * @param settings Settings
+ * @return nvTaskExecutor *
+ */
+nvTaskExecutor *nvTaskExecutor_new_with_settings(size_t size, nvTaskExecutorSettings settings);
+
 /**
  * @brief Free the task executor and its threads.
  * 
@@ -244,7 +316,7 @@ bool nvTaskExecutor_add_task(
 /**
  * @brief Add a task to a specific thread in the pool.
  * 
- * Returns false if the thread is busy or fails to allocate task.
+ * Returns false if the thread is busy.
  * 
  * @param task_executor Task executor
  * @param task_func Task callback function
@@ -267,4 +339,52 @@ bool nvTaskExecutor_add_task_to(
 void nvTaskExecutor_wait_tasks(nvTaskExecutor *task_executor);
 
 
+/**
+ * @brief Task interface Nova Physics uses to run all of its parallel phases.
+ * 
+ * Applications that already have their own job system can implement these
+ * callbacks to run physics inside their scheduler instead of letting Nova
+ * spawn its own threads. See @ref nvSpace_set_task_interface.
+ * 
+ * The built-in task executor is used as the default implementation, see
+ * @ref nvTaskExecutor_get_interface.
+ */
+typedef struct {
+    /**
+     * @brief Enqueue a parallel-for over items in range [0, count).
+     * 
+     * The callback must be invoked with disjoint ranges that together cover
+     * [0, count), each range should be at least min_range items long unless
+     * it is the last one. Returns a handle to the task group that is later
+     * passed to wait_group.
+     */
+    void *( *enqueue_range)(
+        nvParallelForCallback callback,
+        void *data,
+        size_t count,
+        size_t min_range,
+        void *context
+    );
+
+    /**
+     * @brief Wait until all ranges of the task group are finished.
+     */
+    void ( *wait_group)(void *group, void *context);
+
+    size_t worker_count; /**< Number of workers, used to size per-worker buffers and partitions. */
+    void *context; /**< User data passed to the callbacks. */
+} nvTaskInterface;
+
+/**
+ * @brief Get the task interface implemented by the task executor.
+ * 
+ * Each thread is given one range. Ranges of threads that are still busy with
+ * tasks added by @ref nvTaskExecutor_add_task are run on the calling thread.
+ * 
+ * @param task_executor Task executor
+ * @return nvTaskInterface
+ */
+nvTaskInterface nvTaskExecutor_get_interface(nvTaskExecutor *task_executor);
+
+
 #endif
\ No newline at end of file
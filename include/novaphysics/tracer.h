@@ -0,0 +1,127 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#ifndef NOVAPHYSICS_TRACER_H
+#define NOVAPHYSICS_TRACER_H
+
+#include <stdio.h>
+#include "novaphysics/internal.h"
+
+
+/**
+ * @file tracer.h
+ *
+ * @brief Timeline tracer exporting Chrome trace event JSON.
+ *
+ * The tracer records begin and end timestamps of step phases and of the
+ * parallel ranges executor threads run, into a buffer allocated once. The
+ * recording can be saved as Chrome trace event JSON that opens in Perfetto or
+ * chrome://tracing without any other dependency.
+ *
+ * Recording is lock-free and can be done from any thread. When the buffer is
+ * full new events are dropped and counted.
+ */
+
+
+/**
+ * @brief Recorded span.
+ */
+typedef struct {
+    const char *name; /**< Name of the span. Not copied, must outlive the tracer. */
+    nv_uint64 begin; /**< Begin time in nanoseconds since the tracer was created. */
+    nv_uint64 end; /**< End time in nanoseconds since the tracer was created. */
+    nv_uint32 thread; /**< ID of the recording thread, given to threads in the order they first record. */
+    nv_uint32 items; /**< Number of items a parallel range processed, 0 for other spans. */
+} nvTraceEvent;
+
+/**
+ * @brief Tracer.
+ */
+typedef struct {
+    nvTraceEvent *events; /**< Preallocated events. */
+    nv_uint32 capacity; /**< Maximum number of events. */
+    nv_uint32 _reserved; /**< Number of reserved slots, can be higher than the capacity. */
+    nv_uint32 dropped; /**< Number of events dropped because the buffer was full. */
+    nv_uint64 origin; /**< Creation time of the tracer, see @ref nvTracer_now. */
+} nvTracer;
+
+/**
+ * @brief Create new tracer.
+ *
+ * @param capacity Maximum number of events
+ * @return nvTracer *
+ */
+nvTracer *nvTracer_new(nv_uint32 capacity);
+
+/**
+ * @brief Free tracer.
+ *
+ * @param tracer Tracer
+ */
+void nvTracer_free(nvTracer *tracer);
+
+/**
+ * @brief Remove all recorded events.
+ *
+ * Don't call this while a space that uses the tracer is stepping.
+ *
+ * @param tracer Tracer
+ */
+void nvTracer_clear(nvTracer *tracer);
+
+/**
+ * @brief Current monotonic time in nanoseconds.
+ *
+ * @return nv_uint64
+ */
+nv_uint64 nvTracer_now();
+
+/**
+ * @brief Record a span on the calling thread.
+ *
+ * @param tracer Tracer
+ * @param name Name of the span, must outlive the tracer
+ * @param begin Begin time from @ref nvTracer_now
+ * @param end End time from @ref nvTracer_now
+ * @param items Number of items processed, 0 if not applicable
+ */
+void nvTracer_record(nvTracer *tracer, const char *name, nv_uint64 begin, nv_uint64 end, nv_uint32 items);
+
+/**
+ * @brief Get the number of recorded events.
+ *
+ * @param tracer Tracer
+ * @return nv_uint32
+ */
+nv_uint32 nvTracer_get_count(nvTracer *tracer);
+
+/**
+ * @brief Write recorded events as Chrome trace event JSON.
+ *
+ * Don't call this while a space that uses the tracer is stepping.
+ *
+ * @param tracer Tracer
+ * @param file File to write to
+ */
+void nvTracer_write(nvTracer *tracer, FILE *file);
+
+/**
+ * @brief Save recorded events as a Chrome trace event JSON file.
+ *
+ * Returns false if the file couldn't be opened.
+ *
+ * @param tracer Tracer
+ * @param filename Path of the JSON file
+ * @return bool
+ */
+bool nvTracer_save(nvTracer *tracer, const char *filename);
+
+
+#endif
\ No newline at end of file
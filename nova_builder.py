@@ -1477,6 +1477,7 @@ def main():
     cli.add_argument("--force-deps", "Force download all dependencies (for example demos)")
     cli.add_argument("--enable-tracy", "Enable Tracy profiler")
     cli.add_argument("--no-profiler", "Disable built-in profiler")
+    cli.add_argument("--track-alloc", "Track allocations per subsystem for memory profiling")
     cli.add_argument("--no-simd", "Disable SIMD vectorization")
     cli.add_argument("--m32", "Build for x86")
     cli.add_argument("-g", "Compile for debugging")
@@ -1610,6 +1611,7 @@ def main():
             "debug": cli.check_argument("-g"),
             "enable-tracy": cli.check_argument("--enable-tracy"),
             "no-profiler": cli.check_argument("--no-profiler"),
+            "track-alloc": cli.check_argument("--track-alloc"),
             "no-simd": cli.check_argument("--no-simd"),
             "x86": cli.check_argument("--m32"),
             "command": builder_command
@@ -1683,6 +1685,9 @@ def build(cli: CLI, compiler: Compiler):
     if not cli.check_argument("--no-profiler"):
         defines.append("NV_PROFILE")
 
+    if cli.check_argument("--track-alloc"):
+        defines.append("NV_TRACK_ALLOCATIONS")
+
     if not cli.check_argument("--no-simd"):
         defines.append("NV_USE_SIMD")
 
@@ -1804,6 +1809,9 @@ def examples(cli: CLI, compiler: Compiler):
     if not cli.check_argument("--no-profiler"):
         defines.append("NV_PROFILE")
 
+    if cli.check_argument("--track-alloc"):
+        defines.append("NV_TRACK_ALLOCATIONS")
+
     if not cli.check_argument("--no-simd"):
         defines.append("NV_USE_SIMD")
 
@@ -1932,6 +1940,9 @@ def benchmark(cli: CLI, compiler: Compiler):
     if not cli.check_argument("--no-profiler"):
         defines.append("NV_PROFILE")
 
+    if cli.check_argument("--track-alloc"):
+        defines.append("NV_TRACK_ALLOCATIONS")
+
     if not cli.check_argument("--no-simd"):
         defines.append("NV_USE_SIMD")
 
@@ -1971,9 +1982,16 @@ def benchmark(cli: CLI, compiler: Compiler):
 
     info("Running the benchmarks", NO_COLOR)
 
+    # Arguments after the benchmark name are passed to it, resolve file paths
+    # since the benchmark runs in the build directory
+    bench_args = []
+    for arg in cli.extra_arguments[1:]:
+        if os.path.exists(arg): bench_args.append(os.path.abspath(arg))
+        else: bench_args.append(arg)
+
     os.chdir(BUILD_PATH)
 
-    out = subprocess.run(binary, shell=True)
+    out = subprocess.run([binary] + bench_args)
 
     if out.returncode == 0:
         success(f"Benchmark exited with code {out.returncode}.", NO_COLOR)
@@ -2019,6 +2037,9 @@ def tests(cli: CLI, compiler: Compiler):
     if not cli.check_argument("--no-profiler"):
         defines.append("NV_PROFILE")
 
+    if cli.check_argument("--track-alloc"):
+        defines.append("NV_TRACK_ALLOCATIONS")
+
     if not cli.check_argument("--no-simd"):
         defines.append("NV_USE_SIMD")
 
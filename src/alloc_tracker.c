@@ -0,0 +1,315 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <string.h>
+#include "novaphysics/alloc_tracker.h"
+
+
+/**
+ * @file alloc_tracker.c
+ *
+ * @brief Allocation tracker of allocation-tracking builds.
+ */
+
+
+static const char *_nv_alloc_category_names[nvAllocCategory_COUNT] = {
+    "other",
+    "bodies",
+    "shapes",
+    "constraints",
+    "resolutions",
+    "broadphase",
+    "threading",
+    "particles",
+    "soft bodies",
+    "articulations"
+};
+
+const char *nvAllocCategory_name(nvAllocCategory category) {
+    if (category >= nvAllocCategory_COUNT) return "total";
+    return _nv_alloc_category_names[category];
+}
+
+
+#ifdef NV_TRACK_ALLOCATIONS
+
+    #define _NV_ALLOC_STACK_SIZE 16
+
+
+    /**
+     * @brief Live allocation in the side table.
+     */
+    typedef struct {
+        void *ptr; /**< NULL if the slot is empty. */
+        size_t size;
+        nvAllocCategory category;
+    } _nvAllocEntry;
+
+    // Open addressing table of live allocations, it's allocated with plain malloc
+    static _nvAllocEntry *_nv_alloc_table = NULL;
+    static size_t _nv_alloc_table_cap = 0;
+    static size_t _nv_alloc_table_count = 0;
+
+    static nvAllocStats _nv_alloc_stats[nvAllocCategory_COUNT + 1];
+
+    static volatile long _nv_alloc_lock = 0;
+
+    static NV_THREAD_LOCAL nvAllocCategory _nv_alloc_stack[_NV_ALLOC_STACK_SIZE];
+    static NV_THREAD_LOCAL size_t _nv_alloc_stack_size = 0;
+
+
+    static void _nv_alloc_acquire() {
+        #if defined(NV_COMPILER_GCC)
+            while (__atomic_exchange_n(&_nv_alloc_lock, 1, __ATOMIC_ACQUIRE)) nv_cpu_relax();
+        #elif defined(NV_COMPILER_MSVC)
+            while (_InterlockedExchange(&_nv_alloc_lock, 1)) nv_cpu_relax();
+        #endif
+    }
+
+    static void _nv_alloc_release() {
+        #if defined(NV_COMPILER_GCC)
+            __atomic_store_n(&_nv_alloc_lock, 0, __ATOMIC_RELEASE);
+        #elif defined(NV_COMPILER_MSVC)
+            _InterlockedExchange(&_nv_alloc_lock, 0);
+        #endif
+    }
+
+    static inline size_t _nv_alloc_slot(void *ptr) {
+        nv_uint64 x = (nv_uint64)(uintptr_t)ptr;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return (size_t)x & (_nv_alloc_table_cap - 1);
+    }
+
+    static void _nv_alloc_table_insert(void *ptr, size_t size, nvAllocCategory category);
+
+    static bool _nv_alloc_table_grow() {
+        _nvAllocEntry *old_table = _nv_alloc_table;
+        size_t old_cap = _nv_alloc_table_cap;
+
+        size_t cap = old_cap ? old_cap * 2 : 4096;
+        _nvAllocEntry *table = calloc(cap, sizeof(_nvAllocEntry));
+        if (!table) return false;
+
+        _nv_alloc_table = table;
+        _nv_alloc_table_cap = cap;
+        _nv_alloc_table_count = 0;
+
+        for (size_t i = 0; i < old_cap; i++) {
+            if (old_table[i].ptr)
+                _nv_alloc_table_insert(old_table[i].ptr, old_table[i].size, old_table[i].category);
+        }
+
+        free(old_table);
+        return true;
+    }
+
+    static void _nv_alloc_table_insert(void *ptr, size_t size, nvAllocCategory category) {
+        size_t i = _nv_alloc_slot(ptr);
+        while (_nv_alloc_table[i].ptr) i = (i + 1) & (_nv_alloc_table_cap - 1);
+
+        _nv_alloc_table[i] = (_nvAllocEntry){ptr, size, category};
+        _nv_alloc_table_count++;
+    }
+
+    /**
+     * Remove the entry of the pointer, returns false if it's not tracked.
+     */
+    static bool _nv_alloc_table_remove(void *ptr, _nvAllocEntry *removed) {
+        if (_nv_alloc_table_cap == 0) return false;
+
+        size_t mask = _nv_alloc_table_cap - 1;
+        size_t i = _nv_alloc_slot(ptr);
+
+        while (_nv_alloc_table[i].ptr != ptr) {
+            if (!_nv_alloc_table[i].ptr) return false;
+            i = (i + 1) & mask;
+        }
+
+        *removed = _nv_alloc_table[i];
+        _nv_alloc_table[i].ptr = NULL;
+        _nv_alloc_table_count--;
+
+        // Shift the following entries back so lookups don't stop at the hole
+        size_t hole = i;
+        for (size_t j = (i + 1) & mask; _nv_alloc_table[j].ptr; j = (j + 1) & mask) {
+            size_t home = _nv_alloc_slot(_nv_alloc_table[j].ptr);
+
+            bool movable = (hole <= j) ? (home <= hole || home > j) : (home <= hole && home > j);
+            if (movable) {
+                _nv_alloc_table[hole] = _nv_alloc_table[j];
+                _nv_alloc_table[j].ptr = NULL;
+                hole = j;
+            }
+        }
+
+        return true;
+    }
+
+    static void _nv_alloc_account(nvAllocCategory category, size_t size) {
+        nvAllocStats *stats[2] = {&_nv_alloc_stats[category], &_nv_alloc_stats[nvAllocCategory_COUNT]};
+
+        for (size_t i = 0; i < 2; i++) {
+            stats[i]->current += size;
+            stats[i]->allocated += size;
+            stats[i]->allocations++;
+            if (stats[i]->current > stats[i]->peak) stats[i]->peak = stats[i]->current;
+        }
+    }
+
+    static void _nv_alloc_unaccount(_nvAllocEntry *entry, bool count_free) {
+        nvAllocStats *stats[2] = {&_nv_alloc_stats[entry->category], &_nv_alloc_stats[nvAllocCategory_COUNT]};
+
+        for (size_t i = 0; i < 2; i++) {
+            stats[i]->current -= entry->size;
+            if (count_free) stats[i]->frees++;
+        }
+    }
+
+    static void _nv_alloc_track(void *ptr, size_t size) {
+        if (!ptr) return;
+
+        nvAllocCategory category = _nv_alloc_current_category();
+
+        _nv_alloc_acquire();
+
+        // A pointer freed with plain free() can come back from malloc, drop the stale entry
+        _nvAllocEntry stale;
+        if (_nv_alloc_table_remove(ptr, &stale)) _nv_alloc_unaccount(&stale, false);
+
+        if ((_nv_alloc_table_count + 1) * 2 > _nv_alloc_table_cap && !_nv_alloc_table_grow()) {
+            _nv_alloc_release();
+            return;
+        }
+
+        _nv_alloc_table_insert(ptr, size, category);
+        _nv_alloc_account(category, size);
+
+        _nv_alloc_release();
+    }
+
+
+    void *_nv_tracked_malloc(size_t size) {
+        void *ptr = malloc(size);
+        _nv_alloc_track(ptr, size);
+        return ptr;
+    }
+
+    void *_nv_tracked_calloc(size_t count, size_t size) {
+        void *ptr = calloc(count, size);
+        _nv_alloc_track(ptr, count * size);
+        return ptr;
+    }
+
+    void *_nv_tracked_realloc(void *ptr, size_t size) {
+        if (!ptr) return _nv_tracked_malloc(size);
+
+        if (size == 0) {
+            _nv_tracked_free(ptr);
+            return NULL;
+        }
+
+        // Take the entry out before the old pointer becomes invalid
+        _nv_alloc_acquire();
+        _nvAllocEntry entry;
+        bool tracked = _nv_alloc_table_remove(ptr, &entry);
+        if (tracked) _nv_alloc_unaccount(&entry, false);
+        _nv_alloc_release();
+
+        void *new_ptr = realloc(ptr, size);
+
+        // The old block is still valid if realloc fails, put it back
+        if (!new_ptr) {
+            if (tracked) {
+                _nv_alloc_acquire();
+                _nv_alloc_table_insert(entry.ptr, entry.size, entry.category);
+                _nv_alloc_stats[entry.category].current += entry.size;
+                _nv_alloc_stats[nvAllocCategory_COUNT].current += entry.size;
+                _nv_alloc_release();
+            }
+            return NULL;
+        }
+
+        _nv_alloc_track(new_ptr, size);
+
+        return new_ptr;
+    }
+
+    void _nv_tracked_free(void *ptr) {
+        if (!ptr) return;
+
+        _nv_alloc_acquire();
+        _nvAllocEntry entry;
+        if (_nv_alloc_table_remove(ptr, &entry)) _nv_alloc_unaccount(&entry, true);
+        _nv_alloc_release();
+
+        free(ptr);
+    }
+
+    void _nv_alloc_push_category(nvAllocCategory category) {
+        // Deeper scopes keep the category of the last one that fit
+        if (_nv_alloc_stack_size < _NV_ALLOC_STACK_SIZE)
+            _nv_alloc_stack[_nv_alloc_stack_size] = category;
+
+        _nv_alloc_stack_size++;
+    }
+
+    void _nv_alloc_pop_category() {
+        NV_ASSERT(_nv_alloc_stack_size > 0, "Allocation category scope ended without a beginning.");
+        _nv_alloc_stack_size--;
+    }
+
+    nvAllocCategory _nv_alloc_current_category() {
+        if (_nv_alloc_stack_size == 0) return nvAllocCategory_OTHER;
+
+        size_t top = _nv_alloc_stack_size - 1;
+        if (top >= _NV_ALLOC_STACK_SIZE) top = _NV_ALLOC_STACK_SIZE - 1;
+
+        return _nv_alloc_stack[top];
+    }
+
+
+    bool nvAllocTracker_is_enabled() {
+        return true;
+    }
+
+    nvAllocStats nvAllocTracker_get(nvAllocCategory category) {
+        if (category > nvAllocCategory_COUNT) category = nvAllocCategory_COUNT;
+
+        _nv_alloc_acquire();
+        nvAllocStats stats = _nv_alloc_stats[category];
+        _nv_alloc_release();
+
+        return stats;
+    }
+
+    void nvAllocTracker_reset_peaks() {
+        _nv_alloc_acquire();
+
+        for (size_t i = 0; i <= nvAllocCategory_COUNT; i++)
+            _nv_alloc_stats[i].peak = _nv_alloc_stats[i].current;
+
+        _nv_alloc_release();
+    }
+
+#else
+
+    bool nvAllocTracker_is_enabled() {
+        return false;
+    }
+
+    nvAllocStats nvAllocTracker_get(nvAllocCategory category) {
+        return (nvAllocStats){0};
+    }
+
+    void nvAllocTracker_reset_peaks() {}
+
+#endif
\ No newline at end of file
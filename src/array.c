@@ -24,9 +24,9 @@ nvArray *nvArray_new() {
 
     array->size = 0;
     array->max = 0;
-    array->data = (void **)malloc(sizeof(void *));
+    array->data = (void **)NV_MALLOC(sizeof(void *));
     if (!array->data) {
-        free(array);
+        NV_FREE(array);
         return NULL;
     }
 
@@ -34,10 +34,10 @@ nvArray *nvArray_new() {
 }
 
 void nvArray_free(nvArray *array) {
-    free(array->data);
+    NV_FREE(array->data);
     array->data = NULL;
     array->size = 0;
-    free(array);
+    NV_FREE(array);
 }
 
 void nvArray_free_each(nvArray *array, void (free_func)(void *)) {
@@ -50,7 +50,7 @@ void nvArray_add(nvArray *array, void *elem) {
     if (array->size == array->max) {
         array->size++;
         array->max++;
-        array->data = (void **)realloc(array->data, array->size * sizeof(void *));
+        array->data = (void **)NV_REALLOC(array->data, array->size * sizeof(void *));
     }
     else {
         array->size++;
@@ -59,6 +59,16 @@ void nvArray_add(nvArray *array, void *elem) {
     array->data[array->size - 1] = elem;
 }
 
+void nvArray_reserve(nvArray *array, size_t capacity) {
+    if (capacity <= array->max) return;
+
+    void **data = (void **)NV_REALLOC(array->data, capacity * sizeof(void *));
+    if (!data) return;
+
+    array->data = data;
+    array->max = capacity;
+}
+
 void *nvArray_pop(nvArray *array, size_t index) {
     for (size_t i = 0; i < array->size; i++) {
         if (i == index) {
@@ -0,0 +1,724 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include "novaphysics/articulation.h"
+#include "novaphysics/constants.h"
+#include "novaphysics/space.h"
+#include "novaphysics/space_step.h"
+
+
+/**
+ * @file articulation.c
+ *
+ * @brief Articulated bodies solved in reduced coordinates.
+ *
+ * The state of an articulation is the root body's velocity and the joint
+ * angles and speeds. Every substep the articulated body algorithm computes
+ * the inertia of every subtree as seen from its joint (O(n)), then forces and
+ * impulses are propagated through them from the leaves to the root and the
+ * resulting accelerations or velocity changes from the root to the leaves.
+ *
+ * Spatial vectors are measured at the root's center of mass, so the numbers
+ * stay small wherever the articulation is in the space. The root's spatial
+ * velocity is then its center of mass velocity.
+ *
+ * Contacts and constraints see the links as free bodies. Whatever they change
+ * on a link is taken back as an impulse and applied to the whole articulation,
+ * so after enough iterations the contacts converge on the articulated inertia.
+ */
+
+
+/*
+    Spatial algebra in 2D. Motions are (angular velocity, linear velocity of
+    the body point at the reference point) and forces are (torque about the
+    reference point, linear force).
+*/
+
+static inline nv_float _nvSpatial_dot(nvSpatialVector a, nvSpatialVector b) {
+    return a.w * b.w + a.x * b.x + a.y * b.y;
+}
+
+static inline nvSpatialVector _nvSpatial_add(nvSpatialVector a, nvSpatialVector b) {
+    return (nvSpatialVector){a.w + b.w, a.x + b.x, a.y + b.y};
+}
+
+static inline nvSpatialVector _nvSpatial_sub(nvSpatialVector a, nvSpatialVector b) {
+    return (nvSpatialVector){a.w - b.w, a.x - b.x, a.y - b.y};
+}
+
+static inline nvSpatialVector _nvSpatial_mul(nvSpatialVector a, nv_float s) {
+    return (nvSpatialVector){a.w * s, a.x * s, a.y * s};
+}
+
+// Motion of a unit joint speed
+static inline nvSpatialVector _nvSpatial_joint(nvVector2 axis) {
+    return (nvSpatialVector){1.0, axis.x, axis.y};
+}
+
+// Cross product of two motions
+static inline nvSpatialVector _nvSpatial_cross_motion(nvSpatialVector a, nvSpatialVector b) {
+    return (nvSpatialVector){0.0, b.w * a.y - a.w * b.y, a.w * b.x - b.w * a.x};
+}
+
+// Cross product of a motion and a force
+static inline nvSpatialVector _nvSpatial_cross_force(nvSpatialVector v, nvSpatialVector f) {
+    return (nvSpatialVector){v.x * f.y - v.y * f.x, -v.w * f.y, v.w * f.x};
+}
+
+static inline nvSpatialVector _nvSpatialInertia_mul(nvSpatialInertia m, nvSpatialVector v) {
+    return (nvSpatialVector){
+        m.ww * v.w + m.wx * v.x + m.wy * v.y,
+        m.wx * v.w + m.xx * v.x + m.xy * v.y,
+        m.wy * v.w + m.xy * v.x + m.yy * v.y
+    };
+}
+
+static inline nvSpatialInertia _nvSpatialInertia_add(nvSpatialInertia a, nvSpatialInertia b) {
+    return (nvSpatialInertia){
+        a.ww + b.ww, a.wx + b.wx, a.wy + b.wy,
+        a.xx + b.xx, a.xy + b.xy, a.yy + b.yy
+    };
+}
+
+// a - u * u^T * s
+static inline nvSpatialInertia _nvSpatialInertia_sub_outer(nvSpatialInertia a, nvSpatialVector u, nv_float s) {
+    return (nvSpatialInertia){
+        a.ww - u.w * u.w * s, a.wx - u.w * u.x * s, a.wy - u.w * u.y * s,
+        a.xx - u.x * u.x * s, a.xy - u.x * u.y * s, a.yy - u.y * u.y * s
+    };
+}
+
+static inline nvSpatialInertia _nvSpatialInertia_inverse(nvSpatialInertia m) {
+    nv_float c_ww = m.xx * m.yy - m.xy * m.xy;
+    nv_float c_wx = m.wy * m.xy - m.wx * m.yy;
+    nv_float c_wy = m.wx * m.xy - m.wy * m.xx;
+
+    nv_float det = m.ww * c_ww + m.wx * c_wx + m.wy * c_wy;
+    if (det == 0.0) return (nvSpatialInertia){0};
+    nv_float inv_det = 1.0 / det;
+
+    return (nvSpatialInertia){
+        c_ww * inv_det,
+        c_wx * inv_det,
+        c_wy * inv_det,
+        (m.ww * m.yy - m.wy * m.wy) * inv_det,
+        (m.wx * m.wy - m.ww * m.xy) * inv_det,
+        (m.ww * m.xx - m.wx * m.wx) * inv_det
+    };
+}
+
+// Spatial inertia of a body with its center of mass at r
+static inline nvSpatialInertia _nvSpatialInertia_body(nvBody *body, nvVector2 r) {
+    nv_float m = body->mass;
+
+    return (nvSpatialInertia){
+        body->inertia + m * nvVector2_len2(r), -m * r.y, m * r.x,
+        m, 0.0, m
+    };
+}
+
+// Spatial motion of a body with its center of mass at r
+static inline nvSpatialVector _nvSpatial_from_body(nvVector2 linear, nv_float angular, nvVector2 r) {
+    return (nvSpatialVector){angular, linear.x + angular * r.y, linear.y - angular * r.x};
+}
+
+// Center of mass velocity of a spatial motion
+static inline nvVector2 _nvSpatial_linear_at(nvSpatialVector v, nvVector2 r) {
+    return NV_VEC2(v.x - v.w * r.y, v.y + v.w * r.x);
+}
+
+
+nvArticulation *nvArticulation_new(nvBody *root) {
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_ARTICULATIONS);
+    nvArticulation *art = NV_NEW(nvArticulation);
+    NV_ALLOC_SCOPE_END;
+    if (!art) return NULL;
+
+    *art = (nvArticulation){0};
+
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_ARTICULATIONS);
+    bool reserved = _nv_reserve((void **)&art->links, sizeof(nvArticulationLink), 8);
+    NV_ALLOC_SCOPE_END;
+
+    if (!reserved) {
+        NV_FREE(art);
+        return NULL;
+    }
+
+    art->capacity = 8;
+    art->count = 1;
+
+    art->links[0] = (nvArticulationLink){
+        .body = root,
+        .parent = 0,
+        ._linear_velocity = root->linear_velocity,
+        ._angular_velocity = root->angular_velocity,
+        ._velocity = {root->angular_velocity, root->linear_velocity.x, root->linear_velocity.y},
+        ._position = root->position,
+        ._angle = root->angle
+    };
+
+    root->articulation = art;
+
+    return art;
+}
+
+void nvArticulation_free(void *art) {
+    if (!art) return;
+    nvArticulation *a = (nvArticulation *)art;
+
+    _nvArticulation_detach(a);
+
+    NV_FREE(a->links);
+    NV_FREE(a);
+}
+
+bool nvArticulation_add_link(
+    nvArticulation *art,
+    nvBody *parent,
+    nvBody *body,
+    nvVector2 anchor
+) {
+    NV_ASSERT(body->type == nvBodyType_DYNAMIC, "Only the root of an articulation can be static.");
+    NV_ASSERT(!body->articulation, "Body is already in an articulation.");
+    NV_ASSERT(parent->articulation == art, "Parent body isn't in the articulation.");
+
+    size_t parent_index = 0;
+    for (; parent_index < art->count; parent_index++) {
+        if (art->links[parent_index].body == parent) break;
+    }
+
+    if (art->count == art->capacity) {
+        size_t capacity = art->capacity * 2;
+
+        NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_ARTICULATIONS);
+        bool reserved = _nv_reserve((void **)&art->links, sizeof(nvArticulationLink), capacity);
+        NV_ALLOC_SCOPE_END;
+
+        if (!reserved) return false;
+        art->capacity = capacity;
+    }
+
+    art->links[art->count++] = (nvArticulationLink){
+        .body = body,
+        .parent = parent_index,
+        .parent_anchor = nvVector2_rotate(nvVector2_sub(anchor, parent->position), -parent->angle),
+        .anchor = nvVector2_rotate(nvVector2_sub(anchor, body->position), -body->angle),
+        .reference_angle = body->angle - parent->angle,
+        .angle = 0.0,
+        .speed = body->angular_velocity - parent->angular_velocity,
+        .enable_limits = false,
+        ._linear_velocity = body->linear_velocity,
+        ._angular_velocity = body->angular_velocity,
+        ._position = body->position,
+        ._angle = body->angle
+    };
+
+    body->articulation = art;
+
+    return true;
+}
+
+void nvArticulation_set_limits(
+    nvArticulation *art,
+    size_t link,
+    nv_float lower,
+    nv_float upper
+) {
+    NV_ASSERT(link > 0 && link < art->count, "Only joints of articulation links can be limited.");
+
+    nvArticulationLink *l = &art->links[link];
+    l->enable_limits = true;
+    l->lower_limit = lower;
+    l->upper_limit = upper;
+}
+
+
+/**
+ * @brief Place the bodies from the root's pose and the joint angles.
+ */
+static void _nvArticulation_place(nvArticulation *art) {
+    nvArticulationLink *links = art->links;
+
+    links[0]._position = links[0].body->position;
+    links[0]._angle = links[0].body->angle;
+
+    for (size_t i = 1; i < art->count; i++) {
+        nvArticulationLink *link = &links[i];
+        nvArticulationLink *parent = &links[link->parent];
+
+        nv_float angle = parent->_angle + link->reference_angle + link->angle;
+        nvVector2 joint = nvVector2_add(parent->_position, nvVector2_rotate(link->parent_anchor, parent->_angle));
+
+        link->_position = nvVector2_sub(joint, nvVector2_rotate(link->anchor, angle));
+        link->_angle = angle;
+
+        nvBody *body = link->body;
+        if (body->position.x != link->_position.x || body->position.y != link->_position.y || body->angle != link->_angle) {
+            body->position = link->_position;
+            body->angle = link->_angle;
+            _nvBody_mark_moved(body);
+        }
+    }
+}
+
+/**
+ * @brief Compute the spatial and articulated inertias at the placed poses.
+ */
+static void _nvArticulation_factor(nvArticulation *art) {
+    nvArticulationLink *links = art->links;
+    nvVector2 origin = links[0]._position;
+
+    for (size_t i = 0; i < art->count; i++) {
+        nvArticulationLink *link = &links[i];
+
+        link->_r = nvVector2_sub(link->_position, origin);
+        link->_inertia = _nvSpatialInertia_body(link->body, link->_r);
+        link->_articulated = link->_inertia;
+
+        if (i > 0) {
+            nvArticulationLink *parent = &links[link->parent];
+            nvVector2 joint = nvVector2_add(
+                nvVector2_sub(parent->_position, origin),
+                nvVector2_rotate(link->parent_anchor, parent->_angle)
+            );
+
+            // Linear velocity of the reference point when rotating about the joint
+            link->_axis = NV_VEC2(joint.y, -joint.x);
+        }
+    }
+
+    for (size_t i = art->count - 1; i > 0; i--) {
+        nvArticulationLink *link = &links[i];
+        nvArticulationLink *parent = &links[link->parent];
+
+        link->_u = _nvSpatialInertia_mul(link->_articulated, _nvSpatial_joint(link->_axis));
+        nv_float d = link->_u.w + link->_u.x * link->_axis.x + link->_u.y * link->_axis.y;
+        link->_inv_d = (d > 0.0) ? 1.0 / d : 0.0;
+
+        parent->_articulated = _nvSpatialInertia_add(
+            parent->_articulated,
+            _nvSpatialInertia_sub_outer(link->_articulated, link->_u, link->_inv_d)
+        );
+    }
+
+    if (links[0].body->type == nvBodyType_STATIC)
+        art->_root_inverse = (nvSpatialInertia){0};
+    else
+        art->_root_inverse = _nvSpatialInertia_inverse(links[0]._articulated);
+}
+
+/**
+ * @brief Propagate the forces and torques of the links through the articulation.
+ *
+ * Forces are taken negated from _force and torques from _torque. The changes
+ * they cause are left in _delta and _delta_speed. With impulses those are
+ * velocity changes.
+ */
+static void _nvArticulation_propagate(nvArticulation *art) {
+    nvArticulationLink *links = art->links;
+
+    for (size_t i = art->count - 1; i > 0; i--) {
+        nvArticulationLink *link = &links[i];
+        nvArticulationLink *parent = &links[link->parent];
+
+        link->_torque -= _nvSpatial_dot(_nvSpatial_joint(link->_axis), link->_force);
+
+        parent->_force = _nvSpatial_add(
+            parent->_force,
+            _nvSpatial_add(link->_force, _nvSpatial_mul(link->_u, link->_torque * link->_inv_d))
+        );
+    }
+
+    links[0]._delta = _nvSpatial_mul(_nvSpatialInertia_mul(art->_root_inverse, links[0]._force), -1.0);
+
+    for (size_t i = 1; i < art->count; i++) {
+        nvArticulationLink *link = &links[i];
+        nvSpatialVector parent_delta = links[link->parent]._delta;
+
+        link->_delta_speed = (link->_torque - _nvSpatial_dot(link->_u, parent_delta)) * link->_inv_d;
+        link->_delta = _nvSpatial_add(parent_delta, _nvSpatial_mul(_nvSpatial_joint(link->_axis), link->_delta_speed));
+    }
+}
+
+static inline void _nvArticulation_clear_forces(nvArticulation *art) {
+    for (size_t i = 0; i < art->count; i++) {
+        art->links[i]._force = (nvSpatialVector){0.0, 0.0, 0.0};
+        art->links[i]._torque = 0.0;
+    }
+}
+
+/**
+ * @brief Add the propagated velocity changes to the root and the joints.
+ */
+static inline void _nvArticulation_apply_deltas(nvArticulation *art) {
+    art->links[0]._velocity = _nvSpatial_add(art->links[0]._velocity, art->links[0]._delta);
+
+    for (size_t i = 1; i < art->count; i++)
+        art->links[i].speed += art->links[i]._delta_speed;
+}
+
+/**
+ * @brief Give the bodies the velocities of the root and the joints.
+ */
+static void _nvArticulation_write_velocities(nvArticulation *art) {
+    nvArticulationLink *links = art->links;
+
+    for (size_t i = 0; i < art->count; i++) {
+        nvArticulationLink *link = &links[i];
+
+        if (i > 0) {
+            link->_velocity = _nvSpatial_add(
+                links[link->parent]._velocity,
+                _nvSpatial_mul(_nvSpatial_joint(link->_axis), link->speed)
+            );
+        }
+
+        if (link->body->type == nvBodyType_STATIC) continue;
+
+        link->_linear_velocity = _nvSpatial_linear_at(link->_velocity, link->_r);
+        link->_angular_velocity = link->_velocity.w;
+        link->body->linear_velocity = link->_linear_velocity;
+        link->body->angular_velocity = link->_angular_velocity;
+    }
+}
+
+/**
+ * @brief Apply an impulse to one joint.
+ */
+static void _nvArticulation_apply_joint_impulse(nvArticulation *art, size_t i, nv_float impulse) {
+    _nvArticulation_clear_forces(art);
+    art->links[i]._torque = impulse;
+
+    _nvArticulation_propagate(art);
+    _nvArticulation_apply_deltas(art);
+}
+
+
+void _nvArticulation_integrate_accelerations(nvSpace *space, nvArticulation *art, nv_float dt) {
+    art->_active = false;
+    if (art->count < 2) return;
+
+    // Links sleep and join steps together, the first link tells for all of them
+    nvBody *first = art->links[1].body;
+    if (first->is_sleeping) return;
+    if (space->_multirate && !first->_sim_active) return;
+
+    art->_active = true;
+
+    nv_float art_dt = dt;
+    for (size_t i = 0; i < art->count; i++) {
+        nv_float body_dt = _nvSpace_body_dt(space, art->links[i].body, dt);
+        if (body_dt > art_dt) art_dt = body_dt;
+    }
+    art->_dt = art_dt;
+
+    nvArticulationLink *links = art->links;
+
+    // Bodies moved by the user bring their subtrees with them
+    _nvArticulation_place(art);
+    _nvArticulation_factor(art);
+
+    if (links[0].body->type == nvBodyType_STATIC)
+        links[0]._velocity = (nvSpatialVector){0.0, 0.0, 0.0};
+
+    /*
+        Gravity, forces, damping and anything else applied to the bodies since
+        they were given their velocities are taken as impulses over the substep.
+    */
+    for (size_t i = 0; i < art->count; i++) {
+        nvArticulationLink *link = &links[i];
+        nvBody *body = link->body;
+
+        if (i > 0) {
+            nvSpatialVector joint = _nvSpatial_mul(_nvSpatial_joint(link->_axis), link->speed);
+            nvSpatialVector parent_velocity = links[link->parent]._velocity;
+
+            link->_velocity = _nvSpatial_add(parent_velocity, joint);
+            link->_coriolis = _nvSpatial_cross_motion(parent_velocity, joint);
+        }
+
+        nvSpatialVector momentum = _nvSpatialInertia_mul(link->_inertia, link->_velocity);
+        link->_force = _nvSpatial_cross_force(link->_velocity, momentum);
+        link->_torque = 0.0;
+
+        if (body->type == nvBodyType_STATIC) continue;
+
+        nvSpatialVector change = _nvSpatial_from_body(
+            nvVector2_sub(body->linear_velocity, link->_linear_velocity),
+            body->angular_velocity - link->_angular_velocity,
+            link->_r
+        );
+
+        link->_force = _nvSpatial_sub(
+            link->_force,
+            _nvSpatial_mul(_nvSpatialInertia_mul(link->_inertia, change), 1.0 / art_dt)
+        );
+    }
+
+    for (size_t i = art->count - 1; i > 0; i--) {
+        nvArticulationLink *link = &links[i];
+        nvArticulationLink *parent = &links[link->parent];
+
+        link->_torque -= _nvSpatial_dot(_nvSpatial_joint(link->_axis), link->_force);
+
+        // Bias of the subtree with the joint's velocity-product acceleration
+        nvSpatialVector coriolis = _nvSpatial_sub(
+            _nvSpatialInertia_mul(link->_articulated, link->_coriolis),
+            _nvSpatial_mul(link->_u, _nvSpatial_dot(link->_u, link->_coriolis) * link->_inv_d)
+        );
+
+        parent->_force = _nvSpatial_add(
+            parent->_force,
+            _nvSpatial_add(
+                _nvSpatial_add(link->_force, coriolis),
+                _nvSpatial_mul(link->_u, link->_torque * link->_inv_d)
+            )
+        );
+    }
+
+    links[0]._delta = _nvSpatial_mul(_nvSpatialInertia_mul(art->_root_inverse, links[0]._force), -1.0);
+    links[0]._velocity = _nvSpatial_add(links[0]._velocity, _nvSpatial_mul(links[0]._delta, art_dt));
+
+    for (size_t i = 1; i < art->count; i++) {
+        nvArticulationLink *link = &links[i];
+        nvSpatialVector acceleration = _nvSpatial_add(links[link->parent]._delta, link->_coriolis);
+
+        nv_float joint_acceleration = (link->_torque - _nvSpatial_dot(link->_u, acceleration)) * link->_inv_d;
+
+        link->_delta = _nvSpatial_add(acceleration, _nvSpatial_mul(_nvSpatial_joint(link->_axis), joint_acceleration));
+        link->speed += joint_acceleration * art_dt;
+
+        link->_lower_impulse = 0.0;
+        link->_upper_impulse = 0.0;
+    }
+
+    _nvArticulation_write_velocities(art);
+
+    // Effective masses of the limited joints, one propagation of a unit impulse each
+    for (size_t i = 1; i < art->count; i++) {
+        nvArticulationLink *link = &links[i];
+        if (!link->enable_limits) continue;
+
+        _nvArticulation_clear_forces(art);
+        link->_torque = 1.0;
+        _nvArticulation_propagate(art);
+
+        link->_limit_mass = (link->_delta_speed > 0.0) ? 1.0 / link->_delta_speed : 0.0;
+    }
+}
+
+void _nvArticulation_solve_velocities(nvArticulation *art) {
+    if (!art->_active) return;
+
+    nvArticulationLink *links = art->links;
+    bool changed = false;
+
+    for (size_t i = 0; i < art->count; i++) {
+        nvArticulationLink *link = &links[i];
+        nvBody *body = link->body;
+
+        link->_force = (nvSpatialVector){0.0, 0.0, 0.0};
+        link->_torque = 0.0;
+
+        if (body->type == nvBodyType_STATIC) continue;
+
+        nvVector2 linear = nvVector2_sub(body->linear_velocity, link->_linear_velocity);
+        nv_float angular = body->angular_velocity - link->_angular_velocity;
+        if (linear.x == 0.0 && linear.y == 0.0 && angular == 0.0) continue;
+
+        nvSpatialVector change = _nvSpatial_from_body(linear, angular, link->_r);
+        link->_force = _nvSpatial_mul(_nvSpatialInertia_mul(link->_inertia, change), -1.0);
+        changed = true;
+    }
+
+    if (changed) {
+        _nvArticulation_propagate(art);
+        _nvArticulation_apply_deltas(art);
+    }
+
+    nv_float inv_dt = 1.0 / art->_dt;
+
+    /*
+        Limits are speculative like the hinge joint's, joints can reach them
+        in this substep but not pass them. Violations are pushed back with a
+        Baumgarte bias.
+    */
+    for (size_t i = 1; i < art->count; i++) {
+        nvArticulationLink *link = &links[i];
+        if (!link->enable_limits) continue;
+
+        nv_float c, bias, impulse, impulse0;
+
+        c = link->angle - link->lower_limit;
+        bias = (c > 0.0) ? c * inv_dt : c * NV_BAUMGARTE * inv_dt;
+        impulse = -link->_limit_mass * (link->speed + bias);
+
+        impulse0 = link->_lower_impulse;
+        link->_lower_impulse = nv_fmax(link->_lower_impulse + impulse, 0.0);
+        impulse = link->_lower_impulse - impulse0;
+
+        if (impulse != 0.0) {
+            _nvArticulation_apply_joint_impulse(art, i, impulse);
+            changed = true;
+        }
+
+        c = link->upper_limit - link->angle;
+        bias = (c > 0.0) ? c * inv_dt : c * NV_BAUMGARTE * inv_dt;
+        impulse = -link->_limit_mass * (-link->speed + bias);
+
+        impulse0 = link->_upper_impulse;
+        link->_upper_impulse = nv_fmax(link->_upper_impulse + impulse, 0.0);
+        impulse = link->_upper_impulse - impulse0;
+
+        if (impulse != 0.0) {
+            _nvArticulation_apply_joint_impulse(art, i, -impulse);
+            changed = true;
+        }
+    }
+
+    if (changed) _nvArticulation_write_velocities(art);
+}
+
+void _nvArticulation_integrate_velocities(nvArticulation *art) {
+    if (!art->_active) {
+        // Collisions can wake links in the middle of the substep, the others are brought back to them
+        if (_nvArticulation_wake(art)) _nvArticulation_place(art);
+        return;
+    }
+
+    for (size_t i = 1; i < art->count; i++)
+        art->links[i].angle += art->links[i].speed * art->_dt;
+
+    _nvArticulation_place(art);
+}
+
+void _nvArticulation_solve_positions(nvArticulation *art) {
+    if (!art->_active) {
+        // Position correction moves sleeping bodies too, they are kept on their joints
+        if (art->count > 1) _nvArticulation_place(art);
+        return;
+    }
+
+    nvArticulationLink *links = art->links;
+    bool changed = false;
+
+    for (size_t i = 0; i < art->count && !changed; i++) {
+        nvBody *body = links[i].body;
+
+        changed =
+            body->position.x != links[i]._position.x ||
+            body->position.y != links[i]._position.y ||
+            body->angle != links[i]._angle;
+    }
+
+    if (!changed) return;
+
+    // Corrections are small, they are propagated like impulses at the current poses
+    _nvArticulation_factor(art);
+
+    for (size_t i = 0; i < art->count; i++) {
+        nvArticulationLink *link = &links[i];
+        nvBody *body = link->body;
+
+        link->_force = (nvSpatialVector){0.0, 0.0, 0.0};
+        link->_torque = 0.0;
+
+        if (body->type == nvBodyType_STATIC) continue;
+
+        nvSpatialVector change = _nvSpatial_from_body(
+            nvVector2_sub(body->position, link->_position),
+            body->angle - link->_angle,
+            link->_r
+        );
+
+        link->_force = _nvSpatial_mul(_nvSpatialInertia_mul(link->_inertia, change), -1.0);
+    }
+
+    _nvArticulation_propagate(art);
+
+    nvBody *root = links[0].body;
+    if (root->type != nvBodyType_STATIC) {
+        root->position = nvVector2_add(links[0]._position, NV_VEC2(links[0]._delta.x, links[0]._delta.y));
+        root->angle = links[0]._angle + links[0]._delta.w;
+    }
+
+    // Corrections don't push joints past their limits, the velocity solver does that
+    for (size_t i = 1; i < art->count; i++) {
+        nvArticulationLink *link = &links[i];
+        nv_float angle = link->angle + link->_delta_speed;
+
+        if (link->enable_limits) {
+            if (link->_delta_speed < 0.0 && angle < link->lower_limit)
+                angle = nv_fmin(link->angle, link->lower_limit);
+            else if (link->_delta_speed > 0.0 && angle > link->upper_limit)
+                angle = nv_fmax(link->angle, link->upper_limit);
+        }
+
+        link->angle = angle;
+    }
+
+    _nvArticulation_place(art);
+}
+
+bool _nvArticulation_wake(nvArticulation *art) {
+    bool awake = false;
+
+    for (size_t i = 0; i < art->count && !awake; i++) {
+        nvBody *body = art->links[i].body;
+        awake = body->type != nvBodyType_STATIC && !body->is_sleeping;
+    }
+
+    if (!awake) return false;
+
+    bool woken = false;
+
+    for (size_t i = 0; i < art->count; i++) {
+        nvBody *body = art->links[i].body;
+
+        if (body->is_sleeping) {
+            nvBody_awake(body);
+            woken = true;
+        }
+    }
+
+    return woken;
+}
+
+void _nvArticulation_rest(nvArticulation *art, unsigned int timer_threshold) {
+    for (size_t i = 0; i < art->count; i++) {
+        nvBody *body = art->links[i].body;
+
+        if (body->type == nvBodyType_STATIC) continue;
+        if (body->is_sleeping || body->sleep_timer <= timer_threshold) return;
+    }
+
+    for (size_t i = 0; i < art->count; i++) {
+        nvBody *body = art->links[i].body;
+
+        nvBody_sleep(body);
+        body->sleep_timer = 0;
+        art->links[i].speed = 0.0;
+        art->links[i]._linear_velocity = nvVector2_zero;
+        art->links[i]._angular_velocity = 0.0;
+    }
+
+    art->links[0]._velocity = (nvSpatialVector){0.0, 0.0, 0.0};
+}
+
+void _nvArticulation_detach(nvArticulation *art) {
+    for (size_t i = 0; i < art->count; i++) {
+        if (art->links[i].body->articulation == art)
+            art->links[i].body->articulation = NULL;
+    }
+
+    art->count = 0;
+    art->_active = false;
+}
\ No newline at end of file
@@ -16,6 +16,7 @@
 #include "novaphysics/aabb.h"
 #include "novaphysics/constants.h"
 #include "novaphysics/space.h"
+#include "novaphysics/recorder.h"
 
 
 /**
@@ -34,7 +35,9 @@ nvBody *nvBody_new(
     nv_float angle,
     nvMaterial material
 ) {
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_BODIES);
     nvBody *body = NV_NEW(nvBody);
+    NV_ALLOC_SCOPE_END;
     if (!body) return NULL;
 
     body->space = NULL;
@@ -61,13 +64,26 @@ nvBody *nvBody_new(
     body->is_sleeping = false;
     body->sleep_timer = 0;
 
+    body->sim_tier = 0;
+    body->_sim_steps = 0;
+    body->_sim_active = false;
+
     body->is_attractor = false;
 
+    body->articulation = NULL;
+
     body->enable_collision = true;
     body->collision_group = 0;
     body->collision_category = 0b11111111111111111111111111111111;
     body->collision_mask = 0b11111111111111111111111111111111;
 
+    body->_shg_placed = false;
+    body->_shg_parked = false;
+    body->_shg_range = (nvSHGRange){0, 0, 0, 0};
+    body->_shg_dirty = false;
+
+    body->_cache_position = position;
+    body->_cache_angle = angle;
     body->_cache_aabb = false;
     body->_cache_transform = false;
     body->_cached_aabb = (nvAABB){0.0, 0.0, 0.0, 0.0};
@@ -83,7 +99,7 @@ void nvBody_free(void *body) {
 
     nvShape_free(b->shape);
     
-    free(b);
+    NV_FREE(b);
 }
 
 void nvBody_calc_mass_and_inertia(nvBody *body) {
@@ -251,6 +267,11 @@ void nvBody_apply_attraction(nvBody *body, nvBody *attractor, nv_float dt) {
 void nvBody_apply_force(nvBody *body, nvVector2 force) {
     if (body->type == nvBodyType_STATIC) return;
 
+    if (body->space && body->space->recorder) {
+        nv_float values[2] = {force.x, force.y};
+        _nvRecorder_record_body(body->space->recorder, nvRecordEvent_APPLY_FORCE, body, values, 2);
+    }
+
     body->force = nvVector2_add(body->force, force);
 
     nvBody_awake(body);
@@ -263,6 +284,11 @@ void nvBody_apply_force_at(
 ) {
     if (body->type == nvBodyType_STATIC) return;
 
+    if (body->space && body->space->recorder) {
+        nv_float values[4] = {force.x, force.y, position.x, position.y};
+        _nvRecorder_record_body(body->space->recorder, nvRecordEvent_APPLY_FORCE_AT, body, values, 4);
+    }
+
     body->force = nvVector2_add(body->force, force);
     body->torque += nvVector2_cross(position, force);
 
@@ -276,6 +302,12 @@ void nvBody_apply_impulse(
 ) {
     if (body->type == nvBodyType_STATIC) return;
 
+    // Recorder is detached while stepping, so solver impulses aren't recorded
+    if (body->space && body->space->recorder) {
+        nv_float values[4] = {impulse.x, impulse.y, position.x, position.y};
+        _nvRecorder_record_body(body->space->recorder, nvRecordEvent_APPLY_IMPULSE, body, values, 4);
+    }
+
     /*
         v -= J * (1/M)
         w -= rᴾ ⨯ J * (1/I)
@@ -300,11 +332,51 @@ void nvBody_sleep(nvBody *body) {
 void nvBody_awake(nvBody *body) {
     body->is_sleeping = false;
     body->sleep_timer = 0;
+
+    _nvBody_mark_moved(body);
+}
+
+void _nvBody_mark_moved(nvBody *body) {
+    if (!body->_shg_parked || body->_shg_dirty || !body->space) return;
+
+    body->_shg_dirty = true;
+    nvArray_add(body->space->_shg_dirty, body);
+}
+
+void nvBody_set_sim_tier(nvBody *body, nv_uint8 tier) {
+    NV_ASSERT(tier < NV_SIM_TIERS, "Simulation tier is out of range.");
+
+    if (body->space && body->space->recorder) {
+        nv_float value = (nv_float)tier;
+        _nvRecorder_record_body(body->space->recorder, nvRecordEvent_SET_SIM_TIER, body, &value, 1);
+    }
+
+    body->sim_tier = tier;
+}
+
+/*
+    Caches are only invalidated when the pose actually changed (bitwise), so
+    bodies that didn't move keep their AABB and transformed vertices. This also
+    catches poses changed without going through the setters.
+*/
+static inline void _nvBody_check_pose(nvBody *body) {
+    if (
+        body->position.x != body->_cache_position.x ||
+        body->position.y != body->_cache_position.y ||
+        body->angle != body->_cache_angle
+    ) {
+        body->_cache_position = body->position;
+        body->_cache_angle = body->angle;
+        body->_cache_aabb = false;
+        body->_cache_transform = false;
+    }
 }
 
 nvAABB nvBody_get_aabb(nvBody *body) {
     NV_TRACY_ZONE_START;
 
+    _nvBody_check_pose(body);
+
     if (body->_cache_aabb) {
         NV_TRACY_ZONE_END;
         return body->_cached_aabb;
@@ -388,9 +460,51 @@ bool nvBody_get_is_attractor(nvBody *body) {
     return body->is_attractor;
 }
 
+void nvBody_set_position(nvBody *body, nvVector2 position) {
+    if (body->space && body->space->recorder) {
+        nv_float values[2] = {position.x, position.y};
+        _nvRecorder_record_body(body->space->recorder, nvRecordEvent_SET_POSITION, body, values, 2);
+    }
+
+    body->position = position;
+    body->_cache_aabb = false;
+    body->_cache_transform = false;
+
+    _nvBody_mark_moved(body);
+}
+
+void nvBody_set_angle(nvBody *body, nv_float angle) {
+    if (body->space && body->space->recorder)
+        _nvRecorder_record_body(body->space->recorder, nvRecordEvent_SET_ANGLE, body, &angle, 1);
+
+    body->angle = angle;
+    body->_cache_aabb = false;
+    body->_cache_transform = false;
+
+    _nvBody_mark_moved(body);
+}
+
+void nvBody_set_linear_velocity(nvBody *body, nvVector2 velocity) {
+    if (body->space && body->space->recorder) {
+        nv_float values[2] = {velocity.x, velocity.y};
+        _nvRecorder_record_body(body->space->recorder, nvRecordEvent_SET_LINEAR_VELOCITY, body, values, 2);
+    }
+
+    body->linear_velocity = velocity;
+}
+
+void nvBody_set_angular_velocity(nvBody *body, nv_float velocity) {
+    if (body->space && body->space->recorder)
+        _nvRecorder_record_body(body->space->recorder, nvRecordEvent_SET_ANGULAR_VELOCITY, body, &velocity, 1);
+
+    body->angular_velocity = velocity;
+}
+
 void nvBody_local_to_world(nvBody *body) {
     NV_TRACY_ZONE_START;
 
+    _nvBody_check_pose(body);
+
     if (body->_cache_transform) {
         NV_TRACY_ZONE_END;
         return;
@@ -19,6 +19,7 @@
 #include "novaphysics/space.h"
 #include "novaphysics/bvh.h"
 #include "novaphysics/threading.h"
+#include "novaphysics/space_step.h"
 
 
 /**
@@ -56,6 +57,10 @@ static inline bool nvBroadPhase_early_out(nvSpace *space, nvBody *a, nvBody *b)
             return true;
     }
 
+    // Neither body is simulated in this step
+    if (space->_multirate && !a->_sim_active && !b->_sim_active)
+        return true;
+
     // Bodies share the same non-zero group
     if (a->collision_group == b->collision_group && a->collision_group != 0)
         return true;
@@ -93,158 +98,223 @@ void nvBroadPhase_brute_force(nvSpace *space) {
 }
 
 
-void nvBroadPhase_SHG(nvSpace *space) {
-    NV_TRACY_ZONE_START;
-    
-    nvHashMap_clear(space->broadphase_pairs);
+static inline bool nvSHGRange_equals(nvSHGRange a, nvSHGRange b) {
+    return a.min_x == b.min_x && a.min_y == b.min_y && a.max_x == b.max_x && a.max_y == b.max_y;
+}
 
-    nvSHG_place(space->shg, space->bodies);
+/**
+ * @brief Update the cells of bodies that moved to other cells.
+ * 
+ * Cells are persistent, a body is only removed from its old cells and
+ * inserted into the new ones when the range of cells it covers changes.
+ * Static and sleeping bodies are parked in their own cells and aren't looked
+ * at until they wake up or are moved, so the update only goes through the
+ * moving bodies and the ones that were marked since the last update.
+ */
+static void nvBroadPhase_SHG_update(nvSpace *space) {
+    nvSHG *shg = space->shg;
+    nvArray *moving = space->_shg_moving;
 
-    for (size_t i = 0; i < space->bodies->size; i++) {
-        nvBody *a = (nvBody *)space->bodies->data[i];
-        nvAABB abox = nvBody_get_aabb(a);
+    // New, woken up and moved parked bodies
+    for (size_t i = 0; i < space->_shg_dirty->size; i++) {
+        nvBody *body = (nvBody *)space->_shg_dirty->data[i];
+        body->_shg_dirty = false;
 
-        nv_int16 min_x = (nv_int16)(abox.min_x / space->shg->cell_width);
-        nv_int16 min_y = (nv_int16)(abox.min_y / space->shg->cell_height);
-        nv_int16 max_x = (nv_int16)(abox.max_x / space->shg->cell_width);
-        nv_int16 max_y = (nv_int16)(abox.max_y / space->shg->cell_height);
+        // Moving bodies are updated below
+        if (body->_shg_placed) continue;
 
-        for (nv_int16 y = min_y; y < max_y + 1; y++) {
-            for (nv_int16 x = min_x; x < max_x + 1; x++) {
+        bool resting = body->type == nvBodyType_STATIC || body->is_sleeping;
+        nvSHGRange range = nvSHG_get_range(shg, nvBody_get_aabb(body));
 
-                nv_uint32 neighbors[8];
-                bool neighbor_flags[8];
-                nvSHG_get_neighbors(space->shg, x, y, neighbors, neighbor_flags);
+        if (resting && body->_shg_parked && nvSHGRange_equals(range, body->_shg_range))
+            continue;
 
-                for (size_t j = 0; j < 9; j++) {
-                    nvArray *cell;
+        if (body->_shg_parked) nvSHG_unpark(shg, body, body->_shg_range);
 
-                    // Own cell
-                    if (j == 8) {
-                        cell = nvSHG_get(space->shg, nv_pair(x, y));
-                        if (!cell) continue;
-                    }
-                    // Neighbor cells
-                    else {
-                        if (!neighbor_flags[j]) continue;
+        if (resting) {
+            nvSHG_park(shg, body, range);
+        }
+        else {
+            nvSHG_insert(shg, body, range);
+            nvArray_add(moving, body);
+        }
 
-                        cell = nvSHG_get(space->shg, neighbors[j]);
-                        if (!cell) continue;
-                    }
+        body->_shg_range = range;
+        body->_shg_placed = !resting;
+        body->_shg_parked = resting;
+    }
+    nvArray_clear(space->_shg_dirty, NULL);
 
-                    for (size_t k = 0; k < cell->size; k++) {
-                        nvBody *b = (nvBody *)cell->data[k];
+    // Bodies that fell asleep are parked and leave the moving bodies
+    size_t kept = 0;
+    for (size_t i = 0; i < moving->size; i++) {
+        nvBody *body = (nvBody *)moving->data[i];
+        bool resting = body->type == nvBodyType_STATIC || body->is_sleeping;
 
-                        if (nvBroadPhase_early_out(space, a, b)) continue;
+        nvSHGRange range = nvSHG_get_range(shg, nvBody_get_aabb(body));
+        bool same_range = nvSHGRange_equals(range, body->_shg_range);
 
-                        nv_uint32 id_pair = nv_pair(a->id, b->id);
+        if (resting) {
+            nvSHG_remove(shg, body, body->_shg_range);
+            nvSHG_park(shg, body, range);
+        }
+        else {
+            moving->data[kept++] = body;
 
-                        nvAABB bbox = nvBody_get_aabb(b);
+            // Body stays in the same cells
+            if (same_range) continue;
 
-                        if (nv_collide_aabb_x_aabb(abox, bbox)) {
-                            nvHashMap_set(space->broadphase_pairs, &(nvBroadPhasePair){.a=a, .b=b, .id_pair=id_pair});
-                        }
-                    }
-                }
-            }
+            nvSHG_remove(shg, body, body->_shg_range);
+            nvSHG_insert(shg, body, range);
         }
-    }
 
-    NV_TRACY_ZONE_END;
+        body->_shg_range = range;
+        body->_shg_placed = !resting;
+        body->_shg_parked = resting;
+    }
+    moving->size = kept;
 }
 
+/**
+ * @brief Check a moving body against the bodies of one cell.
+ */
+static void nvBroadPhase_SHG_check_cell(
+    nvSpace *space,
+    nvBody *a,
+    nvAABB abox,
+    nvArray *cell,
+    nvHashMap *pairs
+) {
+    for (size_t k = 0; k < cell->size; k++) {
+        nvBody *b = (nvBody *)cell->data[k];
+
+        // Pairs of parked bodies are only found from the moving body, so keep the lower ID first
+        nvBody *first = (a->id < b->id) ? a : b;
+        nvBody *second = (a->id < b->id) ? b : a;
+        if (!b->_shg_parked) {
+            first = a;
+            second = b;
+        }
 
-typedef struct {
-    struct nvSpace *space;
-    nvArray *bodies;
-    nv_uint8 task_id;
-} SHGWorkerData;
+        if (nvBroadPhase_early_out(space, first, second)) continue;
 
+        nv_uint32 id_pair = nv_pair(first->id, second->id);
 
-static int nvBroadPhase_SHG_task(void *data) {
-    NV_TRACY_ZONE_START;
+        nvAABB bbox = nvBody_get_aabb(b);
 
-    nvSpace *space = (((SHGWorkerData *)data))->space;
-    nvArray *bodies = ((SHGWorkerData *)data)->bodies;
-    nv_uint8 task_id = ((SHGWorkerData *)data)->task_id;
+        if (nv_collide_aabb_x_aabb(abox, bbox)) {
+            nvHashMap_set(pairs, &(nvBroadPhasePair){.a=first, .b=second, .id_pair=id_pair});
+        }
+    }
+}
 
-    for (size_t i = 0; i < bodies->size; i++) {
-        nvBody *a = (nvBody *)bodies->data[i];
-        nvAABB abox = nvBody_get_aabb(a);
+/**
+ * @brief Find the pairs of a moving body.
+ */
+static void nvBroadPhase_SHG_query(nvSpace *space, nvBody *a, nvHashMap *pairs) {
+    nvAABB abox = nvBody_get_aabb(a);
+    nvSHGRange range = nvSHG_get_range(space->shg, abox);
 
-        nv_int16 min_x = (nv_int16)(abox.min_x / space->shg->cell_width);
-        nv_int16 min_y = (nv_int16)(abox.min_y / space->shg->cell_height);
-        nv_int16 max_x = (nv_int16)(abox.max_x / space->shg->cell_width);
-        nv_int16 max_y = (nv_int16)(abox.max_y / space->shg->cell_height);
+    for (nv_int16 y = range.min_y; y < range.max_y + 1; y++) {
+        for (nv_int16 x = range.min_x; x < range.max_x + 1; x++) {
 
-        for (nv_int16 y = min_y; y < max_y + 1; y++) {
-            for (nv_int16 x = min_x; x < max_x + 1; x++) {
+            nv_uint32 neighbors[8];
+            bool neighbor_flags[8];
+            nvSHG_get_neighbors(space->shg, x, y, neighbors, neighbor_flags);
 
-                nv_uint32 neighbors[8];
-                bool neighbor_flags[8];
-                nvSHG_get_neighbors(space->shg, x, y, neighbors, neighbor_flags);
+            for (size_t j = 0; j < 9; j++) {
+                nvArray *cell;
 
-                for (size_t j = 0; j < 9; j++) {
-                    nvArray *cell;
+                // Own cell
+                if (j == 8) {
+                    cell = nvSHG_get(space->shg, nv_pair(x, y));
+                    if (!cell) continue;
+                }
+                // Neighbor cells
+                else {
+                    if (!neighbor_flags[j]) continue;
 
-                    // Own cell
-                    if (j == 8) {
-                        cell = nvSHG_get(space->shg, nv_pair(x, y));
-                        if (!cell) continue;
-                    }
-                    // Neighbor cells
-                    else {
-                        if (!neighbor_flags[j]) continue;
+                    cell = nvSHG_get(space->shg, neighbors[j]);
+                    if (!cell) continue;
+                }
 
-                        cell = nvSHG_get(space->shg, neighbors[j]);
-                        if (!cell) continue;
-                    }
+                nvBroadPhase_SHG_check_cell(space, a, abox, cell, pairs);
+            }
 
-                    for (size_t k = 0; k < cell->size; k++) {
-                        nvBody *b = (nvBody *)cell->data[k];
+            /*
+                Parked bodies are in every cell they cover, so an overlapping
+                parked body always shares a cell with the moving body.
+            */
+            nvArray *parked = nvSHG_get_parked(space->shg, nv_pair(x, y));
+            if (parked) nvBroadPhase_SHG_check_cell(space, a, abox, parked, pairs);
+        }
+    }
+}
 
-                        if (nvBroadPhase_early_out(space, a, b)) continue;
+void nvBroadPhase_SHG(nvSpace *space) {
+    NV_TRACY_ZONE_START;
+    
+    nvHashMap_clear(space->broadphase_pairs);
 
-                        nv_uint32 id_pair = nv_pair(a->id, b->id);
+    nvBroadPhase_SHG_update(space);
 
-                        nvAABB bbox = nvBody_get_aabb(b);
+    // Only moving bodies are query sources
+    for (size_t i = 0; i < space->_shg_moving->size; i++) {
+        nvBody *a = (nvBody *)space->_shg_moving->data[i];
+        nvBroadPhase_SHG_query(space, a, space->broadphase_pairs);
+    }
 
-                        if (nv_collide_aabb_x_aabb(abox, bbox)) {
-                            nvBroadPhasePair pair = {
-                                .a = a,
-                                .b = b,
-                                .id_pair = id_pair
-                            };
+    NV_TRACY_ZONE_END;
+}
 
-                            nvHashMap_set(space->mt_shg_pairs->data[task_id], &pair);
-                        }
-                    }
-                }
-            }
-        }
+
+static void nvBroadPhase_SHG_bin_task(nvSpace *space, size_t task_id) {
+    nvArray *bodies = space->mt_shg_bins->data[task_id];
+
+    for (size_t i = 0; i < bodies->size; i++) {
+        nvBody *a = (nvBody *)bodies->data[i];
+        nvBroadPhase_SHG_query(space, a, space->mt_shg_pairs->data[task_id]);
     }
+}
+
+static void nvBroadPhase_SHG_task(void *data, size_t start, size_t end) {
+    NV_TRACY_ZONE_START;
+
+    // Every bin has its own pair map, so bins can be processed on any worker
+    for (size_t i = start; i < end; i++)
+        nvBroadPhase_SHG_bin_task((nvSpace *)data, i);
 
     NV_TRACY_ZONE_END;
-    return 0;
 }
 
 
+size_t nvBroadPhase_SHG_bin(nv_float x, nv_float min_x, nv_float max_x, size_t bin_count) {
+    nv_float width = max_x - min_x;
+
+    // Also catches NaNs and infinite ranges
+    if (!(width > 0.0) || !(x > min_x) || bin_count <= 1) return 0;
+
+    nv_float bin = (x - min_x) / width * (nv_float)bin_count;
+    if (bin >= (nv_float)bin_count) return bin_count - 1;
+
+    return (size_t)bin;
+}
+
 void nvBroadPhase_SHG_parallel(nvSpace *space) {
     NV_TRACY_ZONE_START;
     
-    nvSHG_place(space->shg, space->bodies);
+    nvBroadPhase_SHG_update(space);
 
     for (size_t i = 0; i < space->thread_count; i++) {
         nvHashMap_clear(space->mt_shg_pairs->data[i]);
         nvArray_clear(space->mt_shg_bins->data[i], NULL);
     }
 
-    // Add bodies to bins for individual threads
+    // Add moving bodies to bins for individual threads
 
     nvAABB dyn_aabb = {NV_INF, NV_INF, -NV_INF, -NV_INF};
-    for (size_t i = 0; i < space->bodies->size; i++) {
-        nvBody *body = space->bodies->data[i];
-        if (body->type == nvBodyType_STATIC) continue;
+    for (size_t i = 0; i < space->_shg_moving->size; i++) {
+        nvBody *body = space->_shg_moving->data[i];
         nvAABB aabb = nvBody_get_aabb(body);
 
         dyn_aabb.min_x = nv_fmin(dyn_aabb.min_x, aabb.min_x);
@@ -253,116 +323,27 @@ void nvBroadPhase_SHG_parallel(nvSpace *space) {
         dyn_aabb.max_y = nv_fmax(dyn_aabb.max_y, aabb.max_y);
     }
 
-    nv_float q = (dyn_aabb.max_x - dyn_aabb.min_x) / (nv_float)space->thread_count;
-    for (size_t i = 0; i < space->bodies->size; i++) {
-        nvBody *body = space->bodies->data[i];
-        if (body->type == nvBodyType_STATIC) continue;
-        nvAABB aabb = nvBody_get_aabb(body);
-
-        for (size_t j = 0; j < space->thread_count; j++) {
-            if (j == 0) {
-                if (
-                    aabb.max_x >= dyn_aabb.min_x &&
-                    body->position.x <= q + dyn_aabb.min_x
-                ) {
-                    nvArray_add(space->mt_shg_bins->data[j], body);
-                    break;
-                }
-            }
-
-            else if (j == (space->thread_count - 1)) {
-                if (
-                    aabb.min_x <= dyn_aabb.max_x &&
-                    body->position.x > q * (nv_float)(space->thread_count - 1) + dyn_aabb.min_x
-                ) {
-                    nvArray_add(space->mt_shg_bins->data[j], body);
-                    break;
-                }
-            }
-
-            else {
-                if (
-                    body->position.x > q * (nv_float)(j) + dyn_aabb.min_x &&
-                    body->position.x <= q * (nv_float)(j + 1) + dyn_aabb.min_x
-                ) {
-                    nvArray_add(space->mt_shg_bins->data[j], body);
-                    break;
-                }
-            }
-        }
-    }
-
-    q = space->shg->bounds.max_x / (nv_float)space->thread_count;
-    for (size_t i = 0; i < space->bodies->size; i++) {
-        nvBody *body = space->bodies->data[i];
-        if (body->type == nvBodyType_DYNAMIC) continue;
-        nvAABB aabb = nvBody_get_aabb(body);
-
-        for (size_t j = 0; j < space->thread_count; j++) {
-            if (j == 0) {
-                if (
-                    aabb.max_x >= space->shg->bounds.min_x &&
-                    body->position.x <= q
-                ) {
-                    nvArray_add(space->mt_shg_bins->data[j], body);
-                    break;
-                }
-            }
-
-            else if (j == (space->thread_count - 1)) {
-                if (
-                    aabb.min_x <= space->shg->bounds.max_x &&
-                    body->position.x > q * (nv_float)(space->thread_count - 1)
-                ) {
-                    nvArray_add(space->mt_shg_bins->data[j], body);
-                    break;
-                }
-            }
-
-            else {
-                if (
-                    body->position.x > q * (nv_float)(j) &&
-                    body->position.x <= q * (nv_float)(j + 1)
-                ) {
-                    nvArray_add(space->mt_shg_bins->data[j], body);
-                    break;
-                }
-            }
-        }
-    }
-
-    #ifdef NV_COMPILER_MSVC
-        
-        SHGWorkerData *data = malloc(sizeof(SHGWorkerData) * space->thread_count);
-
-    #else
-
-        SHGWorkerData data[space->thread_count];
-
-    #endif
-    for (size_t i = 0; i < space->thread_count; i++) {
-        data[i] = (SHGWorkerData){
-            .space=space,
-            .bodies=space->mt_shg_bins->data[i],
-            .task_id=i
-        };
-    }
-
-    for (size_t i = 0; i < space->thread_count; i++)
-        nvTaskExecutor_add_task_to(
-            space->task_executor,
-            nvBroadPhase_SHG_task,
-            &data[i],
-            i
+    /*
+        Every moving body is assigned to exactly one bin, otherwise a pair could
+        be skipped or found twice depending on the thread count. Pairs of moving
+        bodies are only checked from the body with the lower ID and pairs with
+        parked bodies only from the moving body, so the union of pairs found in
+        the bins is the same for any number of bins.
+    */
+    for (size_t i = 0; i < space->_shg_moving->size; i++) {
+        nvBody *body = space->_shg_moving->data[i];
+
+        size_t bin = nvBroadPhase_SHG_bin(
+            body->position.x,
+            dyn_aabb.min_x,
+            dyn_aabb.max_x,
+            space->thread_count
         );
 
-    nvTaskExecutor_wait_tasks(space->task_executor);
-
-    #ifdef NV_COMPILER_MSVC
-
-        free(data);
+        nvArray_add(space->mt_shg_bins->data[bin], body);
+    }
 
-    #endif
+    _nvSpace_parallel_for(space, nvBroadPhase_SHG_task, space, space->thread_count, 1);
 
     NV_TRACY_ZONE_END;
 }
@@ -408,4 +389,105 @@ void nvBroadPhase_BVH(nvSpace *space) {
     NV_PROFILER_STOP(timer, space->profiler.bvh_destroy);
 
     NV_TRACY_ZONE_END;
-}
\ No newline at end of file
+}
+
+
+void nvBroadPhase_SHG_measure_drift(nvSpace *space) {
+    NV_TRACY_ZONE_START;
+
+    nv_int16 drift = 0;
+
+    for (size_t i = 0; i < space->awake_bodies->size; i++) {
+        nvBody *body = (nvBody *)space->awake_bodies->data[i];
+        if (!body->_shg_placed && !body->_shg_parked) continue;
+
+        nvSHGRange range = nvSHG_get_range(space->shg, nvBody_get_aabb(body));
+        nvSHGRange placed = body->_shg_range;
+
+        if (placed.min_x - range.min_x > drift) drift = placed.min_x - range.min_x;
+        if (placed.min_y - range.min_y > drift) drift = placed.min_y - range.min_y;
+        if (range.max_x - placed.max_x > drift) drift = range.max_x - placed.max_x;
+        if (range.max_y - placed.max_y > drift) drift = range.max_y - placed.max_y;
+    }
+
+    space->_shg_drift = drift;
+
+    NV_TRACY_ZONE_END;
+}
+
+static int _nvBroadPhase_id_cmp(const void *a, const void *b) {
+    nv_uint32 id_a = (*(nvBody **)a)->id;
+    nv_uint32 id_b = (*(nvBody **)b)->id;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+/**
+ * @brief Add the bodies of one cell that overlap the AABB.
+ * 
+ * A body is in every cell it covers, so it is only taken from the first cell
+ * its range shares with the query range.
+ */
+static void nvBroadPhase_query_cell(
+    nvArray *cell,
+    nvAABB aabb,
+    nvSHGRange range,
+    nv_int16 x,
+    nv_int16 y,
+    nvArray *output
+) {
+    for (size_t k = 0; k < cell->size; k++) {
+        nvBody *body = (nvBody *)cell->data[k];
+        nvSHGRange body_range = body->_shg_range;
+
+        nv_int16 first_x = (body_range.min_x > range.min_x) ? body_range.min_x : range.min_x;
+        nv_int16 first_y = (body_range.min_y > range.min_y) ? body_range.min_y : range.min_y;
+        if (x != first_x || y != first_y) continue;
+
+        if (nv_collide_aabb_x_aabb(aabb, nvBody_get_aabb(body)))
+            nvArray_add(output, body);
+    }
+}
+
+void nvBroadPhase_query_aabb(nvSpace *space, nvAABB aabb, nvArray *output) {
+    size_t start = output->size;
+
+    if (space->broadphase_algorithm != nvBroadPhaseAlg_SHG) {
+        for (size_t i = 0; i < space->bodies->size; i++) {
+            nvBody *body = (nvBody *)space->bodies->data[i];
+            if (nv_collide_aabb_x_aabb(aabb, nvBody_get_aabb(body)))
+                nvArray_add(output, body);
+        }
+    }
+    else {
+        nvSHG *shg = space->shg;
+        nvSHGRange range = nvSHG_get_range(shg, aabb);
+
+        // Bodies moved after the broad-phase placed them, read the cells they could have left
+        nv_int16 drift = space->_shg_drift;
+        range.min_x -= drift; range.min_y -= drift; range.max_x += drift; range.max_y += drift;
+
+        // Cells outside of the borders are never filled
+        if (range.min_x < 0) range.min_x = 0;
+        if (range.min_y < 0) range.min_y = 0;
+        if (range.max_x > (nv_int16)shg->cols - 1) range.max_x = (nv_int16)shg->cols - 1;
+        if (range.max_y > (nv_int16)shg->rows - 1) range.max_y = (nv_int16)shg->rows - 1;
+
+        for (nv_int16 y = range.min_y; y <= range.max_y; y++) {
+            for (nv_int16 x = range.min_x; x <= range.max_x; x++) {
+                nvArray *cell = nvSHG_get(shg, nv_pair(x, y));
+                if (cell) nvBroadPhase_query_cell(cell, aabb, range, x, y, output);
+
+                nvArray *parked = nvSHG_get_parked(shg, nv_pair(x, y));
+                if (parked) nvBroadPhase_query_cell(parked, aabb, range, x, y, output);
+            }
+        }
+    }
+
+    // Cell order depends on the grid, ID order doesn't
+    qsort(
+        output->data + start,
+        output->size - start,
+        sizeof(void *),
+        _nvBroadPhase_id_cmp
+    );
+}
@@ -0,0 +1,124 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include "novaphysics/cell_grid.h"
+#include "novaphysics/space_step.h"
+
+
+/**
+ * @file cell_grid.c
+ *
+ * @brief Uniform grid of points sorted by cells, shared by particles and soft bodies.
+ */
+
+
+/**
+ * @brief Points binned by a parallel range.
+ */
+typedef struct {
+    nvCellGrid *grid;
+    const nv_float *x;
+    const nv_float *y;
+} _nvCellGridBin;
+
+
+void nvCellGrid_release(nvCellGrid *grid) {
+    NV_FREE(grid->cells);
+    NV_FREE(grid->order);
+    NV_FREE(grid->starts);
+    *grid = (nvCellGrid){0};
+}
+
+/**
+ * @brief Find the cells of the points.
+ */
+static void _nvCellGrid_bin(void *data, size_t start, size_t end) {
+    _nvCellGridBin *bin = (_nvCellGridBin *)data;
+    nvCellGrid *grid = bin->grid;
+
+    for (size_t i = start; i < end; i++) {
+        grid->cells[i] = nvCellGrid_cell(
+            grid,
+            nvCellGrid_coord(grid, bin->x[i]),
+            nvCellGrid_coord(grid, bin->y[i])
+        );
+    }
+}
+
+bool nvCellGrid_sort(
+    nvCellGrid *grid,
+    struct nvSpace *space,
+    const nv_float *x,
+    const nv_float *y,
+    size_t count,
+    nvAABB bounds,
+    nv_float cell_size,
+    size_t min_range
+) {
+    grid->inv_cell = 1.0 / cell_size;
+
+    // Rows of cells are used if they don't cover much more space than the points fill
+    nv_float width = nv_floor((bounds.max_x - bounds.min_x) * grid->inv_cell) + 2.0;
+    nv_float height = nv_floor((bounds.max_y - bounds.min_y) * grid->inv_cell) + 2.0;
+    size_t cell_count;
+
+    grid->dense = width * height <= (nv_float)(count * NV_CELL_GRID_DENSE_CELLS);
+
+    if (grid->dense) {
+        grid->origin_x = nvCellGrid_coord(grid, bounds.min_x);
+        grid->origin_y = nvCellGrid_coord(grid, bounds.min_y);
+        grid->width = nvCellGrid_coord(grid, bounds.max_x) - grid->origin_x + 1;
+        grid->height = nvCellGrid_coord(grid, bounds.max_y) - grid->origin_y + 1;
+        cell_count = (size_t)grid->width * (size_t)grid->height;
+    }
+    else {
+        // At least twice as many buckets as points
+        cell_count = 1;
+        while (cell_count < count * 2) cell_count <<= 1;
+        grid->cell_mask = (nv_uint32)(cell_count - 1);
+    }
+
+    if (count > grid->point_capacity) {
+        bool reserved =
+            _nv_reserve((void **)&grid->cells, sizeof(nv_uint32), count) &&
+            _nv_reserve((void **)&grid->order, sizeof(nv_uint32), count);
+
+        if (!reserved) return false;
+        grid->point_capacity = count;
+    }
+
+    if (cell_count > grid->cell_capacity) {
+        if (!_nv_reserve((void **)&grid->starts, sizeof(nv_uint32), cell_count + 1)) return false;
+        grid->cell_capacity = cell_count;
+    }
+
+    _nvCellGridBin bin = {grid, x, y};
+    _nvSpace_parallel_for_items(space, _nvCellGrid_bin, &bin, count, min_range);
+
+    nv_uint32 *starts = grid->starts;
+    for (size_t i = 0; i <= cell_count; i++)
+        starts[i] = 0;
+
+    for (size_t i = 0; i < count; i++)
+        starts[grid->cells[i] + 1]++;
+
+    for (size_t i = 0; i < cell_count; i++)
+        starts[i + 1] += starts[i];
+
+    // Stable scatter, each start is advanced to the start of the next cell
+    for (size_t i = 0; i < count; i++)
+        grid->order[starts[grid->cells[i]]++] = (nv_uint32)i;
+
+    for (size_t i = cell_count; i > 0; i--)
+        starts[i] = starts[i - 1];
+    starts[0] = 0;
+
+    return true;
+}
@@ -27,8 +27,8 @@ void nvConstraint_free(void *cons) {
     if (cons == NULL) return;
     nvConstraint *c = (nvConstraint *)cons;
 
-    free(c->def);
-    free(c);
+    NV_FREE(c->def);
+    NV_FREE(c);
 }
 
 void nvConstraint_presolve(
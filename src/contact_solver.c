@@ -29,6 +29,40 @@
  */
 
 
+/**
+ * @brief Can the contact data prepared earlier in this step be reused?
+ */
+static inline bool _nv_can_reuse_presolve(nvSpace *space, nvResolution *res, nv_uint64 step) {
+    if (space->presolve_reuse == nvPresolveReuse_NONE ||
+        res->_presolve_step != step ||
+        res->_presolve_count != res->contact_count ||
+        nvVector2_dot(res->normal, res->_presolve_normal) <= NV_PRESOLVE_REUSE_NORMAL_COS)
+        return false;
+
+    // Arms are compared to the ones the effective masses were computed with, so drift can't add up over substeps
+    nv_float tolerance = NV_PRESOLVE_REUSE_ARM_TOLERANCE * NV_PRESOLVE_REUSE_ARM_TOLERANCE;
+    for (size_t i = 0; i < res->contact_count; i++) {
+        nvContact *contact = &res->contacts[i];
+        nvVector2 ra = nvVector2_sub(contact->position, res->a->position);
+        nvVector2 rb = nvVector2_sub(contact->position, res->b->position);
+
+        if (nvVector2_len2(nvVector2_sub(ra, contact->_presolve_ra)) > tolerance ||
+            nvVector2_len2(nvVector2_sub(rb, contact->_presolve_rb)) > tolerance)
+            return false;
+    }
+
+    return true;
+}
+
+static inline void _nv_measure_presolve_drift(nvSpace *space, nv_float reused, nv_float prepared) {
+    nvPresolveDrift *drift = &space->presolve_drift;
+    nv_float error = nv_fabs(reused - prepared) / nv_fabs(prepared);
+
+    drift->contacts++;
+    drift->max_error = nv_fmax(drift->max_error, error);
+    drift->mean_error += (error - drift->mean_error) / (nv_float)drift->contacts;
+}
+
 void nv_presolve_contact(
     nvSpace *space,
     nvResolution *res,
@@ -41,19 +75,32 @@ void nv_presolve_contact(
     nvVector2 normal = res->normal;
     nvVector2 tangent = nvVector2_perpr(normal);
 
-    // Mixed restitution
-    nv_float e = nv_mix_coefficients(
-        a->material.restitution,
-        b->material.restitution,
-        space->mix_restitution
-    );
+    // Steps are counted after they finish, 0 marks data that was never prepared
+    nv_uint64 step = space->_step_count + 1;
+    bool reuse = _nv_can_reuse_presolve(space, res, step);
+    bool measure = reuse && space->presolve_reuse == nvPresolveReuse_MEASURE;
+
+    if (!reuse) {
+        // Mixed restitution
+        res->_restitution = nv_mix_coefficients(
+            a->material.restitution,
+            b->material.restitution,
+            space->mix_restitution
+        );
 
-    // Mixed friction
-    res->friction = nv_mix_coefficients(
-        a->material.friction,
-        b->material.friction,
-        space->mix_friction
-    );
+        // Mixed friction
+        res->friction = nv_mix_coefficients(
+            a->material.friction,
+            b->material.friction,
+            space->mix_friction
+        );
+
+        res->_presolve_step = step;
+        res->_presolve_normal = normal;
+        res->_presolve_count = res->contact_count;
+    }
+
+    nv_float e = res->_restitution;
 
     for (size_t i = 0; i < res->contact_count; i++) {
         nvContact *contact = &res->contacts[i];
@@ -76,19 +123,36 @@ void nv_presolve_contact(
             contact->velocity_bias = e * cn;
         }
 
-        contact->mass_normal = 1.0 / nv_calc_mass_k(
-            normal,
-            contact->ra, contact->rb,
-            a->invmass, b->invmass,
-            a->invinertia, b->invinertia
-        );
+        if (!reuse || measure) {
+            nv_float mass_normal = 1.0 / nv_calc_mass_k(
+                normal,
+                contact->ra, contact->rb,
+                a->invmass, b->invmass,
+                a->invinertia, b->invinertia
+            );
 
-        contact->mass_tangent = 1.0 / nv_calc_mass_k(
-            tangent,
-            contact->ra, contact->rb,
-            a->invmass, b->invmass,
-            a->invinertia, b->invinertia
-        );
+            nv_float mass_tangent = 1.0 / nv_calc_mass_k(
+                tangent,
+                contact->ra, contact->rb,
+                a->invmass, b->invmass,
+                a->invinertia, b->invinertia
+            );
+
+            if (measure) {
+                _nv_measure_presolve_drift(space, contact->mass_normal, mass_normal);
+                _nv_measure_presolve_drift(space, contact->mass_tangent, mass_tangent);
+            }
+            else {
+                contact->mass_normal = mass_normal;
+                contact->mass_tangent = mass_tangent;
+                contact->_presolve_ra = contact->ra;
+                contact->_presolve_rb = contact->rb;
+            }
+        }
+
+        // Shock propagation passes start over every substep
+        contact->shock_jn = 0.0;
+        contact->shock_jt = 0.0;
 
         if (space->position_correction == nvPositionCorrection_BAUMGARTE) {
             // Position error is fed back to the velocity constraint as a bias 
@@ -137,9 +201,33 @@ void nv_warmstart(nvSpace *space, nvResolution *res) {
     NV_TRACY_ZONE_END;
 }
 
-void nv_solve_velocity(nvResolution *res) {
-    NV_TRACY_ZONE_START;
+/**
+ * @brief Effective mass with one body treated as having infinite mass.
+ */
+static inline nv_float _nv_shock_mass(
+    nvVector2 direction,
+    nvContact *contact,
+    nvBody *a,
+    nvBody *b,
+    nvBody *fixed
+) {
+    nv_float k = nv_calc_mass_k(
+        direction,
+        contact->ra, contact->rb,
+        (a == fixed) ? 0.0 : a->invmass, (b == fixed) ? 0.0 : b->invmass,
+        (a == fixed) ? 0.0 : a->invinertia, (b == fixed) ? 0.0 : b->invinertia
+    );
+
+    return (k > 0.0) ? 1.0 / k : 0.0;
+}
 
+/*
+    Shock propagation impulses are accumulated apart from the regular ones.
+    Fixed bodies don't receive them, so warm-starting them onto both bodies
+    in the next step would push the lower bodies of a stack down. Clamping
+    still applies to the total impulse of the contact.
+*/
+static inline void _nv_solve_velocity(nvResolution *res, nvBody *fixed, bool shock) {
     nvBody *a = res->a;
     nvBody *b = res->b;
     nvVector2 normal = res->normal;
@@ -164,20 +252,23 @@ void nv_solve_velocity(nvResolution *res) {
         );
 
         // Tangential lambda (tangential impulse magnitude)
-        nv_float jt = -nvVector2_dot(rv, tangent) * contact->mass_tangent;
+        nv_float mass_tangent = fixed ? _nv_shock_mass(tangent, contact, a, b, fixed) : contact->mass_tangent;
+        nv_float jt = -nvVector2_dot(rv, tangent) * mass_tangent;
 
         // Accumulate tangential impulse
-        nv_float f = contact->jn * res->friction;
-        nv_float jt0 = contact->jt;
+        nv_float *accumulated = shock ? &contact->shock_jt : &contact->jt;
+        nv_float base = shock ? contact->jt : 0.0;
+        nv_float f = (contact->jn + contact->shock_jn) * res->friction;
+        nv_float jt0 = *accumulated;
         // Clamp lambda between friction limits
-        contact->jt = nv_fmax(-f, nv_fmin(jt0 + jt, f));
-        jt = contact->jt - jt0;
+        *accumulated = nv_fmax(-f, nv_fmin(base + jt0 + jt, f)) - base;
+        jt = *accumulated - jt0;
 
         nvVector2 impulse = nvVector2_mul(tangent, jt);
 
         // Apply tangential impulse
-        nvBody_apply_impulse(a, nvVector2_neg(impulse), contact->ra);
-        nvBody_apply_impulse(b, impulse, contact->rb);
+        if (a != fixed) nvBody_apply_impulse(a, nvVector2_neg(impulse), contact->ra);
+        if (b != fixed) nvBody_apply_impulse(b, impulse, contact->rb);
     }
 
     // Solve penetration
@@ -196,20 +287,37 @@ void nv_solve_velocity(nvResolution *res) {
         //nv_float jn = -(cn + contact->velocity_bias + contact->position_bias) * contact->mass_normal;
         
         //-cp->normalMass * (vn + cp->biasCoefficient * cp->separation * inv_dt)
-        nv_float jn = -(cn + contact->position_bias * -res->depth) * contact->mass_normal;
+        nv_float mass_normal = fixed ? _nv_shock_mass(normal, contact, a, b, fixed) : contact->mass_normal;
+        nv_float jn = -(cn + contact->position_bias * -res->depth) * mass_normal;
 
         // Accumulate normal impulse
-        nv_float jn0 = contact->jn;
+        nv_float *accumulated = shock ? &contact->shock_jn : &contact->jn;
+        nv_float base = shock ? contact->jn : 0.0;
+        nv_float jn0 = *accumulated;
         // Clamp lambda because we only want to solve penetration
-        contact->jn = nv_fmax(jn0 + jn, 0.0);
-        jn = contact->jn - jn0;
+        *accumulated = nv_fmax(base + jn0 + jn, 0.0) - base;
+        jn = *accumulated - jn0;
 
         nvVector2 impulse = nvVector2_mul(normal, jn);
 
         // Apply normal impulse
-        nvBody_apply_impulse(a, nvVector2_neg(impulse), contact->ra);
-        nvBody_apply_impulse(b, impulse, contact->rb);
+        if (a != fixed) nvBody_apply_impulse(a, nvVector2_neg(impulse), contact->ra);
+        if (b != fixed) nvBody_apply_impulse(b, impulse, contact->rb);
     }
+}
+
+void nv_solve_velocity(nvResolution *res) {
+    NV_TRACY_ZONE_START;
+
+    _nv_solve_velocity(res, NULL, false);
+
+    NV_TRACY_ZONE_END;
+}
+
+void nv_solve_velocity_shock(nvResolution *res, nvBody *fixed) {
+    NV_TRACY_ZONE_START;
+
+    _nv_solve_velocity(res, fixed, true);
 
     NV_TRACY_ZONE_END;
 }
@@ -261,5 +369,9 @@ void nv_solve_position(nvResolution *res) {
         b->angle += nvVector2_cross(rb, impulse) * b->invinertia;
     }
 
+    // Sleeping bodies can be pushed by awake ones
+    _nvBody_mark_moved(a);
+    _nvBody_mark_moved(b);
+
     NV_TRACY_ZONE_END;
 }
\ No newline at end of file
@@ -26,14 +26,18 @@ nvConstraint *nvDistanceJoint_new(
     nvVector2 anchor_b,
     nv_float length
 ) {
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_CONSTRAINTS);
     nvConstraint *cons = NV_NEW(nvConstraint);
+    NV_ALLOC_SCOPE_END;
     if (!cons) return NULL;
 
     cons->a = a;
     cons->b = b;
     cons->type = nvConstraintType_DISTANCEJOINT;
 
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_CONSTRAINTS);
     cons->def = (void *)NV_NEW(nvDistanceJoint);
+    NV_ALLOC_SCOPE_END;
     if (!cons->def) return NULL;
     nvDistanceJoint *dist_joint = (nvDistanceJoint *)cons->def;
 
@@ -24,14 +24,18 @@ nvConstraint *nvHingeJoint_new(
     nvBody *b,
     nvVector2 anchor
 ) {
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_CONSTRAINTS);
     nvConstraint *cons = NV_NEW(nvConstraint);
+    NV_ALLOC_SCOPE_END;
     if (!cons) return NULL;
 
     cons->a = a;
     cons->b = b;
     cons->type = nvConstraintType_HINGEJOINT;
 
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_CONSTRAINTS);
     cons->def = (void *)NV_NEW(nvHingeJoint);
+    NV_ALLOC_SCOPE_END;
     if (!cons->def) return NULL;
     nvHingeJoint *hinge_joint = (nvHingeJoint *)cons->def;
 
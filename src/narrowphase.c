@@ -11,6 +11,7 @@
 #include "novaphysics/internal.h"
 #include "novaphysics/narrowphase.h"
 #include "novaphysics/space.h"
+#include "novaphysics/space_step.h"
 
 
 /**
@@ -21,10 +22,15 @@
 
 
 void nv_narrow_phase(nvSpace *space) {
-    void *map_val;
-    size_t l = 0;
-    while (nvHashMap_iter(space->broadphase_pairs, &l, &map_val)) {
-        nvBroadPhasePair *pair = map_val;
+    /*
+        Pairs are processed in an order sorted by body IDs, so new
+        resolutions are always inserted in the same order no matter how the
+        broad-phase pairs were collected.
+    */
+    _nvSpace_sort_pairs(space);
+
+    for (size_t i = 0; i < space->_pair_order->size; i++) {
+        nvBroadPhasePair *pair = space->_pair_order->data[i];
 
         nvResolution *res_value;
         res_value = nvHashMap_get(space->res, &(nvResolution){.a=pair->a, .b=pair->b});
@@ -134,6 +140,7 @@ void nv_narrow_phase_between_pair(
             res_new.contacts[1].jt = 0.0; 
             res_new.state = nvResolutionState_FIRST;
             res_new.lifetime = space->collision_persistence;
+            res_new._presolve_step = 0;
             
             nvHashMap_set(space->res, &res_new);
         }
@@ -0,0 +1,724 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include "novaphysics/particle.h"
+#include "novaphysics/constants.h"
+#include "novaphysics/broadphase.h"
+#include "novaphysics/collision.h"
+#include "novaphysics/resolution.h"
+#include "novaphysics/space.h"
+#include "novaphysics/space_step.h"
+
+
+/**
+ * @file particle.c
+ *
+ * @brief Particle system for granular material and debris.
+ *
+ * Every substep the particles are moved with their velocities and sorted into
+ * a cell grid one particle diameter wide (see cell_grid.h). Particle
+ * components are gathered in grid order, so neighbour search only reads the
+ * 3x3 cells around a particle, which are three ranges of particles when the
+ * cells are in rows.
+ *
+ * Particle-particle contacts are solved with Jacobi iterations: each particle
+ * only writes its own correction, so particles are solved on multiple threads
+ * and the result doesn't depend on the thread count. Bodies near the
+ * particles are found through the broad-phase once per substep, their
+ * contacts are solved one body at a time, then velocities are derived from
+ * the change in positions.
+ */
+
+
+// Minimum number of particles in one parallel range
+#define _NV_PARTICLE_MIN_RANGE 512
+
+
+nvParticleSystem *nvParticleSystem_new(nv_float radius, nvMaterial material) {
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_PARTICLES);
+    nvParticleSystem *ps = NV_NEW(nvParticleSystem);
+    NV_ALLOC_SCOPE_END;
+    if (!ps) return NULL;
+
+    *ps = (nvParticleSystem){0};
+
+    ps->radius = radius;
+    ps->material = material;
+    ps->mass = material.density * NV_PI * radius * radius;
+    ps->gravity_scale = 1.0;
+    ps->linear_damping = 0.002;
+    ps->substeps = NV_PARTICLE_SUBSTEPS;
+    ps->iterations = NV_PARTICLE_ITERATIONS;
+    ps->coupling = nvParticleCoupling_TWO_WAY;
+
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_PARTICLES);
+    ps->_bodies = nvArray_new();
+    NV_ALLOC_SCOPE_END;
+    if (!ps->_bodies) {
+        NV_FREE(ps);
+        return NULL;
+    }
+
+    ps->collide_particles = true;
+    ps->collision_category = 0b11111111111111111111111111111111;
+    ps->collision_mask = 0b11111111111111111111111111111111;
+
+    return ps;
+}
+
+void nvParticleSystem_free(void *ps) {
+    if (!ps) return;
+    nvParticleSystem *p = (nvParticleSystem *)ps;
+
+    NV_FREE(p->position_x);
+    NV_FREE(p->position_y);
+    NV_FREE(p->velocity_x);
+    NV_FREE(p->velocity_y);
+    NV_FREE(p->_prev_x);
+    NV_FREE(p->_prev_y);
+    NV_FREE(p->_delta_x);
+    NV_FREE(p->_delta_y);
+    NV_FREE(p->_visits);
+    for (size_t i = 0; i < 6; i++)
+        NV_FREE(p->_sorted[i]);
+    nvCellGrid_release(&p->_grid);
+    nvArray_free(p->_bodies);
+    NV_FREE(p->_normals);
+
+    NV_FREE(p);
+}
+
+/**
+ * @brief Grow the particle buffers.
+ */
+static bool _nvParticleSystem_reserve(nvParticleSystem *ps, size_t capacity) {
+    if (capacity <= ps->capacity) return true;
+
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_PARTICLES);
+
+    bool reserved =
+        _nv_reserve((void **)&ps->position_x, sizeof(nv_float), capacity) &&
+        _nv_reserve((void **)&ps->position_y, sizeof(nv_float), capacity) &&
+        _nv_reserve((void **)&ps->velocity_x, sizeof(nv_float), capacity) &&
+        _nv_reserve((void **)&ps->velocity_y, sizeof(nv_float), capacity) &&
+        _nv_reserve((void **)&ps->_prev_x, sizeof(nv_float), capacity) &&
+        _nv_reserve((void **)&ps->_prev_y, sizeof(nv_float), capacity) &&
+        _nv_reserve((void **)&ps->_delta_x, sizeof(nv_float), capacity) &&
+        _nv_reserve((void **)&ps->_delta_y, sizeof(nv_float), capacity);
+
+    if (reserved) {
+        // New particles haven't been visited by any body pass
+        nv_uint32 *visits = NV_REALLOC(ps->_visits, sizeof(nv_uint32) * capacity);
+        reserved = visits != NULL;
+
+        if (visits) {
+            for (size_t i = ps->capacity; i < capacity; i++)
+                visits[i] = 0;
+            ps->_visits = visits;
+        }
+    }
+
+    for (size_t i = 0; i < 6 && reserved; i++)
+        reserved = _nv_reserve((void **)&ps->_sorted[i], sizeof(nv_float), capacity);
+
+    NV_ALLOC_SCOPE_END;
+
+    if (reserved) ps->capacity = capacity;
+    return reserved;
+}
+
+bool nvParticleSystem_add(nvParticleSystem *ps, nvVector2 position, nvVector2 velocity) {
+    if (ps->count == ps->capacity) {
+        size_t capacity = (ps->capacity < 64) ? 64 : ps->capacity * 2;
+        if (!_nvParticleSystem_reserve(ps, capacity)) return false;
+    }
+
+    size_t i = ps->count++;
+    ps->position_x[i] = position.x;
+    ps->position_y[i] = position.y;
+    ps->velocity_x[i] = velocity.x;
+    ps->velocity_y[i] = velocity.y;
+
+    return true;
+}
+
+void nvParticleSystem_clear(nvParticleSystem *ps) {
+    ps->count = 0;
+}
+
+
+/**
+ * @brief State of the substep shared with the parallel ranges.
+ */
+typedef struct {
+    nvParticleSystem *ps;
+    nv_float dt;
+    nvVector2 gravity;
+    nv_float damping;
+    nvCellGrid *grid;
+} _nvParticleStep;
+
+/**
+ * @brief Parallel-for over particles, the split only depends on the particle count.
+ */
+static void _nvParticleSystem_parallel_for(
+    nvSpace *space,
+    nvParallelForCallback callback,
+    void *data,
+    size_t count
+) {
+    _nvSpace_parallel_for_items(space, callback, data, count, _NV_PARTICLE_MIN_RANGE);
+}
+
+/**
+ * @brief Apply gravity & damping and move the particles.
+ */
+static void _nvParticleSystem_predict(void *data, size_t start, size_t end) {
+    _nvParticleStep *step = (_nvParticleStep *)data;
+    nvParticleSystem *ps = step->ps;
+
+    for (size_t i = start; i < end; i++) {
+        nv_float vx = (ps->velocity_x[i] + step->gravity.x * step->dt) * step->damping;
+        nv_float vy = (ps->velocity_y[i] + step->gravity.y * step->dt) * step->damping;
+
+        ps->_prev_x[i] = ps->position_x[i];
+        ps->_prev_y[i] = ps->position_y[i];
+        ps->position_x[i] += vx * step->dt;
+        ps->position_y[i] += vy * step->dt;
+        ps->velocity_x[i] = vx;
+        ps->velocity_y[i] = vy;
+    }
+}
+
+/**
+ * @brief Gather particle components in grid order.
+ */
+static void _nvParticleSystem_gather(void *data, size_t start, size_t end) {
+    _nvParticleStep *step = (_nvParticleStep *)data;
+    nvParticleSystem *ps = step->ps;
+
+    nv_float *components[6] = {
+        ps->position_x, ps->position_y,
+        ps->velocity_x, ps->velocity_y,
+        ps->_prev_x, ps->_prev_y
+    };
+
+    for (size_t k = 0; k < 6; k++) {
+        nv_float *src = components[k];
+        nv_float *dst = ps->_sorted[k];
+
+        for (size_t i = start; i < end; i++)
+            dst[i] = src[step->grid->order[i]];
+    }
+}
+
+/**
+ * @brief Remove the particles outside of kill bounds and find the bounds of the rest.
+ */
+static void _nvParticleSystem_cull(nvSpace *space, nvParticleSystem *ps) {
+    nvAABB kill = space->kill_bounds;
+    nvAABB bounds = {NV_INF, NV_INF, -NV_INF, -NV_INF};
+
+    // Order of the remaining particles doesn't matter since they are sorted next
+    for (size_t i = 0; i < ps->count;) {
+        nv_float x = ps->position_x[i];
+        nv_float y = ps->position_y[i];
+
+        if (!space->use_kill_bounds || (x >= kill.min_x && x <= kill.max_x && y >= kill.min_y && y <= kill.max_y)) {
+            bounds.min_x = nv_fmin(bounds.min_x, x);
+            bounds.min_y = nv_fmin(bounds.min_y, y);
+            bounds.max_x = nv_fmax(bounds.max_x, x);
+            bounds.max_y = nv_fmax(bounds.max_y, y);
+            i++;
+            continue;
+        }
+
+        size_t last = --ps->count;
+        ps->position_x[i] = ps->position_x[last];
+        ps->position_y[i] = ps->position_y[last];
+        ps->velocity_x[i] = ps->velocity_x[last];
+        ps->velocity_y[i] = ps->velocity_y[last];
+        ps->_prev_x[i] = ps->_prev_x[last];
+        ps->_prev_y[i] = ps->_prev_y[last];
+    }
+
+    ps->bounds = bounds;
+}
+
+/**
+ * @brief Sort particles by grid cells.
+ *
+ * Returns false if the cells couldn't be allocated.
+ */
+static bool _nvParticleSystem_sort(nvSpace *space, nvParticleSystem *ps, _nvParticleStep *step) {
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_PARTICLES);
+    bool sorted = nvCellGrid_sort(
+        step->grid,
+        space,
+        ps->position_x,
+        ps->position_y,
+        ps->count,
+        ps->bounds,
+        ps->radius * 2.0,
+        _NV_PARTICLE_MIN_RANGE
+    );
+    NV_ALLOC_SCOPE_END;
+
+    if (!sorted) return false;
+
+    _nvParticleSystem_parallel_for(space, _nvParticleSystem_gather, step, ps->count);
+
+    nv_float **components[6] = {
+        &ps->position_x, &ps->position_y,
+        &ps->velocity_x, &ps->velocity_y,
+        &ps->_prev_x, &ps->_prev_y
+    };
+
+    for (size_t k = 0; k < 6; k++) {
+        nv_float *swap = *components[k];
+        *components[k] = ps->_sorted[k];
+        ps->_sorted[k] = swap;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Compute particle-particle corrections.
+ */
+static void _nvParticleSystem_solve_particles(void *data, size_t start, size_t end) {
+    _nvParticleStep *step = (_nvParticleStep *)data;
+    nvParticleSystem *ps = step->ps;
+
+    nv_float diameter = ps->radius * 2.0;
+    nv_float diameter2 = diameter * diameter;
+    nv_float friction = ps->material.friction;
+
+    const nv_float *px = ps->position_x;
+    const nv_float *py = ps->position_y;
+    const nv_float *prev_x = ps->_prev_x;
+    const nv_float *prev_y = ps->_prev_y;
+
+    const nvCellGrid *grid = step->grid;
+    nvCellRanges ranges;
+
+    for (size_t i = start; i < end; i++) {
+        nv_float xi = px[i];
+        nv_float yi = py[i];
+        nv_float mxi = xi - prev_x[i];
+        nv_float myi = yi - prev_y[i];
+
+        nvCellGrid_neighbour_ranges(
+            grid,
+            nvCellGrid_coord(grid, xi),
+            nvCellGrid_coord(grid, yi),
+            &ranges
+        );
+
+        nv_float sum_x = 0.0;
+        nv_float sum_y = 0.0;
+        size_t contacts = 0;
+
+        for (size_t r = 0; r < ranges.count; r++) {
+            for (nv_uint32 j = ranges.begins[r]; j < ranges.ends[r]; j++) {
+                nv_float dx = xi - px[j];
+                nv_float dy = yi - py[j];
+                nv_float dist2 = dx * dx + dy * dy;
+                if (dist2 >= diameter2 || j == i) continue;
+
+                nv_float nx, ny, dist;
+
+                // Particles at the same position are separated vertically by their order
+                if (dist2 == 0.0) {
+                    nx = 0.0;
+                    ny = (i < j) ? -1.0 : 1.0;
+                    dist = 0.0;
+                }
+                else {
+                    dist = nv_sqrt(dist2);
+                    nv_float inv_dist = 1.0 / dist;
+                    nx = dx * inv_dist;
+                    ny = dy * inv_dist;
+                }
+
+                nv_float depth = (diameter - dist) * 0.5;
+                nv_float corr_x = nx * depth;
+                nv_float corr_y = ny * depth;
+
+                // Friction cancels relative tangential movement in the substep
+                if (friction > 0.0) {
+                    nv_float rx = mxi - (px[j] - prev_x[j]);
+                    nv_float ry = myi - (py[j] - prev_y[j]);
+                    nv_float rn = rx * nx + ry * ny;
+                    nv_float tx = rx - nx * rn;
+                    nv_float ty = ry - ny * rn;
+                    nv_float tlen2 = tx * tx + ty * ty;
+
+                    // Half of the movement is cancelled while sticking, no need for the length
+                    nv_float limit = friction * depth;
+                    nv_float f = 0.5;
+                    if (tlen2 * 0.25 > limit * limit) f = limit / nv_sqrt(tlen2);
+
+                    corr_x -= tx * f;
+                    corr_y -= ty * f;
+                }
+
+                sum_x += corr_x;
+                sum_y += corr_y;
+                contacts++;
+            }
+        }
+
+        // Corrections are averaged, summing them overshoots in dense packings
+        nv_float scale = (contacts > 0) ? 1.0 / (nv_float)contacts : 0.0;
+        ps->_delta_x[i] = sum_x * scale;
+        ps->_delta_y[i] = sum_y * scale;
+    }
+}
+
+/**
+ * @brief Apply particle-particle corrections.
+ */
+static void _nvParticleSystem_apply_deltas(void *data, size_t start, size_t end) {
+    _nvParticleStep *step = (_nvParticleStep *)data;
+    nvParticleSystem *ps = step->ps;
+
+    for (size_t i = start; i < end; i++) {
+        ps->position_x[i] += ps->_delta_x[i];
+        ps->position_y[i] += ps->_delta_y[i];
+    }
+}
+
+/**
+ * @brief Derive velocities from the movement in the substep.
+ */
+static void _nvParticleSystem_finish(void *data, size_t start, size_t end) {
+    _nvParticleStep *step = (_nvParticleStep *)data;
+    nvParticleSystem *ps = step->ps;
+    nv_float inv_dt = 1.0 / step->dt;
+
+    for (size_t i = start; i < end; i++) {
+        ps->velocity_x[i] = (ps->position_x[i] - ps->_prev_x[i]) * inv_dt;
+        ps->velocity_y[i] = (ps->position_y[i] - ps->_prev_y[i]) * inv_dt;
+    }
+}
+
+bool _nvParticle_collide_body(
+    nvBody *body,
+    nvArray *vertices,
+    const nvVector2 *normals,
+    nv_float r,
+    nvVector2 p,
+    nvVector2 *normal,
+    nv_float *depth,
+    nvVector2 *point
+) {
+
+    if (body->shape->type == nvShapeType_CIRCLE) {
+        nvVector2 d = nvVector2_sub(p, body->position);
+        nv_float reach = body->shape->radius + r;
+        nv_float dist2 = nvVector2_len2(d);
+        if (dist2 >= reach * reach) return false;
+
+        nv_float dist = nv_sqrt(dist2);
+        *normal = (dist > 0.0) ? nvVector2_div(d, dist) : NV_VEC2(0.0, -1.0);
+        *depth = reach - dist;
+        *point = nvVector2_add(body->position, nvVector2_mul(*normal, body->shape->radius));
+        return true;
+    }
+
+    // Edge with the highest separation, normals are outward
+    size_t n = vertices->size;
+    nv_float separation = -NV_INF;
+    size_t edge = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        nv_float s = nvVector2_dot(normals[i], nvVector2_sub(p, NV_TO_VEC2(vertices->data[i])));
+        if (s >= r) return false;
+
+        if (s > separation) {
+            separation = s;
+            edge = i;
+        }
+    }
+
+    nvVector2 v1 = NV_TO_VEC2(vertices->data[edge]);
+    nvVector2 v2 = NV_TO_VEC2(vertices->data[(edge + 1) % n]);
+
+    // Particle's center is outside, it can be closest to one of the vertices
+    if (separation > 0.0) {
+        nvVector2 vertex;
+        bool corner = true;
+
+        if (nvVector2_dot(nvVector2_sub(p, v1), nvVector2_sub(v2, v1)) <= 0.0) vertex = v1;
+        else if (nvVector2_dot(nvVector2_sub(p, v2), nvVector2_sub(v1, v2)) <= 0.0) vertex = v2;
+        else corner = false;
+
+        if (corner) {
+            nvVector2 d = nvVector2_sub(p, vertex);
+            nv_float dist2 = nvVector2_len2(d);
+            if (dist2 >= r * r || dist2 == 0.0) return false;
+
+            nv_float dist = nv_sqrt(dist2);
+            *normal = nvVector2_div(d, dist);
+            *depth = r - dist;
+            *point = vertex;
+            return true;
+        }
+    }
+
+    *normal = normals[edge];
+    *depth = r - separation;
+    *point = nvVector2_sub(p, nvVector2_mul(*normal, separation));
+    return true;
+}
+
+bool _nvParticle_wake_body(nvSpace *space, nvBody *body, nvVector2 correction, nv_float dt) {
+    if (!space->sleeping || !body->is_sleeping || body->type != nvBodyType_DYNAMIC) return false;
+
+    nv_float linear = nvVector2_len2(nvVector2_div(correction, dt)) * (1.0 / 60.0);
+    if (linear <= space->wake_energy_threshold) return false;
+
+    nvBody_awake(body);
+    return true;
+}
+
+bool _nvParticle_polygon_normals(nvBody *body, nvVector2 **normals, size_t *capacity) {
+    nvBody_local_to_world(body);
+    nvArray *vertices = body->shape->trans_vertices;
+    size_t n = vertices->size;
+
+    if (n > *capacity) {
+        if (!_nv_reserve((void **)normals, sizeof(nvVector2), n)) return false;
+        *capacity = n;
+    }
+
+    // Signed area gives the winding of the vertices
+    nv_float area = 0.0;
+    for (size_t i = 0; i < n; i++)
+        area += nvVector2_cross(NV_TO_VEC2(vertices->data[i]), NV_TO_VEC2(vertices->data[(i + 1) % n]));
+
+    for (size_t i = 0; i < n; i++) {
+        nvVector2 edge = nvVector2_sub(NV_TO_VEC2(vertices->data[(i + 1) % n]), NV_TO_VEC2(vertices->data[i]));
+        (*normals)[i] = nvVector2_normalize((area > 0.0) ? nvVector2_perpr(edge) : nvVector2_perp(edge));
+    }
+
+    return true;
+}
+
+/**
+ * @brief Push one particle out of a body.
+ */
+static inline void _nvParticleSystem_solve_body_contact(
+    nvSpace *space,
+    _nvParticleStep *step,
+    nvBody *body,
+    nvArray *vertices,
+    nv_float friction,
+    bool *pushed,
+    size_t i
+) {
+    nvParticleSystem *ps = step->ps;
+
+    nvVector2 p = NV_VEC2(ps->position_x[i], ps->position_y[i]);
+    nvVector2 normal, point;
+    nv_float depth;
+    if (!_nvParticle_collide_body(body, vertices, ps->_normals, ps->radius, p, &normal, &depth, &point)) return;
+
+    nvVector2 correction = nvVector2_mul(normal, depth);
+
+    // Friction cancels movement relative to the body's surface in the substep
+    nvVector2 arm = nvVector2_sub(point, body->position);
+    nvVector2 surface = nvVector2_add(
+        body->linear_velocity,
+        nvVector2_mul(nvVector2_perp(arm), body->angular_velocity)
+    );
+
+    nvVector2 moved = nvVector2_sub(
+        nvVector2_add(NV_VEC2(p.x - ps->_prev_x[i], p.y - ps->_prev_y[i]), correction),
+        nvVector2_mul(surface, step->dt)
+    );
+    nvVector2 tangent = nvVector2_sub(moved, nvVector2_mul(normal, nvVector2_dot(moved, normal)));
+    nv_float tangent_len = nvVector2_len(tangent);
+
+    if (tangent_len > 0.0) {
+        nv_float f = nv_fmin(tangent_len, friction * depth) / tangent_len;
+        correction = nvVector2_sub(correction, nvVector2_mul(tangent, f));
+    }
+
+    ps->position_x[i] += correction.x;
+    ps->position_y[i] += correction.y;
+
+    // Particles landing on a sleeping body wake it up and push it from then on
+    if (
+        !*pushed &&
+        ps->coupling == nvParticleCoupling_TWO_WAY &&
+        _nvParticle_wake_body(space, body, correction, step->dt)
+    )
+        *pushed = !space->_multirate;
+
+    // Momentum the particle gained is taken from the body
+    if (*pushed)
+        nvBody_apply_impulse(body, nvVector2_mul(correction, -ps->mass / step->dt), arm);
+}
+
+/**
+ * @brief Push particles out of one body.
+ */
+static void _nvParticleSystem_solve_body(nvSpace *space, _nvParticleStep *step, nvBody *body) {
+    nvParticleSystem *ps = step->ps;
+
+    nvArray *vertices = NULL;
+    if (body->shape->type == nvShapeType_POLYGON) {
+        NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_PARTICLES);
+        bool prepared = _nvParticle_polygon_normals(body, &ps->_normals, &ps->_normal_capacity);
+        NV_ALLOC_SCOPE_END;
+
+        if (!prepared) return;
+        vertices = body->shape->trans_vertices;
+    }
+
+    nv_float r = ps->radius;
+    nvAABB box = nvBody_get_aabb(body);
+    box = (nvAABB){box.min_x - r, box.min_y - r, box.max_x + r, box.max_y + r};
+
+    bool pushed = (
+        ps->coupling == nvParticleCoupling_TWO_WAY &&
+        body->type == nvBodyType_DYNAMIC &&
+        !body->is_sleeping &&
+        (!space->_multirate || body->_sim_active)
+    );
+
+    nv_float friction = nv_mix_coefficients(ps->material.friction, body->material.friction, space->mix_friction);
+
+    const nvCellGrid *grid = step->grid;
+    nv_int32 x0 = nvCellGrid_coord(grid, box.min_x);
+    nv_int32 y0 = nvCellGrid_coord(grid, box.min_y);
+    nv_int32 x1 = nvCellGrid_coord(grid, box.max_x);
+    nv_int32 y1 = nvCellGrid_coord(grid, box.max_y);
+
+    // Particles can move out of their cells while iterating, one more cell is checked around the body
+    x0--; y0--; x1++; y1++;
+
+    if (grid->dense) {
+        x0 = (x0 > grid->origin_x) ? x0 - grid->origin_x : 0;
+        y0 = (y0 > grid->origin_y) ? y0 - grid->origin_y : 0;
+        x1 = (x1 - grid->origin_x < grid->width - 1) ? x1 - grid->origin_x : grid->width - 1;
+        y1 = (y1 - grid->origin_y < grid->height - 1) ? y1 - grid->origin_y : grid->height - 1;
+
+        for (nv_int32 y = y0; y <= y1 && x0 <= x1; y++) {
+            nv_uint32 row = (nv_uint32)(y * grid->width);
+            nv_uint32 end = grid->starts[row + x1 + 1];
+
+            for (nv_uint32 i = grid->starts[row + x0]; i < end; i++)
+                _nvParticleSystem_solve_body_contact(space, step, body, vertices, friction, &pushed, i);
+        }
+
+        return;
+    }
+
+    // Bodies covering more cells than there are buckets test every particle instead
+    nv_float cells = ((nv_float)x1 - (nv_float)x0 + 1.0) * ((nv_float)y1 - (nv_float)y0 + 1.0);
+    if (cells >= (nv_float)grid->cell_mask + 1.0) {
+        for (size_t i = 0; i < ps->count; i++)
+            _nvParticleSystem_solve_body_contact(space, step, body, vertices, friction, &pushed, i);
+
+        return;
+    }
+
+    // Cells can share buckets, particles are only visited once per body
+    ps->_visit++;
+    if (ps->_visit == 0) {
+        for (size_t i = 0; i < ps->count; i++)
+            ps->_visits[i] = 0;
+        ps->_visit = 1;
+    }
+
+    for (nv_int32 y = y0; y <= y1; y++) {
+        for (nv_int32 x = x0; x <= x1; x++) {
+            nv_uint32 bucket = nvCellGrid_cell(grid, x, y);
+            nv_uint32 end = grid->starts[bucket + 1];
+
+            for (nv_uint32 i = grid->starts[bucket]; i < end; i++) {
+                if (ps->_visits[i] == ps->_visit) continue;
+                ps->_visits[i] = ps->_visit;
+
+                _nvParticleSystem_solve_body_contact(space, step, body, vertices, friction, &pushed, i);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Should particles collide with the body?
+ */
+static inline bool _nvParticleSystem_filter(nvParticleSystem *ps, nvBody *body) {
+    if (!body->enable_collision) return false;
+
+    return (
+        (ps->collision_mask & body->collision_category) != 0 &&
+        (body->collision_mask & ps->collision_category) != 0
+    );
+}
+
+void nvParticleSystem_step(nvSpace *space, nvParticleSystem *ps, nv_float dt) {
+    if (ps->count == 0 || ps->substeps == 0) return;
+
+    NV_TRACY_ZONE_START;
+
+    _nvParticleStep step = {
+        .ps = ps,
+        .dt = dt / (nv_float)ps->substeps,
+        .gravity = nvVector2_mul(space->gravity, ps->gravity_scale),
+        .damping = nv_pow(0.98, ps->linear_damping),
+        .grid = &ps->_grid
+    };
+
+    for (size_t k = 0; k < ps->substeps && ps->count > 0; k++) {
+        _nvParticleSystem_parallel_for(space, _nvParticleSystem_predict, &step, ps->count);
+        _nvParticleSystem_cull(space, ps);
+
+        if (ps->count == 0 || !_nvParticleSystem_sort(space, ps, &step)) break;
+
+        // Particles can move up to a diameter while iterating
+        nv_float margin = ps->radius * 2.0;
+        nvAABB reach = {
+            ps->bounds.min_x - margin, ps->bounds.min_y - margin,
+            ps->bounds.max_x + margin, ps->bounds.max_y + margin
+        };
+
+        // Bodies don't move while particles are solved, they are found once per substep
+        nvArray_clear(ps->_bodies, NULL);
+        NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_PARTICLES);
+        nvBroadPhase_query_aabb(space, reach, ps->_bodies);
+        NV_ALLOC_SCOPE_END;
+
+        size_t body_count = 0;
+        for (size_t j = 0; j < ps->_bodies->size; j++) {
+            nvBody *body = ps->_bodies->data[j];
+            if (_nvParticleSystem_filter(ps, body)) ps->_bodies->data[body_count++] = body;
+        }
+        ps->_bodies->size = body_count;
+
+        for (size_t i = 0; i < ps->iterations; i++) {
+            if (ps->collide_particles) {
+                _nvParticleSystem_parallel_for(space, _nvParticleSystem_solve_particles, &step, ps->count);
+                _nvParticleSystem_parallel_for(space, _nvParticleSystem_apply_deltas, &step, ps->count);
+            }
+
+            for (size_t j = 0; j < ps->_bodies->size; j++)
+                _nvParticleSystem_solve_body(space, &step, ps->_bodies->data[j]);
+        }
+
+        _nvParticleSystem_parallel_for(space, _nvParticleSystem_finish, &step, ps->count);
+    }
+
+    NV_TRACY_ZONE_END;
+}
\ No newline at end of file
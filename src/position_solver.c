@@ -0,0 +1,544 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include "novaphysics/internal.h"
+#include "novaphysics/position_solver.h"
+#include "novaphysics/constants.h"
+#include "novaphysics/space.h"
+#include "novaphysics/space_step.h"
+
+
+/**
+ * @file position_solver.c
+ *
+ * @brief Batched NGS position solver.
+ */
+
+
+// Marks body IDs that are not in the solver
+#define _NV_SOLVER_NO_BODY 0xFFFFFFFF
+
+// Colour of the contacts that are solved serially
+#define _NV_SOLVER_SERIAL_COLOR NV_POSITION_SOLVER_COLORS
+
+
+nvPositionSolver *nvPositionSolver_new() {
+    nvPositionSolver *solver = NV_NEW(nvPositionSolver);
+    if (!solver) return NULL;
+
+    *solver = (nvPositionSolver){0};
+
+    return solver;
+}
+
+void nvPositionSolver_free(nvPositionSolver *solver) {
+    if (!solver) return;
+
+    NV_FREE(solver->bodies);
+    NV_FREE(solver->position_x);
+    NV_FREE(solver->position_y);
+    NV_FREE(solver->angle);
+    NV_FREE(solver->rotation_c);
+    NV_FREE(solver->rotation_s);
+    NV_FREE(solver->invmass);
+    NV_FREE(solver->invinertia);
+    NV_FREE(solver->is_static);
+    NV_FREE(solver->_color_masks);
+
+    NV_FREE(solver->a);
+    NV_FREE(solver->b);
+    NV_FREE(solver->ra_x);
+    NV_FREE(solver->ra_y);
+    NV_FREE(solver->rb_x);
+    NV_FREE(solver->rb_y);
+    NV_FREE(solver->normal_x);
+    NV_FREE(solver->normal_y);
+    NV_FREE(solver->depth);
+
+    NV_FREE(solver->_staged_res);
+    NV_FREE(solver->_staged_index);
+    NV_FREE(solver->_staged_color);
+
+    NV_FREE(solver->_id_map);
+
+    NV_FREE(solver);
+}
+
+
+/**
+ * @brief Grow the buffers, they are reused every substep.
+ */
+static bool _nvPositionSolver_reserve(nvPositionSolver *solver, size_t contacts, size_t max_id) {
+    if (contacts > solver->contact_capacity) {
+        if (!_nv_reserve((void **)&solver->a, sizeof(nv_uint32), contacts) ||
+            !_nv_reserve((void **)&solver->b, sizeof(nv_uint32), contacts) ||
+            !_nv_reserve((void **)&solver->ra_x, sizeof(nv_float), contacts) ||
+            !_nv_reserve((void **)&solver->ra_y, sizeof(nv_float), contacts) ||
+            !_nv_reserve((void **)&solver->rb_x, sizeof(nv_float), contacts) ||
+            !_nv_reserve((void **)&solver->rb_y, sizeof(nv_float), contacts) ||
+            !_nv_reserve((void **)&solver->normal_x, sizeof(nv_float), contacts) ||
+            !_nv_reserve((void **)&solver->normal_y, sizeof(nv_float), contacts) ||
+            !_nv_reserve((void **)&solver->depth, sizeof(nv_float), contacts) ||
+            !_nv_reserve((void **)&solver->_staged_res, sizeof(nvResolution *), contacts) ||
+            !_nv_reserve((void **)&solver->_staged_index, sizeof(nv_uint8), contacts) ||
+            !_nv_reserve((void **)&solver->_staged_color, sizeof(nv_uint8), contacts))
+            return false;
+
+        solver->contact_capacity = contacts;
+    }
+
+    // Every contact adds at most two bodies
+    size_t bodies = contacts * 2;
+    if (bodies > solver->body_capacity) {
+        if (!_nv_reserve((void **)&solver->bodies, sizeof(nvBody *), bodies) ||
+            !_nv_reserve((void **)&solver->position_x, sizeof(nv_float), bodies) ||
+            !_nv_reserve((void **)&solver->position_y, sizeof(nv_float), bodies) ||
+            !_nv_reserve((void **)&solver->angle, sizeof(nv_float), bodies) ||
+            !_nv_reserve((void **)&solver->rotation_c, sizeof(nv_float), bodies) ||
+            !_nv_reserve((void **)&solver->rotation_s, sizeof(nv_float), bodies) ||
+            !_nv_reserve((void **)&solver->invmass, sizeof(nv_float), bodies) ||
+            !_nv_reserve((void **)&solver->invinertia, sizeof(nv_float), bodies) ||
+            !_nv_reserve((void **)&solver->is_static, sizeof(bool), bodies) ||
+            !_nv_reserve((void **)&solver->_color_masks, sizeof(nv_uint32), bodies))
+            return false;
+
+        solver->body_capacity = bodies;
+    }
+
+    if (max_id + 1 > solver->_id_map_size) {
+        if (!_nv_reserve((void **)&solver->_id_map, sizeof(nv_uint32), max_id + 1))
+            return false;
+
+        for (size_t i = solver->_id_map_size; i < max_id + 1; i++)
+            solver->_id_map[i] = _NV_SOLVER_NO_BODY;
+
+        solver->_id_map_size = max_id + 1;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Get the solver index of a body, adding it to the solver if it isn't in yet.
+ */
+static nv_uint32 _nvPositionSolver_add_body(nvPositionSolver *solver, nvBody *body, nv_float angle0) {
+    nv_uint32 index = solver->_id_map[body->id];
+    if (index != _NV_SOLVER_NO_BODY) return index;
+
+    index = (nv_uint32)solver->body_count++;
+    solver->_id_map[body->id] = index;
+
+    // Contact arms are rotated by how much the body turned since presolve
+    nv_float turned = body->angle - angle0;
+
+    solver->bodies[index] = body;
+    solver->position_x[index] = body->position.x;
+    solver->position_y[index] = body->position.y;
+    solver->angle[index] = body->angle;
+    solver->rotation_c[index] = nv_cos(turned);
+    solver->rotation_s[index] = nv_sin(turned);
+    solver->invmass[index] = body->invmass;
+    solver->invinertia[index] = body->invinertia;
+    solver->is_static[index] = body->type == nvBodyType_STATIC;
+    solver->_color_masks[index] = 0;
+
+    return index;
+}
+
+/**
+ * @brief Get the lowest colour neither body is used in.
+ */
+static nv_uint8 _nvPositionSolver_color(nvPositionSolver *solver, nv_uint32 a, nv_uint32 b) {
+    // Static bodies are never written, so they don't restrict colours
+    nv_uint32 used = 0;
+    if (!solver->is_static[a]) used |= solver->_color_masks[a];
+    if (!solver->is_static[b]) used |= solver->_color_masks[b];
+
+    for (nv_uint8 color = 0; color < NV_POSITION_SOLVER_COLORS; color++) {
+        nv_uint32 bit = (nv_uint32)1 << color;
+
+        if (!(used & bit)) {
+            if (!solver->is_static[a]) solver->_color_masks[a] |= bit;
+            if (!solver->is_static[b]) solver->_color_masks[b] |= bit;
+            return color;
+        }
+    }
+
+    return _NV_SOLVER_SERIAL_COLOR;
+}
+
+bool nvPositionSolver_prepare(nvPositionSolver *solver, nvArray *resolutions) {
+    NV_TRACY_ZONE_START;
+
+    solver->body_count = 0;
+    solver->contact_count = 0;
+
+    size_t contacts = 0;
+    size_t max_id = 0;
+    for (size_t i = 0; i < resolutions->size; i++) {
+        nvResolution *res = resolutions->data[i];
+        contacts += res->contact_count;
+        if (res->a->id > max_id) max_id = res->a->id;
+        if (res->b->id > max_id) max_id = res->b->id;
+    }
+
+    if (!_nvPositionSolver_reserve(solver, contacts, max_id)) {
+        NV_TRACY_ZONE_END;
+        return false;
+    }
+
+    size_t color_counts[NV_POSITION_SOLVER_COLORS + 1] = {0};
+
+    for (size_t i = 0; i < resolutions->size; i++) {
+        nvResolution *res = resolutions->data[i];
+
+        for (nv_uint8 j = 0; j < res->contact_count; j++) {
+            nvContact *contact = &res->contacts[j];
+
+            nv_uint32 a = _nvPositionSolver_add_body(solver, res->a, contact->a_angle0);
+            nv_uint32 b = _nvPositionSolver_add_body(solver, res->b, contact->b_angle0);
+            nv_uint8 color = _nvPositionSolver_color(solver, a, b);
+
+            solver->_staged_res[solver->contact_count] = res;
+            solver->_staged_index[solver->contact_count] = j;
+            solver->_staged_color[solver->contact_count] = color;
+            solver->contact_count++;
+            color_counts[color]++;
+        }
+    }
+
+    solver->color_starts[0] = 0;
+    for (size_t i = 0; i < NV_POSITION_SOLVER_COLORS + 1; i++)
+        solver->color_starts[i + 1] = solver->color_starts[i] + color_counts[i];
+
+    // Sort contacts by colour, they keep the order of the resolutions within a colour
+    size_t offsets[NV_POSITION_SOLVER_COLORS + 1];
+    for (size_t i = 0; i < NV_POSITION_SOLVER_COLORS + 1; i++)
+        offsets[i] = solver->color_starts[i];
+
+    for (size_t i = 0; i < solver->contact_count; i++) {
+        nvResolution *res = solver->_staged_res[i];
+        nvContact *contact = &res->contacts[solver->_staged_index[i]];
+        size_t k = offsets[solver->_staged_color[i]]++;
+
+        solver->a[k] = solver->_id_map[res->a->id];
+        solver->b[k] = solver->_id_map[res->b->id];
+        solver->ra_x[k] = contact->ra.x;
+        solver->ra_y[k] = contact->ra.y;
+        solver->rb_x[k] = contact->rb.x;
+        solver->rb_y[k] = contact->rb.y;
+        solver->normal_x[k] = res->normal.x;
+        solver->normal_y[k] = res->normal.y;
+        solver->depth[k] = res->depth;
+    }
+
+    NV_TRACY_ZONE_END;
+    return true;
+}
+
+
+/**
+ * @brief Apply a small angle correction to a solver body.
+ *
+ * Rotation is advanced with the truncated series of sine & cosine, the error
+ * is at the order of the fourth power of the correction which is negligible
+ * for the corrections NGS makes.
+ */
+static inline void _nvPositionSolver_rotate(nvPositionSolver *solver, nv_uint32 i, nv_float dangle) {
+    nv_float dangle2 = dangle * dangle;
+    nv_float dc = 1.0 - dangle2 * 0.5;
+    nv_float ds = dangle - dangle2 * dangle / 6.0;
+
+    nv_float c = solver->rotation_c[i];
+    nv_float s = solver->rotation_s[i];
+
+    solver->angle[i] += dangle;
+    solver->rotation_c[i] = c * dc - s * ds;
+    solver->rotation_s[i] = s * dc + c * ds;
+}
+
+/**
+ * @brief Solve one contact, same as @ref nv_solve_position.
+ *
+ * Operations are in the same order as the AVX version, so a contact gets the
+ * same result whether it is solved in a batch or not.
+ */
+static inline void _nvPositionSolver_solve_contact(nvPositionSolver *solver, size_t k) {
+    nv_uint32 a = solver->a[k];
+    nv_uint32 b = solver->b[k];
+    nv_float nx = solver->normal_x[k];
+    nv_float ny = solver->normal_y[k];
+
+    nv_float rax = solver->rotation_c[a] * solver->ra_x[k] - solver->rotation_s[a] * solver->ra_y[k];
+    nv_float ray = solver->rotation_s[a] * solver->ra_x[k] + solver->rotation_c[a] * solver->ra_y[k];
+    nv_float rbx = solver->rotation_c[b] * solver->rb_x[k] - solver->rotation_s[b] * solver->rb_y[k];
+    nv_float rby = solver->rotation_s[b] * solver->rb_x[k] + solver->rotation_c[b] * solver->rb_y[k];
+
+    // Current separation
+    nv_float dx = (solver->position_x[b] - solver->position_x[a]) + (rbx - rax);
+    nv_float dy = (solver->position_y[b] - solver->position_y[a]) + (rby - ray);
+    nv_float depth = dx * nx + dy * ny - solver->depth[k];
+
+    nv_float rna = rax * ny - ray * nx;
+    nv_float rnb = rbx * ny - rby * nx;
+    nv_float mass_normal = (solver->invmass[a] + solver->invmass[b]) +
+                           (solver->invinertia[a] * (rna * rna) + solver->invinertia[b] * (rnb * rnb));
+
+    nv_float correction = nv_fmin(0.0, depth + NV_POSITION_CORRECTION_SLOP);
+    nv_float position_bias = -NV_BAUMGARTE * correction;
+
+    // Normal pseudo lambda
+    nv_float jp = position_bias / mass_normal;
+
+    nv_float ix = nx * jp;
+    nv_float iy = ny * jp;
+
+    // Apply pseudo-impulse
+    if (!solver->is_static[a]) {
+        solver->position_x[a] -= ix * solver->invmass[a];
+        solver->position_y[a] -= iy * solver->invmass[a];
+        _nvPositionSolver_rotate(solver, a, -(rax * iy - ray * ix) * solver->invinertia[a]);
+    }
+
+    if (!solver->is_static[b]) {
+        solver->position_x[b] += ix * solver->invmass[b];
+        solver->position_y[b] += iy * solver->invmass[b];
+        _nvPositionSolver_rotate(solver, b, (rbx * iy - rby * ix) * solver->invinertia[b]);
+    }
+}
+
+#if defined(NV_AVX) && defined(NV_USE_SIMD) && !defined(NV_USE_FLOAT)
+
+    /**
+     * @brief Solve four contacts of the same colour using AVX double vectors.
+     */
+    static inline void _nvPositionSolver_solve_contacts_AVX(nvPositionSolver *solver, size_t k) {
+        nv_uint32 *a = &solver->a[k];
+        nv_uint32 *b = &solver->b[k];
+
+        #define _NV_GATHER(array, i) _mm256_set_pd(array[i[3]], array[i[2]], array[i[1]], array[i[0]])
+
+        __m256d v_pax = _NV_GATHER(solver->position_x, a);
+        __m256d v_pay = _NV_GATHER(solver->position_y, a);
+        __m256d v_ca = _NV_GATHER(solver->rotation_c, a);
+        __m256d v_sa = _NV_GATHER(solver->rotation_s, a);
+        __m256d v_ima = _NV_GATHER(solver->invmass, a);
+        __m256d v_iia = _NV_GATHER(solver->invinertia, a);
+
+        __m256d v_pbx = _NV_GATHER(solver->position_x, b);
+        __m256d v_pby = _NV_GATHER(solver->position_y, b);
+        __m256d v_cb = _NV_GATHER(solver->rotation_c, b);
+        __m256d v_sb = _NV_GATHER(solver->rotation_s, b);
+        __m256d v_imb = _NV_GATHER(solver->invmass, b);
+        __m256d v_iib = _NV_GATHER(solver->invinertia, b);
+
+        #undef _NV_GATHER
+
+        // Contact data is already laid out contiguously
+        __m256d v_ra_x = _mm256_loadu_pd(&solver->ra_x[k]);
+        __m256d v_ra_y = _mm256_loadu_pd(&solver->ra_y[k]);
+        __m256d v_rb_x = _mm256_loadu_pd(&solver->rb_x[k]);
+        __m256d v_rb_y = _mm256_loadu_pd(&solver->rb_y[k]);
+        __m256d v_nx = _mm256_loadu_pd(&solver->normal_x[k]);
+        __m256d v_ny = _mm256_loadu_pd(&solver->normal_y[k]);
+        __m256d v_depth = _mm256_loadu_pd(&solver->depth[k]);
+
+        __m256d v_rax = _mm256_sub_pd(_mm256_mul_pd(v_ca, v_ra_x), _mm256_mul_pd(v_sa, v_ra_y));
+        __m256d v_ray = _mm256_add_pd(_mm256_mul_pd(v_sa, v_ra_x), _mm256_mul_pd(v_ca, v_ra_y));
+        __m256d v_rbx = _mm256_sub_pd(_mm256_mul_pd(v_cb, v_rb_x), _mm256_mul_pd(v_sb, v_rb_y));
+        __m256d v_rby = _mm256_add_pd(_mm256_mul_pd(v_sb, v_rb_x), _mm256_mul_pd(v_cb, v_rb_y));
+
+        // Current separation
+        __m256d v_dx = _mm256_add_pd(_mm256_sub_pd(v_pbx, v_pax), _mm256_sub_pd(v_rbx, v_rax));
+        __m256d v_dy = _mm256_add_pd(_mm256_sub_pd(v_pby, v_pay), _mm256_sub_pd(v_rby, v_ray));
+        __m256d v_sep = _mm256_sub_pd(
+            _mm256_add_pd(_mm256_mul_pd(v_dx, v_nx), _mm256_mul_pd(v_dy, v_ny)),
+            v_depth
+        );
+
+        __m256d v_rna = _mm256_sub_pd(_mm256_mul_pd(v_rax, v_ny), _mm256_mul_pd(v_ray, v_nx));
+        __m256d v_rnb = _mm256_sub_pd(_mm256_mul_pd(v_rbx, v_ny), _mm256_mul_pd(v_rby, v_nx));
+        __m256d v_mass_normal = _mm256_add_pd(
+            _mm256_add_pd(v_ima, v_imb),
+            _mm256_add_pd(
+                _mm256_mul_pd(v_iia, _mm256_mul_pd(v_rna, v_rna)),
+                _mm256_mul_pd(v_iib, _mm256_mul_pd(v_rnb, v_rnb))
+            )
+        );
+
+        __m256d v_correction = _mm256_min_pd(
+            _mm256_setzero_pd(),
+            _mm256_add_pd(v_sep, NV_AVX_VECTOR_FROM_DOUBLE(NV_POSITION_CORRECTION_SLOP))
+        );
+        __m256d v_jp = _mm256_div_pd(
+            _mm256_mul_pd(NV_AVX_VECTOR_FROM_DOUBLE(-NV_BAUMGARTE), v_correction),
+            v_mass_normal
+        );
+
+        __m256d v_ix = _mm256_mul_pd(v_nx, v_jp);
+        __m256d v_iy = _mm256_mul_pd(v_ny, v_jp);
+
+        NV_ALIGNED_AS(32) double final_pax[4];
+        NV_ALIGNED_AS(32) double final_pay[4];
+        NV_ALIGNED_AS(32) double final_dangle_a[4];
+        NV_ALIGNED_AS(32) double final_pbx[4];
+        NV_ALIGNED_AS(32) double final_pby[4];
+        NV_ALIGNED_AS(32) double final_dangle_b[4];
+
+        _mm256_store_pd(final_pax, _mm256_sub_pd(v_pax, _mm256_mul_pd(v_ix, v_ima)));
+        _mm256_store_pd(final_pay, _mm256_sub_pd(v_pay, _mm256_mul_pd(v_iy, v_ima)));
+        _mm256_store_pd(final_pbx, _mm256_add_pd(v_pbx, _mm256_mul_pd(v_ix, v_imb)));
+        _mm256_store_pd(final_pby, _mm256_add_pd(v_pby, _mm256_mul_pd(v_iy, v_imb)));
+
+        _mm256_store_pd(final_dangle_a, _mm256_mul_pd(
+            _mm256_sub_pd(_mm256_mul_pd(v_ray, v_ix), _mm256_mul_pd(v_rax, v_iy)),
+            v_iia
+        ));
+        _mm256_store_pd(final_dangle_b, _mm256_mul_pd(
+            _mm256_sub_pd(_mm256_mul_pd(v_rbx, v_iy), _mm256_mul_pd(v_rby, v_ix)),
+            v_iib
+        ));
+
+        // Bodies are unique in a colour, so lanes never write the same body
+        for (size_t lane = 0; lane < 4; lane++) {
+            if (!solver->is_static[a[lane]]) {
+                solver->position_x[a[lane]] = final_pax[lane];
+                solver->position_y[a[lane]] = final_pay[lane];
+                _nvPositionSolver_rotate(solver, a[lane], final_dangle_a[lane]);
+            }
+
+            if (!solver->is_static[b[lane]]) {
+                solver->position_x[b[lane]] = final_pbx[lane];
+                solver->position_y[b[lane]] = final_pby[lane];
+                _nvPositionSolver_rotate(solver, b[lane], final_dangle_b[lane]);
+            }
+        }
+    }
+
+#endif
+
+static void _nvPositionSolver_solve_range(nvPositionSolver *solver, size_t start, size_t end) {
+    size_t k = start;
+
+    #if defined(NV_AVX) && defined(NV_USE_SIMD) && !defined(NV_USE_FLOAT)
+
+        for (; k + 4 <= end; k += 4)
+            _nvPositionSolver_solve_contacts_AVX(solver, k);
+
+    #endif
+
+    for (; k < end; k++)
+        _nvPositionSolver_solve_contact(solver, k);
+}
+
+
+// Contacts of a colour are split between threads in batches of this size
+#define _NV_SOLVER_BATCH 4
+
+typedef struct {
+    nvPositionSolver *solver;
+    size_t start;
+    size_t end;
+} _nvPositionSolverColor;
+
+static void _nvPositionSolver_color_task(void *data, size_t start, size_t end) {
+    NV_TRACY_ZONE_START;
+
+    _nvPositionSolverColor *color = data;
+
+    // Ranges are in batches, so the same contacts are batched together for any thread count
+    size_t contact_start = color->start + start * _NV_SOLVER_BATCH;
+    size_t contact_end = color->start + end * _NV_SOLVER_BATCH;
+    if (contact_end > color->end) contact_end = color->end;
+
+    _nvPositionSolver_solve_range(color->solver, contact_start, contact_end);
+
+    NV_TRACY_ZONE_END;
+}
+
+void nvPositionSolver_solve(nvSpace *space, nvPositionSolver *solver) {
+    NV_TRACY_ZONE_START;
+
+    for (size_t i = 0; i < NV_POSITION_SOLVER_COLORS; i++) {
+        size_t start = solver->color_starts[i];
+        size_t end = solver->color_starts[i + 1];
+
+        if (end - start >= NV_POSITION_SOLVER_PARALLEL_THRESHOLD) {
+            _nvPositionSolverColor color = {.solver = solver, .start = start, .end = end};
+            size_t batches = (end - start + _NV_SOLVER_BATCH - 1) / _NV_SOLVER_BATCH;
+            _nvSpace_parallel_for(space, _nvPositionSolver_color_task, &color, batches, 16);
+        }
+        else {
+            _nvPositionSolver_solve_range(solver, start, end);
+        }
+    }
+
+    // Contacts of the serial colour can share bodies with each other
+    for (size_t k = solver->color_starts[_NV_SOLVER_SERIAL_COLOR]; k < solver->color_starts[_NV_SOLVER_SERIAL_COLOR + 1]; k++)
+        _nvPositionSolver_solve_contact(solver, k);
+
+    NV_TRACY_ZONE_END;
+}
+
+/**
+ * @brief Get the solver index of a body, or _NV_SOLVER_NO_BODY if it isn't in the solver.
+ */
+static inline nv_uint32 _nvPositionSolver_find_body(nvPositionSolver *solver, nvBody *body) {
+    if (body->id >= solver->_id_map_size) return _NV_SOLVER_NO_BODY;
+    return solver->_id_map[body->id];
+}
+
+void nvPositionSolver_store_body(nvPositionSolver *solver, nvBody *body) {
+    nv_uint32 i = _nvPositionSolver_find_body(solver, body);
+    if (i == _NV_SOLVER_NO_BODY || solver->is_static[i]) return;
+
+    body->position = NV_VEC2(solver->position_x[i], solver->position_y[i]);
+    body->angle = solver->angle[i];
+}
+
+void nvPositionSolver_load_body(nvPositionSolver *solver, nvBody *body) {
+    nv_uint32 i = _nvPositionSolver_find_body(solver, body);
+    if (i == _NV_SOLVER_NO_BODY || solver->is_static[i]) return;
+
+    solver->position_x[i] = body->position.x;
+    solver->position_y[i] = body->position.y;
+
+    // The body can be turned by more than a small correction, so the rotation is advanced exactly
+    nv_float turned = body->angle - solver->angle[i];
+    if (turned != 0.0) {
+        nv_float dc = nv_cos(turned);
+        nv_float ds = nv_sin(turned);
+        nv_float c = solver->rotation_c[i];
+        nv_float s = solver->rotation_s[i];
+
+        solver->angle[i] = body->angle;
+        solver->rotation_c[i] = c * dc - s * ds;
+        solver->rotation_s[i] = s * dc + c * ds;
+    }
+}
+
+void nvPositionSolver_finish(nvPositionSolver *solver) {
+    for (size_t i = 0; i < solver->body_count; i++) {
+        nvBody *body = solver->bodies[i];
+
+        if (!solver->is_static[i]) {
+            body->position = NV_VEC2(solver->position_x[i], solver->position_y[i]);
+            body->angle = solver->angle[i];
+
+            // Sleeping bodies can be pushed by awake ones
+            _nvBody_mark_moved(body);
+        }
+
+        solver->_id_map[body->id] = _NV_SOLVER_NO_BODY;
+    }
+
+    solver->body_count = 0;
+    solver->contact_count = 0;
+}
\ No newline at end of file
@@ -0,0 +1,643 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "novaphysics/internal.h"
+#include "novaphysics/recorder.h"
+#include "novaphysics/body.h"
+#include "novaphysics/constraint.h"
+
+
+/**
+ * @file recorder.c
+ *
+ * @brief Recording external mutations of a space and replaying them.
+ */
+
+
+// Number of recordable body IDs
+#define _NV_RECORDER_MAX_IDS 65536
+
+
+static bool _nvRecorder_snapshot(nvRecorder *recorder) {
+    nvSpace *space = recorder->space;
+
+    nv_uint8 *scene;
+    size_t scene_size = nvScene_serialize(space, &scene, 0.0, 0, 0, 0, 0);
+    if (scene_size == 0) return false;
+
+    nv_uint16 *ids = NV_MALLOC(sizeof(nv_uint16) * (space->bodies->size + 1));
+    if (!ids) {
+        NV_FREE(scene);
+        return false;
+    }
+
+    for (size_t i = 0; i < space->bodies->size; i++)
+        ids[i] = ((nvBody *)space->bodies->data[i])->id;
+
+    NV_FREE(recorder->scene);
+    NV_FREE(recorder->ids);
+
+    recorder->scene = scene;
+    recorder->scene_size = scene_size;
+    recorder->ids = ids;
+    recorder->body_count = space->bodies->size;
+    recorder->id_counter = space->_id_counter;
+
+    recorder->size = 0;
+    recorder->step_count = 0;
+    recorder->complete = true;
+
+    return true;
+}
+
+static bool _nvRecorder_reserve(nvRecorder *recorder, size_t size) {
+    if (recorder->size + size <= recorder->capacity) return true;
+
+    size_t capacity = recorder->capacity * 2;
+    if (capacity < recorder->size + size) capacity = recorder->size + size;
+    if (capacity < 4096) capacity = 4096;
+
+    nv_uint8 *events = NV_REALLOC(recorder->events, capacity);
+    if (!events) {
+        recorder->complete = false;
+        return false;
+    }
+
+    recorder->events = events;
+    recorder->capacity = capacity;
+    return true;
+}
+
+static void _nvRecorder_write(nvRecorder *recorder, const void *data, size_t size) {
+    memcpy(recorder->events + recorder->size, data, size);
+    recorder->size += size;
+}
+
+static void _nvRecorder_write_varint(nvRecorder *recorder, nv_uint64 value) {
+    while (value >= 0x80) {
+        recorder->events[recorder->size++] = (nv_uint8)(value | 0x80);
+        value >>= 7;
+    }
+    recorder->events[recorder->size++] = (nv_uint8)value;
+}
+
+static void _nvRecorder_write_double(nvRecorder *recorder, double value) {
+    _nvRecorder_write(recorder, &value, sizeof(double));
+}
+
+
+nvRecorder *nvRecorder_new(nvSpace *space) {
+    NV_ASSERT(!space->recorder, "Space already has a recorder attached.");
+    NV_ASSERT(!space->_async_running, "You can't attach a recorder while an asynchronous step is running.");
+
+    nvRecorder *recorder = NV_NEW(nvRecorder);
+    if (!recorder) return NULL;
+
+    recorder->space = space;
+    recorder->scene = NULL;
+    recorder->ids = NULL;
+    recorder->events = NULL;
+    recorder->size = 0;
+    recorder->capacity = 0;
+    recorder->_callback_start = 0;
+    recorder->_callback_events = 0;
+
+    if (!_nvRecorder_snapshot(recorder)) {
+        NV_FREE(recorder);
+        return NULL;
+    }
+
+    space->recorder = recorder;
+
+    return recorder;
+}
+
+void nvRecorder_free(nvRecorder *recorder) {
+    if (!recorder) return;
+
+    if (recorder->space) recorder->space->recorder = NULL;
+
+    NV_FREE(recorder->scene);
+    NV_FREE(recorder->ids);
+    NV_FREE(recorder->events);
+    NV_FREE(recorder);
+}
+
+bool nvRecorder_restart(nvRecorder *recorder) {
+    if (!recorder->space) return false;
+
+    return _nvRecorder_snapshot(recorder);
+}
+
+bool nvRecorder_save(nvRecorder *recorder, const char *filename) {
+    FILE *file = fopen(filename, "wb");
+    if (!file) return false;
+
+    nvRecordingHeader header = {
+        .magic = NV_RECORDING_MAGIC,
+        .version = NV_RECORDING_VERSION,
+        .scene_size = recorder->scene_size,
+        .body_count = (nv_uint32)recorder->body_count,
+        .step_count = (nv_uint32)recorder->step_count,
+        .id_counter = recorder->id_counter,
+        .complete = recorder->complete
+    };
+
+    bool ok = fwrite(&header, sizeof(nvRecordingHeader), 1, file) == 1 &&
+              fwrite(recorder->scene, 1, recorder->scene_size, file) == recorder->scene_size &&
+              fwrite(recorder->ids, sizeof(nv_uint16), recorder->body_count, file) == recorder->body_count &&
+              fwrite(recorder->events, 1, recorder->size, file) == recorder->size;
+
+    if (fclose(file) != 0) ok = false;
+    if (!ok) remove(filename);
+
+    return ok;
+}
+
+void _nvRecorder_record_step(
+    nvRecorder *recorder,
+    nv_float dt,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+) {
+    // 1 byte type, 8 bytes dt, 4 varints
+    if (!_nvRecorder_reserve(recorder, 1 + 8 + 4 * 10)) return;
+
+    recorder->events[recorder->size++] = nvRecordEvent_STEP;
+    _nvRecorder_write_double(recorder, dt);
+    _nvRecorder_write_varint(recorder, velocity_iters);
+    _nvRecorder_write_varint(recorder, position_iters);
+    _nvRecorder_write_varint(recorder, constraint_iters);
+    _nvRecorder_write_varint(recorder, substeps);
+
+    recorder->step_count++;
+}
+
+void _nvRecorder_record_add(nvRecorder *recorder, nvBody *body) {
+    nvSceneBody record = nvSceneBody_from_body(body);
+
+    size_t vertex_count = 0;
+    if (body->shape->type == nvShapeType_POLYGON)
+        vertex_count = body->shape->vertices->size;
+
+    size_t size = 1 + 10 + sizeof(nvSceneBody) + sizeof(double) * 2 * vertex_count;
+    if (!_nvRecorder_reserve(recorder, size)) return;
+
+    recorder->events[recorder->size++] = nvRecordEvent_ADD_BODY;
+    _nvRecorder_write_varint(recorder, body->id);
+    _nvRecorder_write(recorder, &record, sizeof(nvSceneBody));
+
+    for (size_t i = 0; i < vertex_count; i++) {
+        nvVector2 v = NV_TO_VEC2(body->shape->vertices->data[i]);
+        _nvRecorder_write_double(recorder, v.x);
+        _nvRecorder_write_double(recorder, v.y);
+    }
+}
+
+void _nvRecorder_record_constraint(nvRecorder *recorder, nvConstraint *cons) {
+    nvSpace *space = recorder->space;
+    nv_uint32 a = NV_SCENE_NO_BODY;
+    nv_uint32 b = NV_SCENE_NO_BODY;
+
+    // Bodies that aren't in the space yet don't have IDs to refer to
+    if (cons->a) {
+        if (cons->a->space == space) a = cons->a->id;
+        else recorder->complete = false;
+    }
+    if (cons->b) {
+        if (cons->b->space == space) b = cons->b->id;
+        else recorder->complete = false;
+    }
+
+    nvSceneConstraint record = nvSceneConstraint_from_constraint(cons, a, b);
+
+    if (!_nvRecorder_reserve(recorder, 1 + sizeof(nvSceneConstraint))) return;
+
+    recorder->events[recorder->size++] = nvRecordEvent_ADD_CONSTRAINT;
+    _nvRecorder_write(recorder, &record, sizeof(nvSceneConstraint));
+}
+
+void _nvRecorder_record_body(
+    nvRecorder *recorder,
+    nvRecordEvent event,
+    nvBody *body,
+    const nv_float *values,
+    size_t count
+) {
+    if (!_nvRecorder_reserve(recorder, 1 + 10 + sizeof(double) * count)) return;
+
+    recorder->events[recorder->size++] = (nv_uint8)event;
+    if (body) _nvRecorder_write_varint(recorder, body->id);
+
+    for (size_t i = 0; i < count; i++)
+        _nvRecorder_write_double(recorder, values[i]);
+}
+
+void _nvRecorder_begin_callback(nvRecorder *recorder, size_t index) {
+    recorder->_callback_start = recorder->size;
+
+    // Events of the callback can't be told apart without the marker
+    if (!_nvRecorder_reserve(recorder, 1 + 10)) {
+        recorder->complete = false;
+        recorder->_callback_events = recorder->size;
+        return;
+    }
+
+    recorder->events[recorder->size++] = nvRecordEvent_CALLBACK;
+    _nvRecorder_write_varint(recorder, index);
+    recorder->_callback_events = recorder->size;
+}
+
+void _nvRecorder_end_callback(nvRecorder *recorder) {
+    // Most callbacks don't mutate the space, their markers are dropped
+    if (recorder->size == recorder->_callback_events) {
+        recorder->size = recorder->_callback_start;
+        return;
+    }
+
+    if (!_nvRecorder_reserve(recorder, 1)) {
+        recorder->complete = false;
+        return;
+    }
+
+    recorder->events[recorder->size++] = nvRecordEvent_CALLBACK_END;
+}
+
+
+static bool _nvReplay_read(nvReplay *replay, void *data, size_t size) {
+    if (replay->size - replay->offset < size) return false;
+
+    memcpy(data, replay->data + replay->offset, size);
+    replay->offset += size;
+    return true;
+}
+
+static bool _nvReplay_read_varint(nvReplay *replay, nv_uint64 *value) {
+    *value = 0;
+
+    for (size_t shift = 0; shift < 64; shift += 7) {
+        if (replay->offset >= replay->size) return false;
+
+        nv_uint8 byte = replay->data[replay->offset++];
+        *value |= (nv_uint64)(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80)) return true;
+    }
+
+    return false;
+}
+
+static bool _nvReplay_read_values(nvReplay *replay, nv_float *values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        double value;
+        if (!_nvReplay_read(replay, &value, sizeof(double))) return false;
+        values[i] = value;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Read body ID of an event and look the body up.
+ *
+ * Body is NULL if it was removed, events on removed bodies are skipped.
+ */
+static bool _nvReplay_read_body(nvReplay *replay, nvBody **body) {
+    nv_uint64 id;
+    if (!_nvReplay_read_varint(replay, &id) || id >= _NV_RECORDER_MAX_IDS) return false;
+
+    *body = replay->bodies[id];
+    return true;
+}
+
+static bool _nvReplay_add_body(nvReplay *replay) {
+    nv_uint64 id;
+    nvSceneBody record;
+
+    if (
+        !_nvReplay_read_varint(replay, &id) ||
+        id >= _NV_RECORDER_MAX_IDS ||
+        !_nvReplay_read(replay, &record, sizeof(nvSceneBody)) ||
+        !nvSceneBody_is_valid(&record)
+    ) return false;
+
+    size_t vertex_count = 0;
+    if (record.shape_type == nvShapeType_POLYGON) vertex_count = record.vertex_count;
+
+    if ((replay->size - replay->offset) / (sizeof(double) * 2) < vertex_count) return false;
+
+    // Vertices in the log aren't necessarily aligned
+    double *vertices = NV_MALLOC(sizeof(double) * 2 * (vertex_count + 1));
+    if (!vertices) return false;
+    _nvReplay_read(replay, vertices, sizeof(double) * 2 * vertex_count);
+
+    nvBody *body = nvSceneBody_create(&record, vertices);
+    NV_FREE(vertices);
+
+    nvSpace_add(replay->space, body);
+    body->id = (nv_uint16)id;
+    replay->space->_id_counter = (nv_uint16)(id + 1);
+    replay->bodies[id] = body;
+
+    if (record.is_attractor) nvBody_set_is_attractor(body, true);
+
+    return true;
+}
+
+static bool _nvReplay_add_constraint(nvReplay *replay) {
+    nvSceneConstraint record;
+
+    if (
+        !_nvReplay_read(replay, &record, sizeof(nvSceneConstraint)) ||
+        record.type > nvConstraintType_HINGEJOINT ||
+        (record.a != NV_SCENE_NO_BODY && record.a >= _NV_RECORDER_MAX_IDS) ||
+        (record.b != NV_SCENE_NO_BODY && record.b >= _NV_RECORDER_MAX_IDS)
+    ) return false;
+
+    nvBody *a = NULL;
+    nvBody *b = NULL;
+    if (record.a != NV_SCENE_NO_BODY) a = replay->bodies[record.a];
+    if (record.b != NV_SCENE_NO_BODY) b = replay->bodies[record.b];
+
+    // One of the bodies was removed or wasn't recorded
+    if ((record.a != NV_SCENE_NO_BODY && !a) || (record.b != NV_SCENE_NO_BODY && !b))
+        return true;
+    if (!a && !b) return true;
+
+    nvSpace_add_constraint(replay->space, nvSceneConstraint_create(&record, a, b));
+
+    return true;
+}
+
+
+/**
+ * @brief Apply a recorded mutation.
+ */
+static bool _nvReplay_apply(nvReplay *replay, nvRecordEvent event) {
+    nvBody *body = NULL;
+    nv_float values[4];
+    bool ok = true;
+
+    switch (event) {
+        case nvRecordEvent_ADD_BODY:
+            ok = _nvReplay_add_body(replay);
+            break;
+
+        case nvRecordEvent_REMOVE_BODY:
+        case nvRecordEvent_KILL_BODY: {
+            nv_uint64 id;
+            ok = _nvReplay_read_varint(replay, &id) && id < _NV_RECORDER_MAX_IDS;
+            if (!ok || !replay->bodies[id]) break;
+
+            // Replay owns all the bodies, so removed ones are freed as well
+            nvSpace_kill(replay->space, replay->bodies[id]);
+            replay->bodies[id] = NULL;
+            break;
+        }
+
+        case nvRecordEvent_ADD_CONSTRAINT:
+            ok = _nvReplay_add_constraint(replay);
+            break;
+
+        case nvRecordEvent_APPLY_FORCE:
+            ok = _nvReplay_read_body(replay, &body) && _nvReplay_read_values(replay, values, 2);
+            if (ok && body) nvBody_apply_force(body, NV_VEC2(values[0], values[1]));
+            break;
+
+        case nvRecordEvent_APPLY_FORCE_AT:
+            ok = _nvReplay_read_body(replay, &body) && _nvReplay_read_values(replay, values, 4);
+            if (ok && body)
+                nvBody_apply_force_at(body, NV_VEC2(values[0], values[1]), NV_VEC2(values[2], values[3]));
+            break;
+
+        case nvRecordEvent_APPLY_IMPULSE:
+            ok = _nvReplay_read_body(replay, &body) && _nvReplay_read_values(replay, values, 4);
+            if (ok && body)
+                nvBody_apply_impulse(body, NV_VEC2(values[0], values[1]), NV_VEC2(values[2], values[3]));
+            break;
+
+        case nvRecordEvent_SET_POSITION:
+            ok = _nvReplay_read_body(replay, &body) && _nvReplay_read_values(replay, values, 2);
+            if (ok && body) nvBody_set_position(body, NV_VEC2(values[0], values[1]));
+            break;
+
+        case nvRecordEvent_SET_ANGLE:
+            ok = _nvReplay_read_body(replay, &body) && _nvReplay_read_values(replay, values, 1);
+            if (ok && body) nvBody_set_angle(body, values[0]);
+            break;
+
+        case nvRecordEvent_SET_LINEAR_VELOCITY:
+            ok = _nvReplay_read_body(replay, &body) && _nvReplay_read_values(replay, values, 2);
+            if (ok && body) nvBody_set_linear_velocity(body, NV_VEC2(values[0], values[1]));
+            break;
+
+        case nvRecordEvent_SET_ANGULAR_VELOCITY:
+            ok = _nvReplay_read_body(replay, &body) && _nvReplay_read_values(replay, values, 1);
+            if (ok && body) nvBody_set_angular_velocity(body, values[0]);
+            break;
+
+        case nvRecordEvent_SET_SIM_TIER:
+            ok = _nvReplay_read_body(replay, &body) && _nvReplay_read_values(replay, values, 1);
+            ok = ok && values[0] >= 0.0 && values[0] < NV_SIM_TIERS;
+            if (ok && body) nvBody_set_sim_tier(body, (nv_uint8)values[0]);
+            break;
+
+        case nvRecordEvent_CLEAR:
+            nvSpace_clear(replay->space);
+            memset(replay->bodies, 0, sizeof(nvBody *) * _NV_RECORDER_MAX_IDS);
+            break;
+
+        // Steps and callback markers aren't mutations
+        default:
+            ok = false;
+            break;
+    }
+
+    return ok;
+}
+
+/**
+ * @brief Apply the mutations recorded in the collision callback with the given index, if there are any.
+ */
+static void _nvReplay_callback(nvReplay *replay, size_t index) {
+    if (replay->error || replay->offset >= replay->size) return;
+    if (replay->data[replay->offset] != nvRecordEvent_CALLBACK) return;
+
+    size_t marker = replay->offset++;
+    nv_uint64 recorded;
+
+    if (!_nvReplay_read_varint(replay, &recorded)) {
+        replay->error = true;
+        return;
+    }
+
+    // Mutations of a later callback
+    if (recorded != index) {
+        replay->offset = marker;
+        return;
+    }
+
+    while (replay->offset < replay->size) {
+        nv_uint8 event = replay->data[replay->offset++];
+        if (event == nvRecordEvent_CALLBACK_END) return;
+
+        if (!_nvReplay_apply(replay, (nvRecordEvent)event)) break;
+    }
+
+    replay->error = true;
+}
+
+static void _nvReplay_before_collision(nvSpace *space, void *user_data) {
+    nvReplay *replay = user_data;
+    _nvReplay_callback(replay, replay->_substep * 2);
+}
+
+static void _nvReplay_after_collision(nvSpace *space, void *user_data) {
+    nvReplay *replay = user_data;
+    _nvReplay_callback(replay, replay->_substep * 2 + 1);
+    replay->_substep++;
+}
+
+
+nvReplay *nvReplay_open(const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) return NULL;
+
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+    if (size < (long)sizeof(nvRecordingHeader) || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    nvReplay *replay = NV_NEW(nvReplay);
+    if (!replay) {
+        fclose(file);
+        return NULL;
+    }
+
+    replay->size = (size_t)size;
+    replay->data = NV_MALLOC(replay->size);
+    replay->bodies = NV_CALLOC(_NV_RECORDER_MAX_IDS, sizeof(nvBody *));
+    replay->space = NULL;
+
+    bool ok = replay->data && replay->bodies &&
+              fread(replay->data, 1, replay->size, file) == replay->size;
+    fclose(file);
+
+    nvRecordingHeader header;
+    if (ok) {
+        memcpy(&header, replay->data, sizeof(nvRecordingHeader));
+
+        ok = header.magic == NV_RECORDING_MAGIC &&
+             header.version == NV_RECORDING_VERSION &&
+             header.scene_size <= replay->size - sizeof(nvRecordingHeader) &&
+             (nv_uint64)header.body_count * sizeof(nv_uint16) <=
+                replay->size - sizeof(nvRecordingHeader) - header.scene_size;
+    }
+
+    nvScene *scene = NULL;
+    if (ok) {
+        scene = nvScene_open_memory(replay->data + sizeof(nvRecordingHeader), (size_t)header.scene_size);
+        ok = scene && scene->header->body_count == header.body_count;
+    }
+
+    if (!ok) {
+        nvScene_close(scene);
+        NV_FREE(replay->data);
+        NV_FREE(replay->bodies);
+        NV_FREE(replay);
+        return NULL;
+    }
+
+    replay->space = nvSpace_new();
+    nvScene_instantiate(scene, replay->space);
+    nvScene_close(scene);
+
+    // Restore the recorded IDs, later events refer to bodies by them
+    replay->offset = sizeof(nvRecordingHeader) + (size_t)header.scene_size;
+    for (size_t i = 0; i < header.body_count; i++) {
+        nv_uint16 id = 0;
+        _nvReplay_read(replay, &id, sizeof(nv_uint16));
+
+        nvBody *body = replay->space->bodies->data[i];
+        body->id = id;
+        replay->bodies[id] = body;
+    }
+    replay->space->_id_counter = (nv_uint16)header.id_counter;
+
+    replay->step_count = header.step_count;
+    replay->step = 0;
+    replay->complete = header.complete != 0;
+    replay->error = false;
+    replay->_substep = 0;
+
+    // Mutations recorded in collision callbacks are applied from the replay's own callbacks
+    replay->space->callback_user_data = replay;
+    replay->space->before_collision = _nvReplay_before_collision;
+    replay->space->after_collision = _nvReplay_after_collision;
+
+    return replay;
+}
+
+void nvReplay_free(nvReplay *replay) {
+    if (!replay) return;
+
+    nvSpace_free(replay->space);
+    NV_FREE(replay->data);
+    NV_FREE(replay->bodies);
+    NV_FREE(replay);
+}
+
+bool nvReplay_step(nvReplay *replay) {
+    while (replay->offset < replay->size && !replay->error) {
+        nv_uint8 event = replay->data[replay->offset++];
+
+        if (event != nvRecordEvent_STEP) {
+            if (!_nvReplay_apply(replay, (nvRecordEvent)event)) replay->error = true;
+            continue;
+        }
+
+        double dt;
+        nv_uint64 iters[4];
+
+        bool ok = _nvReplay_read(replay, &dt, sizeof(double)) &&
+                  _nvReplay_read_varint(replay, &iters[0]) &&
+                  _nvReplay_read_varint(replay, &iters[1]) &&
+                  _nvReplay_read_varint(replay, &iters[2]) &&
+                  _nvReplay_read_varint(replay, &iters[3]);
+
+        if (!ok) {
+            replay->error = true;
+            break;
+        }
+
+        replay->_substep = 0;
+
+        nvSpace_step(
+            replay->space,
+            dt,
+            (size_t)iters[0],
+            (size_t)iters[1],
+            (size_t)iters[2],
+            (size_t)iters[3]
+        );
+
+        replay->step++;
+        return true;
+    }
+
+    return false;
+}
\ No newline at end of file
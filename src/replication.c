@@ -0,0 +1,565 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "novaphysics/internal.h"
+#include "novaphysics/replication.h"
+#include "novaphysics/body.h"
+#include "novaphysics/constants.h"
+
+
+/**
+ * @file replication.c
+ *
+ * @brief Quantized, delta-compressed body state replication.
+ */
+
+
+// Field mask bits of a changed body
+#define _NV_REP_POSITION         (1 << 0)
+#define _NV_REP_ANGLE            (1 << 1)
+#define _NV_REP_LINEAR_VELOCITY  (1 << 2)
+#define _NV_REP_ANGULAR_VELOCITY (1 << 3)
+#define _NV_REP_SLEEPING         (1 << 4)
+#define _NV_REP_FIELD_BITS 5
+
+// Body IDs are 16-bit, so there can be 65536 bodies
+#define _NV_REP_COUNT_BITS 17
+
+// Quantized values are clamped to this range so deltas always fit in 32 bits
+#define _NV_REP_MAX_QUANTIZED 0x3FFFFFFF
+
+
+/*
+    Bit-level packet writer & reader.
+*/
+
+typedef struct {
+    nv_uint8 *data;
+    size_t capacity;
+    size_t bit;
+    bool overflow;
+} _nvBitWriter;
+
+typedef struct {
+    const nv_uint8 *data;
+    size_t size;
+    size_t bit;
+    bool overflow;
+} _nvBitReader;
+
+static void _nvBitWriter_write(_nvBitWriter *writer, nv_uint32 value, nv_uint8 bits) {
+    if (writer->bit + bits > writer->capacity * 8) {
+        writer->overflow = true;
+        return;
+    }
+
+    for (nv_uint8 i = 0; i < bits; i++) {
+        size_t byte = writer->bit >> 3;
+        nv_uint8 shift = writer->bit & 7;
+
+        if (shift == 0) writer->data[byte] = 0;
+        writer->data[byte] |= (nv_uint8)(((value >> i) & 1) << shift);
+
+        writer->bit++;
+    }
+}
+
+static nv_uint32 _nvBitReader_read(_nvBitReader *reader, nv_uint8 bits) {
+    if (reader->bit + bits > reader->size * 8) {
+        reader->overflow = true;
+        return 0;
+    }
+
+    nv_uint32 value = 0;
+    for (nv_uint8 i = 0; i < bits; i++) {
+        size_t byte = reader->bit >> 3;
+        nv_uint8 shift = reader->bit & 7;
+
+        value |= (nv_uint32)((reader->data[byte] >> shift) & 1) << i;
+
+        reader->bit++;
+    }
+
+    return value;
+}
+
+/*
+    Deltas are zigzag encoded and written with a 2-bit size class, so the
+    small deltas of slowly moving bodies only take 6 bits.
+*/
+
+static const nv_uint8 _nv_delta_class_bits[4] = {4, 8, 16, 32};
+
+static void _nvBitWriter_write_delta(_nvBitWriter *writer, nv_int32 delta) {
+    nv_uint32 zigzag = ((nv_uint32)delta << 1) ^ (nv_uint32)(delta >> 31);
+
+    nv_uint8 class = 3;
+    for (nv_uint8 i = 0; i < 3; i++) {
+        if (zigzag < ((nv_uint32)1 << _nv_delta_class_bits[i])) {
+            class = i;
+            break;
+        }
+    }
+
+    _nvBitWriter_write(writer, class, 2);
+    _nvBitWriter_write(writer, zigzag, _nv_delta_class_bits[class]);
+}
+
+static nv_int32 _nvBitReader_read_delta(_nvBitReader *reader) {
+    nv_uint8 class = (nv_uint8)_nvBitReader_read(reader, 2);
+    nv_uint32 zigzag = _nvBitReader_read(reader, _nv_delta_class_bits[class]);
+
+    return (nv_int32)(zigzag >> 1) ^ -(nv_int32)(zigzag & 1);
+}
+
+
+/*
+    Quantization.
+*/
+
+static nv_int32 _nv_quantize(nv_float value, nv_float precision) {
+    nv_float q = nv_round(value / precision);
+
+    // Also catches NaNs
+    if (!(q > -(nv_float)_NV_REP_MAX_QUANTIZED)) return -_NV_REP_MAX_QUANTIZED;
+    if (q > (nv_float)_NV_REP_MAX_QUANTIZED) return _NV_REP_MAX_QUANTIZED;
+
+    return (nv_int32)q;
+}
+
+static nv_int32 _nv_quantize_angle(nv_float angle, nv_uint8 bits) {
+    nv_float turns = angle / (2.0 * NV_PI);
+    turns -= nv_floor(turns);
+
+    nv_uint32 steps = (nv_uint32)1 << bits;
+    return (nv_int32)((nv_uint32)nv_round(turns * (nv_float)steps) & (steps - 1));
+}
+
+// Shortest signed difference of two angles on the quantized circle
+static nv_int32 _nv_angle_delta(nv_int32 to, nv_int32 from, nv_uint8 bits) {
+    nv_uint32 steps = (nv_uint32)1 << bits;
+    nv_uint32 delta = ((nv_uint32)to - (nv_uint32)from) & (steps - 1);
+
+    if (delta >= steps / 2) return (nv_int32)delta - (nv_int32)steps;
+    return (nv_int32)delta;
+}
+
+static nvReplicatedState _nv_quantize_body(nvBody *body, nvReplicationSettings *settings) {
+    nvReplicatedState state;
+
+    state.present = true;
+    state.is_sleeping = body->is_sleeping;
+    state.position[0] = _nv_quantize(body->position.x, settings->position_precision);
+    state.position[1] = _nv_quantize(body->position.y, settings->position_precision);
+    state.angle = _nv_quantize_angle(body->angle, settings->angle_bits);
+    state.linear_velocity[0] = _nv_quantize(body->linear_velocity.x, settings->linear_velocity_precision);
+    state.linear_velocity[1] = _nv_quantize(body->linear_velocity.y, settings->linear_velocity_precision);
+    state.angular_velocity = _nv_quantize(body->angular_velocity, settings->angular_velocity_precision);
+
+    return state;
+}
+
+static nv_uint8 _nv_state_changes(nvReplicatedState *state, nvReplicatedState *base) {
+    if (!state->present) return 0;
+
+    // Everything is written for bodies that aren't in the baseline
+    if (!base || !base->present)
+        return _NV_REP_POSITION | _NV_REP_ANGLE | _NV_REP_LINEAR_VELOCITY |
+               _NV_REP_ANGULAR_VELOCITY | _NV_REP_SLEEPING;
+
+    nv_uint8 mask = 0;
+
+    if (state->position[0] != base->position[0] || state->position[1] != base->position[1])
+        mask |= _NV_REP_POSITION;
+
+    if (state->angle != base->angle)
+        mask |= _NV_REP_ANGLE;
+
+    if (state->linear_velocity[0] != base->linear_velocity[0] ||
+        state->linear_velocity[1] != base->linear_velocity[1])
+        mask |= _NV_REP_LINEAR_VELOCITY;
+
+    if (state->angular_velocity != base->angular_velocity)
+        mask |= _NV_REP_ANGULAR_VELOCITY;
+
+    if (state->is_sleeping != base->is_sleeping)
+        mask |= _NV_REP_SLEEPING;
+
+    return mask;
+}
+
+
+/*
+    Snapshot history.
+*/
+
+static bool _nvReplicationSnapshot_resize(nvReplicationSnapshot *snapshot, size_t size) {
+    if (size > snapshot->size) {
+        nvReplicatedState *new_states = NV_REALLOC(snapshot->states, sizeof(nvReplicatedState) * size);
+        if (!new_states) return false;
+
+        snapshot->states = new_states;
+        snapshot->size = size;
+    }
+
+    memset(snapshot->states, 0, sizeof(nvReplicatedState) * snapshot->size);
+
+    return true;
+}
+
+static void _nvReplication_init_history(nvReplicationSnapshot *history) {
+    for (size_t i = 0; i < NV_REPLICATION_HISTORY; i++) {
+        history[i].sequence = NV_REPLICATION_NO_BASELINE;
+        history[i].states = NULL;
+        history[i].size = 0;
+    }
+}
+
+static void _nvReplication_free_history(nvReplicationSnapshot *history) {
+    for (size_t i = 0; i < NV_REPLICATION_HISTORY; i++)
+        NV_FREE(history[i].states);
+}
+
+static nvReplicationSnapshot *_nvReplication_find(nvReplicationSnapshot *history, nv_uint32 sequence) {
+    if (sequence == NV_REPLICATION_NO_BASELINE) return NULL;
+
+    nvReplicationSnapshot *snapshot = &history[sequence % NV_REPLICATION_HISTORY];
+    if (snapshot->sequence != sequence) return NULL;
+
+    return snapshot;
+}
+
+static nvReplicatedState *_nvReplicationSnapshot_get(nvReplicationSnapshot *snapshot, size_t id) {
+    if (!snapshot || id >= snapshot->size) return NULL;
+    return &snapshot->states[id];
+}
+
+
+nvReplicationEncoder *nvReplicationEncoder_new(nvSpace *space, nvReplicationSettings settings) {
+    NV_ASSERT(settings.angle_bits > 0 && settings.angle_bits < 32, "Angle bits must be between 1 and 31.");
+
+    nvReplicationEncoder *encoder = NV_NEW(nvReplicationEncoder);
+    if (!encoder) return NULL;
+
+    encoder->space = space;
+    encoder->settings = settings;
+    encoder->sequence = 0;
+    encoder->acked = NV_REPLICATION_NO_BASELINE;
+
+    _nvReplication_init_history(encoder->history);
+
+    return encoder;
+}
+
+void nvReplicationEncoder_free(nvReplicationEncoder *encoder) {
+    if (!encoder) return;
+
+    _nvReplication_free_history(encoder->history);
+    NV_FREE(encoder);
+}
+
+size_t nvReplicationEncoder_encode(
+    nvReplicationEncoder *encoder,
+    nv_uint8 *buffer,
+    size_t capacity
+) {
+    NV_TRACY_ZONE_START;
+
+    nvSpace *space = encoder->space;
+    nv_uint32 sequence = encoder->sequence;
+    nvReplicationSnapshot *current = &encoder->history[sequence % NV_REPLICATION_HISTORY];
+
+    // Baseline would be overwritten by this packet, send everything instead
+    nvReplicationSnapshot *base = _nvReplication_find(encoder->history, encoder->acked);
+    if (base == current) base = NULL;
+
+    size_t max_id = 0;
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = space->bodies->data[i];
+        if (body->id > max_id) max_id = body->id;
+    }
+
+    current->sequence = NV_REPLICATION_NO_BASELINE;
+    if (!_nvReplicationSnapshot_resize(current, max_id + 1)) {
+        NV_TRACY_ZONE_END;
+        return 0;
+    }
+
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = space->bodies->data[i];
+        nvReplicatedState *base_state = _nvReplicationSnapshot_get(base, body->id);
+
+        // Sleeping bodies can't move, reuse the baseline without quantizing
+        if (body->is_sleeping && base_state && base_state->present && base_state->is_sleeping)
+            current->states[body->id] = *base_state;
+        else
+            current->states[body->id] = _nv_quantize_body(body, &encoder->settings);
+    }
+
+    size_t id_count = current->size;
+    if (base && base->size > id_count) id_count = base->size;
+
+    nv_uint32 changed = 0;
+    nv_uint32 removed = 0;
+    for (size_t id = 0; id < id_count; id++) {
+        nvReplicatedState *state = _nvReplicationSnapshot_get(current, id);
+        nvReplicatedState *base_state = _nvReplicationSnapshot_get(base, id);
+
+        if (state && _nv_state_changes(state, base_state)) changed++;
+        else if (base_state && base_state->present && !(state && state->present)) removed++;
+    }
+
+    _nvBitWriter writer = {.data = buffer, .capacity = capacity, .bit = 0, .overflow = false};
+
+    _nvBitWriter_write(&writer, sequence, 32);
+    _nvBitWriter_write(&writer, base ? base->sequence : NV_REPLICATION_NO_BASELINE, 32);
+
+    _nvBitWriter_write(&writer, changed, _NV_REP_COUNT_BITS);
+    for (size_t id = 0; id < current->size; id++) {
+        nvReplicatedState *state = &current->states[id];
+        nvReplicatedState *base_state = _nvReplicationSnapshot_get(base, id);
+
+        nv_uint8 mask = _nv_state_changes(state, base_state);
+        if (!mask) continue;
+
+        // Deltas of new bodies are against zero
+        nvReplicatedState zero = {0};
+        if (!base_state || !base_state->present) base_state = &zero;
+
+        _nvBitWriter_write(&writer, (nv_uint32)id, 16);
+        _nvBitWriter_write(&writer, mask, _NV_REP_FIELD_BITS);
+
+        if (mask & _NV_REP_POSITION) {
+            _nvBitWriter_write_delta(&writer, state->position[0] - base_state->position[0]);
+            _nvBitWriter_write_delta(&writer, state->position[1] - base_state->position[1]);
+        }
+
+        if (mask & _NV_REP_ANGLE)
+            _nvBitWriter_write_delta(
+                &writer,
+                _nv_angle_delta(state->angle, base_state->angle, encoder->settings.angle_bits)
+            );
+
+        if (mask & _NV_REP_LINEAR_VELOCITY) {
+            _nvBitWriter_write_delta(&writer, state->linear_velocity[0] - base_state->linear_velocity[0]);
+            _nvBitWriter_write_delta(&writer, state->linear_velocity[1] - base_state->linear_velocity[1]);
+        }
+
+        if (mask & _NV_REP_ANGULAR_VELOCITY)
+            _nvBitWriter_write_delta(&writer, state->angular_velocity - base_state->angular_velocity);
+
+        if (mask & _NV_REP_SLEEPING)
+            _nvBitWriter_write(&writer, state->is_sleeping, 1);
+    }
+
+    _nvBitWriter_write(&writer, removed, _NV_REP_COUNT_BITS);
+    if (base) {
+        for (size_t id = 0; id < base->size; id++) {
+            nvReplicatedState *state = _nvReplicationSnapshot_get(current, id);
+            if (base->states[id].present && !(state && state->present))
+                _nvBitWriter_write(&writer, (nv_uint32)id, 16);
+        }
+    }
+
+    NV_TRACY_ZONE_END;
+
+    if (writer.overflow) return 0;
+
+    // Only keep the snapshot once the packet is actually written
+    current->sequence = sequence;
+    encoder->sequence++;
+    if (encoder->sequence == NV_REPLICATION_NO_BASELINE) encoder->sequence = 0;
+
+    return (writer.bit + 7) / 8;
+}
+
+void nvReplicationEncoder_ack(nvReplicationEncoder *encoder, nv_uint32 sequence) {
+    // Ignore acks that arrive out of order
+    if (
+        encoder->acked != NV_REPLICATION_NO_BASELINE &&
+        (nv_int32)(sequence - encoder->acked) <= 0
+    )
+        return;
+
+    encoder->acked = sequence;
+}
+
+
+nvReplicationDecoder *nvReplicationDecoder_new(nvReplicationSettings settings) {
+    NV_ASSERT(settings.angle_bits > 0 && settings.angle_bits < 32, "Angle bits must be between 1 and 31.");
+
+    nvReplicationDecoder *decoder = NV_NEW(nvReplicationDecoder);
+    if (!decoder) return NULL;
+
+    decoder->settings = settings;
+    decoder->latest = 0;
+    decoder->has_latest = false;
+
+    _nvReplication_init_history(decoder->history);
+
+    return decoder;
+}
+
+void nvReplicationDecoder_free(nvReplicationDecoder *decoder) {
+    if (!decoder) return;
+
+    _nvReplication_free_history(decoder->history);
+    NV_FREE(decoder);
+}
+
+static void _nvReplicationDecoder_apply(
+    nvReplicationDecoder *decoder,
+    nvReplicationSnapshot *snapshot,
+    nvSpace *space
+) {
+    nvReplicationSettings *settings = &decoder->settings;
+    nv_float angle_step = 2.0 * NV_PI / (nv_float)((nv_uint32)1 << settings->angle_bits);
+
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = space->bodies->data[i];
+
+        nvReplicatedState *state = _nvReplicationSnapshot_get(snapshot, body->id);
+        if (!state || !state->present) continue;
+
+        body->position = NV_VEC2(
+            (nv_float)state->position[0] * settings->position_precision,
+            (nv_float)state->position[1] * settings->position_precision
+        );
+        body->angle = (nv_float)state->angle * angle_step;
+        body->linear_velocity = NV_VEC2(
+            (nv_float)state->linear_velocity[0] * settings->linear_velocity_precision,
+            (nv_float)state->linear_velocity[1] * settings->linear_velocity_precision
+        );
+        body->angular_velocity = (nv_float)state->angular_velocity * settings->angular_velocity_precision;
+
+        body->_cache_aabb = false;
+        body->_cache_transform = false;
+        _nvBody_mark_moved(body);
+
+        if (state->is_sleeping && !body->is_sleeping) {
+            body->is_sleeping = true;
+            body->force = nvVector2_zero;
+            body->torque = 0.0;
+        }
+        else if (!state->is_sleeping && body->is_sleeping) {
+            nvBody_awake(body);
+        }
+    }
+}
+
+bool nvReplicationDecoder_decode(
+    nvReplicationDecoder *decoder,
+    nvSpace *space,
+    const nv_uint8 *data,
+    size_t size,
+    nv_uint32 *sequence
+) {
+    NV_TRACY_ZONE_START;
+
+    _nvBitReader reader = {.data = data, .size = size, .bit = 0, .overflow = false};
+
+    nv_uint32 packet_sequence = _nvBitReader_read(&reader, 32);
+    nv_uint32 base_sequence = _nvBitReader_read(&reader, 32);
+    if (reader.overflow || packet_sequence == NV_REPLICATION_NO_BASELINE) {
+        NV_TRACY_ZONE_END;
+        return false;
+    }
+
+    nvReplicationSnapshot *current = &decoder->history[packet_sequence % NV_REPLICATION_HISTORY];
+    nvReplicationSnapshot *base = _nvReplication_find(decoder->history, base_sequence);
+
+    // Baseline was dropped from the history, or it's in the same slot
+    if ((base_sequence != NV_REPLICATION_NO_BASELINE && !base) || base == current) {
+        NV_TRACY_ZONE_END;
+        return false;
+    }
+
+    // Start from the baseline, then apply the changes on top of it
+    current->sequence = NV_REPLICATION_NO_BASELINE;
+    if (!_nvReplicationSnapshot_resize(current, base ? base->size : 0)) {
+        NV_TRACY_ZONE_END;
+        return false;
+    }
+    if (base)
+        memcpy(current->states, base->states, sizeof(nvReplicatedState) * base->size);
+
+    nv_uint32 changed = _nvBitReader_read(&reader, _NV_REP_COUNT_BITS);
+    for (nv_uint32 i = 0; i < changed && !reader.overflow; i++) {
+        nv_uint32 id = _nvBitReader_read(&reader, 16);
+        nv_uint8 mask = (nv_uint8)_nvBitReader_read(&reader, _NV_REP_FIELD_BITS);
+
+        if (id >= current->size) {
+            size_t old_size = current->size;
+            nvReplicatedState *new_states = NV_REALLOC(current->states, sizeof(nvReplicatedState) * (id + 1));
+            if (!new_states) {
+                NV_TRACY_ZONE_END;
+                return false;
+            }
+
+            memset(new_states + old_size, 0, sizeof(nvReplicatedState) * (id + 1 - old_size));
+            current->states = new_states;
+            current->size = id + 1;
+        }
+
+        nvReplicatedState *state = &current->states[id];
+        if (!state->present) {
+            *state = (nvReplicatedState){0};
+            state->present = true;
+        }
+
+        if (mask & _NV_REP_POSITION) {
+            state->position[0] += _nvBitReader_read_delta(&reader);
+            state->position[1] += _nvBitReader_read_delta(&reader);
+        }
+
+        if (mask & _NV_REP_ANGLE) {
+            nv_uint32 steps = (nv_uint32)1 << decoder->settings.angle_bits;
+            nv_int32 delta = _nvBitReader_read_delta(&reader);
+            state->angle = (nv_int32)(((nv_uint32)state->angle + (nv_uint32)delta) & (steps - 1));
+        }
+
+        if (mask & _NV_REP_LINEAR_VELOCITY) {
+            state->linear_velocity[0] += _nvBitReader_read_delta(&reader);
+            state->linear_velocity[1] += _nvBitReader_read_delta(&reader);
+        }
+
+        if (mask & _NV_REP_ANGULAR_VELOCITY)
+            state->angular_velocity += _nvBitReader_read_delta(&reader);
+
+        if (mask & _NV_REP_SLEEPING)
+            state->is_sleeping = _nvBitReader_read(&reader, 1);
+    }
+
+    nv_uint32 removed = _nvBitReader_read(&reader, _NV_REP_COUNT_BITS);
+    for (nv_uint32 i = 0; i < removed && !reader.overflow; i++) {
+        nv_uint32 id = _nvBitReader_read(&reader, 16);
+        if (id < current->size) current->states[id].present = false;
+    }
+
+    if (reader.overflow) {
+        NV_TRACY_ZONE_END;
+        return false;
+    }
+
+    current->sequence = packet_sequence;
+    if (sequence) *sequence = packet_sequence;
+
+    // Late packets are still useful as baselines, but don't roll the space back
+    if (!decoder->has_latest || (nv_int32)(packet_sequence - decoder->latest) > 0) {
+        _nvReplicationDecoder_apply(decoder, current, space);
+        decoder->latest = packet_sequence;
+        decoder->has_latest = true;
+    }
+
+    NV_TRACY_ZONE_END;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,650 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "novaphysics/internal.h"
+#include "novaphysics/scene.h"
+#include "novaphysics/body.h"
+#include "novaphysics/shape.h"
+#include "novaphysics/constraint.h"
+#include "novaphysics/spring.h"
+#include "novaphysics/distance_joint.h"
+#include "novaphysics/hinge_joint.h"
+#include "novaphysics/contact_solver.h"
+#include "novaphysics/resolution.h"
+
+
+/**
+ * @file scene.c
+ *
+ * @brief Binary scene files.
+ */
+
+
+static nv_uint64 _nvScene_file_size(
+    nv_uint64 body_count,
+    nv_uint64 vertex_count,
+    nv_uint64 constraint_count
+) {
+    return sizeof(nvSceneHeader) +
+           sizeof(nvSceneBody) * body_count +
+           sizeof(double) * 2 * vertex_count +
+           sizeof(nvSceneConstraint) * constraint_count;
+}
+
+
+nvSceneBody nvSceneBody_from_body(nvBody *body) {
+    nvSceneBody record = {
+        .position = {body->position.x, body->position.y},
+        .angle = body->angle,
+        .linear_velocity = {body->linear_velocity.x, body->linear_velocity.y},
+        .angular_velocity = body->angular_velocity,
+        .linear_damping = body->linear_damping,
+        .angular_damping = body->angular_damping,
+        .gravity_scale = body->gravity_scale,
+        .density = body->material.density,
+        .restitution = body->material.restitution,
+        .friction = body->material.friction,
+        .mass = body->mass,
+        .inertia = body->inertia,
+        .collision_group = body->collision_group,
+        .collision_category = body->collision_category,
+        .collision_mask = body->collision_mask,
+        .type = (nv_uint8)body->type,
+        .shape_type = (nv_uint8)body->shape->type,
+        .enable_collision = body->enable_collision,
+        .is_attractor = body->is_attractor
+    };
+
+    if (body->shape->type == nvShapeType_CIRCLE)
+        record.radius = body->shape->radius;
+    else
+        record.vertex_count = (nv_uint32)body->shape->vertices->size;
+
+    return record;
+}
+
+bool nvSceneBody_is_valid(const nvSceneBody *record) {
+    if (record->type > nvBodyType_DYNAMIC) return false;
+
+    if (record->shape_type == nvShapeType_CIRCLE) {
+        if (!(record->radius > 0.0)) return false;
+    }
+    else if (record->shape_type == nvShapeType_POLYGON) {
+        if (record->vertex_count < 3) return false;
+    }
+    else return false;
+
+    if (record->type == nvBodyType_DYNAMIC && !(record->mass > 0.0)) return false;
+
+    return true;
+}
+
+nvBody *nvSceneBody_create(const nvSceneBody *record, const double *vertices) {
+    nvShape *shape;
+    if (record->shape_type == nvShapeType_CIRCLE) {
+        shape = nvCircleShape_new(record->radius);
+    }
+    else {
+        nvArray *shape_vertices = nvArray_new();
+        nvArray_reserve(shape_vertices, record->vertex_count);
+
+        for (size_t i = 0; i < record->vertex_count; i++)
+            nvArray_add(shape_vertices, NV_VEC2_NEW(vertices[i * 2], vertices[i * 2 + 1]));
+
+        shape = nvPolygonShape_new(shape_vertices);
+    }
+
+    nvBody *body = nvBody_new(
+        (nvBodyType)record->type,
+        shape,
+        NV_VEC2(record->position[0], record->position[1]),
+        record->angle,
+        (nvMaterial){record->density, record->restitution, record->friction}
+    );
+
+    body->linear_velocity = NV_VEC2(record->linear_velocity[0], record->linear_velocity[1]);
+    body->angular_velocity = record->angular_velocity;
+    body->linear_damping = record->linear_damping;
+    body->angular_damping = record->angular_damping;
+    body->gravity_scale = record->gravity_scale;
+    body->enable_collision = record->enable_collision;
+    body->collision_group = record->collision_group;
+    body->collision_category = record->collision_category;
+    body->collision_mask = record->collision_mask;
+
+    // Mass might have been set explicitly, set_mass recalculates the inertia
+    nvBody_set_mass(body, record->mass);
+    nvBody_set_inertia(body, record->inertia);
+
+    return body;
+}
+
+nvSceneConstraint nvSceneConstraint_from_constraint(
+    nvConstraint *cons,
+    nv_uint32 a,
+    nv_uint32 b
+) {
+    nvSceneConstraint record = {
+        .type = (nv_uint32)cons->type,
+        .a = a,
+        .b = b
+    };
+
+    switch (cons->type) {
+        case nvConstraintType_SPRING: {
+            nvSpring *spring = cons->def;
+            record.anchor_a[0] = spring->anchor_a.x;
+            record.anchor_a[1] = spring->anchor_a.y;
+            record.anchor_b[0] = spring->anchor_b.x;
+            record.anchor_b[1] = spring->anchor_b.y;
+            record.length = spring->length;
+            record.stiffness = spring->stiffness;
+            record.damping = spring->damping;
+            break;
+        }
+
+        case nvConstraintType_DISTANCEJOINT: {
+            nvDistanceJoint *dist_joint = cons->def;
+            record.anchor_a[0] = dist_joint->anchor_a.x;
+            record.anchor_a[1] = dist_joint->anchor_a.y;
+            record.anchor_b[0] = dist_joint->anchor_b.x;
+            record.anchor_b[1] = dist_joint->anchor_b.y;
+            record.length = dist_joint->length;
+            break;
+        }
+
+        case nvConstraintType_HINGEJOINT: {
+            nvHingeJoint *hinge_joint = cons->def;
+            record.enable_limits = hinge_joint->enable_limits;
+            record.anchor[0] = hinge_joint->anchor.x;
+            record.anchor[1] = hinge_joint->anchor.y;
+            record.anchor_a[0] = hinge_joint->anchor_a.x;
+            record.anchor_a[1] = hinge_joint->anchor_a.y;
+            record.anchor_b[0] = hinge_joint->anchor_b.x;
+            record.anchor_b[1] = hinge_joint->anchor_b.y;
+            record.reference_angle = hinge_joint->reference_angle;
+            record.lower_limit = hinge_joint->lower_limit;
+            record.upper_limit = hinge_joint->upper_limit;
+            break;
+        }
+    }
+
+    return record;
+}
+
+nvConstraint *nvSceneConstraint_create(
+    const nvSceneConstraint *record,
+    nvBody *a,
+    nvBody *b
+) {
+    nvVector2 anchor_a = NV_VEC2(record->anchor_a[0], record->anchor_a[1]);
+    nvVector2 anchor_b = NV_VEC2(record->anchor_b[0], record->anchor_b[1]);
+
+    nvConstraint *cons = NULL;
+
+    switch ((nvConstraintType)record->type) {
+        case nvConstraintType_SPRING:
+            cons = nvSpring_new(
+                a, b,
+                anchor_a, anchor_b,
+                record->length,
+                record->stiffness,
+                record->damping
+            );
+            break;
+
+        case nvConstraintType_DISTANCEJOINT:
+            cons = nvDistanceJoint_new(a, b, anchor_a, anchor_b, record->length);
+            break;
+
+        case nvConstraintType_HINGEJOINT: {
+            cons = nvHingeJoint_new(a, b, NV_VEC2(record->anchor[0], record->anchor[1]));
+
+            // Bodies moved since the joint was created, restore its original frame
+            nvHingeJoint *hinge_joint = cons->def;
+            hinge_joint->anchor_a = anchor_a;
+            hinge_joint->anchor_b = anchor_b;
+            hinge_joint->reference_angle = record->reference_angle;
+            hinge_joint->enable_limits = record->enable_limits;
+            hinge_joint->lower_limit = record->lower_limit;
+            hinge_joint->upper_limit = record->upper_limit;
+            break;
+        }
+    }
+
+    return cons;
+}
+
+
+size_t nvScene_serialize(
+    nvSpace *space,
+    nv_uint8 **data,
+    nv_float dt,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+) {
+    // Constraints refer to bodies by their index in the scene
+    size_t id_map_size = 0;
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = space->bodies->data[i];
+        if ((size_t)body->id + 1 > id_map_size) id_map_size = (size_t)body->id + 1;
+    }
+
+    nv_uint32 *id_map = NV_MALLOC(sizeof(nv_uint32) * (id_map_size + 1));
+    if (!id_map) return 0;
+
+    nv_uint32 vertex_count = 0;
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = space->bodies->data[i];
+        id_map[body->id] = (nv_uint32)i;
+
+        if (body->shape->type == nvShapeType_POLYGON)
+            vertex_count += (nv_uint32)body->shape->vertices->size;
+    }
+
+    // A constraint linked to a body that isn't in the space can't be saved
+    for (size_t i = 0; i < space->constraints->size; i++) {
+        nvConstraint *cons = space->constraints->data[i];
+
+        if ((cons->a && cons->a->space != space) || (cons->b && cons->b->space != space)) {
+            NV_FREE(id_map);
+            return 0;
+        }
+    }
+
+    size_t size = (size_t)_nvScene_file_size(
+        space->bodies->size,
+        vertex_count,
+        space->constraints->size
+    );
+
+    // The caller frees the buffer with free(), so it's not tracked
+    nv_uint8 *buffer = malloc(size);
+    if (!buffer) {
+        NV_FREE(id_map);
+        return 0;
+    }
+
+    nvSceneHeader *header = (nvSceneHeader *)buffer;
+    nvSceneBody *bodies = (nvSceneBody *)(buffer + sizeof(nvSceneHeader));
+    double *vertices = (double *)(bodies + space->bodies->size);
+    nvSceneConstraint *constraints = (nvSceneConstraint *)(vertices + 2 * (size_t)vertex_count);
+
+    *header = (nvSceneHeader){
+        .magic = NV_SCENE_MAGIC,
+        .version = NV_SCENE_VERSION,
+        .body_count = (nv_uint32)space->bodies->size,
+        .vertex_count = vertex_count,
+        .constraint_count = (nv_uint32)space->constraints->size,
+
+        .broadphase_algorithm = (nv_uint32)space->broadphase_algorithm,
+        .position_correction = (nv_uint32)space->position_correction,
+        .mix_restitution = (nv_uint32)space->mix_restitution,
+        .mix_friction = (nv_uint32)space->mix_friction,
+        .sleep_timer_threshold = (nv_uint32)space->sleep_timer_threshold,
+        .collision_persistence = (nv_int32)space->collision_persistence,
+        .sleeping = space->sleeping,
+        .warmstarting = space->warmstarting,
+        .use_kill_bounds = space->use_kill_bounds,
+
+        .gravity = {space->gravity.x, space->gravity.y},
+        .sleep_energy_threshold = space->sleep_energy_threshold,
+        .wake_energy_threshold = space->wake_energy_threshold,
+        .kill_bounds = {
+            space->kill_bounds.min_x, space->kill_bounds.min_y,
+            space->kill_bounds.max_x, space->kill_bounds.max_y
+        },
+
+        .dt = dt,
+        .velocity_iters = (nv_uint32)velocity_iters,
+        .position_iters = (nv_uint32)position_iters,
+        .constraint_iters = (nv_uint32)constraint_iters,
+        .substeps = (nv_uint32)substeps
+    };
+
+    if (space->shg) {
+        header->shg_bounds[0] = space->shg->bounds.min_x;
+        header->shg_bounds[1] = space->shg->bounds.min_y;
+        header->shg_bounds[2] = space->shg->bounds.max_x;
+        header->shg_bounds[3] = space->shg->bounds.max_y;
+        header->shg_cell_size[0] = space->shg->cell_width;
+        header->shg_cell_size[1] = space->shg->cell_height;
+    }
+
+    nv_uint32 first_vertex = 0;
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = space->bodies->data[i];
+
+        bodies[i] = nvSceneBody_from_body(body);
+        if (body->shape->type != nvShapeType_POLYGON) continue;
+
+        bodies[i].first_vertex = first_vertex;
+
+        for (size_t j = 0; j < body->shape->vertices->size; j++) {
+            nvVector2 v = NV_TO_VEC2(body->shape->vertices->data[j]);
+            vertices[first_vertex * 2] = v.x;
+            vertices[first_vertex * 2 + 1] = v.y;
+            first_vertex++;
+        }
+    }
+
+    for (size_t i = 0; i < space->constraints->size; i++) {
+        nvConstraint *cons = space->constraints->data[i];
+
+        constraints[i] = nvSceneConstraint_from_constraint(
+            cons,
+            cons->a ? id_map[cons->a->id] : NV_SCENE_NO_BODY,
+            cons->b ? id_map[cons->b->id] : NV_SCENE_NO_BODY
+        );
+    }
+
+    NV_FREE(id_map);
+
+    *data = buffer;
+    return size;
+}
+
+bool nvScene_save(
+    nvSpace *space,
+    const char *filename,
+    nv_float dt,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+) {
+    nv_uint8 *data;
+    size_t size = nvScene_serialize(
+        space,
+        &data,
+        dt,
+        velocity_iters,
+        position_iters,
+        constraint_iters,
+        substeps
+    );
+    if (size == 0) return false;
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        free(data);
+        return false;
+    }
+
+    bool ok = fwrite(data, 1, size, file) == size;
+    free(data);
+
+    if (fclose(file) != 0) ok = false;
+    if (!ok) remove(filename);
+
+    return ok;
+}
+
+
+static bool _nvScene_validate(nvScene *scene) {
+    if (scene->size < sizeof(nvSceneHeader)) return false;
+
+    const nvSceneHeader *header = scene->memory;
+
+    if (header->magic != NV_SCENE_MAGIC || header->version != NV_SCENE_VERSION)
+        return false;
+
+    nv_uint64 expected_size = _nvScene_file_size(
+        header->body_count,
+        header->vertex_count,
+        header->constraint_count
+    );
+    if (expected_size != (nv_uint64)scene->size) return false;
+
+    if (
+        header->broadphase_algorithm > nvBroadPhaseAlg_BVH ||
+        header->position_correction > nvPositionCorrection_NGS ||
+        header->mix_restitution > nvCoefficientMix_MAX ||
+        header->mix_friction > nvCoefficientMix_MAX
+    ) return false;
+
+    if (
+        header->broadphase_algorithm == nvBroadPhaseAlg_SHG &&
+        (header->shg_cell_size[0] <= 0.0 || header->shg_cell_size[1] <= 0.0)
+    ) return false;
+
+    nv_uint8 *data = (nv_uint8 *)scene->memory + sizeof(nvSceneHeader);
+    scene->header = header;
+    scene->bodies = (const nvSceneBody *)data;
+    data += sizeof(nvSceneBody) * header->body_count;
+    scene->vertices = (const double *)data;
+    data += sizeof(double) * 2 * header->vertex_count;
+    scene->constraints = (const nvSceneConstraint *)data;
+
+    for (size_t i = 0; i < header->body_count; i++) {
+        const nvSceneBody *body = &scene->bodies[i];
+
+        if (!nvSceneBody_is_valid(body)) return false;
+
+        if (
+            body->shape_type == nvShapeType_POLYGON &&
+            (nv_uint64)body->first_vertex + body->vertex_count > header->vertex_count
+        ) return false;
+    }
+
+    for (size_t i = 0; i < header->constraint_count; i++) {
+        const nvSceneConstraint *cons = &scene->constraints[i];
+
+        if (cons->type > nvConstraintType_HINGEJOINT) return false;
+        if (cons->a == NV_SCENE_NO_BODY && cons->b == NV_SCENE_NO_BODY) return false;
+        if (cons->a != NV_SCENE_NO_BODY && cons->a >= header->body_count) return false;
+        if (cons->b != NV_SCENE_NO_BODY && cons->b >= header->body_count) return false;
+    }
+
+    return true;
+}
+
+
+#if defined(NV_WINDOWS) || defined(NV_WEB)
+
+    /* Scene files are read into memory on this platform. */
+
+    static bool _nvScene_map(nvScene *scene, const char *filename) {
+        FILE *file = fopen(filename, "rb");
+        if (!file) return false;
+
+        if (fseek(file, 0, SEEK_END) != 0) {
+            fclose(file);
+            return false;
+        }
+
+        long size = ftell(file);
+        if (size <= 0 || fseek(file, 0, SEEK_SET) != 0) {
+            fclose(file);
+            return false;
+        }
+
+        scene->memory = NV_MALLOC((size_t)size);
+        if (!scene->memory) {
+            fclose(file);
+            return false;
+        }
+
+        if (fread(scene->memory, 1, (size_t)size, file) != (size_t)size) {
+            NV_FREE(scene->memory);
+            fclose(file);
+            return false;
+        }
+
+        fclose(file);
+
+        scene->size = (size_t)size;
+        scene->mapped = false;
+        return true;
+    }
+
+    static void _nvScene_unmap(nvScene *scene) {
+        NV_FREE(scene->memory);
+    }
+
+#else
+
+    /* Scene files are memory-mapped on POSIX systems. */
+
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+
+
+    static bool _nvScene_map(nvScene *scene, const char *filename) {
+        int fd = open(filename, O_RDONLY);
+        if (fd == -1) return false;
+
+        struct stat info;
+        if (fstat(fd, &info) == -1 || info.st_size <= 0) {
+            close(fd);
+            return false;
+        }
+
+        scene->size = (size_t)info.st_size;
+        scene->memory = mmap(NULL, scene->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (scene->memory == MAP_FAILED) return false;
+
+        scene->mapped = true;
+        return true;
+    }
+
+    static void _nvScene_unmap(nvScene *scene) {
+        if (scene->mapped) munmap(scene->memory, scene->size);
+        else NV_FREE(scene->memory);
+    }
+
+#endif
+
+
+nvScene *nvScene_open(const char *filename) {
+    nvScene *scene = NV_NEW(nvScene);
+    if (!scene) return NULL;
+
+    if (!_nvScene_map(scene, filename)) {
+        NV_FREE(scene);
+        return NULL;
+    }
+
+    if (!_nvScene_validate(scene)) {
+        _nvScene_unmap(scene);
+        NV_FREE(scene);
+        return NULL;
+    }
+
+    return scene;
+}
+
+nvScene *nvScene_open_memory(const void *data, size_t size) {
+    if (size == 0) return NULL;
+
+    nvScene *scene = NV_NEW(nvScene);
+    if (!scene) return NULL;
+
+    scene->memory = NV_MALLOC(size);
+    if (!scene->memory) {
+        NV_FREE(scene);
+        return NULL;
+    }
+
+    memcpy(scene->memory, data, size);
+    scene->size = size;
+    scene->mapped = false;
+
+    if (!_nvScene_validate(scene)) {
+        NV_FREE(scene->memory);
+        NV_FREE(scene);
+        return NULL;
+    }
+
+    return scene;
+}
+
+void nvScene_close(nvScene *scene) {
+    if (!scene) return;
+
+    _nvScene_unmap(scene);
+    NV_FREE(scene);
+}
+
+void nvScene_instantiate(const nvScene *scene, nvSpace *space) {
+    NV_TRACY_ZONE_START;
+
+    const nvSceneHeader *header = scene->header;
+
+    space->gravity = NV_VEC2(header->gravity[0], header->gravity[1]);
+    space->sleeping = header->sleeping;
+    space->sleep_energy_threshold = header->sleep_energy_threshold;
+    space->wake_energy_threshold = header->wake_energy_threshold;
+    space->sleep_timer_threshold = header->sleep_timer_threshold;
+    space->warmstarting = header->warmstarting;
+    space->collision_persistence = header->collision_persistence;
+    space->position_correction = (nvPositionCorrection)header->position_correction;
+    space->mix_restitution = (nvCoefficientMix)header->mix_restitution;
+    space->mix_friction = (nvCoefficientMix)header->mix_friction;
+    space->use_kill_bounds = header->use_kill_bounds;
+    space->kill_bounds = (nvAABB){
+        header->kill_bounds[0], header->kill_bounds[1],
+        header->kill_bounds[2], header->kill_bounds[3]
+    };
+
+    nvSpace_set_broadphase(space, (nvBroadPhaseAlg)header->broadphase_algorithm);
+    if (space->broadphase_algorithm == nvBroadPhaseAlg_SHG) {
+        nvSpace_set_SHG(
+            space,
+            (nvAABB){
+                header->shg_bounds[0], header->shg_bounds[1],
+                header->shg_bounds[2], header->shg_bounds[3]
+            },
+            header->shg_cell_size[0],
+            header->shg_cell_size[1]
+        );
+    }
+
+    // Bodies in the space before instantiating offset the constraint indices
+    size_t body_offset = space->bodies->size;
+
+    nvArray_reserve(space->bodies, body_offset + header->body_count);
+    nvArray_reserve(space->constraints, space->constraints->size + header->constraint_count);
+
+    for (size_t i = 0; i < header->body_count; i++) {
+        const nvSceneBody *record = &scene->bodies[i];
+
+        nvBody *body = nvSceneBody_create(
+            record,
+            &scene->vertices[(size_t)record->first_vertex * 2]
+        );
+
+        nvSpace_add(space, body);
+
+        if (record->is_attractor) nvBody_set_is_attractor(body, true);
+    }
+
+    for (size_t i = 0; i < header->constraint_count; i++) {
+        const nvSceneConstraint *record = &scene->constraints[i];
+
+        nvBody *a = NULL;
+        nvBody *b = NULL;
+        if (record->a != NV_SCENE_NO_BODY) a = space->bodies->data[body_offset + record->a];
+        if (record->b != NV_SCENE_NO_BODY) b = space->bodies->data[body_offset + record->b];
+
+        nvSpace_add_constraint(space, nvSceneConstraint_create(record, a, b));
+    }
+
+    NV_TRACY_ZONE_END;
+}
\ No newline at end of file
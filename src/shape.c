@@ -23,7 +23,9 @@
 
 
 nvShape *nvCircleShape_new(nv_float radius) {
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_SHAPES);
     nvShape *shape = NV_NEW(nvShape);
+    NV_ALLOC_SCOPE_END;
     if (!shape) return NULL;
 
     shape->type = nvShapeType_CIRCLE;
@@ -34,8 +36,13 @@ nvShape *nvCircleShape_new(nv_float radius) {
 }
 
 nvShape *nvPolygonShape_new(nvArray *vertices) {
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_SHAPES);
+
     nvShape *shape = NV_NEW(nvShape);
-    if (!shape) return NULL;
+    if (!shape) {
+        NV_ALLOC_SCOPE_END;
+        return NULL;
+    }
 
     shape->type = nvShapeType_POLYGON;
 
@@ -56,6 +63,8 @@ nvShape *nvPolygonShape_new(nvArray *vertices) {
         nvArray_add(shape->normals, NV_VEC2_NEW(normal.x, normal.y));
     }
 
+    NV_ALLOC_SCOPE_END;
+
     return shape;
 }
 
@@ -63,11 +72,13 @@ nvShape *nvRectShape_new(nv_float width, nv_float height) {
     nv_float w = width / 2.0;
     nv_float h = height / 2.0;
 
-    nvArray *vertices = nvArray_new();    
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_SHAPES);
+    nvArray *vertices = nvArray_new();
     nvArray_add(vertices, NV_VEC2_NEW(-w, -h));
     nvArray_add(vertices, NV_VEC2_NEW( w, -h));
     nvArray_add(vertices, NV_VEC2_NEW( w,  h));
     nvArray_add(vertices, NV_VEC2_NEW(-w,  h));
+    NV_ALLOC_SCOPE_END;
 
     return nvPolygonShape_new(vertices);
 }
@@ -75,6 +86,8 @@ nvShape *nvRectShape_new(nv_float width, nv_float height) {
 nvShape *nvNGonShape_new(size_t n, nv_float radius) {
     NV_ASSERT(n >= 3, "Cannot create a polygon with vertices lesser than 3.\n");
 
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_SHAPES);
+
     nvArray *vertices = nvArray_new();
     nvVector2 arm = NV_VEC2(radius / 2.0, 0.0);
 
@@ -83,11 +96,15 @@ nvShape *nvNGonShape_new(size_t n, nv_float radius) {
         arm = nvVector2_rotate(arm, 2.0 * NV_PI / (nv_float)n);
     }
 
+    NV_ALLOC_SCOPE_END;
+
     return nvPolygonShape_new(vertices);
 }
 
 nvShape *nvConvexHullShape_new(nvArray *points) {
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_SHAPES);
     nvArray *vertices = nv_generate_convex_hull(points);
+    NV_ALLOC_SCOPE_END;
 
     // Transform hull vertices so the center of gravity is at center
     nvVector2 hull_centroid = nv_polygon_centroid(vertices);
@@ -104,13 +121,13 @@ nvShape *nvConvexHullShape_new(nvArray *points) {
 
 void nvShape_free(nvShape *shape) {
     if (shape->type == nvShapeType_POLYGON) {
-        nvArray_free_each(shape->vertices, free);
+        nvArray_free_each(shape->vertices, NV_FREE_FUNC);
         nvArray_free(shape->vertices);
-        nvArray_free_each(shape->trans_vertices, free);
+        nvArray_free_each(shape->trans_vertices, NV_FREE_FUNC);
         nvArray_free(shape->trans_vertices);
-        nvArray_free_each(shape->normals, free);
+        nvArray_free_each(shape->normals, NV_FREE_FUNC);
         nvArray_free(shape->normals);
     }
 
-    free(shape);
+    NV_FREE(shape);
 }
\ No newline at end of file
@@ -46,20 +46,22 @@ nvSHG *nvSHG_new(
     shg->map = nvHashMap_new(sizeof(nvSHGEntry), 0, nvSHG_hash);
     if (!shg->map) return NULL;
 
+    shg->parked_map = nvHashMap_new(sizeof(nvSHGEntry), 0, nvSHG_hash);
+    if (!shg->parked_map) return NULL;
+
     return shg;
 }
 
 void nvSHG_free(nvSHG *shg) {
     if (!shg) return;
     
-    size_t iter = 0;
-    void *item;
-    while (nvHashMap_iter(shg->map, &iter, &item)) {
-        nvSHGEntry *entry = (nvSHGEntry *)item;
-        if (entry->cell != NULL) free((entry)->cell);
-    }
+    nvSHG_clear(shg);
     nvHashMap_free(shg->map);
-    free(shg);
+
+    nvSHG_clear_parked(shg);
+    nvHashMap_free(shg->parked_map);
+
+    NV_FREE(shg);
 }
 
 nvArray *nvSHG_get(nvSHG *shg, nv_uint32 key) {
@@ -71,64 +73,100 @@ nvArray *nvSHG_get(nvSHG *shg, nv_uint32 key) {
 void nvSHG_place(nvSHG *shg, nvArray *bodies) {
     NV_TRACY_ZONE_START;
 
-    size_t iter = 0;
-    void *item;
+    // Rebuild every cell from scratch
+    nvSHG_clear(shg);
 
-    // Free each array from previous frame
-    while (nvHashMap_iter(shg->map, &iter, &item)) {
-        nvSHGEntry *entry = (nvSHGEntry *)item;
-        nvArray_free((entry)->cell);
+    for (nv_uint32 i = 0; i < bodies->size; i++) {
+        nvBody *body = (nvBody *)bodies->data[i];
+        nvSHG_insert(shg, body, nvSHG_get_range(shg, nvBody_get_aabb(body)));
     }
 
-    nvHashMap_clear(shg->map);
+    NV_TRACY_ZONE_END;
+}
 
-    for (nv_uint32 i = 0; i < bodies->size; i++) {
-        nvBody *body = (nvBody *)bodies->data[i];
-        nvAABB aabb = nvBody_get_aabb(body);
-
-        /*
-            Spread AABB to exceeding cells
-
-            min
-            [ ] ---- [ ]
-             |        |
-             |        |
-            [ ] ---- [ ]
-                     max
-        */
-
-        nv_int16 min_x = (nv_int16)(aabb.min_x / shg->cell_width);
-        nv_int16 min_y = (nv_int16)(aabb.min_y / shg->cell_height);
-        nv_int16 max_x = (nv_int16)(aabb.max_x / shg->cell_width);
-        nv_int16 max_y = (nv_int16)(aabb.max_y / shg->cell_height);
-
-        for (nv_int16 y = min_y; y < max_y + 1; y++) {
-            for (nv_int16 x = min_x; x < max_x + 1; x++) {
-
-                // Don't insert outside of the borders
-                if (0 <= x && x < (signed)shg->cols && 0 <= y && y < (signed)shg->rows) {
-                    nv_uint32 pair = nv_pair(x, y);
-
-                    nvSHGEntry *entry = (nvSHGEntry *)nvHashMap_get(shg->map, &(nvSHGEntry){.xy_pair=pair});
-
-                    // If grid doesn't exist, create it
-                    if (entry == NULL) {
-                        nvArray *new_cell = nvArray_new();
-                        nvArray_add(new_cell, body);
-                        nvHashMap_set(shg->map, &(nvSHGEntry){.xy_pair=pair, .cell=new_cell});
-                    }
-
-                    // If grid exists, add body to it
-                    else {
-                        nvArray_add(entry->cell, body);
-                    }
-                }
+nvSHGRange nvSHG_get_range(nvSHG *shg, nvAABB aabb) {
+    return (nvSHGRange){
+        .min_x = (nv_int16)(aabb.min_x / shg->cell_width),
+        .min_y = (nv_int16)(aabb.min_y / shg->cell_height),
+        .max_x = (nv_int16)(aabb.max_x / shg->cell_width),
+        .max_y = (nv_int16)(aabb.max_y / shg->cell_height)
+    };
+}
+
+nvArray *nvSHG_get_parked(nvSHG *shg, nv_uint32 key) {
+    nvSHGEntry *entry = (nvSHGEntry *)nvHashMap_get(shg->parked_map, &(nvSHGEntry){.xy_pair=key});
+    if (entry == NULL) return NULL;
+    else return entry->cell;
+}
+
+static void _nvSHG_add_to_cells(nvSHG *shg, nvHashMap *map, void *body, nvSHGRange range) {
+    for (nv_int16 y = range.min_y; y < range.max_y + 1; y++) {
+        for (nv_int16 x = range.min_x; x < range.max_x + 1; x++) {
 
+            // Don't insert outside of the borders
+            if (!(0 <= x && x < (signed)shg->cols && 0 <= y && y < (signed)shg->rows)) continue;
+
+            nv_uint32 pair = nv_pair(x, y);
+            nvSHGEntry *entry = (nvSHGEntry *)nvHashMap_get(map, &(nvSHGEntry){.xy_pair=pair});
+
+            if (entry == NULL) {
+                nvArray *new_cell = nvArray_new();
+                nvArray_add(new_cell, body);
+                nvHashMap_set(map, &(nvSHGEntry){.xy_pair=pair, .cell=new_cell});
+            }
+            else {
+                nvArray_add(entry->cell, body);
             }
         }
     }
+}
 
-    NV_TRACY_ZONE_END;
+static void _nvSHG_remove_from_cells(nvSHG *shg, nvHashMap *map, void *body, nvSHGRange range) {
+    for (nv_int16 y = range.min_y; y < range.max_y + 1; y++) {
+        for (nv_int16 x = range.min_x; x < range.max_x + 1; x++) {
+            if (!(0 <= x && x < (signed)shg->cols && 0 <= y && y < (signed)shg->rows)) continue;
+
+            nvSHGEntry *entry = (nvSHGEntry *)nvHashMap_get(map, &(nvSHGEntry){.xy_pair=nv_pair(x, y)});
+
+            // Emptied cells are kept, they are likely to be filled again
+            if (entry) nvArray_remove(entry->cell, body);
+        }
+    }
+}
+
+static void _nvSHG_clear_cells(nvHashMap *map) {
+    size_t iter = 0;
+    void *item;
+    while (nvHashMap_iter(map, &iter, &item)) {
+        nvSHGEntry *entry = (nvSHGEntry *)item;
+        nvArray_free(entry->cell);
+    }
+
+    nvHashMap_clear(map);
+}
+
+void nvSHG_insert(nvSHG *shg, void *body, nvSHGRange range) {
+    _nvSHG_add_to_cells(shg, shg->map, body, range);
+}
+
+void nvSHG_remove(nvSHG *shg, void *body, nvSHGRange range) {
+    _nvSHG_remove_from_cells(shg, shg->map, body, range);
+}
+
+void nvSHG_clear(nvSHG *shg) {
+    _nvSHG_clear_cells(shg->map);
+}
+
+void nvSHG_park(nvSHG *shg, void *body, nvSHGRange range) {
+    _nvSHG_add_to_cells(shg, shg->parked_map, body, range);
+}
+
+void nvSHG_unpark(nvSHG *shg, void *body, nvSHGRange range) {
+    _nvSHG_remove_from_cells(shg, shg->parked_map, body, range);
+}
+
+void nvSHG_clear_parked(nvSHG *shg) {
+    _nvSHG_clear_cells(shg->parked_map);
 }
 
 void nvSHG_get_neighbors(
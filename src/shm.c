@@ -0,0 +1,320 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "novaphysics/internal.h"
+#include "novaphysics/shm.h"
+#include "novaphysics/body.h"
+#include "novaphysics/resolution.h"
+
+
+/**
+ * @file shm.c
+ *
+ * @brief Shared-memory state export for out-of-process viewers.
+ */
+
+
+// Number of times a reader retries copying a slot the writer is updating
+#define _NV_SHM_READ_RETRIES 16
+
+
+static size_t _nvShm_slot_size(size_t max_bodies, size_t max_contacts) {
+    size_t size = sizeof(nvShmFrame) +
+                  sizeof(nvShmBody) * max_bodies +
+                  sizeof(nvShmContact) * max_contacts;
+
+    // Keep slots 8-byte aligned
+    return (size + 7) & ~(size_t)7;
+}
+
+static nv_uint8 *_nvShm_slot(nvShmHeader *header, nv_uint32 frame) {
+    return (nv_uint8 *)header + sizeof(nvShmHeader) +
+           (size_t)header->slot_size * (frame % header->slot_count);
+}
+
+
+#if defined(NV_WINDOWS) || defined(NV_WEB)
+
+    /* Shared memory export is not supported on this platform. */
+
+    nvShmExporter *nvShmExporter_new(
+        const char *name,
+        size_t max_bodies,
+        size_t max_contacts,
+        size_t slot_count
+    ) {
+        return NULL;
+    }
+
+    void nvShmExporter_free(nvShmExporter *exporter) {
+        return;
+    }
+
+    nvShmReader *nvShmReader_open(const char *name) {
+        return NULL;
+    }
+
+    void nvShmReader_close(nvShmReader *reader) {
+        return;
+    }
+
+#else
+
+    /* POSIX shared memory implementation. */
+
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+
+
+    nvShmExporter *nvShmExporter_new(
+        const char *name,
+        size_t max_bodies,
+        size_t max_contacts,
+        size_t slot_count
+    ) {
+        NV_ASSERT(slot_count > 0, "Shared memory needs at least one slot.");
+
+        nvShmExporter *exporter = NV_NEW(nvShmExporter);
+        if (!exporter) return NULL;
+
+        exporter->name = NV_MALLOC(strlen(name) + 1);
+        if (!exporter->name) {
+            NV_FREE(exporter);
+            return NULL;
+        }
+        strcpy(exporter->name, name);
+
+        size_t slot_size = _nvShm_slot_size(max_bodies, max_contacts);
+        exporter->size = sizeof(nvShmHeader) + slot_size * slot_count;
+        exporter->frame = 0;
+
+        int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+        if (fd == -1) {
+            NV_FREE(exporter->name);
+            NV_FREE(exporter);
+            return NULL;
+        }
+
+        if (ftruncate(fd, (off_t)exporter->size) == -1) {
+            close(fd);
+            shm_unlink(name);
+            NV_FREE(exporter->name);
+            NV_FREE(exporter);
+            return NULL;
+        }
+
+        exporter->memory = mmap(NULL, exporter->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (exporter->memory == MAP_FAILED) {
+            shm_unlink(name);
+            NV_FREE(exporter->name);
+            NV_FREE(exporter);
+            return NULL;
+        }
+
+        memset(exporter->memory, 0, exporter->size);
+
+        exporter->header = exporter->memory;
+        exporter->header->version = NV_SHM_VERSION;
+        exporter->header->slot_count = (nv_uint32)slot_count;
+        exporter->header->slot_size = (nv_uint32)slot_size;
+        exporter->header->max_bodies = (nv_uint32)max_bodies;
+        exporter->header->max_contacts = (nv_uint32)max_contacts;
+        exporter->header->profiler_size = (nv_uint32)sizeof(nvProfiler);
+        exporter->header->latest_frame = 0;
+
+        // Readers check the magic, so write it last
+        nv_atomic_store(&exporter->header->magic, NV_SHM_MAGIC);
+
+        return exporter;
+    }
+
+    void nvShmExporter_free(nvShmExporter *exporter) {
+        if (!exporter) return;
+
+        munmap(exporter->memory, exporter->size);
+        shm_unlink(exporter->name);
+        NV_FREE(exporter->name);
+        NV_FREE(exporter);
+    }
+
+    nvShmReader *nvShmReader_open(const char *name) {
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd == -1) return NULL;
+
+        struct stat info;
+        if (fstat(fd, &info) == -1 || (size_t)info.st_size < sizeof(nvShmHeader)) {
+            close(fd);
+            return NULL;
+        }
+
+        nvShmReader *reader = NV_NEW(nvShmReader);
+        if (!reader) {
+            close(fd);
+            return NULL;
+        }
+
+        reader->size = (size_t)info.st_size;
+        reader->memory = mmap(NULL, reader->size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (reader->memory == MAP_FAILED) {
+            NV_FREE(reader);
+            return NULL;
+        }
+
+        reader->header = reader->memory;
+        nvShmHeader *header = reader->header;
+
+        if (
+            nv_atomic_load(&header->magic) != NV_SHM_MAGIC ||
+            header->version != NV_SHM_VERSION ||
+            header->profiler_size != sizeof(nvProfiler) ||
+            header->slot_count == 0 ||
+            sizeof(nvShmHeader) + (size_t)header->slot_size * header->slot_count > reader->size
+        ) {
+            munmap(reader->memory, reader->size);
+            NV_FREE(reader);
+            return NULL;
+        }
+
+        return reader;
+    }
+
+    void nvShmReader_close(nvShmReader *reader) {
+        if (!reader) return;
+
+        munmap(reader->memory, reader->size);
+        NV_FREE(reader);
+    }
+
+#endif
+
+
+void nvShmExporter_write(nvShmExporter *exporter, nvSpace *space) {
+    if (!exporter) return;
+
+    NV_TRACY_ZONE_START;
+
+    nvShmHeader *header = exporter->header;
+    nv_uint32 frame_no = exporter->frame + 1;
+    if (frame_no == 0) frame_no = 1;
+
+    nv_uint8 *slot = _nvShm_slot(header, frame_no);
+    nvShmFrame *frame = (nvShmFrame *)slot;
+    nvShmBody *bodies = (nvShmBody *)(slot + sizeof(nvShmFrame));
+    nvShmContact *contacts = (nvShmContact *)(bodies + header->max_bodies);
+
+    // Odd sequence tells readers the slot is being written
+    nv_uint32 sequence = frame->sequence;
+    nv_atomic_store(&frame->sequence, sequence + 1);
+    nv_atomic_fence();
+
+    size_t body_count = 0;
+    for (size_t i = 0; i < space->bodies->size && body_count < header->max_bodies; i++) {
+        nvBody *body = space->bodies->data[i];
+        nvAABB aabb = nvBody_get_aabb(body);
+
+        bodies[body_count++] = (nvShmBody){
+            .id = body->id,
+            .type = (nv_uint8)body->type,
+            .is_sleeping = body->is_sleeping,
+            .position = {(float)body->position.x, (float)body->position.y},
+            .angle = (float)body->angle,
+            .aabb = {(float)aabb.min_x, (float)aabb.min_y, (float)aabb.max_x, (float)aabb.max_y}
+        };
+    }
+
+    size_t contact_count = 0;
+    size_t total_contacts = 0;
+    void *map_val;
+    size_t l = 0;
+    while (nvHashMap_iter(space->res, &l, &map_val)) {
+        nvResolution *res = map_val;
+        if (res->state == nvResolutionState_CACHED) continue;
+
+        for (size_t c = 0; c < res->contact_count; c++) {
+            total_contacts++;
+            if (contact_count >= header->max_contacts) continue;
+
+            contacts[contact_count++] = (nvShmContact){
+                .position = {(float)res->contacts[c].position.x, (float)res->contacts[c].position.y},
+                .normal = {(float)res->normal.x, (float)res->normal.y}
+            };
+        }
+    }
+
+    frame->frame = frame_no;
+    frame->body_count = (nv_uint32)body_count;
+    frame->contact_count = (nv_uint32)contact_count;
+    frame->total_bodies = (nv_uint32)space->bodies->size;
+    frame->total_contacts = (nv_uint32)total_contacts;
+    frame->profiler = space->profiler;
+
+    nv_atomic_fence();
+    nv_atomic_store(&frame->sequence, sequence + 2);
+
+    exporter->frame = frame_no;
+    nv_atomic_store(&header->latest_frame, frame_no);
+
+    NV_TRACY_ZONE_END;
+}
+
+bool nvShmReader_read(
+    nvShmReader *reader,
+    nvShmFrame *frame,
+    nvShmBody *bodies,
+    nvShmContact *contacts
+) {
+    if (!reader) return false;
+
+    nvShmHeader *header = reader->header;
+
+    nv_uint32 frame_no = nv_atomic_load(&header->latest_frame);
+    if (frame_no == 0) return false;
+
+    nv_uint8 *slot = _nvShm_slot(header, frame_no);
+    nvShmFrame *shared_frame = (nvShmFrame *)slot;
+    nvShmBody *shared_bodies = (nvShmBody *)(slot + sizeof(nvShmFrame));
+    nvShmContact *shared_contacts = (nvShmContact *)(shared_bodies + header->max_bodies);
+
+    for (size_t i = 0; i < _NV_SHM_READ_RETRIES; i++) {
+        nv_uint32 sequence = nv_atomic_load(&shared_frame->sequence);
+        if (sequence & 1) continue;
+
+        nv_atomic_fence();
+
+        memcpy(frame, shared_frame, sizeof(nvShmFrame));
+
+        // Counts can be garbage if the slot was overwritten mid-copy,
+        // the sequence check below rejects them anyway
+        size_t body_count = frame->body_count;
+        size_t contact_count = frame->contact_count;
+        if (body_count > header->max_bodies) body_count = header->max_bodies;
+        if (contact_count > header->max_contacts) contact_count = header->max_contacts;
+
+        memcpy(bodies, shared_bodies, sizeof(nvShmBody) * body_count);
+        memcpy(contacts, shared_contacts, sizeof(nvShmContact) * contact_count);
+
+        nv_atomic_fence();
+
+        if (nv_atomic_load(&shared_frame->sequence) == sequence) {
+            frame->sequence = sequence;
+            return true;
+        }
+    }
+
+    return false;
+}
\ No newline at end of file
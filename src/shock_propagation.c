@@ -0,0 +1,211 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include "novaphysics/internal.h"
+#include "novaphysics/shock_propagation.h"
+
+
+/**
+ * @file shock_propagation.c
+ *
+ * @brief Contact graph layering for shock propagation.
+ */
+
+
+// Marks the end of the edge list of a body
+#define _NV_SHOCK_NO_EDGE 0xFFFFFFFF
+
+
+nvShockGraph *nvShockGraph_new() {
+    nvShockGraph *graph = NV_NEW(nvShockGraph);
+    if (!graph) return NULL;
+
+    *graph = (nvShockGraph){0};
+
+    return graph;
+}
+
+void nvShockGraph_free(nvShockGraph *graph) {
+    if (!graph) return;
+
+    NV_FREE(graph->order);
+    NV_FREE(graph->fixed);
+    NV_FREE(graph->levels);
+    NV_FREE(graph->_heads);
+    NV_FREE(graph->_next);
+    NV_FREE(graph->_queue);
+    NV_FREE(graph->_buckets);
+
+    NV_FREE(graph);
+}
+
+
+/**
+ * @brief Grow the buffers, they are reused every substep.
+ */
+static bool _nvShockGraph_reserve(nvShockGraph *graph, size_t count, size_t max_id) {
+    if (count > graph->capacity) {
+        if (!_nv_reserve((void **)&graph->order, sizeof(nvResolution *), count) ||
+            !_nv_reserve((void **)&graph->fixed, sizeof(nvBody *), count) ||
+            !_nv_reserve((void **)&graph->_next, sizeof(nv_uint32), count * 2) ||
+            !_nv_reserve((void **)&graph->_queue, sizeof(nv_uint32), count * 2))
+            return false;
+
+        graph->capacity = count;
+    }
+
+    if (max_id + 1 > graph->_id_capacity) {
+        if (!_nv_reserve((void **)&graph->levels, sizeof(nv_uint32), max_id + 1) ||
+            !_nv_reserve((void **)&graph->_heads, sizeof(nv_uint32), max_id + 1))
+            return false;
+
+        graph->_id_capacity = max_id + 1;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Does the contact hold one body up on the other?
+ */
+static inline bool _nvShockGraph_supports(nvResolution *res, bool has_gravity, nvVector2 down) {
+    if (!has_gravity) return true;
+    return nv_fabs(nvVector2_dot(res->normal, down)) >= NV_SHOCK_SUPPORT_COS;
+}
+
+static inline nv_uint32 _nvShockGraph_res_level(nvShockGraph *graph, nvResolution *res) {
+    nv_uint32 level_a = graph->levels[res->a->id];
+    nv_uint32 level_b = graph->levels[res->b->id];
+    return (level_a < level_b) ? level_a : level_b;
+}
+
+bool nvShockGraph_build(nvShockGraph *graph, nvArray *resolutions, nvVector2 gravity) {
+    NV_TRACY_ZONE_START;
+
+    size_t count = resolutions->size;
+    graph->count = 0;
+
+    size_t max_id = 0;
+    for (size_t i = 0; i < count; i++) {
+        nvResolution *res = resolutions->data[i];
+        if (res->a->id > max_id) max_id = res->a->id;
+        if (res->b->id > max_id) max_id = res->b->id;
+    }
+
+    if (!_nvShockGraph_reserve(graph, count, max_id)) {
+        NV_TRACY_ZONE_END;
+        return false;
+    }
+
+    // Only reset the entries of the bodies in contact
+    for (size_t i = 0; i < count; i++) {
+        nvResolution *res = resolutions->data[i];
+        graph->levels[res->a->id] = NV_SHOCK_NO_LEVEL;
+        graph->levels[res->b->id] = NV_SHOCK_NO_LEVEL;
+        graph->_heads[res->a->id] = _NV_SHOCK_NO_EDGE;
+        graph->_heads[res->b->id] = _NV_SHOCK_NO_EDGE;
+    }
+
+    bool has_gravity = nvVector2_len2(gravity) > 0.0;
+    nvVector2 down = has_gravity ? nvVector2_normalize(gravity) : nvVector2_zero;
+
+    // Edge 2i belongs to body A of resolution i and edge 2i + 1 to body B
+    for (size_t i = 0; i < count; i++) {
+        nvResolution *res = resolutions->data[i];
+        if (!_nvShockGraph_supports(res, has_gravity, down)) continue;
+
+        graph->_next[i * 2] = graph->_heads[res->a->id];
+        graph->_heads[res->a->id] = (nv_uint32)(i * 2);
+
+        graph->_next[i * 2 + 1] = graph->_heads[res->b->id];
+        graph->_heads[res->b->id] = (nv_uint32)(i * 2 + 1);
+    }
+
+    // Breadth-first search from static bodies
+    size_t head = 0;
+    size_t tail = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        nvResolution *res = resolutions->data[i];
+        nvBody *bodies[2] = {res->a, res->b};
+
+        for (size_t j = 0; j < 2; j++) {
+            if (bodies[j]->type == nvBodyType_STATIC && graph->levels[bodies[j]->id] == NV_SHOCK_NO_LEVEL) {
+                graph->levels[bodies[j]->id] = 0;
+                graph->_queue[tail++] = bodies[j]->id;
+            }
+        }
+    }
+
+    nv_uint32 max_level = 0;
+
+    while (head < tail) {
+        nv_uint32 id = graph->_queue[head++];
+        nv_uint32 level = graph->levels[id];
+
+        for (nv_uint32 edge = graph->_heads[id]; edge != _NV_SHOCK_NO_EDGE; edge = graph->_next[edge]) {
+            nvResolution *res = resolutions->data[edge / 2];
+            nvBody *other = (edge & 1) ? res->a : res->b;
+
+            if (graph->levels[other->id] == NV_SHOCK_NO_LEVEL) {
+                graph->levels[other->id] = level + 1;
+                graph->_queue[tail++] = other->id;
+                if (level + 1 > max_level) max_level = level + 1;
+            }
+        }
+    }
+
+    // Unsupported bodies go to the bucket after the highest level
+    size_t buckets = (size_t)max_level + 2;
+    if (buckets > graph->_bucket_capacity) {
+        if (!_nv_reserve((void **)&graph->_buckets, sizeof(nv_uint32), buckets)) {
+            NV_TRACY_ZONE_END;
+            return false;
+        }
+
+        graph->_bucket_capacity = buckets;
+    }
+
+    for (size_t i = 0; i < buckets; i++)
+        graph->_buckets[i] = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        nv_uint32 level = _nvShockGraph_res_level(graph, resolutions->data[i]);
+        graph->_buckets[(level == NV_SHOCK_NO_LEVEL) ? buckets - 1 : level]++;
+    }
+
+    nv_uint32 offset = 0;
+    for (size_t i = 0; i < buckets; i++) {
+        nv_uint32 size = graph->_buckets[i];
+        graph->_buckets[i] = offset;
+        offset += size;
+    }
+
+    // Stable counting sort, resolutions on the same level keep their order
+    for (size_t i = 0; i < count; i++) {
+        nvResolution *res = resolutions->data[i];
+        nv_uint32 level = _nvShockGraph_res_level(graph, res);
+        nv_uint32 k = graph->_buckets[(level == NV_SHOCK_NO_LEVEL) ? buckets - 1 : level]++;
+
+        nv_uint32 level_a = graph->levels[res->a->id];
+        nv_uint32 level_b = graph->levels[res->b->id];
+
+        graph->order[k] = res;
+        graph->fixed[k] = NULL;
+
+        if (level_a != level_b && _nvShockGraph_supports(res, has_gravity, down))
+            graph->fixed[k] = (level_a < level_b) ? res->a : res->b;
+    }
+
+    graph->count = count;
+
+    NV_TRACY_ZONE_END;
+    return true;
+}
\ No newline at end of file
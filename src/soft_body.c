@@ -0,0 +1,878 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include "novaphysics/soft_body.h"
+#include "novaphysics/constants.h"
+#include "novaphysics/broadphase.h"
+#include "novaphysics/collision.h"
+#include "novaphysics/space.h"
+#include "novaphysics/space_step.h"
+
+
+/**
+ * @file soft_body.c
+ *
+ * @brief Mass-spring soft bodies and cloth.
+ *
+ * Every substep the points are moved with their velocities, then each
+ * iteration solves the links colour by colour, pushes points out of each
+ * other and pushes points out of the bodies. Velocities are derived from the
+ * change in positions at the end of the substep.
+ *
+ * Links are solved with XPBD, so their stiffness doesn't depend on the step
+ * size or iteration count as long as the solver converges. Link multipliers
+ * are reset every substep.
+ */
+
+
+// Minimum number of points in one parallel range
+#define _NV_SOFT_BODY_MIN_RANGE 512
+
+// Colour of the links that are solved serially
+#define _NV_SOFT_BODY_SERIAL_COLOR NV_SOFT_BODY_COLORS
+
+// Links of a colour are split between threads in batches of this size
+#define _NV_SOFT_BODY_BATCH 4
+
+
+nvSoftBody *nvSoftBody_new(nv_float radius, nvMaterial material) {
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_SOFT_BODIES);
+    nvSoftBody *sb = NV_NEW(nvSoftBody);
+    NV_ALLOC_SCOPE_END;
+    if (!sb) return NULL;
+
+    *sb = (nvSoftBody){0};
+
+    sb->radius = radius;
+    sb->material = material;
+    sb->gravity_scale = 1.0;
+    sb->linear_damping = 0.002;
+    sb->substeps = NV_SOFT_BODY_SUBSTEPS;
+    sb->iterations = NV_SOFT_BODY_ITERATIONS;
+    sb->coupling = nvParticleCoupling_TWO_WAY;
+
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_SOFT_BODIES);
+    sb->_bodies = nvArray_new();
+    NV_ALLOC_SCOPE_END;
+    if (!sb->_bodies) {
+        NV_FREE(sb);
+        return NULL;
+    }
+
+    sb->self_collision = false;
+    sb->collision_category = 0b11111111111111111111111111111111;
+    sb->collision_mask = 0b11111111111111111111111111111111;
+
+    return sb;
+}
+
+nvSoftBody *nvSoftBody_new_cloth(
+    nvVector2 position,
+    size_t columns,
+    size_t rows,
+    nv_float spacing,
+    nv_float mass,
+    nv_float compliance,
+    nvMaterial material
+) {
+    nvSoftBody *sb = nvSoftBody_new(spacing * 0.4, material);
+    if (!sb) return NULL;
+
+    bool added = true;
+
+    for (size_t y = 0; y < rows && added; y++) {
+        for (size_t x = 0; x < columns && added; x++) {
+            added = nvSoftBody_add_point(
+                sb,
+                nvVector2_add(position, NV_VEC2((nv_float)x * spacing, (nv_float)y * spacing)),
+                mass
+            );
+        }
+    }
+
+    for (size_t y = 0; y < rows && added; y++) {
+        for (size_t x = 0; x < columns && added; x++) {
+            size_t i = y * columns + x;
+
+            // Structural links
+            if (x > 0) added = added && nvSoftBody_add_link(sb, i - 1, i, compliance);
+            if (y > 0) added = added && nvSoftBody_add_link(sb, i - columns, i, compliance);
+
+            // Shear links
+            if (x > 0 && y > 0) {
+                added = added && nvSoftBody_add_link(sb, i - columns - 1, i, compliance);
+                added = added && nvSoftBody_add_link(sb, i - columns, i - 1, compliance);
+            }
+        }
+    }
+
+    if (!added) {
+        nvSoftBody_free(sb);
+        return NULL;
+    }
+
+    return sb;
+}
+
+void nvSoftBody_free(void *sb) {
+    if (!sb) return;
+    nvSoftBody *s = (nvSoftBody *)sb;
+
+    NV_FREE(s->position_x);
+    NV_FREE(s->position_y);
+    NV_FREE(s->velocity_x);
+    NV_FREE(s->velocity_y);
+    NV_FREE(s->invmass);
+    NV_FREE(s->_prev_x);
+    NV_FREE(s->_prev_y);
+    NV_FREE(s->_delta_x);
+    NV_FREE(s->_delta_y);
+    NV_FREE(s->_sorted_x);
+    NV_FREE(s->_sorted_y);
+    NV_FREE(s->_sorted_w);
+    NV_FREE(s->_color_masks);
+    nvCellGrid_release(&s->_grid);
+    nvArray_free(s->_bodies);
+
+    NV_FREE(s->link_a);
+    NV_FREE(s->link_b);
+    NV_FREE(s->rest_length);
+    NV_FREE(s->compliance);
+    NV_FREE(s->_lambda);
+    NV_FREE(s->_link_colors);
+    NV_FREE(s->_staged_a);
+    NV_FREE(s->_staged_b);
+    NV_FREE(s->_staged_rest);
+    NV_FREE(s->_staged_compliance);
+
+    NV_FREE(s->_normals);
+
+    NV_FREE(s);
+}
+
+bool nvSoftBody_add_point(nvSoftBody *sb, nvVector2 position, nv_float mass) {
+    if (sb->count == sb->capacity) {
+        size_t capacity = (sb->capacity < 64) ? 64 : sb->capacity * 2;
+
+        NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_SOFT_BODIES);
+
+        bool reserved =
+            _nv_reserve((void **)&sb->position_x, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->position_y, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->velocity_x, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->velocity_y, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->invmass, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->_prev_x, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->_prev_y, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->_delta_x, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->_delta_y, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->_sorted_x, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->_sorted_y, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->_sorted_w, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->_color_masks, sizeof(nv_uint32), capacity);
+
+        NV_ALLOC_SCOPE_END;
+
+        if (!reserved) return false;
+        sb->capacity = capacity;
+    }
+
+    size_t i = sb->count++;
+    sb->position_x[i] = position.x;
+    sb->position_y[i] = position.y;
+    sb->velocity_x[i] = 0.0;
+    sb->velocity_y[i] = 0.0;
+    sb->invmass[i] = (mass > 0.0) ? 1.0 / mass : 0.0;
+
+    return true;
+}
+
+bool nvSoftBody_add_link(nvSoftBody *sb, size_t a, size_t b, nv_float compliance) {
+    NV_ASSERT(a < sb->count && b < sb->count && a != b, "Soft body links must connect two different points of the soft body.");
+
+    if (sb->link_count == sb->link_capacity) {
+        size_t capacity = (sb->link_capacity < 64) ? 64 : sb->link_capacity * 2;
+
+        NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_SOFT_BODIES);
+
+        bool reserved =
+            _nv_reserve((void **)&sb->link_a, sizeof(nv_uint32), capacity) &&
+            _nv_reserve((void **)&sb->link_b, sizeof(nv_uint32), capacity) &&
+            _nv_reserve((void **)&sb->rest_length, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->compliance, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->_lambda, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->_link_colors, sizeof(nv_uint8), capacity) &&
+            _nv_reserve((void **)&sb->_staged_a, sizeof(nv_uint32), capacity) &&
+            _nv_reserve((void **)&sb->_staged_b, sizeof(nv_uint32), capacity) &&
+            _nv_reserve((void **)&sb->_staged_rest, sizeof(nv_float), capacity) &&
+            _nv_reserve((void **)&sb->_staged_compliance, sizeof(nv_float), capacity);
+
+        NV_ALLOC_SCOPE_END;
+
+        if (!reserved) return false;
+        sb->link_capacity = capacity;
+    }
+
+    nv_float dx = sb->position_x[b] - sb->position_x[a];
+    nv_float dy = sb->position_y[b] - sb->position_y[a];
+
+    size_t k = sb->link_count++;
+    sb->link_a[k] = (nv_uint32)a;
+    sb->link_b[k] = (nv_uint32)b;
+    sb->rest_length[k] = nv_sqrt(dx * dx + dy * dy);
+    sb->compliance[k] = compliance;
+    sb->_dirty = true;
+
+    return true;
+}
+
+void nvSoftBody_set_mass(nvSoftBody *sb, size_t i, nv_float mass) {
+    nv_float invmass = (mass > 0.0) ? 1.0 / mass : 0.0;
+    sb->invmass[i] = invmass;
+
+    if (invmass == 0.0) {
+        sb->velocity_x[i] = 0.0;
+        sb->velocity_y[i] = 0.0;
+    }
+}
+
+
+/**
+ * @brief Sort links by colours.
+ *
+ * Pinned points restrict colours too, since links write them back unchanged.
+ */
+static void _nvSoftBody_color(nvSoftBody *sb) {
+    NV_TRACY_ZONE_START;
+
+    for (size_t i = 0; i < sb->count; i++)
+        sb->_color_masks[i] = 0;
+
+    size_t color_counts[NV_SOFT_BODY_COLORS + 1] = {0};
+
+    for (size_t k = 0; k < sb->link_count; k++) {
+        nv_uint32 a = sb->link_a[k];
+        nv_uint32 b = sb->link_b[k];
+        nv_uint32 used = sb->_color_masks[a] | sb->_color_masks[b];
+
+        nv_uint8 color = _NV_SOFT_BODY_SERIAL_COLOR;
+        for (nv_uint8 c = 0; c < NV_SOFT_BODY_COLORS; c++) {
+            nv_uint32 bit = (nv_uint32)1 << c;
+
+            if (!(used & bit)) {
+                sb->_color_masks[a] |= bit;
+                sb->_color_masks[b] |= bit;
+                color = c;
+                break;
+            }
+        }
+
+        sb->_link_colors[k] = color;
+        color_counts[color]++;
+    }
+
+    sb->color_starts[0] = 0;
+    for (size_t i = 0; i < NV_SOFT_BODY_COLORS + 1; i++)
+        sb->color_starts[i + 1] = sb->color_starts[i] + color_counts[i];
+
+    // Links keep their order within a colour
+    size_t offsets[NV_SOFT_BODY_COLORS + 1];
+    for (size_t i = 0; i < NV_SOFT_BODY_COLORS + 1; i++)
+        offsets[i] = sb->color_starts[i];
+
+    for (size_t k = 0; k < sb->link_count; k++) {
+        size_t j = offsets[sb->_link_colors[k]]++;
+
+        sb->_staged_a[j] = sb->link_a[k];
+        sb->_staged_b[j] = sb->link_b[k];
+        sb->_staged_rest[j] = sb->rest_length[k];
+        sb->_staged_compliance[j] = sb->compliance[k];
+    }
+
+    nv_uint32 *swap_index;
+    nv_float *swap_float;
+
+    swap_index = sb->link_a; sb->link_a = sb->_staged_a; sb->_staged_a = swap_index;
+    swap_index = sb->link_b; sb->link_b = sb->_staged_b; sb->_staged_b = swap_index;
+    swap_float = sb->rest_length; sb->rest_length = sb->_staged_rest; sb->_staged_rest = swap_float;
+    swap_float = sb->compliance; sb->compliance = sb->_staged_compliance; sb->_staged_compliance = swap_float;
+
+    sb->_dirty = false;
+
+    NV_TRACY_ZONE_END;
+}
+
+
+/**
+ * @brief State of the substep shared with the parallel ranges.
+ */
+typedef struct {
+    nvSoftBody *sb;
+    nv_float dt;
+    nvVector2 gravity;
+    nv_float damping;
+    nv_float inv_dt2; /**< Link compliances are scaled by this. */
+    nvCellGrid *grid; /**< Self collision grid. */
+
+    size_t color_start; /**< Range of links of the colour being solved. */
+    size_t color_end;
+} _nvSoftBodyStep;
+
+/**
+ * @brief Solve one link.
+ *
+ * Operations are in the same order as the AVX version, so a link gets the
+ * same result whether it is solved in a batch or not.
+ */
+static inline void _nvSoftBody_solve_link(nvSoftBody *sb, nv_float inv_dt2, size_t k) {
+    nv_uint32 a = sb->link_a[k];
+    nv_uint32 b = sb->link_b[k];
+    nv_float wa = sb->invmass[a];
+    nv_float wb = sb->invmass[b];
+
+    nv_float dx = sb->position_x[b] - sb->position_x[a];
+    nv_float dy = sb->position_y[b] - sb->position_y[a];
+    nv_float len = nv_sqrt(dx * dx + dy * dy);
+
+    nv_float alpha = sb->compliance[k] * inv_dt2;
+    nv_float denom = (wa + wb) + alpha;
+    if (!(denom > 0.0 && len > 0.0)) return;
+
+    nv_float c = len - sb->rest_length[k];
+    nv_float dl = ((0.0 - c) - alpha * sb->_lambda[k]) / denom;
+    nv_float s = dl / len;
+
+    sb->_lambda[k] += dl;
+
+    // Pinned points have zero inverse mass, they are written back unchanged
+    sb->position_x[a] -= dx * s * wa;
+    sb->position_y[a] -= dy * s * wa;
+    sb->position_x[b] += dx * s * wb;
+    sb->position_y[b] += dy * s * wb;
+}
+
+#if defined(NV_AVX) && defined(NV_USE_SIMD) && !defined(NV_USE_FLOAT)
+
+    /**
+     * @brief Solve four links of the same colour using AVX double vectors.
+     */
+    static inline void _nvSoftBody_solve_links_AVX(nvSoftBody *sb, nv_float inv_dt2, size_t k) {
+        nv_uint32 *a = &sb->link_a[k];
+        nv_uint32 *b = &sb->link_b[k];
+
+        #define _NV_GATHER(array, i) _mm256_set_pd(array[i[3]], array[i[2]], array[i[1]], array[i[0]])
+
+        __m256d v_pax = _NV_GATHER(sb->position_x, a);
+        __m256d v_pay = _NV_GATHER(sb->position_y, a);
+        __m256d v_wa = _NV_GATHER(sb->invmass, a);
+
+        __m256d v_pbx = _NV_GATHER(sb->position_x, b);
+        __m256d v_pby = _NV_GATHER(sb->position_y, b);
+        __m256d v_wb = _NV_GATHER(sb->invmass, b);
+
+        #undef _NV_GATHER
+
+        // Link data is already laid out contiguously
+        __m256d v_rest = _mm256_loadu_pd(&sb->rest_length[k]);
+        __m256d v_compliance = _mm256_loadu_pd(&sb->compliance[k]);
+        __m256d v_lambda = _mm256_loadu_pd(&sb->_lambda[k]);
+
+        __m256d v_zero = _mm256_setzero_pd();
+        __m256d v_one = NV_AVX_VECTOR_FROM_DOUBLE(1.0);
+
+        __m256d v_dx = _mm256_sub_pd(v_pbx, v_pax);
+        __m256d v_dy = _mm256_sub_pd(v_pby, v_pay);
+        __m256d v_len = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(v_dx, v_dx), _mm256_mul_pd(v_dy, v_dy)));
+
+        __m256d v_alpha = _mm256_mul_pd(v_compliance, NV_AVX_VECTOR_FROM_DOUBLE(inv_dt2));
+        __m256d v_denom = _mm256_add_pd(_mm256_add_pd(v_wa, v_wb), v_alpha);
+
+        // Links between two pinned points and links of zero length are skipped
+        __m256d v_valid = _mm256_and_pd(
+            _mm256_cmp_pd(v_denom, v_zero, _CMP_GT_OQ),
+            _mm256_cmp_pd(v_len, v_zero, _CMP_GT_OQ)
+        );
+        v_denom = _mm256_blendv_pd(v_one, v_denom, v_valid);
+        v_len = _mm256_blendv_pd(v_one, v_len, v_valid);
+
+        __m256d v_c = _mm256_sub_pd(v_len, v_rest);
+        __m256d v_dl = _mm256_and_pd(
+            v_valid,
+            _mm256_div_pd(
+                _mm256_sub_pd(_mm256_sub_pd(v_zero, v_c), _mm256_mul_pd(v_alpha, v_lambda)),
+                v_denom
+            )
+        );
+        __m256d v_s = _mm256_div_pd(v_dl, v_len);
+
+        _mm256_storeu_pd(&sb->_lambda[k], _mm256_add_pd(v_lambda, v_dl));
+
+        __m256d v_sx = _mm256_mul_pd(v_dx, v_s);
+        __m256d v_sy = _mm256_mul_pd(v_dy, v_s);
+
+        NV_ALIGNED_AS(32) double final_pax[4];
+        NV_ALIGNED_AS(32) double final_pay[4];
+        NV_ALIGNED_AS(32) double final_pbx[4];
+        NV_ALIGNED_AS(32) double final_pby[4];
+
+        _mm256_store_pd(final_pax, _mm256_sub_pd(v_pax, _mm256_mul_pd(v_sx, v_wa)));
+        _mm256_store_pd(final_pay, _mm256_sub_pd(v_pay, _mm256_mul_pd(v_sy, v_wa)));
+        _mm256_store_pd(final_pbx, _mm256_add_pd(v_pbx, _mm256_mul_pd(v_sx, v_wb)));
+        _mm256_store_pd(final_pby, _mm256_add_pd(v_pby, _mm256_mul_pd(v_sy, v_wb)));
+
+        // Points are unique in a colour, so lanes never write the same point.
+        // Writing pinned points back unchanged is cheaper than branching on them.
+        for (size_t lane = 0; lane < 4; lane++) {
+            sb->position_x[a[lane]] = final_pax[lane];
+            sb->position_y[a[lane]] = final_pay[lane];
+            sb->position_x[b[lane]] = final_pbx[lane];
+            sb->position_y[b[lane]] = final_pby[lane];
+        }
+    }
+
+#endif
+
+static void _nvSoftBody_solve_range(nvSoftBody *sb, nv_float inv_dt2, size_t start, size_t end) {
+    size_t k = start;
+
+    #if defined(NV_AVX) && defined(NV_USE_SIMD) && !defined(NV_USE_FLOAT)
+
+        for (; k + 4 <= end; k += 4)
+            _nvSoftBody_solve_links_AVX(sb, inv_dt2, k);
+
+    #endif
+
+    for (; k < end; k++)
+        _nvSoftBody_solve_link(sb, inv_dt2, k);
+}
+
+static void _nvSoftBody_color_task(void *data, size_t start, size_t end) {
+    NV_TRACY_ZONE_START;
+
+    _nvSoftBodyStep *step = (_nvSoftBodyStep *)data;
+
+    // Ranges are in batches, so the same links are batched together for any thread count
+    size_t link_start = step->color_start + start * _NV_SOFT_BODY_BATCH;
+    size_t link_end = step->color_start + end * _NV_SOFT_BODY_BATCH;
+    if (link_end > step->color_end) link_end = step->color_end;
+
+    _nvSoftBody_solve_range(step->sb, step->inv_dt2, link_start, link_end);
+
+    NV_TRACY_ZONE_END;
+}
+
+/**
+ * @brief Solve all links once, colour by colour.
+ */
+static void _nvSoftBody_solve_links(nvSpace *space, _nvSoftBodyStep *step) {
+    nvSoftBody *sb = step->sb;
+
+    for (size_t i = 0; i < NV_SOFT_BODY_COLORS; i++) {
+        size_t start = sb->color_starts[i];
+        size_t end = sb->color_starts[i + 1];
+
+        if (end - start >= NV_SOFT_BODY_PARALLEL_THRESHOLD) {
+            step->color_start = start;
+            step->color_end = end;
+            size_t batches = (end - start + _NV_SOFT_BODY_BATCH - 1) / _NV_SOFT_BODY_BATCH;
+            _nvSpace_parallel_for_items(space, _nvSoftBody_color_task, step, batches, 64);
+        }
+        else {
+            _nvSoftBody_solve_range(sb, step->inv_dt2, start, end);
+        }
+    }
+
+    // Links of the serial colour can share points with each other
+    for (size_t k = sb->color_starts[_NV_SOFT_BODY_SERIAL_COLOR]; k < sb->color_starts[_NV_SOFT_BODY_SERIAL_COLOR + 1]; k++)
+        _nvSoftBody_solve_link(sb, step->inv_dt2, k);
+}
+
+/**
+ * @brief Apply gravity & damping and move the points.
+ */
+static void _nvSoftBody_predict(void *data, size_t start, size_t end) {
+    _nvSoftBodyStep *step = (_nvSoftBodyStep *)data;
+    nvSoftBody *sb = step->sb;
+
+    for (size_t i = start; i < end; i++) {
+        sb->_prev_x[i] = sb->position_x[i];
+        sb->_prev_y[i] = sb->position_y[i];
+        if (sb->invmass[i] == 0.0) continue;
+
+        nv_float vx = (sb->velocity_x[i] + step->gravity.x * step->dt) * step->damping;
+        nv_float vy = (sb->velocity_y[i] + step->gravity.y * step->dt) * step->damping;
+
+        sb->position_x[i] += vx * step->dt;
+        sb->position_y[i] += vy * step->dt;
+        sb->velocity_x[i] = vx;
+        sb->velocity_y[i] = vy;
+    }
+}
+
+/**
+ * @brief Derive velocities from the movement in the substep.
+ */
+static void _nvSoftBody_finish(void *data, size_t start, size_t end) {
+    _nvSoftBodyStep *step = (_nvSoftBodyStep *)data;
+    nvSoftBody *sb = step->sb;
+    nv_float inv_dt = 1.0 / step->dt;
+
+    for (size_t i = start; i < end; i++) {
+        sb->velocity_x[i] = (sb->position_x[i] - sb->_prev_x[i]) * inv_dt;
+        sb->velocity_y[i] = (sb->position_y[i] - sb->_prev_y[i]) * inv_dt;
+    }
+}
+
+
+/**
+ * @brief Sort point indices by self collision grid cells.
+ *
+ * Points themselves aren't moved since links refer to them. Returns false if
+ * the cells couldn't be allocated.
+ */
+static bool _nvSoftBody_sort(nvSpace *space, _nvSoftBodyStep *step) {
+    nvSoftBody *sb = step->sb;
+
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_SOFT_BODIES);
+    bool sorted = nvCellGrid_sort(
+        step->grid,
+        space,
+        sb->position_x,
+        sb->position_y,
+        sb->count,
+        sb->bounds,
+        sb->radius * 2.0,
+        _NV_SOFT_BODY_MIN_RANGE
+    );
+    NV_ALLOC_SCOPE_END;
+
+    return sorted;
+}
+
+/**
+ * @brief Gather point positions in grid order.
+ */
+static void _nvSoftBody_gather(void *data, size_t start, size_t end) {
+    _nvSoftBodyStep *step = (_nvSoftBodyStep *)data;
+    nvSoftBody *sb = step->sb;
+
+    for (size_t o = start; o < end; o++) {
+        nv_uint32 i = step->grid->order[o];
+        sb->_sorted_x[o] = sb->position_x[i];
+        sb->_sorted_y[o] = sb->position_y[i];
+        sb->_sorted_w[o] = sb->invmass[i];
+    }
+}
+
+/**
+ * @brief Compute self collision corrections.
+ *
+ * Points are visited in grid order and only write their own corrections, so
+ * the result doesn't depend on the thread count.
+ */
+static void _nvSoftBody_solve_self(void *data, size_t start, size_t end) {
+    _nvSoftBodyStep *step = (_nvSoftBodyStep *)data;
+    nvSoftBody *sb = step->sb;
+
+    nv_float diameter = sb->radius * 2.0;
+    nv_float diameter2 = diameter * diameter;
+    const nv_float *sx = sb->_sorted_x;
+    const nv_float *sy = sb->_sorted_y;
+    const nv_float *sw = sb->_sorted_w;
+
+    for (size_t o = start; o < end; o++) {
+        sb->_delta_x[o] = 0.0;
+        sb->_delta_y[o] = 0.0;
+
+        nv_float wi = sw[o];
+        if (wi == 0.0) continue;
+
+        nv_float xi = sx[o];
+        nv_float yi = sy[o];
+        nv_int32 cx = nvCellGrid_coord(step->grid, xi);
+        nv_int32 cy = nvCellGrid_coord(step->grid, yi);
+
+        nvCellRanges ranges;
+        nvCellGrid_neighbour_ranges(step->grid, cx, cy, &ranges);
+
+        nv_float sum_x = 0.0;
+        nv_float sum_y = 0.0;
+        size_t contacts = 0;
+
+        for (size_t r = 0; r < ranges.count; r++) {
+            for (nv_uint32 k = ranges.begins[r]; k < ranges.ends[r]; k++) {
+                nv_float dx = xi - sx[k];
+                nv_float dy = yi - sy[k];
+                nv_float dist2 = dx * dx + dy * dy;
+
+                // Points at the same position can't be separated in any meaningful direction
+                if (dist2 >= diameter2 || dist2 == 0.0) continue;
+
+                nv_float dist = nv_sqrt(dist2);
+                nv_float share = (diameter - dist) / dist * wi / (wi + sw[k]);
+
+                sum_x += dx * share;
+                sum_y += dy * share;
+                contacts++;
+            }
+        }
+
+        // Corrections are averaged, summing them overshoots when many points overlap
+        if (contacts > 0) {
+            sb->_delta_x[o] = sum_x / (nv_float)contacts;
+            sb->_delta_y[o] = sum_y / (nv_float)contacts;
+        }
+    }
+}
+
+/**
+ * @brief Apply self collision corrections.
+ */
+static void _nvSoftBody_apply_deltas(void *data, size_t start, size_t end) {
+    _nvSoftBodyStep *step = (_nvSoftBodyStep *)data;
+    nvSoftBody *sb = step->sb;
+
+    for (size_t o = start; o < end; o++) {
+        nv_uint32 i = step->grid->order[o];
+        sb->position_x[i] += sb->_delta_x[o];
+        sb->position_y[i] += sb->_delta_y[o];
+    }
+}
+
+
+/**
+ * @brief Apply the point's reaction impulse to a body.
+ *
+ * Impulse stops the body from approaching the point and separates them
+ * slowly. Turning the point's whole position correction into an impulse would
+ * make points squeezed between two bodies act like undamped springs.
+ */
+static inline void _nvSoftBody_push_body(
+    nvBody *body,
+    nvVector2 arm,
+    nvVector2 normal,
+    nvVector2 relative,
+    nv_float depth,
+    nv_float friction,
+    nv_float invmass,
+    nv_float dt
+) {
+    nv_float rn = nvVector2_cross(arm, normal);
+    nv_float mass_normal = 1.0 / (invmass + body->invmass + body->invinertia * rn * rn);
+
+    nv_float jn = (nvVector2_dot(relative, normal) + NV_BAUMGARTE * depth / dt) * mass_normal;
+    if (jn <= 0.0) return;
+
+    nvVector2 impulse = nvVector2_mul(normal, -jn);
+
+    nvVector2 tangent = nvVector2_sub(relative, nvVector2_mul(normal, nvVector2_dot(relative, normal)));
+    nv_float tangent_len = nvVector2_len(tangent);
+
+    if (tangent_len > 0.0) {
+        tangent = nvVector2_div(tangent, tangent_len);
+        nv_float rt = nvVector2_cross(arm, tangent);
+        nv_float mass_tangent = 1.0 / (invmass + body->invmass + body->invinertia * rt * rt);
+
+        nv_float jt = nv_fmin(tangent_len * mass_tangent, friction * jn);
+        impulse = nvVector2_sub(impulse, nvVector2_mul(tangent, jt));
+    }
+
+    nvBody_apply_impulse(body, impulse, arm);
+}
+
+/**
+ * @brief Do points apply impulses to the body?
+ */
+static inline bool _nvSoftBody_pushes(nvSpace *space, nvSoftBody *sb, nvBody *body) {
+    return (
+        sb->coupling == nvParticleCoupling_TWO_WAY &&
+        body->type == nvBodyType_DYNAMIC &&
+        !body->is_sleeping &&
+        (!space->_multirate || body->_sim_active)
+    );
+}
+
+/**
+ * @brief Push the points out of one body.
+ */
+static void _nvSoftBody_solve_body(nvSpace *space, _nvSoftBodyStep *step, nvBody *body) {
+    nvSoftBody *sb = step->sb;
+
+    nvArray *vertices = NULL;
+    if (body->shape->type == nvShapeType_POLYGON) {
+        NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_SOFT_BODIES);
+        bool prepared = _nvParticle_polygon_normals(body, &sb->_normals, &sb->_normal_capacity);
+        NV_ALLOC_SCOPE_END;
+
+        if (!prepared) return;
+        vertices = body->shape->trans_vertices;
+    }
+
+    nv_float r = sb->radius;
+    nvAABB box = nvBody_get_aabb(body);
+    box = (nvAABB){box.min_x - r, box.min_y - r, box.max_x + r, box.max_y + r};
+
+    bool pushed = _nvSoftBody_pushes(space, sb, body);
+
+    nv_float friction = nv_mix_coefficients(sb->material.friction, body->material.friction, space->mix_friction);
+
+    for (size_t i = 0; i < sb->count; i++) {
+        if (sb->invmass[i] == 0.0) continue;
+
+        nvVector2 p = NV_VEC2(sb->position_x[i], sb->position_y[i]);
+        if (p.x < box.min_x || p.x > box.max_x || p.y < box.min_y || p.y > box.max_y) continue;
+
+        nvVector2 normal, point;
+        nv_float depth;
+        if (!_nvParticle_collide_body(body, vertices, sb->_normals, r, p, &normal, &depth, &point)) continue;
+
+        nvVector2 correction = nvVector2_mul(normal, depth);
+
+        // Friction cancels movement relative to the body's surface in the substep
+        nvVector2 arm = nvVector2_sub(point, body->position);
+        nvVector2 surface = nvVector2_add(
+            body->linear_velocity,
+            nvVector2_mul(nvVector2_perp(arm), body->angular_velocity)
+        );
+
+        nvVector2 velocity = NV_VEC2(p.x - sb->_prev_x[i], p.y - sb->_prev_y[i]);
+        nvVector2 moved = nvVector2_sub(
+            nvVector2_add(velocity, correction),
+            nvVector2_mul(surface, step->dt)
+        );
+        velocity = nvVector2_div(velocity, step->dt);
+        nvVector2 tangent = nvVector2_sub(moved, nvVector2_mul(normal, nvVector2_dot(moved, normal)));
+        nv_float tangent_len = nvVector2_len(tangent);
+
+        if (tangent_len > 0.0) {
+            nv_float f = nv_fmin(tangent_len, friction * depth) / tangent_len;
+            correction = nvVector2_sub(correction, nvVector2_mul(tangent, f));
+        }
+
+        sb->position_x[i] += correction.x;
+        sb->position_y[i] += correction.y;
+
+        // Points landing on a sleeping body wake it up and push it from then on
+        if (
+            !pushed &&
+            sb->coupling == nvParticleCoupling_TWO_WAY &&
+            _nvParticle_wake_body(space, body, correction, step->dt)
+        )
+            pushed = !space->_multirate;
+
+        if (pushed)
+            _nvSoftBody_push_body(body, arm, normal, nvVector2_sub(surface, velocity), depth, friction, sb->invmass[i], step->dt);
+    }
+}
+
+/**
+ * @brief Should the soft body collide with the body?
+ */
+static inline bool _nvSoftBody_filter(nvSoftBody *sb, nvBody *body) {
+    if (!body->enable_collision) return false;
+
+    return (
+        (sb->collision_mask & body->collision_category) != 0 &&
+        (body->collision_mask & sb->collision_category) != 0
+    );
+}
+
+/**
+ * @brief Find the bounds of the points.
+ */
+static void _nvSoftBody_bounds(nvSoftBody *sb) {
+    nvAABB bounds = {NV_INF, NV_INF, -NV_INF, -NV_INF};
+
+    for (size_t i = 0; i < sb->count; i++) {
+        bounds.min_x = nv_fmin(bounds.min_x, sb->position_x[i]);
+        bounds.min_y = nv_fmin(bounds.min_y, sb->position_y[i]);
+        bounds.max_x = nv_fmax(bounds.max_x, sb->position_x[i]);
+        bounds.max_y = nv_fmax(bounds.max_y, sb->position_y[i]);
+    }
+
+    sb->bounds = bounds;
+}
+
+void nvSoftBody_step(nvSpace *space, nvSoftBody *sb, nv_float dt) {
+    if (sb->count == 0 || sb->substeps == 0) return;
+
+    NV_TRACY_ZONE_START;
+
+    if (sb->_dirty) _nvSoftBody_color(sb);
+
+    _nvSoftBodyStep step = {
+        .sb = sb,
+        .dt = dt / (nv_float)sb->substeps,
+        .gravity = nvVector2_mul(space->gravity, sb->gravity_scale),
+        .damping = nv_pow(0.98, sb->linear_damping),
+        .grid = &sb->_grid
+    };
+    step.inv_dt2 = 1.0 / (step.dt * step.dt);
+
+    for (size_t k = 0; k < sb->substeps; k++) {
+        _nvSpace_parallel_for_items(space, _nvSoftBody_predict, &step, sb->count, _NV_SOFT_BODY_MIN_RANGE);
+        _nvSoftBody_bounds(sb);
+
+        for (size_t i = 0; i < sb->link_count; i++)
+            sb->_lambda[i] = 0.0;
+
+        bool self_collision = sb->self_collision && sb->radius > 0.0 && _nvSoftBody_sort(space, &step);
+
+        // Points can move up to a diameter while iterating
+        nv_float margin = sb->radius * 2.0;
+        nvAABB reach = {
+            sb->bounds.min_x - margin, sb->bounds.min_y - margin,
+            sb->bounds.max_x + margin, sb->bounds.max_y + margin
+        };
+
+        /*
+            The whole soft body is one broad-phase proxy. Bodies don't move while points are
+            solved, so they are found once per substep.
+        */
+        nvArray_clear(sb->_bodies, NULL);
+        NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_SOFT_BODIES);
+        nvBroadPhase_query_aabb(space, reach, sb->_bodies);
+        NV_ALLOC_SCOPE_END;
+
+        size_t body_count = 0;
+        for (size_t j = 0; j < sb->_bodies->size; j++) {
+            nvBody *body = sb->_bodies->data[j];
+            if (_nvSoftBody_filter(sb, body)) sb->_bodies->data[body_count++] = body;
+        }
+        sb->_bodies->size = body_count;
+
+        for (size_t i = 0; i < sb->iterations; i++) {
+            _nvSoftBody_solve_links(space, &step);
+
+            if (self_collision) {
+                _nvSpace_parallel_for_items(space, _nvSoftBody_gather, &step, sb->count, _NV_SOFT_BODY_MIN_RANGE);
+                _nvSpace_parallel_for_items(space, _nvSoftBody_solve_self, &step, sb->count, _NV_SOFT_BODY_MIN_RANGE);
+                _nvSpace_parallel_for_items(space, _nvSoftBody_apply_deltas, &step, sb->count, _NV_SOFT_BODY_MIN_RANGE);
+            }
+
+            /*
+                Bodies that aren't pushed are solved last, so points squeezed against them don't end
+                the substep inside them and bounce out towards the pushed bodies.
+            */
+            for (size_t pass = 0; pass < 2; pass++) {
+                for (size_t j = 0; j < sb->_bodies->size; j++) {
+                    nvBody *body = sb->_bodies->data[j];
+                    if (_nvSoftBody_pushes(space, sb, body) != (pass == 0)) continue;
+
+                    _nvSoftBody_solve_body(space, &step, body);
+                }
+            }
+        }
+
+        _nvSpace_parallel_for_items(space, _nvSoftBody_finish, &step, sb->count, _NV_SOFT_BODY_MIN_RANGE);
+    }
+
+    NV_TRACY_ZONE_END;
+}
\ No newline at end of file
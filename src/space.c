@@ -21,6 +21,7 @@
 #include "novaphysics/narrowphase.h"
 #include "novaphysics/debug.h"
 #include "novaphysics/space_step.h"
+#include "novaphysics/recorder.h"
 
 
 /**
@@ -38,11 +39,16 @@ nvSpace *nvSpace_new() {
     space->awake_bodies = nvArray_new();
     space->attractors = nvArray_new();
     space->constraints = nvArray_new();
+    space->particle_systems = nvArray_new();
+    space->soft_bodies = nvArray_new();
+    space->articulations = nvArray_new();
 
     space->_removed_bodies = nvArray_new();
     space->_killed_bodies = nvArray_new();
 
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_RESOLUTIONS);
     space->res = nvHashMap_new(sizeof(nvResolution), 0, _nvSpace_resolution_hash);
+    NV_ALLOC_SCOPE_END;
 
     space->gravity = NV_VEC2(0.0, NV_GRAV_EARTH);
 
@@ -54,11 +60,26 @@ nvSpace *nvSpace_new() {
     space->warmstarting = true;
     space->collision_persistence = NV_COLLISION_PERSISTENCE;
     space->position_correction = nvPositionCorrection_BAUMGARTE;
+    space->presolve_reuse = nvPresolveReuse_NONE;
+    space->presolve_drift = (nvPresolveDrift){0};
+    space->shock_propagation_iters = 0;
 
     space->shg = NULL;
+    space->_shg_moving = nvArray_new();
+    space->_shg_dirty = nvArray_new();
+    space->_shg_drift = 0;
     nvSpace_set_broadphase(space, nvBroadPhaseAlg_SHG);
 
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_BROADPHASE);
     space->broadphase_pairs = nvHashMap_new(sizeof(nvBroadPhasePair), 0, _nvSpace_broadphase_pair_hash);
+    space->_pair_order = nvArray_new();
+    NV_ALLOC_SCOPE_END;
+
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_RESOLUTIONS);
+    space->_res_order = nvArray_new();
+    space->_position_solver = nvPositionSolver_new();
+    space->_shock_graph = nvShockGraph_new();
+    NV_ALLOC_SCOPE_END;
 
     space->kill_bounds = (nvAABB){-1e4, -1e4, 1e4, 1e4};
     space->use_kill_bounds = true;
@@ -71,19 +92,58 @@ nvSpace *nvSpace_new() {
     space->after_collision = NULL;
 
     nvProfiler_reset(&space->profiler);
+    space->profiler_hook = NULL;
+    space->profiler_hook_data = NULL;
+
+    space->tracer = NULL;
+    space->_trace_phase = nvProfilerPhase_STEP;
+
+    space->step_cost_model = nvStepCostModel_DEFAULT;
 
     space->multithreading = false;
     space->task_executor = NULL;
+    space->task_interface = (nvTaskInterface){0};
+    space->task_executor_settings = nvTaskExecutorSettings_DEFAULT;
+    space->parallel_body_threshold = NV_PARALLEL_BODY_THRESHOLD;
     space->mt_shg_bins = NULL;
     space->mt_shg_pairs = NULL;
     space->thread_count = 0;
 
+    space->capture_views = false;
+    space->_views[0] = NULL;
+    space->_views[1] = NULL;
+    space->_front_view = 0;
+    space->_step_count = 0;
+
+    space->_step_executor = NULL;
+    space->_async_running = false;
+
+    space->recorder = NULL;
+
     space->_id_counter = 0;
 
     return space;
 }
 
 void nvSpace_free(nvSpace *space) {
+    nvSpace_step_wait(space);
+
+    // Clearing the space below isn't a recorded mutation
+    if (space->recorder) {
+        space->recorder->space = NULL;
+        space->recorder = NULL;
+    }
+
+    if (space->_step_executor) {
+        nvTaskExecutor_close(space->_step_executor);
+        nvTaskExecutor_free(space->_step_executor);
+    }
+
+    nvSpaceView_free(space->_views[0]);
+    nvSpaceView_free(space->_views[1]);
+
+    nvSpace_disable_multithreading(space);
+
     nvSpace_clear(space);
     nvArray_free_each(space->bodies, nvBody_free);
     nvArray_free(space->bodies);
@@ -91,9 +151,22 @@ void nvSpace_free(nvSpace *space) {
     nvArray_free(space->attractors);
     nvArray_free_each(space->constraints, nvConstraint_free);
     nvArray_free(space->constraints);
+    nvArray_free(space->particle_systems);
+    nvArray_free(space->soft_bodies);
+    nvArray_free(space->articulations);
     nvHashMap_free(space->res);
-
-    free(space);
+    nvHashMap_free(space->broadphase_pairs);
+    nvArray_free(space->_pair_order);
+    nvArray_free(space->_res_order);
+    nvPositionSolver_free(space->_position_solver);
+    nvShockGraph_free(space->_shock_graph);
+    nvArray_free(space->_removed_bodies);
+    nvArray_free(space->_killed_bodies);
+    if (space->shg) nvSHG_free(space->shg);
+    nvArray_free(space->_shg_moving);
+    nvArray_free(space->_shg_dirty);
+
+    NV_FREE(space);
 }
 
 void nvSpace_set_broadphase(nvSpace *space, nvBroadPhaseAlg broadphase_alg_type) {
@@ -127,15 +200,46 @@ void nvSpace_set_SHG(
 ) {
     if (space->broadphase_algorithm == nvBroadPhaseAlg_SHG) {
         nvSHG_free(space->shg);
+
+        NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_BROADPHASE);
         space->shg = nvSHG_new(bounds, cell_width, cell_height);
+        NV_ALLOC_SCOPE_END;
+
+        // Bodies are inserted again into the new grid
+        nvArray_clear(space->_shg_moving, NULL);
+        nvArray_clear(space->_shg_dirty, NULL);
+        space->_shg_drift = 0;
+
+        for (size_t i = 0; i < space->bodies->size; i++) {
+            nvBody *body = (nvBody *)space->bodies->data[i];
+            body->_shg_placed = false;
+            body->_shg_parked = false;
+            body->_shg_dirty = true;
+            nvArray_add(space->_shg_dirty, body);
+        }
     }
 }
 
 void nvSpace_clear(nvSpace *space) {
+    if (space->recorder)
+        _nvRecorder_record_body(space->recorder, nvRecordEvent_CLEAR, NULL, NULL, 0);
+
+    if (space->shg) {
+        nvSHG_clear(space->shg);
+        nvSHG_clear_parked(space->shg);
+    }
+    nvArray_clear(space->_shg_moving, NULL);
+    nvArray_clear(space->_shg_dirty, NULL);
+    space->_shg_drift = 0;
+
+    // Articulations are detached from their bodies when freed
+    nvArray_clear(space->articulations, nvArticulation_free);
     nvArray_clear(space->bodies, nvBody_free);
     nvArray_clear(space->awake_bodies, NULL);
     nvArray_clear(space->attractors, NULL);
     nvArray_clear(space->constraints, nvConstraint_free);
+    nvArray_clear(space->particle_systems, nvParticleSystem_free);
+    nvArray_clear(space->soft_bodies, nvSoftBody_free);
     nvHashMap_clear(space->res);
 }
 
@@ -146,21 +250,144 @@ void nvSpace_add(nvSpace *space, nvBody *body) {
     body->space = space;
     body->id = space->_id_counter;
     space->_id_counter++;
+
+    // Placed in the SHG at the next broad-phase
+    body->_shg_dirty = true;
+    nvArray_add(space->_shg_dirty, body);
+
+    if (space->recorder) _nvRecorder_record_add(space->recorder, body);
 }
 
 void nvSpace_remove(nvSpace *space, nvBody *body) {
+    if (space->recorder)
+        _nvRecorder_record_body(space->recorder, nvRecordEvent_REMOVE_BODY, body, NULL, 0);
+
     nvArray_add(space->_removed_bodies, body);
 }
 
 void nvSpace_kill(nvSpace *space, nvBody *body) {
+    if (space->recorder)
+        _nvRecorder_record_body(space->recorder, nvRecordEvent_KILL_BODY, body, NULL, 0);
+
     nvArray_add(space->_killed_bodies, body);
 }
 
 void nvSpace_add_constraint(nvSpace *space, nvConstraint *cons) {
+    if (space->recorder) _nvRecorder_record_constraint(space->recorder, cons);
+
     nvArray_add(space->constraints, cons);
 }
 
-void nvSpace_step(
+void nvSpace_add_particles(nvSpace *space, nvParticleSystem *ps) {
+    NV_ASSERT(ps->space != space, "You can't add the same particle system to the same space multiple times.");
+
+    nvArray_add(space->particle_systems, ps);
+    ps->space = space;
+}
+
+void nvSpace_remove_particles(nvSpace *space, nvParticleSystem *ps) {
+    nvArray_remove(space->particle_systems, ps);
+    ps->space = NULL;
+}
+
+void nvSpace_add_soft_body(nvSpace *space, nvSoftBody *sb) {
+    NV_ASSERT(sb->space != space, "You can't add the same soft body to the same space multiple times.");
+
+    nvArray_add(space->soft_bodies, sb);
+    sb->space = space;
+}
+
+void nvSpace_remove_soft_body(nvSpace *space, nvSoftBody *sb) {
+    nvArray_remove(space->soft_bodies, sb);
+    sb->space = NULL;
+}
+
+void nvSpace_add_articulation(nvSpace *space, nvArticulation *art) {
+    NV_ASSERT(art->space != space, "You can't add the same articulation to the same space multiple times.");
+
+    nvArray_add(space->articulations, art);
+    art->space = space;
+    art->_active = false;
+}
+
+void nvSpace_remove_articulation(nvSpace *space, nvArticulation *art) {
+    nvArray_remove(space->articulations, art);
+    art->space = NULL;
+    art->_active = false;
+}
+
+/**
+ * @brief Remove a body from the SHG cells before it leaves the space.
+ */
+static void _nvSpace_remove_from_shg(nvSpace *space, nvBody *body) {
+    if (space->shg) {
+        if (body->_shg_placed) nvSHG_remove(space->shg, body, body->_shg_range);
+        if (body->_shg_parked) nvSHG_unpark(space->shg, body, body->_shg_range);
+    }
+
+    if (body->_shg_placed) nvArray_remove(space->_shg_moving, body);
+    if (body->_shg_dirty) nvArray_remove(space->_shg_dirty, body);
+
+    body->_shg_placed = false;
+    body->_shg_parked = false;
+    body->_shg_dirty = false;
+}
+
+/**
+ * @brief Take the impulses applied to articulation links back into the articulations.
+ */
+static void _nvSpace_solve_articulations(nvSpace *space) {
+    for (size_t i = 0; i < space->articulations->size; i++)
+        _nvArticulation_solve_velocities(space->articulations->data[i]);
+}
+
+/**
+ * @brief Take the position corrections of articulation links back into the articulations.
+ *
+ * The batched position solver only writes poses back when it finishes, so
+ * only the poses of the links are synced between iterations.
+ */
+static void _nvSpace_solve_articulation_positions(nvSpace *space, nvPositionSolver *solver) {
+    for (size_t i = 0; i < space->articulations->size; i++) {
+        nvArticulation *art = space->articulations->data[i];
+
+        for (size_t j = 0; j < art->count; j++)
+            nvPositionSolver_store_body(solver, art->links[j].body);
+
+        _nvArticulation_solve_positions(art);
+
+        for (size_t j = 0; j < art->count; j++)
+            nvPositionSolver_load_body(solver, art->links[j].body);
+    }
+}
+
+/**
+ * @brief Call a collision callback with the recorder attached.
+ *
+ * Mutations made in the callback are recorded with its index, so they are
+ * replayed at the same point of the step.
+ */
+static void _nvSpace_call_callback(
+    nvSpace *space,
+    nvSpace_callback callback,
+    nvRecorder *recorder,
+    size_t index
+) {
+    if (!recorder) {
+        callback(space, space->callback_user_data);
+        return;
+    }
+
+    space->recorder = recorder;
+    _nvRecorder_begin_callback(recorder, index);
+
+    callback(space, space->callback_user_data);
+
+    _nvRecorder_end_callback(recorder);
+    space->recorder = NULL;
+}
+
+static void _nvSpace_step(
     nvSpace *space,
     nv_float dt,
     size_t velocity_iters,
@@ -181,6 +408,9 @@ void nvSpace_step(
         8. Position correction (NGS)
         9. Rest bodies
 
+        Articulations are solved after integrating accelerations and follow
+        every solver iteration, integration and position correction.
+
 
         Nova Physics uses semi-implicit Euler integration:
 
@@ -193,13 +423,25 @@ void nvSpace_step(
         θ = ω * Δt
     */
 
+    nvRecorder *recorder = space->recorder;
+    if (recorder)
+        _nvRecorder_record_step(recorder, dt, velocity_iters, position_iters, constraint_iters, substeps);
+
     if (dt == 0.0 || substeps <= 0) return;
 
     NV_TRACY_ZONE_START;
 
+    // Mutations made by the step itself aren't recorded, only the ones made in callbacks
+    space->recorder = NULL;
+
     nvPrecisionTimer step_timer;
+    NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_STEP);
     NV_PROFILER_START(step_timer);
 
+    #ifdef NV_PROFILE
+        nvProfiler_reset_workers(&space->profiler);
+    #endif
+
     nvPrecisionTimer timer;
 
     size_t i, j, k, l;
@@ -208,13 +450,25 @@ void nvSpace_step(
     dt /= (nv_float)substeps;
     nv_float inv_dt = 1.0 / dt;
 
+    _nvSpace_begin_sim_tiers(space);
+
+    space->presolve_drift = (nvPresolveDrift){0};
+
     for (k = 0; k < substeps; k++) {
 
+        // Articulations are awake as a whole
+        for (i = 0; i < space->articulations->size; i++)
+            _nvArticulation_wake(space->articulations->data[i]);
+
         // TODO: Instead of clearing and filling this array every frame, update it when individual bodies are slept & awaken
         nvArray_clear(space->awake_bodies, NULL);
         for (i = 0; i < space->bodies->size; i++) {
             nvBody *body = space->bodies->data[i];
 
+            // Bodies in slower tiers idle in steps they aren't simulated in
+            if (space->_multirate && !body->_sim_active && body->type != nvBodyType_STATIC)
+                continue;
+
             if (!body->is_sleeping) {
                 nvArray_add(space->awake_bodies, body);
             }
@@ -225,13 +479,22 @@ void nvSpace_step(
             -----------------------
             Apply forces, gravity, integrate accelerations (update velocities) and apply damping.
         */
+        NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_INTEGRATE_ACCELERATIONS);
         NV_PROFILER_START(timer);
         #if defined(NV_AVX) && defined(NV_USE_SIMD)
 
-            _nvSpace_integrate_accelerations_AVX(
-                space,
-                dt
-            );
+            // Bodies simulated at different rates have their own time steps
+            if (space->_multirate) {
+                for (i = 0; i < space->awake_bodies->size; i++) {
+                    _nvSpace_integrate_accelerations(space, dt, i);
+                }
+            }
+            else {
+                _nvSpace_integrate_accelerations_AVX(
+                    space,
+                    dt
+                );
+            }
 
         #else
 
@@ -241,12 +504,30 @@ void nvSpace_step(
 
         #endif
         NV_PROFILER_STOP(timer, space->profiler.integrate_accelerations);
+        NV_PROFILER_PHASE_END(space, nvProfilerPhase_INTEGRATE_ACCELERATIONS);
+
+        /*
+            Solve articulations
+            -------------------
+            Turn forces on the articulation links into joint accelerations.
+        */
+        if (space->articulations->size > 0) {
+            NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_SOLVE_ARTICULATIONS);
+            NV_PROFILER_START(timer);
+            for (i = 0; i < space->articulations->size; i++) {
+                _nvArticulation_integrate_accelerations(space, space->articulations->data[i], dt);
+            }
+            NV_PROFILER_STOP(timer, space->profiler.solve_articulations);
+            NV_PROFILER_PHASE_END(space, nvProfilerPhase_SOLVE_ARTICULATIONS);
+        }
 
         /*
             Broad-phase
             -----------
             Generate possible collision pairs with the choosen broad-phase algorithm.
         */
+        NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_BROADPHASE);
+        NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_BROADPHASE);
         NV_PROFILER_START(timer);
         switch (space->broadphase_algorithm) {
             case nvBroadPhaseAlg_BRUTE_FORCE:
@@ -254,7 +535,7 @@ void nvSpace_step(
                 break;
 
             case nvBroadPhaseAlg_SHG:
-                if (space->multithreading)
+                if (_nvSpace_is_parallel(space))
                     nvBroadPhase_SHG_parallel(space);
 
                 else
@@ -268,7 +549,7 @@ void nvSpace_step(
         }
 
         // Combine separate pairs from parallel broadphase into one
-        if (space->multithreading) {
+        if (_nvSpace_is_parallel(space) && space->broadphase_algorithm == nvBroadPhaseAlg_SHG) {
             nvHashMap_clear(space->broadphase_pairs);
 
             for (i = 0; i < space->thread_count; i++) {
@@ -279,7 +560,12 @@ void nvSpace_step(
                 }
             }
         }
+
+        _nvSpace_pull_in_broadphase_pairs(space);
+
         NV_PROFILER_STOP(timer, space->profiler.broadphase);
+        NV_PROFILER_PHASE_END(space, nvProfilerPhase_BROADPHASE);
+        NV_ALLOC_SCOPE_END;
 
         /*
             Update resolutions
@@ -287,12 +573,17 @@ void nvSpace_step(
             Update the collision resolutions from last frame for collision persistence.
         */
         l = 0;
+        NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_RESOLUTIONS);
+        NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_UPDATE_RESOLUTIONS);
         NV_PROFILER_START(timer);
         while (nvHashMap_iter(space->res, &l, &map_val)) {
             nvResolution *res = (nvResolution *)map_val;
             nvBody *a = res->a;
             nvBody *b = res->b;
 
+            // Contacts of idle bodies are kept as they are until the bodies are simulated again
+            if (!_nvSpace_is_pair_simulated(space, a, b)) continue;
+
             nvBody *pair_a, *pair_b;
             if (a->id < b->id) {
                 pair_a = a;
@@ -328,6 +619,7 @@ void nvSpace_step(
             }
         }
         NV_PROFILER_STOP(timer, space->profiler.update_resolutions);
+        NV_PROFILER_PHASE_END(space, nvProfilerPhase_UPDATE_RESOLUTIONS);
 
         /*
             Narrow-phase
@@ -335,9 +627,11 @@ void nvSpace_step(
             Do narrow-phase checks between possible collision pairs and
             update collision resolutions.
         */
+        NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_NARROWPHASE);
         NV_PROFILER_START(timer);
         nv_narrow_phase(space);
         NV_PROFILER_STOP(timer, space->profiler.narrowphase);
+        NV_PROFILER_PHASE_END(space, nvProfilerPhase_NARROWPHASE);
 
         /*
             PGS / Projected Gauss-Seidel
@@ -347,41 +641,79 @@ void nvSpace_step(
 
         // Call callback before resolving collisions
         if (space->before_collision != NULL)
-            space->before_collision(space, space->callback_user_data);
+            _nvSpace_call_callback(space, space->before_collision, recorder, k * 2);
 
-        // Prepare for solving contact constraints
-        l = 0;
+        /*
+            Contacts are solved in a fixed order sorted by body IDs. Hash map
+            layout depends on insertion history, which depends on how the
+            broad-phase was split between threads.
+        */
+        NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_PRESOLVE_COLLISIONS);
         NV_PROFILER_START(timer);
-        while (nvHashMap_iter(space->res, &l, &map_val)) {
-            nvResolution *res = map_val;
-            if (res->state == nvResolutionState_CACHED) continue;
-            nv_presolve_contact(space, res, inv_dt);
+        _nvSpace_sort_resolutions(space);
+        nvArray *res_order = space->_res_order;
+
+        // Prepare for solving contact constraints
+        for (i = 0; i < res_order->size; i++) {
+            nvResolution *res = res_order->data[i];
+            nv_presolve_contact(space, res, _nvSpace_pair_inv_dt(space, res->a, res->b, inv_dt));
         }
 
         // Apply accumulated impulses
-        l = 0;
-        while (nvHashMap_iter(space->res, &l, &map_val)) {
-            nvResolution *res = map_val;
-            if (res->state == nvResolutionState_CACHED) continue;
+        for (i = 0; i < res_order->size; i++) {
+            nvResolution *res = res_order->data[i];
             nv_warmstart(space, res);
         }
         NV_PROFILER_STOP(timer, space->profiler.presolve_collisions);
+        NV_PROFILER_PHASE_END(space, nvProfilerPhase_PRESOLVE_COLLISIONS);
+        NV_ALLOC_SCOPE_END;
 
         // Solve velocity constraints iteratively
+        NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_SOLVE_VELOCITIES);
         NV_PROFILER_START(timer);
-        for (i = 0; i < velocity_iters; i++) {
-            l = 0;
-            while (nvHashMap_iter(space->res, &l, &map_val)) {
-                nvResolution *res = map_val;
-                if (res->state == nvResolutionState_CACHED) continue;
-                nv_solve_velocity(res);
+
+        bool shock = false;
+        if (space->shock_propagation_iters > 0 && velocity_iters > 0) {
+            NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_RESOLUTIONS);
+            shock = nvShockGraph_build(space->_shock_graph, res_order, space->gravity);
+            NV_ALLOC_SCOPE_END;
+        }
+
+        if (shock) {
+            nvShockGraph *graph = space->_shock_graph;
+
+            size_t shock_iters = space->shock_propagation_iters;
+            if (shock_iters > velocity_iters) shock_iters = velocity_iters;
+
+            // Contacts are solved from the bottom up, lower bodies are fixed in the last iterations
+            for (i = 0; i < velocity_iters; i++) {
+                bool propagate = i + shock_iters >= velocity_iters;
+
+                // Impulses of shock propagation iterations aren't warm-started
+                for (j = 0; j < graph->count; j++) {
+                    if (propagate) nv_solve_velocity_shock(graph->order[j], graph->fixed[j]);
+                    else nv_solve_velocity(graph->order[j]);
+                }
+
+                _nvSpace_solve_articulations(space);
+            }
+        }
+        else {
+            for (i = 0; i < velocity_iters; i++) {
+                for (j = 0; j < res_order->size; j++) {
+                    nvResolution *res = res_order->data[j];
+                    nv_solve_velocity(res);
+                }
+
+                _nvSpace_solve_articulations(space);
             }
         }
         NV_PROFILER_STOP(timer, space->profiler.solve_velocities);
+        NV_PROFILER_PHASE_END(space, nvProfilerPhase_SOLVE_VELOCITIES);
 
         // Call callback after resolving collisions
         if (space->after_collision != NULL)
-            space->after_collision(space, space->callback_user_data);
+            _nvSpace_call_callback(space, space->after_collision, recorder, k * 2 + 1);
 
         /*
             Solve joint constraints (Baumgarte)
@@ -390,37 +722,51 @@ void nvSpace_step(
         */
 
         // Prepare joint constraints for solving
+        NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_PRESOLVE_CONSTRAINTS);
         NV_PROFILER_START(timer);
         for (i = 0; i < space->constraints->size; i++) {
-            nvConstraint_presolve(
-                space,
-                (nvConstraint *)space->constraints->data[i],
-                inv_dt
-            );
+            nvConstraint *cons = (nvConstraint *)space->constraints->data[i];
+            if (!_nvSpace_is_pair_simulated(space, cons->a, cons->b)) continue;
+
+            nvConstraint_presolve(space, cons, _nvSpace_pair_inv_dt(space, cons->a, cons->b, inv_dt));
         }
         NV_PROFILER_STOP(timer, space->profiler.presolve_constraints);
+        NV_PROFILER_PHASE_END(space, nvProfilerPhase_PRESOLVE_CONSTRAINTS);
 
         // Solve joint constraints iteratively
+        NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_SOLVE_CONSTRAINTS);
         NV_PROFILER_START(timer);
         for (i = 0; i < constraint_iters; i++) {
             for (j = 0; j < space->constraints->size; j++) {
-                nvConstraint_solve(
-                    (nvConstraint *)space->constraints->data[j],
-                    inv_dt
-                );
+                nvConstraint *cons = (nvConstraint *)space->constraints->data[j];
+                if (!_nvSpace_is_pair_simulated(space, cons->a, cons->b)) continue;
+
+                nvConstraint_solve(cons, _nvSpace_pair_inv_dt(space, cons->a, cons->b, inv_dt));
             }
+
+            if (space->constraints->size > 0) _nvSpace_solve_articulations(space);
         }
         NV_PROFILER_STOP(timer, space->profiler.solve_constraints);
+        NV_PROFILER_PHASE_END(space, nvProfilerPhase_SOLVE_CONSTRAINTS);
 
         /*
             Integrate velocities
             --------------------
             Integrate velocities (update positions) and check out-of-bound bodies.
         */
+        NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_INTEGRATE_VELOCITIES);
         NV_PROFILER_START(timer);
         #if defined(NV_AVX) && defined(NV_USE_SIMD)
 
-            _nvSpace_integrate_velocities_AVX(space, dt);
+            // Bodies simulated at different rates have their own time steps
+            if (space->_multirate) {
+                for (i = 0; i < space->awake_bodies->size; i++) {
+                    _nvSpace_integrate_velocities(space, dt, i);
+                }
+            }
+            else {
+                _nvSpace_integrate_velocities_AVX(space, dt);
+            }
 
         #else
 
@@ -429,25 +775,87 @@ void nvSpace_step(
             }
 
         #endif
+
+        for (i = 0; i < space->articulations->size; i++)
+            _nvArticulation_integrate_velocities(space->articulations->data[i]);
+
         NV_PROFILER_STOP(timer, space->profiler.integrate_velocities);
+        NV_PROFILER_PHASE_END(space, nvProfilerPhase_INTEGRATE_VELOCITIES);
 
         /*
             NGS / Non-Linear Gauss-Seidel
             -----------------------------
             Solve position error with pseudo-velocities.
         */
+        NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_SOLVE_POSITIONS);
         NV_PROFILER_START(timer);
-        if (space->position_correction == nvPositionCorrection_NGS) {
-            for (i = 0; i < position_iters; i++) {
-                l = 0;
-                while (nvHashMap_iter(space->res, &l, &map_val)) {
-                    nvResolution *res = map_val;
-                    if (res->state == nvResolutionState_CACHED) continue;
-                    nv_solve_position(res);
+        if (space->position_correction == nvPositionCorrection_NGS && position_iters > 0) {
+            nvPositionSolver *solver = space->_position_solver;
+
+            NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_RESOLUTIONS);
+            bool prepared = nvPositionSolver_prepare(solver, res_order);
+            NV_ALLOC_SCOPE_END;
+
+            if (prepared) {
+                for (i = 0; i < position_iters; i++) {
+                    nvPositionSolver_solve(space, solver);
+
+                    if (space->articulations->size > 0)
+                        _nvSpace_solve_articulation_positions(space, solver);
+                }
+
+                nvPositionSolver_finish(solver);
+            }
+
+            // Solve contacts one by one if the solver couldn't allocate its buffers
+            else {
+                for (i = 0; i < position_iters; i++) {
+                    for (j = 0; j < res_order->size; j++) {
+                        nvResolution *res = res_order->data[j];
+                        nv_solve_position(res);
+                    }
+
+                    for (j = 0; j < space->articulations->size; j++)
+                        _nvArticulation_solve_positions(space->articulations->data[j]);
                 }
             }
         }
         NV_PROFILER_STOP(timer, space->profiler.solve_positions);
+        NV_PROFILER_PHASE_END(space, nvProfilerPhase_SOLVE_POSITIONS);
+
+        // Queries read the cells bodies moved into since the broad-phase
+        if (space->broadphase_algorithm == nvBroadPhaseAlg_SHG)
+            nvBroadPhase_SHG_measure_drift(space);
+
+        /*
+            Step particles
+            --------------
+            Move particles and push them out of each other and the bodies.
+        */
+        if (space->particle_systems->size > 0) {
+            NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_STEP_PARTICLES);
+            NV_PROFILER_START(timer);
+            for (i = 0; i < space->particle_systems->size; i++) {
+                nvParticleSystem_step(space, space->particle_systems->data[i], dt);
+            }
+            NV_PROFILER_STOP(timer, space->profiler.step_particles);
+            NV_PROFILER_PHASE_END(space, nvProfilerPhase_STEP_PARTICLES);
+        }
+
+        /*
+            Step soft bodies
+            ----------------
+            Solve the links of soft bodies and push them out of the bodies.
+        */
+        if (space->soft_bodies->size > 0) {
+            NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_STEP_SOFT_BODIES);
+            NV_PROFILER_START(timer);
+            for (i = 0; i < space->soft_bodies->size; i++) {
+                nvSoftBody_step(space, space->soft_bodies->data[i], dt);
+            }
+            NV_PROFILER_STOP(timer, space->profiler.step_soft_bodies);
+            NV_PROFILER_PHASE_END(space, nvProfilerPhase_STEP_SOFT_BODIES);
+        }
 
         /*
             Rest bodies
@@ -457,6 +865,7 @@ void nvSpace_step(
         if (space->sleeping) {
             for (i = 0; i < space->bodies->size; i++) {
                 nvBody *body = (nvBody *)space->bodies->data[i];
+                if (space->_multirate && !body->_sim_active) continue;
 
                 nv_float linear = nvVector2_len2(body->linear_velocity) * dt;
                 nv_float angular = body->angular_velocity * dt;
@@ -465,7 +874,10 @@ void nvSpace_step(
                 if (total_energy <= space->sleep_energy_threshold / substeps) {
                     body->sleep_timer++;
 
-                    if (body->sleep_timer > space->sleep_timer_threshold * substeps) {
+                    // Links of articulations in the space sleep together below
+                    bool linked = body->articulation && body->articulation->space == space;
+
+                    if (body->sleep_timer > space->sleep_timer_threshold * substeps && !linked) {
                         nvBody_sleep(body);
                         body->sleep_timer = 0;
                     }
@@ -474,16 +886,24 @@ void nvSpace_step(
                     if (body->sleep_timer > 0) body->sleep_timer--;
                 }
             }
+
+            for (i = 0; i < space->articulations->size; i++)
+                _nvArticulation_rest(space->articulations->data[i], space->sleep_timer_threshold * substeps);
         }
     }
 
+    _nvSpace_end_sim_tiers(space);
+
     // Actually remove all killed & removed bodies from the arrays
 
+    NV_PROFILER_PHASE_BEGIN(space, nvProfilerPhase_REMOVE_BODIES);
     NV_PROFILER_START(timer);
 
     for (i = 0; i < space->_removed_bodies->size; i++) {
         nvBody *body = (nvBody *)space->_removed_bodies->data[i];
 
+        if (body->articulation) _nvArticulation_detach(body->articulation);
+
         l = 0;
         while (nvHashMap_iter(space->res, &l, &map_val)) {
             nvResolution *res = map_val;
@@ -497,12 +917,15 @@ void nvSpace_step(
             }
         }
 
+        _nvSpace_remove_from_shg(space, body);
         nvArray_remove(space->bodies, body);
     }
 
     for (i = 0; i < space->_killed_bodies->size; i++) {
         nvBody *body = (nvBody *)space->_killed_bodies->data[i];
 
+        if (body->articulation) _nvArticulation_detach(body->articulation);
+
         l = 0;
         while (nvHashMap_iter(space->res, &l, &map_val)) {
             nvResolution *res = map_val;
@@ -516,6 +939,7 @@ void nvSpace_step(
             }
         }
 
+        _nvSpace_remove_from_shg(space, body);
         nvArray_remove(space->bodies, body);
         nvBody_free(body);
     }
@@ -524,12 +948,138 @@ void nvSpace_step(
     nvArray_clear(space->_killed_bodies, NULL);
 
     NV_PROFILER_STOP(timer, space->profiler.remove_bodies);
+    NV_PROFILER_PHASE_END(space, nvProfilerPhase_REMOVE_BODIES);
+
+    space->_step_count++;
+
+    // Capture body states into the back view, it is published when the step is finished
+    if (space->capture_views) {
+        nv_uint8 back = 1 - space->_front_view;
+
+        if (!space->_views[back])
+            space->_views[back] = nvSpaceView_new();
+
+        if (space->_views[back])
+            nvSpaceView_capture(space->_views[back], space->bodies, space->_step_count);
+    }
+
     NV_PROFILER_STOP(step_timer, space->profiler.step);
+    NV_PROFILER_PHASE_END(space, nvProfilerPhase_STEP);
+
+    space->recorder = recorder;
 
     NV_TRACY_ZONE_END;
     NV_TRACY_FRAMEMARK;
 }
 
+/**
+ * @brief Swap the views if the back view has a newer capture.
+ */
+static void _nvSpace_publish_view(nvSpace *space) {
+    nv_uint8 back = 1 - space->_front_view;
+    nvSpaceView *front_view = space->_views[space->_front_view];
+    nvSpaceView *back_view = space->_views[back];
+
+    if (!back_view) return;
+
+    if (!front_view || back_view->step > front_view->step)
+        space->_front_view = back;
+}
+
+static int _nvSpace_step_task(void *data) {
+    nvSpaceStepArgs *args = (nvSpaceStepArgs *)data;
+
+    _nvSpace_step(
+        args->space,
+        args->dt,
+        args->velocity_iters,
+        args->position_iters,
+        args->constraint_iters,
+        args->substeps
+    );
+
+    return 0;
+}
+
+void nvSpace_step(
+    nvSpace *space,
+    nv_float dt,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+) {
+    NV_ASSERT(!space->_async_running, "You can't step the space while an asynchronous step is running.");
+
+    _nvSpace_step(space, dt, velocity_iters, position_iters, constraint_iters, substeps);
+
+    _nvSpace_publish_view(space);
+}
+
+void nvSpace_step_async(
+    nvSpace *space,
+    nv_float dt,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+) {
+    NV_ASSERT(!space->_async_running, "You can't start an asynchronous step while another one is running.");
+
+    space->capture_views = true;
+
+    // The step thread is created once and reused for all asynchronous steps
+    if (!space->_step_executor) {
+        NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_THREADING);
+        space->_step_executor = nvTaskExecutor_new(1);
+        NV_ALLOC_SCOPE_END;
+        NV_ASSERT(space->_step_executor != NULL, "Failed to create the asynchronous step thread.");
+    }
+
+    space->_async_args = (nvSpaceStepArgs){
+        .space = space,
+        .dt = dt,
+        .velocity_iters = velocity_iters,
+        .position_iters = position_iters,
+        .constraint_iters = constraint_iters,
+        .substeps = substeps
+    };
+
+    space->_async_running = nvTaskExecutor_add_task_to(
+        space->_step_executor,
+        _nvSpace_step_task,
+        &space->_async_args,
+        0
+    );
+
+    // Fall back to stepping on the caller thread
+    if (!space->_async_running)
+        nvSpace_step(space, dt, velocity_iters, position_iters, constraint_iters, substeps);
+}
+
+void nvSpace_step_wait(nvSpace *space) {
+    if (!space->_async_running) return;
+
+    nvTaskExecutor_wait_tasks(space->_step_executor);
+    space->_async_running = false;
+
+    _nvSpace_publish_view(space);
+}
+
+const nvSpaceView *nvSpace_get_view(nvSpace *space) {
+    if (!space->capture_views) return NULL;
+
+    nvSpaceView *view = space->_views[space->_front_view];
+
+    // Nothing is captured yet
+    if (!view) {
+        view = nvSpaceView_new();
+        space->_views[space->_front_view] = view;
+    }
+
+    return view;
+}
+
 void nvSpace_enable_sleeping(nvSpace *space) {
     space->sleeping = true;
 }
@@ -540,13 +1090,48 @@ void nvSpace_disable_sleeping(nvSpace *space) {
         nvBody_awake((nvBody *)space->bodies->data[i]);
 }
 
-void nvSpace_enable_multithreading(nvSpace *space, size_t threads) {
-    if (space->multithreading) return;
+void nvSpace_set_sim_tier_region(nvSpace *space, nvAABB region, nv_uint8 tier) {
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = (nvBody *)space->bodies->data[i];
+        if (body->type == nvBodyType_STATIC) continue;
 
-    size_t thread_count = (threads == 0) ? nv_get_cpu_count() : threads;
+        if (body->sim_tier != tier && nv_collide_aabb_x_point(region, body->position))
+            nvBody_set_sim_tier(body, tier);
+    }
+}
+
+void nvSpace_set_sim_tiers_by_distance(
+    nvSpace *space,
+    nvVector2 *points,
+    size_t count,
+    nv_float radius
+) {
+    if (count == 0) return;
+
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = (nvBody *)space->bodies->data[i];
+        if (body->type == nvBodyType_STATIC) continue;
+
+        nv_float nearest = nvVector2_dist2(body->position, points[0]);
+        for (size_t j = 1; j < count; j++)
+            nearest = nv_fmin(nearest, nvVector2_dist2(body->position, points[j]));
+
+        // Squared radius of each ring is 4 times the previous one
+        nv_uint8 tier = 0;
+        nv_float ring = radius * radius;
+        while (tier < NV_SIM_TIERS - 1 && nearest > ring) {
+            tier++;
+            ring *= 4.0;
+        }
+
+        if (tier != body->sim_tier) nvBody_set_sim_tier(body, tier);
+    }
+}
+
+static void _nvSpace_init_multithreading(nvSpace *space, size_t thread_count) {
     space->thread_count = thread_count;
 
-    space->task_executor = nvTaskExecutor_new(thread_count);
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_THREADING);
 
     space->mt_shg_bins = nvArray_new();
     space->mt_shg_pairs = nvArray_new();
@@ -559,26 +1144,62 @@ void nvSpace_enable_multithreading(nvSpace *space, size_t threads) {
         nvArray_add(space->mt_shg_bins, nvArray_new());
     }
 
+    NV_ALLOC_SCOPE_END;
+
     space->multithreading = true;
+}
 
-    // Busy wait until all the task executor threads are initialized
-    for (size_t i = 0; i < space->task_executor->threads->size; i++) {
-        nvTaskExecutorData *data = space->task_executor->data->data[i];
+void nvSpace_enable_multithreading(nvSpace *space, size_t threads) {
+    if (space->multithreading) return;
 
-        while (!data->is_active) {}
-    }
+    size_t thread_count = (threads == 0) ? nv_get_cpu_count() : threads;
+
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_THREADING);
+    space->task_executor = nvTaskExecutor_new_with_settings(
+        thread_count,
+        space->task_executor_settings
+    );
+    NV_ALLOC_SCOPE_END;
+    space->task_interface = nvTaskExecutor_get_interface(space->task_executor);
+
+    _nvSpace_init_multithreading(space, thread_count);
+}
+
+void nvSpace_set_task_interface(nvSpace *space, nvTaskInterface task_interface) {
+    NV_ASSERT(task_interface.enqueue_range, "Task interface has no enqueue_range callback.");
+    NV_ASSERT(task_interface.wait_group, "Task interface has no wait_group callback.");
+
+    nvSpace_disable_multithreading(space);
+
+    space->task_interface = task_interface;
+
+    _nvSpace_init_multithreading(space, task_interface.worker_count ? task_interface.worker_count : 1);
+}
+
+void nvSpace_set_profiler_hook(nvSpace *space, nvProfilerHook hook, void *user_data) {
+    space->profiler_hook = hook;
+    space->profiler_hook_data = user_data;
+}
+
+void nvSpace_set_tracer(nvSpace *space, nvTracer *tracer) {
+    nvSpace_step_wait(space);
+    space->tracer = tracer;
 }
 
 void nvSpace_disable_multithreading(nvSpace *space) {
     if (!space->multithreading) return;
 
-    nvTaskExecutor_close(space->task_executor);
-    nvTaskExecutor_free(space->task_executor);
-    space->task_executor = NULL;
+    if (space->task_executor) {
+        nvTaskExecutor_close(space->task_executor);
+        nvTaskExecutor_free(space->task_executor);
+        space->task_executor = NULL;
+    }
+
+    space->task_interface = (nvTaskInterface){0};
 
     for (size_t i = 0; i < space->thread_count; i++) {
-        nvHashMap_clear(space->mt_shg_pairs->data[i]);
-        nvArray_clear(space->mt_shg_bins->data[i], NULL);
+        nvHashMap_free(space->mt_shg_pairs->data[i]);
+        nvArray_free(space->mt_shg_bins->data[i]);
     }
     nvArray_free(space->mt_shg_bins);
     nvArray_free(space->mt_shg_pairs);
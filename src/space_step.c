@@ -8,6 +8,7 @@
 
 */
 
+#include <stdlib.h>
 #include "novaphysics/internal.h"
 #include "novaphysics/space_step.h"
 #include "novaphysics/space.h"
@@ -31,6 +32,397 @@ nv_uint64 _nvSpace_broadphase_pair_hash(void *item) {
 }
 
 
+/*
+    Sort key of a body pair, independent of the order bodies are given in.
+    IDs are 16-bit so the key is unique for every pair.
+*/
+static inline nv_uint32 _nvSpace_pair_key(nvBody *a, nvBody *b) {
+    nv_uint16 min_id = (a->id < b->id) ? a->id : b->id;
+    nv_uint16 max_id = (a->id < b->id) ? b->id : a->id;
+    return ((nv_uint32)min_id << 16) | (nv_uint32)max_id;
+}
+
+static int _nvSpace_pair_cmp(const void *x, const void *y) {
+    nvBroadPhasePair *pair_x = *(nvBroadPhasePair **)x;
+    nvBroadPhasePair *pair_y = *(nvBroadPhasePair **)y;
+    nv_uint32 key_x = _nvSpace_pair_key(pair_x->a, pair_x->b);
+    nv_uint32 key_y = _nvSpace_pair_key(pair_y->a, pair_y->b);
+    return (key_x > key_y) - (key_x < key_y);
+}
+
+static int _nvSpace_resolution_cmp(const void *x, const void *y) {
+    nvResolution *res_x = *(nvResolution **)x;
+    nvResolution *res_y = *(nvResolution **)y;
+    nv_uint32 key_x = _nvSpace_pair_key(res_x->a, res_x->b);
+    nv_uint32 key_y = _nvSpace_pair_key(res_y->a, res_y->b);
+    return (key_x > key_y) - (key_x < key_y);
+}
+
+void _nvSpace_sort_pairs(nvSpace *space) {
+    nvArray *order = space->_pair_order;
+    nvArray_clear(order, NULL);
+
+    void *map_val;
+    size_t l = 0;
+    while (nvHashMap_iter(space->broadphase_pairs, &l, &map_val))
+        nvArray_add(order, map_val);
+
+    qsort(order->data, order->size, sizeof(void *), _nvSpace_pair_cmp);
+}
+
+void _nvSpace_sort_resolutions(nvSpace *space) {
+    nvArray *order = space->_res_order;
+    nvArray_clear(order, NULL);
+
+    void *map_val;
+    size_t l = 0;
+    while (nvHashMap_iter(space->res, &l, &map_val)) {
+        nvResolution *res = map_val;
+        if (res->state == nvResolutionState_CACHED) continue;
+        if (!_nvSpace_is_pair_simulated(space, res->a, res->b)) continue;
+        nvArray_add(order, res);
+    }
+
+    qsort(order->data, order->size, sizeof(void *), _nvSpace_resolution_cmp);
+}
+
+
+#ifdef NV_PROFILE
+
+    /**
+     * @brief Per-range timings of one parallel-for.
+     */
+    typedef struct {
+        nvParallelForCallback callback;
+        void *data;
+        nv_uint32 count;
+        size_t starts[NV_PROFILER_MAX_WORKERS];
+        double times[NV_PROFILER_MAX_WORKERS];
+    } _nvParallelForTiming;
+
+    static void _nvSpace_timed_range(void *data, size_t start, size_t end) {
+        _nvParallelForTiming *timing = (_nvParallelForTiming *)data;
+
+        nvPrecisionTimer timer;
+        NV_PROFILER_START(timer);
+
+        timing->callback(timing->data, start, end);
+
+        double elapsed = nvPrecisionTimer_stop(&timer);
+
+        // Every range gets its own slot, they are summed after the group is finished
+        nv_uint32 slot = nv_atomic_add(&timing->count, 1) - 1;
+        if (slot < NV_PROFILER_MAX_WORKERS) {
+            timing->starts[slot] = start;
+            timing->times[slot] = elapsed;
+        }
+    }
+
+#endif
+
+#ifdef NV_TRACK_ALLOCATIONS
+
+    /**
+     * @brief Parallel-for callback tagged with the allocation category of the caller.
+     */
+    typedef struct {
+        nvParallelForCallback callback;
+        void *data;
+        nvAllocCategory category;
+    } _nvParallelForCategory;
+
+    static void _nvSpace_categorized_range(void *data, size_t start, size_t end) {
+        _nvParallelForCategory *categorized = (_nvParallelForCategory *)data;
+
+        NV_ALLOC_SCOPE_BEGIN(categorized->category);
+        categorized->callback(categorized->data, start, end);
+        NV_ALLOC_SCOPE_END;
+    }
+
+#endif
+
+/**
+ * @brief Parallel-for callback recorded to a tracer.
+ */
+typedef struct {
+    nvParallelForCallback callback;
+    void *data;
+    nvTracer *tracer;
+    const char *name;
+} _nvParallelForTrace;
+
+static void _nvSpace_traced_range(void *data, size_t start, size_t end) {
+    _nvParallelForTrace *trace = (_nvParallelForTrace *)data;
+
+    nv_uint64 begin = nvTracer_now();
+    trace->callback(trace->data, start, end);
+    nvTracer_record(trace->tracer, trace->name, begin, nvTracer_now(), (nv_uint32)(end - start));
+}
+
+bool _nvSpace_is_parallel(nvSpace *space) {
+    return space->multithreading && space->bodies->size >= space->parallel_body_threshold;
+}
+
+/**
+ * @brief Run a parallel-for on the task interface, with tracing and profiling.
+ */
+static void _nvSpace_dispatch_parallel_for(
+    nvSpace *space,
+    nvParallelForCallback callback,
+    void *data,
+    size_t count,
+    size_t min_range
+) {
+    nvTaskInterface *iface = &space->task_interface;
+
+    #ifdef NV_TRACK_ALLOCATIONS
+        // Workers allocate on behalf of the phase that started them
+        _nvParallelForCategory categorized = {
+            .callback = callback,
+            .data = data,
+            .category = _nv_alloc_current_category()
+        };
+        callback = _nvSpace_categorized_range;
+        data = &categorized;
+    #endif
+
+    _nvParallelForTrace trace;
+    if (space->tracer) {
+        trace = (_nvParallelForTrace){
+            .callback = callback,
+            .data = data,
+            .tracer = space->tracer,
+            .name = nvProfilerPhase_name(space->_trace_phase)
+        };
+        callback = _nvSpace_traced_range;
+        data = &trace;
+    }
+
+    #ifdef NV_PROFILE
+
+        nvPrecisionTimer timer;
+        NV_PROFILER_START(timer);
+
+        _nvParallelForTiming timing = {
+            .callback = callback,
+            .data = data,
+            .count = 0
+        };
+
+        void *group = iface->enqueue_range(_nvSpace_timed_range, &timing, count, min_range, iface->context);
+        iface->wait_group(group, iface->context);
+
+        space->profiler.parallel_wall += nvPrecisionTimer_stop(&timer);
+
+        // Ranges finish in any order, order them by their position in the items
+        size_t range_count = timing.count;
+        if (range_count > NV_PROFILER_MAX_WORKERS) range_count = NV_PROFILER_MAX_WORKERS;
+
+        for (size_t i = 1; i < range_count; i++) {
+            size_t start = timing.starts[i];
+            double elapsed = timing.times[i];
+            size_t j = i;
+
+            for (; j > 0 && timing.starts[j - 1] > start; j--) {
+                timing.starts[j] = timing.starts[j - 1];
+                timing.times[j] = timing.times[j - 1];
+            }
+
+            timing.starts[j] = start;
+            timing.times[j] = elapsed;
+        }
+
+        for (size_t i = 0; i < range_count; i++) {
+            space->profiler.worker_times[i] += timing.times[i];
+            space->profiler.parallel_work += timing.times[i];
+        }
+
+        if (range_count > space->profiler.worker_count)
+            space->profiler.worker_count = range_count;
+
+    #else
+
+        void *group = iface->enqueue_range(callback, data, count, min_range, iface->context);
+        iface->wait_group(group, iface->context);
+
+    #endif
+}
+
+void _nvSpace_parallel_for(
+    nvSpace *space,
+    nvParallelForCallback callback,
+    void *data,
+    size_t count,
+    size_t min_range
+) {
+    if (count == 0) return;
+
+    if (!_nvSpace_is_parallel(space)) {
+        callback(data, 0, count);
+        return;
+    }
+
+    _nvSpace_dispatch_parallel_for(space, callback, data, count, min_range);
+}
+
+void _nvSpace_parallel_for_items(
+    nvSpace *space,
+    nvParallelForCallback callback,
+    void *data,
+    size_t count,
+    size_t min_range
+) {
+    if (count == 0) return;
+
+    if (!space->multithreading || count < space->parallel_body_threshold) {
+        callback(data, 0, count);
+        return;
+    }
+
+    _nvSpace_dispatch_parallel_for(space, callback, data, count, min_range);
+}
+
+
+/*
+    Tier N is due once every 2^N steps. Every tier is due on a different phase
+    (odd steps for tier 1, 2 mod 4 for tier 2, 4 mod 8 for tier 3) so slower
+    tiers spread their work evenly instead of landing on the same steps.
+*/
+static inline bool _nvSpace_is_tier_due(nvSpace *space, nv_uint8 tier) {
+    if (tier == 0) return true;
+
+    nv_uint64 period = (nv_uint64)1 << tier;
+    return space->_step_count % period == period / 2;
+}
+
+/*
+    If one body of the pair is simulated in this step and the other one is
+    idle, the idle one joins the step. Static and sleeping bodies never join.
+    Returns the body that joined, or NULL.
+*/
+static inline nvBody *_nvSpace_pull_in(nvBody *a, nvBody *b) {
+    if (!a || !b || a->_sim_active == b->_sim_active) return NULL;
+
+    nvBody *idle = a->_sim_active ? b : a;
+    if (idle->type == nvBodyType_STATIC || idle->is_sleeping) return NULL;
+
+    idle->_sim_active = true;
+    return idle;
+}
+
+void _nvSpace_begin_sim_tiers(nvSpace *space) {
+    space->_multirate = false;
+
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = space->bodies->data[i];
+        body->_sim_active = false;
+
+        if (body->type == nvBodyType_STATIC || body->is_sleeping) continue;
+
+        body->_sim_steps++;
+
+        if (_nvSpace_is_tier_due(space, body->sim_tier))
+            body->_sim_active = true;
+
+        // A body that isn't due or has steps to catch up with needs its own time step
+        if (!body->_sim_active || body->_sim_steps > 1)
+            space->_multirate = true;
+    }
+
+    if (!space->_multirate) return;
+
+    /*
+        Bodies touching or joined with simulated bodies are simulated with them,
+        so pairs across tiers are solved together like in an island. Contacts and
+        broad-phase pairs are from the last step. This is repeated until no more
+        bodies join, which is usually a few passes since idle groups are small.
+    */
+    void *map_val;
+    size_t l;
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        l = 0;
+        while (nvHashMap_iter(space->res, &l, &map_val)) {
+            nvResolution *res = map_val;
+            if (res->state == nvResolutionState_CACHED) continue;
+            changed |= _nvSpace_pull_in(res->a, res->b) != NULL;
+        }
+
+        l = 0;
+        while (nvHashMap_iter(space->broadphase_pairs, &l, &map_val)) {
+            nvBroadPhasePair *pair = map_val;
+            changed |= _nvSpace_pull_in(pair->a, pair->b) != NULL;
+        }
+
+        for (size_t i = 0; i < space->constraints->size; i++) {
+            nvConstraint *cons = space->constraints->data[i];
+            changed |= _nvSpace_pull_in(cons->a, cons->b) != NULL;
+        }
+
+        for (size_t i = 0; i < space->articulations->size; i++) {
+            nvArticulation *art = space->articulations->data[i];
+
+            for (size_t j = 1; j < art->count; j++) {
+                nvArticulationLink *link = &art->links[j];
+                changed |= _nvSpace_pull_in(link->body, art->links[link->parent].body) != NULL;
+            }
+        }
+    }
+}
+
+void _nvSpace_pull_in_broadphase_pairs(nvSpace *space) {
+    if (!space->_multirate) return;
+
+    /*
+        Only pairs with a simulated body are generated, so one pass is enough here.
+        Joining bodies missed integrating accelerations of this substep, but they
+        are integrated from here on.
+    */
+    void *map_val;
+    size_t l = 0;
+    while (nvHashMap_iter(space->broadphase_pairs, &l, &map_val)) {
+        nvBroadPhasePair *pair = map_val;
+
+        nvBody *joined = _nvSpace_pull_in(pair->a, pair->b);
+        if (joined) nvArray_add(space->awake_bodies, joined);
+    }
+}
+
+void _nvSpace_end_sim_tiers(nvSpace *space) {
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = space->bodies->data[i];
+
+        if (body->_sim_active || body->type == nvBodyType_STATIC)
+            body->_sim_steps = 0;
+    }
+}
+
+nv_float _nvSpace_body_dt(nvSpace *space, nvBody *body, nv_float dt) {
+    if (!space->_multirate || body->_sim_steps <= 1) return dt;
+
+    return dt * (nv_float)body->_sim_steps;
+}
+
+nv_float _nvSpace_pair_inv_dt(nvSpace *space, nvBody *a, nvBody *b, nv_float inv_dt) {
+    if (!space->_multirate) return inv_dt;
+
+    nv_uint32 steps_a = a ? a->_sim_steps : 0;
+    nv_uint32 steps_b = b ? b->_sim_steps : 0;
+    nv_uint32 steps = (steps_a > steps_b) ? steps_a : steps_b;
+
+    return (steps > 1) ? inv_dt / (nv_float)steps : inv_dt;
+}
+
+bool _nvSpace_is_pair_simulated(nvSpace *space, nvBody *a, nvBody *b) {
+    if (!space->_multirate) return true;
+
+    return (a && a->_sim_active) || (b && b->_sim_active);
+}
+
+
 void _nvSpace_integrate_accelerations(
     nvSpace *space,
     nv_float dt,
@@ -38,21 +430,16 @@ void _nvSpace_integrate_accelerations(
 ) {
     nvBody *body = (nvBody *)space->awake_bodies->data[i];
 
-    if (body->type != nvBodyType_STATIC) {
-        body->_cache_aabb = false;
-        body->_cache_transform = false;
-    }
-
     // Apply attractive forces
     for (size_t j = 0; j < space->attractors->size; j++) {
         nvBody *attractor = (nvBody *)space->attractors->data[j];
         
         if (body == attractor) continue;
 
-        nvBody_apply_attraction(body, attractor, dt);
+        nvBody_apply_attraction(body, attractor, _nvSpace_body_dt(space, body, dt));
     }
     
-    nvBody_integrate_accelerations(body, space->gravity, dt);
+    nvBody_integrate_accelerations(body, space->gravity, _nvSpace_body_dt(space, body, dt));
 }
 
 
@@ -63,7 +450,7 @@ void _nvSpace_integrate_velocities(
 )  {
     nvBody *body = (nvBody *)space->awake_bodies->data[i];
     
-    nvBody_integrate_velocities(body, dt);
+    nvBody_integrate_velocities(body, _nvSpace_body_dt(space, body, dt));
 
     // Since most kill boundaries in games are going to be out of the
     // display area just checking for body's center position
@@ -310,71 +697,30 @@ void _nvSpace_integrate_velocities(
                 body6->angular_velocity = final_angular_velocity[6];
                 body7->angular_velocity = final_angular_velocity[7];
 
-                // Cache AABBs and vertex transforms
-
-                if (body0->type == nvBodyType_STATIC) {
+                // Static bodies never move, other bodies invalidate their caches when their pose changes
+                if (body0->type == nvBodyType_STATIC)
                     nvBody_reset_velocities(body0);
-                }
-                else {
-                    body0->_cache_aabb = false;
-                    body0->_cache_transform = false;
-                }
 
-                if (body1->type == nvBodyType_STATIC) {
+                if (body1->type == nvBodyType_STATIC)
                     nvBody_reset_velocities(body1);
-                }
-                else {
-                    body1->_cache_aabb = false;
-                    body1->_cache_transform = false;
-                }
 
-                if (body2->type == nvBodyType_STATIC) {
+                if (body2->type == nvBodyType_STATIC)
                     nvBody_reset_velocities(body2);
-                }
-                else {
-                    body2->_cache_aabb = false;
-                    body2->_cache_transform = false;
-                }
 
-                if (body3->type == nvBodyType_STATIC) {
+                if (body3->type == nvBodyType_STATIC)
                     nvBody_reset_velocities(body3);
-                }
-                else {
-                    body3->_cache_aabb = false;
-                    body3->_cache_transform = false;
-                }
 
-                if (body4->type == nvBodyType_STATIC) {
+                if (body4->type == nvBodyType_STATIC)
                     nvBody_reset_velocities(body4);
-                }
-                else {
-                    body4->_cache_aabb = false;
-                    body4->_cache_transform = false;
-                }
 
-                if (body5->type == nvBodyType_STATIC) {
+                if (body5->type == nvBodyType_STATIC)
                     nvBody_reset_velocities(body5);
-                }
-                else {
-                    body5->_cache_aabb = false;
-                    body5->_cache_transform = false;
-                }
 
-                if (body6->type == nvBodyType_STATIC) {
+                if (body6->type == nvBodyType_STATIC)
                     nvBody_reset_velocities(body6);
-                }
-                else {
-                    body6->_cache_aabb = false;
-                    body6->_cache_transform = false;
-                }
 
-                if (body7->type == nvBodyType_STATIC) {
+                if (body7->type == nvBodyType_STATIC)
                     nvBody_reset_velocities(body7);
-                }
-                else {
-                    body7->_cache_aabb = false;
-                    body7->_cache_transform = false;
-                }
             }
 
         #else
@@ -531,39 +877,18 @@ void _nvSpace_integrate_velocities(
                 body2->angular_velocity = final_angular_velocity[2];
                 body3->angular_velocity = final_angular_velocity[3];
 
-                // Cache AABBs and vertex transforms
-
-                if (body0->type == nvBodyType_STATIC) {
+                // Static bodies never move, other bodies invalidate their caches when their pose changes
+                if (body0->type == nvBodyType_STATIC)
                     nvBody_reset_velocities(body0);
-                }
-                else {
-                    body0->_cache_aabb = false;
-                    body0->_cache_transform = false;
-                }
 
-                if (body1->type == nvBodyType_STATIC) {
+                if (body1->type == nvBodyType_STATIC)
                     nvBody_reset_velocities(body1);
-                }
-                else {
-                    body1->_cache_aabb = false;
-                    body1->_cache_transform = false;
-                }
 
-                if (body2->type == nvBodyType_STATIC) {
+                if (body2->type == nvBodyType_STATIC)
                     nvBody_reset_velocities(body2);
-                }
-                else {
-                    body2->_cache_aabb = false;
-                    body2->_cache_transform = false;
-                }
 
-                if (body3->type == nvBodyType_STATIC) {
+                if (body3->type == nvBodyType_STATIC)
                     nvBody_reset_velocities(body3);
-                }
-                else {
-                    body3->_cache_aabb = false;
-                    body3->_cache_transform = false;
-                }
             }
 
         #endif
@@ -0,0 +1,368 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdlib.h>
+#include "novaphysics/internal.h"
+#include "novaphysics/space_view.h"
+#include "novaphysics/collision.h"
+
+
+/**
+ * @file space_view.c
+ *
+ * @brief Read-only snapshot of body states captured at the end of a step.
+ */
+
+
+// Marks IDs that are not in the view
+#define _NV_VIEW_NO_STATE 0xFFFFFFFF
+
+
+nvSpaceView *nvSpaceView_new() {
+    nvSpaceView *view = NV_NEW(nvSpaceView);
+    if (!view) return NULL;
+
+    view->states = NULL;
+    view->size = 0;
+    view->capacity = 0;
+    view->step = 0;
+
+    view->_id_map = NULL;
+    view->_id_map_size = 0;
+
+    view->_indexed = false;
+    view->_cell_starts = NULL;
+    view->_cell_states = NULL;
+    view->_large = NULL;
+    view->_large_count = 0;
+    view->_cell_capacity = 0;
+    view->_entry_capacity = 0;
+    view->_large_capacity = 0;
+
+    return view;
+}
+
+void nvSpaceView_free(nvSpaceView *view) {
+    if (!view) return;
+
+    NV_FREE(view->states);
+    NV_FREE(view->_id_map);
+    NV_FREE(view->_cell_starts);
+    NV_FREE(view->_cell_states);
+    NV_FREE(view->_large);
+    NV_FREE(view);
+}
+
+/**
+ * @brief Query grid cell coordinate of a position component, clamped to the grid.
+ */
+static inline nv_int32 _nvSpaceView_coord(nv_float x, nv_float min, nv_float inv_cell, nv_int32 size) {
+    nv_float c = nv_floor((x - min) * inv_cell);
+    if (c < 0.0) return 0;
+    if (c > (nv_float)(size - 1)) return size - 1;
+    return (nv_int32)c;
+}
+
+/**
+ * @brief Range of query grid cells an AABB covers.
+ */
+static inline void _nvSpaceView_cells(
+    const nvSpaceView *view,
+    nvAABB aabb,
+    nv_int32 *x0,
+    nv_int32 *y0,
+    nv_int32 *x1,
+    nv_int32 *y1
+) {
+    *x0 = _nvSpaceView_coord(aabb.min_x, view->_bounds.min_x, view->_inv_cell, view->_width);
+    *y0 = _nvSpaceView_coord(aabb.min_y, view->_bounds.min_y, view->_inv_cell, view->_height);
+    *x1 = _nvSpaceView_coord(aabb.max_x, view->_bounds.min_x, view->_inv_cell, view->_width);
+    *y1 = _nvSpaceView_coord(aabb.max_y, view->_bounds.min_y, view->_inv_cell, view->_height);
+}
+
+/**
+ * @brief Bin the captured states into the query grid.
+ *
+ * Cells are sized after the average state so most states cover a few cells,
+ * the grid is capped at @ref NV_SPACE_VIEW_CELLS_PER_STATE cells per state.
+ * Returns false if the buffers couldn't be allocated.
+ */
+static bool _nvSpaceView_index(nvSpaceView *view) {
+    if (view->size == 0) return false;
+
+    nvAABB bounds = view->states[0].aabb;
+    nv_float extent = 0.0;
+
+    for (size_t i = 0; i < view->size; i++) {
+        nvAABB aabb = view->states[i].aabb;
+        bounds.min_x = nv_fmin(bounds.min_x, aabb.min_x);
+        bounds.min_y = nv_fmin(bounds.min_y, aabb.min_y);
+        bounds.max_x = nv_fmax(bounds.max_x, aabb.max_x);
+        bounds.max_y = nv_fmax(bounds.max_y, aabb.max_y);
+        extent += nv_fmax(aabb.max_x - aabb.min_x, aabb.max_y - aabb.min_y);
+    }
+
+    // Neither side of the grid has more cells than a square grid of the capped size
+    nv_float side = nv_floor(nv_sqrt((nv_float)(view->size * NV_SPACE_VIEW_CELLS_PER_STATE))) + 1.0;
+    nv_float cell = 2.0 * extent / (nv_float)view->size;
+    cell = nv_fmax(cell, (bounds.max_x - bounds.min_x) / side);
+    cell = nv_fmax(cell, (bounds.max_y - bounds.min_y) / side);
+    if (!(cell > 0.0)) cell = 1.0;
+
+    view->_bounds = bounds;
+    view->_inv_cell = 1.0 / cell;
+    view->_width = (nv_int32)nv_fmin(nv_floor((bounds.max_x - bounds.min_x) * view->_inv_cell) + 1.0, side);
+    view->_height = (nv_int32)nv_fmin(nv_floor((bounds.max_y - bounds.min_y) * view->_inv_cell) + 1.0, side);
+    size_t cell_count = (size_t)view->_width * (size_t)view->_height;
+
+    if (cell_count > view->_cell_capacity) {
+        if (!_nv_reserve((void **)&view->_cell_starts, sizeof(nv_uint32), cell_count + 1)) return false;
+        view->_cell_capacity = cell_count;
+    }
+
+    if (view->size > view->_large_capacity) {
+        if (!_nv_reserve((void **)&view->_large, sizeof(nv_uint32), view->size)) return false;
+        view->_large_capacity = view->size;
+    }
+
+    nv_uint32 *starts = view->_cell_starts;
+    for (size_t i = 0; i <= cell_count; i++)
+        starts[i] = 0;
+
+    view->_large_count = 0;
+    size_t entries = 0;
+
+    for (size_t i = 0; i < view->size; i++) {
+        nv_int32 x0, y0, x1, y1;
+        _nvSpaceView_cells(view, view->states[i].aabb, &x0, &y0, &x1, &y1);
+
+        size_t covered = (size_t)(x1 - x0 + 1) * (size_t)(y1 - y0 + 1);
+        if (covered > NV_SPACE_VIEW_MAX_CELLS) {
+            view->_large[view->_large_count++] = (nv_uint32)i;
+            continue;
+        }
+
+        for (nv_int32 y = y0; y <= y1; y++)
+            for (nv_int32 x = x0; x <= x1; x++)
+                starts[y * view->_width + x + 1]++;
+
+        entries += covered;
+    }
+
+    if (entries > view->_entry_capacity) {
+        if (!_nv_reserve((void **)&view->_cell_states, sizeof(nv_uint32), entries)) return false;
+        view->_entry_capacity = entries;
+    }
+
+    for (size_t i = 0; i < cell_count; i++)
+        starts[i + 1] += starts[i];
+
+    // Scatter in state order, each start is advanced to the start of the next cell
+    for (size_t i = 0, l = 0; i < view->size; i++) {
+        if (l < view->_large_count && view->_large[l] == i) {
+            l++;
+            continue;
+        }
+
+        nv_int32 x0, y0, x1, y1;
+        _nvSpaceView_cells(view, view->states[i].aabb, &x0, &y0, &x1, &y1);
+
+        for (nv_int32 y = y0; y <= y1; y++)
+            for (nv_int32 x = x0; x <= x1; x++)
+                view->_cell_states[starts[y * view->_width + x]++] = (nv_uint32)i;
+    }
+
+    for (size_t i = cell_count; i > 0; i--)
+        starts[i] = starts[i - 1];
+    starts[0] = 0;
+
+    return true;
+}
+
+void nvSpaceView_capture(nvSpaceView *view, nvArray *bodies, nv_uint64 step) {
+    NV_TRACY_ZONE_START;
+
+    // Only grow the buffers, views are reused every step
+    if (bodies->size > view->capacity) {
+        nvBodyState *new_states = NV_REALLOC(view->states, sizeof(nvBodyState) * bodies->size);
+        if (!new_states) {
+            NV_TRACY_ZONE_END;
+            return;
+        }
+
+        view->states = new_states;
+        view->capacity = bodies->size;
+    }
+
+    size_t max_id = 0;
+
+    for (size_t i = 0; i < bodies->size; i++) {
+        nvBody *body = (nvBody *)bodies->data[i];
+
+        view->states[i] = (nvBodyState){
+            .body = body,
+            .id = body->id,
+            .type = body->type,
+            .position = body->position,
+            .angle = body->angle,
+            .linear_velocity = body->linear_velocity,
+            .angular_velocity = body->angular_velocity,
+            .aabb = nvBody_get_aabb(body),
+            .is_sleeping = body->is_sleeping
+        };
+
+        if (body->id > max_id) max_id = body->id;
+    }
+
+    view->size = bodies->size;
+    view->step = step;
+
+    if (max_id + 1 > view->_id_map_size) {
+        nv_uint32 *new_map = NV_REALLOC(view->_id_map, sizeof(nv_uint32) * (max_id + 1));
+        if (!new_map) {
+            NV_TRACY_ZONE_END;
+            return;
+        }
+
+        view->_id_map = new_map;
+        view->_id_map_size = max_id + 1;
+    }
+
+    for (size_t i = 0; i < view->_id_map_size; i++)
+        view->_id_map[i] = _NV_VIEW_NO_STATE;
+
+    for (size_t i = 0; i < view->size; i++)
+        view->_id_map[view->states[i].id] = (nv_uint32)i;
+
+    view->_indexed = _nvSpaceView_index(view);
+
+    NV_TRACY_ZONE_END;
+}
+
+const nvBodyState *nvSpaceView_get(const nvSpaceView *view, nv_uint16 id) {
+    if (id >= view->_id_map_size) return NULL;
+
+    nv_uint32 index = view->_id_map[id];
+    if (index == _NV_VIEW_NO_STATE || index >= view->size) return NULL;
+
+    return &view->states[index];
+}
+
+/**
+ * @brief Sort the states appended to the output back into state order.
+ */
+static int _nvSpaceView_compare_states(const void *a, const void *b) {
+    const nvBodyState *state_a = *(const nvBodyState *const *)a;
+    const nvBodyState *state_b = *(const nvBodyState *const *)b;
+    return (state_a > state_b) - (state_a < state_b);
+}
+
+size_t nvSpaceView_query_aabb(const nvSpaceView *view, nvAABB aabb, nvArray *output) {
+    size_t found = 0;
+
+    if (!view->_indexed) {
+        for (size_t i = 0; i < view->size; i++) {
+            const nvBodyState *state = &view->states[i];
+
+            if (nv_collide_aabb_x_aabb(aabb, state->aabb)) {
+                nvArray_add(output, (void *)state);
+                found++;
+            }
+        }
+
+        return found;
+    }
+
+    size_t first = output->size;
+
+    for (size_t i = 0; i < view->_large_count; i++) {
+        const nvBodyState *state = &view->states[view->_large[i]];
+
+        if (nv_collide_aabb_x_aabb(aabb, state->aabb)) {
+            nvArray_add(output, (void *)state);
+            found++;
+        }
+    }
+
+    nv_int32 qx0, qy0, qx1, qy1;
+    _nvSpaceView_cells(view, aabb, &qx0, &qy0, &qx1, &qy1);
+
+    for (nv_int32 y = qy0; y <= qy1; y++) {
+        for (nv_int32 x = qx0; x <= qx1; x++) {
+            nv_uint32 cell = (nv_uint32)(y * view->_width + x);
+
+            for (nv_uint32 k = view->_cell_starts[cell]; k < view->_cell_starts[cell + 1]; k++) {
+                const nvBodyState *state = &view->states[view->_cell_states[k]];
+
+                // A state is only taken from the first cell it shares with the query
+                nv_int32 x0, y0, x1, y1;
+                _nvSpaceView_cells(view, state->aabb, &x0, &y0, &x1, &y1);
+                if ((x0 > qx0 ? x0 : qx0) != x || (y0 > qy0 ? y0 : qy0) != y) continue;
+
+                if (nv_collide_aabb_x_aabb(aabb, state->aabb)) {
+                    nvArray_add(output, (void *)state);
+                    found++;
+                }
+            }
+        }
+    }
+
+    if (found > 1)
+        qsort(&output->data[first], found, sizeof(void *), _nvSpaceView_compare_states);
+
+    return found;
+}
+
+size_t nvSpaceView_query_point(const nvSpaceView *view, nvVector2 point, nvArray *output) {
+    size_t found = 0;
+
+    if (!view->_indexed) {
+        for (size_t i = 0; i < view->size; i++) {
+            const nvBodyState *state = &view->states[i];
+
+            if (nv_collide_aabb_x_point(state->aabb, point)) {
+                nvArray_add(output, (void *)state);
+                found++;
+            }
+        }
+
+        return found;
+    }
+
+    size_t first = output->size;
+
+    for (size_t i = 0; i < view->_large_count; i++) {
+        const nvBodyState *state = &view->states[view->_large[i]];
+
+        if (nv_collide_aabb_x_point(state->aabb, point)) {
+            nvArray_add(output, (void *)state);
+            found++;
+        }
+    }
+
+    // States are in every cell they cover, so only the cell of the point is checked
+    nv_int32 x = _nvSpaceView_coord(point.x, view->_bounds.min_x, view->_inv_cell, view->_width);
+    nv_int32 y = _nvSpaceView_coord(point.y, view->_bounds.min_y, view->_inv_cell, view->_height);
+    nv_uint32 cell = (nv_uint32)(y * view->_width + x);
+
+    for (nv_uint32 k = view->_cell_starts[cell]; k < view->_cell_starts[cell + 1]; k++) {
+        const nvBodyState *state = &view->states[view->_cell_states[k]];
+
+        if (nv_collide_aabb_x_point(state->aabb, point)) {
+            nvArray_add(output, (void *)state);
+            found++;
+        }
+    }
+
+    if (found > 1)
+        qsort(&output->data[first], found, sizeof(void *), _nvSpaceView_compare_states);
+
+    return found;
+}
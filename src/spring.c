@@ -28,14 +28,18 @@ nvConstraint *nvSpring_new(
     nv_float stiffness,
     nv_float damping
 ) {
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_CONSTRAINTS);
     nvConstraint *cons = NV_NEW(nvConstraint);
+    NV_ALLOC_SCOPE_END;
     if (!cons) return NULL;
 
     cons->a = a;
     cons->b = b;
     cons->type = nvConstraintType_SPRING;
 
+    NV_ALLOC_SCOPE_BEGIN(nvAllocCategory_CONSTRAINTS);
     cons->def = (void *)NV_NEW(nvSpring);
+    NV_ALLOC_SCOPE_END;
     if (!cons->def) return NULL;
     nvSpring *spring = (nvSpring *)cons->def;
 
@@ -0,0 +1,265 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include "novaphysics/step_budget.h"
+#include "novaphysics/space.h"
+
+
+/**
+ * @file step_budget.c
+ *
+ * @brief Time-budgeted stepping.
+ */
+
+
+// Iteration scales tried for every substep count, from the best quality down
+static const double _nv_budget_iter_scales[] = {1.0, 0.75, 0.5, 0.25, 0.0};
+#define _NV_BUDGET_ITER_SCALES (sizeof(_nv_budget_iter_scales) / sizeof(double))
+
+
+static inline size_t _nv_scale_iters(size_t iters, double scale) {
+    if (iters == 0) return 0;
+
+    size_t scaled = (size_t)((double)iters * scale + 0.5);
+    return (scaled < 1) ? 1 : scaled;
+}
+
+static inline bool _nvSpace_uses_position_iters(nvSpace *space) {
+    return space->position_correction == nvPositionCorrection_NGS;
+}
+
+/**
+ * Resolutions the next step is expected to solve.
+ *
+ * Pairs found by the last broad-phase include bodies whose bounding boxes
+ * overlap but don't touch yet, so contacts that are about to appear are
+ * counted before they are created.
+ */
+static inline double _nvSpace_expected_resolutions(nvSpace *space) {
+    size_t pairs = space->broadphase_pairs->count;
+    size_t resolutions = space->res->count;
+
+    return (double)((pairs > resolutions) ? pairs : resolutions);
+}
+
+/**
+ * Predicted step time in seconds.
+ */
+static double _nvSpace_predict(
+    nvSpace *space,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+) {
+    nvStepCostModel *model = &space->step_cost_model;
+
+    double resolutions = _nvSpace_expected_resolutions(space);
+    double constraints = (double)space->constraints->size;
+    double elements = (double)space->bodies->size + resolutions;
+
+    double substep = model->element * elements;
+    substep += model->velocity_iter * resolutions * (double)velocity_iters;
+    substep += model->constraint_iter * constraints * (double)constraint_iters;
+
+    if (_nvSpace_uses_position_iters(space))
+        substep += model->position_iter * resolutions * (double)position_iters;
+
+    return (model->step + substep * (double)substeps) * model->scale;
+}
+
+static inline void _nv_learn(double *estimate, double sample, nvStepCostModel *model) {
+    double alpha = (sample > *estimate) ? model->rise : model->fall;
+    *estimate += (sample - *estimate) * alpha;
+}
+
+/**
+ * Calibrate the cost model with the times of the last step.
+ */
+static void _nvSpace_learn_step_cost(
+    nvSpace *space,
+    double elapsed,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+) {
+    nvStepCostModel *model = &space->step_cost_model;
+
+    #ifdef NV_PROFILE
+
+        // Phase times of the profiler are from the last substep, they are learned unscaled per solved resolution
+        nvProfiler *profiler = &space->profiler;
+
+        double resolutions = (double)space->res->count;
+        double constraints = (double)space->constraints->size;
+        double elements = (double)space->bodies->size + resolutions;
+
+        double base = profiler->integrate_accelerations +
+                      profiler->broadphase +
+                      profiler->update_resolutions +
+                      profiler->narrowphase +
+                      profiler->presolve_collisions +
+                      profiler->presolve_constraints +
+                      profiler->integrate_velocities;
+
+        double iterations = profiler->solve_velocities + profiler->solve_constraints;
+
+        if (elements > 0.0)
+            _nv_learn(&model->element, base / elements, model);
+
+        if (velocity_iters > 0 && resolutions > 0.0)
+            _nv_learn(&model->velocity_iter, profiler->solve_velocities / (resolutions * (double)velocity_iters), model);
+
+        if (constraint_iters > 0 && constraints > 0.0)
+            _nv_learn(&model->constraint_iter, profiler->solve_constraints / (constraints * (double)constraint_iters), model);
+
+        if (_nvSpace_uses_position_iters(space)) {
+            iterations += profiler->solve_positions;
+
+            if (position_iters > 0 && resolutions > 0.0)
+                _nv_learn(&model->position_iter, profiler->solve_positions / (resolutions * (double)position_iters), model);
+        }
+        else {
+            base += profiler->solve_positions;
+        }
+
+        double fixed = elapsed - (base + iterations) * (double)substeps;
+        _nv_learn(&model->step, (fixed > 0.0) ? fixed : 0.0, model);
+
+    #endif
+
+    // Correct what the per-unit costs can't explain, like work that doesn't scale with them
+    double predicted = _nvSpace_predict(space, velocity_iters, position_iters, constraint_iters, substeps);
+    if (predicted > 0.0)
+        _nv_learn(&model->scale, model->scale * elapsed / predicted, model);
+
+    model->samples++;
+}
+
+
+double nvSpace_predict_step_time(
+    nvSpace *space,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+) {
+    return _nvSpace_predict(space, velocity_iters, position_iters, constraint_iters, substeps) * 1e3;
+}
+
+nvStepQuality nvSpace_step_budget(
+    nvSpace *space,
+    nv_float dt,
+    double budget_ms,
+    size_t velocity_iters,
+    size_t position_iters,
+    size_t constraint_iters,
+    size_t substeps
+) {
+    if (substeps == 0) substeps = 1;
+
+    double target = budget_ms * 1e-3 * NV_STEP_BUDGET_HEADROOM;
+
+    nvStepQuality quality = {
+        .velocity_iters = _nv_scale_iters(velocity_iters, 0.0),
+        .position_iters = _nv_scale_iters(position_iters, 0.0),
+        .constraint_iters = _nv_scale_iters(constraint_iters, 0.0),
+        .substeps = 1
+    };
+
+    // Keep substeps as long as possible, trade iterations first
+    bool found = false;
+    for (size_t s = substeps; s > 0 && !found; s--) {
+        for (size_t i = 0; i < _NV_BUDGET_ITER_SCALES; i++) {
+            double scale = _nv_budget_iter_scales[i];
+            size_t v = _nv_scale_iters(velocity_iters, scale);
+            size_t p = _nv_scale_iters(position_iters, scale);
+            size_t c = _nv_scale_iters(constraint_iters, scale);
+
+            if (_nvSpace_predict(space, v, p, c, s) <= target) {
+                quality.velocity_iters = v;
+                quality.position_iters = p;
+                quality.constraint_iters = c;
+                quality.substeps = s;
+                found = true;
+                break;
+            }
+        }
+    }
+
+    size_t requested = velocity_iters + constraint_iters;
+    size_t used = quality.velocity_iters + quality.constraint_iters;
+    if (_nvSpace_uses_position_iters(space)) {
+        requested += position_iters;
+        used += quality.position_iters;
+    }
+
+    if (requested > 0)
+        quality.quality = (nv_float)(quality.substeps * used) / (nv_float)(substeps * requested);
+    else
+        quality.quality = (nv_float)quality.substeps / (nv_float)substeps;
+
+    quality.degraded = quality.velocity_iters != velocity_iters ||
+                       quality.position_iters != position_iters ||
+                       quality.constraint_iters != constraint_iters ||
+                       quality.substeps != substeps;
+
+    quality.predicted = nvSpace_predict_step_time(
+        space,
+        quality.velocity_iters,
+        quality.position_iters,
+        quality.constraint_iters,
+        quality.substeps
+    );
+
+    // Let more bodies rest while the step can't afford full quality
+    nv_float sleep_energy = space->sleep_energy_threshold;
+    nv_float wake_energy = space->wake_energy_threshold;
+
+    if (space->sleeping && quality.quality < NV_STEP_BUDGET_COARSE_SLEEP) {
+        nv_float coarsening = NV_STEP_BUDGET_COARSE_SLEEP / nv_fmax(quality.quality, 0.125);
+
+        space->sleep_energy_threshold *= coarsening;
+        space->wake_energy_threshold *= coarsening;
+        quality.coarse_sleep = true;
+    }
+
+    nvPrecisionTimer timer;
+    nvPrecisionTimer_start(&timer);
+
+    nvSpace_step(
+        space,
+        dt,
+        quality.velocity_iters,
+        quality.position_iters,
+        quality.constraint_iters,
+        quality.substeps
+    );
+
+    double elapsed = nvPrecisionTimer_stop(&timer);
+
+    space->sleep_energy_threshold = sleep_energy;
+    space->wake_energy_threshold = wake_energy;
+
+    _nvSpace_learn_step_cost(
+        space,
+        elapsed,
+        quality.velocity_iters,
+        quality.position_iters,
+        quality.constraint_iters,
+        quality.substeps
+    );
+
+    quality.elapsed = elapsed * 1e3;
+    quality.over_budget = quality.elapsed > budget_ms;
+
+    return quality;
+}
\ No newline at end of file
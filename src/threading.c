@@ -8,7 +8,13 @@
 
 */
 
+// Needed for pthread_setaffinity_np
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
+
 #include "novaphysics/threading.h"
+#include "novaphysics/profiler.h"
 
 
 /**
@@ -28,8 +34,20 @@
     require a mutex to wait. So the nvCondition_wait function parameters
     and task executor functions gets inconsistent.
 
-    I'm still not satisfied with how the task executor works in general.
-    I will need to rewrite it before 1.0.0.
+    Task executor threads don't wait on their condition right away. Assigning
+    a task increments the thread's epoch counter, and an idle thread polls it
+    for a while before parking. So back-to-back parallel phases in a step are
+    picked up without going through the OS scheduler, and the dispatching
+    thread only signals the condition if the thread actually parked. Waiting
+    for tasks spins on the pending task counter the same way.
+
+    The spin budget isn't fixed, a fixed count is either too short for
+    scenes with long serial phases between parallel ones or burns a core for
+    nothing when the user only steps once a frame. Every wait measures its
+    latency in polls (parked time is converted with the measured poll cost)
+    and the budget moves halfway towards twice that latency. Waits longer
+    than the spin_count setting could cover pull it down to a small floor
+    instead, so the threads of an idle executor stop spinning quickly.
 */
 
 
@@ -91,6 +109,10 @@
         return;
     }
 
+    bool nvThread_set_affinity(nvThread *thread, size_t core) {
+        return false;
+    }
+
 #elif defined(NV_WINDOWS)
 
     /* Win32 implementation of the API. */
@@ -116,7 +138,7 @@
         );
 
         if (!mutex->_handle) {
-            free(mutex);
+            NV_FREE(mutex);
             return NULL;
         }
 
@@ -125,7 +147,7 @@
 
     void nvMutex_free(nvMutex *mutex) {
         CloseHandle(mutex->_handle);
-        free(mutex);
+        NV_FREE(mutex);
     }
 
     bool nvMutex_lock(nvMutex *mutex) {
@@ -159,7 +181,7 @@
         );
 
         if (!cond->_handle) {
-            free(cond);
+            NV_FREE(cond);
             return NULL;
         }
 
@@ -168,7 +190,7 @@
 
     void nvCondition_free(nvCondition *cond) {
         CloseHandle(cond->_handle);
-        free(cond);
+        NV_FREE(cond);
     }
 
     void nvCondition_wait(nvCondition *cond, nvMutex *mutex) {
@@ -201,7 +223,7 @@
         );
 
         if (!thread_handle) {
-            free(thread);
+            NV_FREE(thread);
             return NULL;
         }
 
@@ -213,8 +235,8 @@
 
     void nvThread_free(nvThread *thread) {
         CloseHandle(thread->_handle);
-        free(thread->worker_data);
-        free(thread);
+        NV_FREE(thread->worker_data);
+        NV_FREE(thread);
     }
 
     void nvThread_join(nvThread *thread) {
@@ -225,7 +247,7 @@
         #ifdef NV_COMPILER_MSVC
 
             // MSVC doesn't like VLAs, so malloc
-            HANDLE *handles = malloc(sizeof(HANDLE) * length);
+            HANDLE *handles = NV_MALLOC(sizeof(HANDLE) * length);
 
         #else
 
@@ -241,11 +263,17 @@
 
         #ifdef NV_COMPILER_MSVC
 
-            free(handles);
+            NV_FREE(handles);
 
         #endif
     }
 
+    bool nvThread_set_affinity(nvThread *thread, size_t core) {
+        if (core >= sizeof(DWORD_PTR) * 8) return false;
+
+        return SetThreadAffinityMask(thread->_handle, (DWORD_PTR)1 << core) != 0;
+    }
+
 #else
 
     /* Posix threads implementation of the API. */
@@ -267,7 +295,7 @@
 
         mutex->_handle = NV_NEW(pthread_mutex_t);
         if (!mutex->_handle) {
-            free(mutex);
+            NV_FREE(mutex);
             return NULL;
         }
 
@@ -277,8 +305,8 @@
                 NULL            // Default creation attributes
             ) != 0
         ) {
-            free(mutex->_handle);
-            free(mutex);
+            NV_FREE(mutex->_handle);
+            NV_FREE(mutex);
             return NULL;
         }
 
@@ -287,8 +315,8 @@
 
     void nvMutex_free(nvMutex *mutex) {
         pthread_mutex_destroy(mutex->_handle);
-        free(mutex->_handle);
-        free(mutex);
+        NV_FREE(mutex->_handle);
+        NV_FREE(mutex);
     }
 
     bool nvMutex_lock(nvMutex *mutex) {
@@ -306,7 +334,7 @@
 
         cond->_handle = NV_NEW(pthread_cond_t);
         if (!cond->_handle) {
-            free(cond);
+            NV_FREE(cond);
             return NULL;
         }
 
@@ -316,8 +344,8 @@
                 NULL           // Default creation attributes
             ) != 0
         ) {
-            free(cond->_handle);
-            free(cond);
+            NV_FREE(cond->_handle);
+            NV_FREE(cond);
             return NULL;
         }
 
@@ -326,8 +354,8 @@
 
     void nvCondition_free(nvCondition *cond) {
         pthread_cond_destroy(cond->_handle);
-        free(cond->_handle);
-        free(cond);
+        NV_FREE(cond->_handle);
+        NV_FREE(cond);
     }
 
     void nvCondition_wait(nvCondition *cond, nvMutex *mutex) {
@@ -360,8 +388,8 @@
     }
 
     void nvThread_free(nvThread *thread) {
-        free(thread->worker_data);
-        free(thread);
+        NV_FREE(thread->worker_data);
+        NV_FREE(thread);
     }
 
     void nvThread_join(nvThread *thread) {
@@ -373,107 +401,243 @@
         }
     }
 
+    bool nvThread_set_affinity(nvThread *thread, size_t core) {
+        #ifdef __linux__
+
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(core, &cpu_set);
+
+            return pthread_setaffinity_np(thread->id, sizeof(cpu_set_t), &cpu_set) == 0;
+
+        #else
+
+            // Other POSIX systems (like macOS) only have affinity hints
+            return false;
+
+        #endif
+    }
+
 #endif
 
 
+/*
+    Parking on Windows doesn't hold the mutex since events don't need one.
+    Events stay signaled until a thread waits on them, so a signal sent
+    before the wait isn't lost.
+
+    With condition variables the parked flag is set and the predicate is
+    checked under the mutex, and signaling thread locks the same mutex. So a
+    signal can't be sent between the check and the wait.
+*/
+
+static void _nvTaskExecutor_park(
+    nv_uint32 *parked,
+    nv_uint32 *word,
+    nv_uint32 value,
+    nvMutex *mutex,
+    nvCondition *cond
+) {
+    // Park until the word changes from the value
+    #ifndef NV_WINDOWS
+        nvMutex_lock(mutex);
+    #endif
+
+    nv_atomic_store(parked, 1);
+    while (nv_atomic_load(word) == value)
+        nvCondition_wait(cond, mutex);
+    nv_atomic_store(parked, 0);
+
+    #ifndef NV_WINDOWS
+        nvMutex_unlock(mutex);
+    #endif
+}
+
+static void _nvTaskExecutor_unpark(
+    nv_uint32 *parked,
+    nvMutex *mutex,
+    nvCondition *cond
+) {
+    if (!nv_atomic_load(parked)) return;
+
+    #ifndef NV_WINDOWS
+        nvMutex_lock(mutex);
+    #endif
+
+    nvCondition_signal(cond);
+
+    #ifndef NV_WINDOWS
+        nvMutex_unlock(mutex);
+    #endif
+}
+
+// Smallest spin budget, so short waits can still be observed and grow it again
+#define _NV_TASK_EXECUTOR_MIN_SPIN 64
+
+static nv_uint32 _nvTaskExecutor_adapt_spin(
+    nv_uint32 spin,
+    nv_uint32 max_spin,
+    nv_uint32 polls,
+    double spun,
+    double parked
+) {
+    // Wait latency in polls, parked time is converted with the measured poll cost
+    double latency = (double)polls;
+    if (parked > 0.0) {
+        if (polls == 0 || spun <= 0.0) return spin;
+        latency += parked / (spun / (double)polls);
+    }
+
+    // Spinning can't catch waits longer than the maximum, stop paying for them
+    double target = 2.0 * latency;
+    if (target > (double)max_spin) target = 0.0;
+
+    double budget = ((double)spin + target) * 0.5;
+    double min_spin = fmin((double)_NV_TASK_EXECUTOR_MIN_SPIN, (double)max_spin);
+
+    return (nv_uint32)fmax(min_spin, fmin(budget, (double)max_spin));
+}
+
 static int nvTaskExecutor_main(nvThreadWorkerData *worker_data) {
     nvTaskExecutorData *data = worker_data->data;
-    data->is_active = true;
+    nvTaskExecutor *task_executor = data->executor;
+    nv_uint32 seen = 0;
+
+    while (true) {
+        nvPrecisionTimer timer;
+        nv_uint32 polls = 0;
+        double spun = 0.0;
+        double parked = 0.0;
+
+        // Spin a while before parking, next task usually arrives shortly
+        nv_uint32 epoch = nv_atomic_load(&data->epoch);
+        if (epoch == seen) nvPrecisionTimer_start(&timer);
+        for (; epoch == seen && polls < data->spin; polls++) {
+            nv_cpu_relax();
+            epoch = nv_atomic_load(&data->epoch);
+        }
 
-    while (data->is_active) {
-        
-        #ifdef NV_WINDOWS
+        if (epoch == seen) {
+            spun = nvPrecisionTimer_stop(&timer);
+            nvPrecisionTimer_start(&timer);
 
-            nvCondition_wait(data->task_event, data->task_mutex);
-            data->is_busy = true;
-            data->task_arrived = true;
+            _nvTaskExecutor_park(
+                &data->parked,
+                &data->epoch,
+                seen,
+                data->task_mutex,
+                data->task_event
+            );
+            epoch = nv_atomic_load(&data->epoch);
 
-            if (data->task) {
-                data->task->task_func(data->task->data);
-                free(data->task);
-                data->task = NULL;
-            }
+            parked = nvPrecisionTimer_stop(&timer);
+        }
 
-            data->is_busy = false;
-            nvCondition_signal(data->done_event);
+        data->spin = _nvTaskExecutor_adapt_spin(
+            data->spin,
+            task_executor->settings.spin_count,
+            polls,
+            spun,
+            parked
+        );
 
-        #else
+        seen = epoch;
 
-            nvMutex_lock(data->task_mutex);
-            nvCondition_wait(data->task_event, data->task_mutex);
-            data->is_busy = true;
-            data->task_arrived = true;
-            nvMutex_unlock(data->task_mutex);
-
-            nvMutex_lock(data->task_mutex);
-            if (data->task) {
-                data->task->task_func(data->task->data);
-                free(data->task);
-                data->task = NULL;
-            }
-            nvMutex_unlock(data->task_mutex);
-
-            nvMutex_lock(data->task_mutex);
-            data->is_busy = false;
-            nvCondition_signal(data->done_event);
-            nvMutex_unlock(data->task_mutex);
+        if (!nv_atomic_load(&data->is_active)) break;
 
-        #endif
+        data->task.task_func(data->task.data);
+        nv_atomic_store(&data->done_epoch, seen);
+
+        // Last finished task releases the thread waiting for tasks
+        if (nv_atomic_add(&task_executor->pending, (nv_uint32)-1) == 0) {
+            _nvTaskExecutor_unpark(
+                &task_executor->join_parked,
+                task_executor->join_mutex,
+                task_executor->join_event
+            );
+        }
     }
 
     return 0;
 }
 
 nvTaskExecutor *nvTaskExecutor_new(size_t size) {
+    return nvTaskExecutor_new_with_settings(size, nvTaskExecutorSettings_DEFAULT);
+}
+
+nvTaskExecutor *nvTaskExecutor_new_with_settings(size_t size, nvTaskExecutorSettings settings) {
     nvTaskExecutor *task_executor = NV_NEW(nvTaskExecutor);
     if (!task_executor) return NULL;
 
     task_executor->threads = nvArray_new();
     task_executor->data = nvArray_new();
 
+    task_executor->ranges = NV_MALLOC(sizeof(nvTaskRange) * size);
+    if (!task_executor->ranges) return NULL;
+
+    nv_uint32 cpu_count = nv_get_cpu_count();
+
+    // Spinning only pays off if every thread, including the dispatching one,
+    // has its own core. Otherwise spinners steal time from the threads doing work.
+    if (size + 1 > cpu_count)
+        settings.spin_count = 0;
+
+    task_executor->settings = settings;
+    task_executor->pending = 0;
+    task_executor->join_spin = settings.spin_count;
+    task_executor->join_parked = 0;
+    task_executor->join_mutex = nvMutex_new();
+    task_executor->join_event = nvCondition_new();
+
     for (size_t i = 0; i < size; i++) {
         nvTaskExecutorData *thread_data = NV_NEW(nvTaskExecutorData);
         if (!thread_data) return NULL;
 
-        thread_data->is_active = true;
-        thread_data->is_busy = false;
-        thread_data->task_arrived = false;
-        thread_data->task = NULL;
+        thread_data->executor = task_executor;
+        thread_data->is_active = 1;
+        thread_data->epoch = 0;
+        thread_data->done_epoch = 0;
+        thread_data->parked = 0;
+        thread_data->spin = settings.spin_count;
+        thread_data->task = (nvTask){NULL, NULL};
         thread_data->task_mutex = nvMutex_new();
         thread_data->task_event = nvCondition_new();
-        thread_data->done_event = nvCondition_new();
         nvArray_add(task_executor->data, thread_data);
 
         nvThread *thread = nvThread_create(nvTaskExecutor_main, thread_data);
         nvArray_add(task_executor->threads, thread);
+
+        if (settings.pin_threads && thread && cpu_count > 0)
+            nvThread_set_affinity(thread, (settings.first_core + i) % cpu_count);
     }
 
     return task_executor;
 }
 
 void nvTaskExecutor_free(nvTaskExecutor *task_executor) {
+    nvArray_free_each(task_executor->threads, (void (*)(void *))nvThread_free);
     nvArray_free(task_executor->threads);
     for (size_t i = 0; i < task_executor->data->size; i++) {
         nvTaskExecutorData *data = task_executor->data->data[i];
-        free(data->task);
         nvMutex_free(data->task_mutex);
         nvCondition_free(data->task_event);
-        nvCondition_free(data->done_event);
     }
-    nvArray_free_each(task_executor->data, free);
+    nvArray_free_each(task_executor->data, NV_FREE_FUNC);
     nvArray_free(task_executor->data);
+    nvMutex_free(task_executor->join_mutex);
+    nvCondition_free(task_executor->join_event);
+    NV_FREE(task_executor->ranges);
+    NV_FREE(task_executor);
 }
 
 void nvTaskExecutor_close(nvTaskExecutor *task_executor) {
     for (size_t i = 0; i < task_executor->data->size; i++) {
         nvTaskExecutorData *data = task_executor->data->data[i];
-        
-        nvMutex_lock(data->task_mutex);
-        data->is_active = false;
-        data->task = NULL;
-        nvCondition_signal(data->task_event);
-        nvMutex_unlock(data->task_mutex);
-        
+
+        // Publish a new epoch so spinning and parked threads both notice
+        nv_atomic_store(&data->is_active, 0);
+        nv_atomic_add(&data->epoch, 1);
+        _nvTaskExecutor_unpark(&data->parked, data->task_mutex, data->task_event);
     }
 
     nvThread_join_multiple(
@@ -510,61 +674,134 @@ bool nvTaskExecutor_add_task_to(
 ) {
     nvTaskExecutorData *data = task_executor->data->data[thread_no];
 
-    if (!data->task) {
-        nvTask *task = NV_NEW(nvTask);
-        if (!task) return false;
+    // Thread is still executing its last task
+    if (nv_atomic_load(&data->done_epoch) != nv_atomic_load(&data->epoch))
+        return false;
 
-        task->task_func = task_func;
-        task->data = task_data;
-        
-        #ifdef NV_WINDOWS
+    data->task = (nvTask){task_func, task_data};
 
-            data->task = task;
-            data->task_arrived = false;
+    nv_atomic_add(&task_executor->pending, 1);
+    nv_atomic_add(&data->epoch, 1);
 
-            nvCondition_signal(data->task_event);
+    _nvTaskExecutor_unpark(&data->parked, data->task_mutex, data->task_event);
 
-        #else
+    return true;
+}
 
-            nvMutex_lock(data->task_mutex);
+void nvTaskExecutor_wait_tasks(nvTaskExecutor *task_executor) {
+    nvPrecisionTimer timer;
+    nv_uint32 polls = 0;
+    double spun = 0.0;
+    double parked = 0.0;
+
+    nv_uint32 pending = nv_atomic_load(&task_executor->pending);
+    if (pending == 0) return;
+
+    nvPrecisionTimer_start(&timer);
+    for (; pending != 0 && polls < task_executor->join_spin; polls++) {
+        nv_cpu_relax();
+        pending = nv_atomic_load(&task_executor->pending);
+    }
+
+    if (pending != 0) {
+        spun = nvPrecisionTimer_stop(&timer);
+        nvPrecisionTimer_start(&timer);
+
+        // Park until the pending counter drops from the value we last saw,
+        // then check again since more than one task may still be running
+        while (pending != 0) {
+            _nvTaskExecutor_park(
+                &task_executor->join_parked,
+                &task_executor->pending,
+                pending,
+                task_executor->join_mutex,
+                task_executor->join_event
+            );
+            pending = nv_atomic_load(&task_executor->pending);
+        }
 
-            data->task = task;
-            data->task_arrived = false;
+        parked = nvPrecisionTimer_stop(&timer);
+    }
 
-            nvCondition_signal(data->task_event);
+    task_executor->join_spin = _nvTaskExecutor_adapt_spin(
+        task_executor->join_spin,
+        task_executor->settings.spin_count,
+        polls,
+        spun,
+        parked
+    );
+}
 
-            nvMutex_unlock(data->task_mutex);
 
-        #endif
+static int _nvTaskExecutor_range_task(void *data) {
+    nvTaskRange *range = (nvTaskRange *)data;
 
-        return true;
-    }
+    if (range->start < range->end)
+        range->callback(range->data, range->start, range->end);
 
-    return false;
+    return 0;
 }
 
-void nvTaskExecutor_wait_tasks(nvTaskExecutor *task_executor) {
-    #ifdef NV_WINDOWS
-
-        for (size_t i = 0; i < task_executor->threads->size; i++) {
-            nvTaskExecutorData *data = task_executor->data->data[i];
-            nvCondition_wait(data->done_event, data->task_mutex);
+static void *_nvTaskExecutor_enqueue_range(
+    nvParallelForCallback callback,
+    void *data,
+    size_t count,
+    size_t min_range,
+    void *context
+) {
+    nvTaskExecutor *task_executor = (nvTaskExecutor *)context;
+    size_t thread_count = task_executor->threads->size;
+
+    if (min_range == 0) min_range = 1;
+
+    // Split the items into contiguous chunks, one per thread
+    size_t chunk = (count + thread_count - 1) / thread_count;
+    if (chunk < min_range) chunk = min_range;
+
+    // Every thread gets a range, even if it is empty, so that waiting for
+    // the group can wait on every thread
+    for (size_t i = 0; i < thread_count; i++) {
+        size_t start = i * chunk;
+        size_t end = start + chunk;
+        if (start > count) start = count;
+        if (end > count) end = count;
+
+        nvTaskExecutorData *thread_data = task_executor->data->data[i];
+        bool idle = nv_atomic_load(&thread_data->done_epoch) == nv_atomic_load(&thread_data->epoch);
+
+        // The range of a busy thread might still be read, it isn't overwritten
+        if (idle) {
+            nvTaskRange *range = &task_executor->ranges[i];
+            range->callback = callback;
+            range->data = data;
+            range->start = start;
+            range->end = end;
+
+            idle = nvTaskExecutor_add_task_to(
+                task_executor,
+                _nvTaskExecutor_range_task,
+                range,
+                i
+            );
         }
 
-    #else
+        // Thread is busy with a task added outside the interface, the range is run here instead
+        if (!idle && start < end)
+            callback(data, start, end);
+    }
 
-        for (size_t i = 0; i < task_executor->threads->size; i++) {
-            nvTaskExecutorData *data = task_executor->data->data[i];
+    return task_executor;
+}
 
-            // Busy wait if the task hasn't arrived yet
-            while (!data->task_arrived) {}
+static void _nvTaskExecutor_wait_group(void *group, void *context) {
+    nvTaskExecutor_wait_tasks((nvTaskExecutor *)group);
+}
 
-            while (data->is_busy) {
-                nvMutex_lock(data->task_mutex);
-                nvCondition_wait(data->done_event, data->task_mutex);
-                nvMutex_unlock(data->task_mutex);
-            }
-        }
-    
-    #endif
+nvTaskInterface nvTaskExecutor_get_interface(nvTaskExecutor *task_executor) {
+    return (nvTaskInterface){
+        .enqueue_range = _nvTaskExecutor_enqueue_range,
+        .wait_group = _nvTaskExecutor_wait_group,
+        .worker_count = task_executor->threads->size,
+        .context = task_executor
+    };
 }
\ No newline at end of file
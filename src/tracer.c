@@ -0,0 +1,171 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include "novaphysics/tracer.h"
+
+#ifdef NV_WINDOWS
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+
+/**
+ * @file tracer.c
+ *
+ * @brief Timeline tracer exporting Chrome trace event JSON.
+ */
+
+
+// IDs are given to threads once and shared by all tracers
+static nv_uint32 _nv_trace_thread_counter = 0;
+static NV_THREAD_LOCAL nv_uint32 _nv_trace_thread = 0; // 0 if the thread doesn't have an ID yet
+
+
+nvTracer *nvTracer_new(nv_uint32 capacity) {
+    nvTracer *tracer = NV_NEW(nvTracer);
+    if (!tracer) return NULL;
+
+    tracer->events = (nvTraceEvent *)NV_MALLOC(sizeof(nvTraceEvent) * capacity);
+    if (!tracer->events) {
+        NV_FREE(tracer);
+        return NULL;
+    }
+
+    tracer->capacity = capacity;
+    tracer->_reserved = 0;
+    tracer->dropped = 0;
+    tracer->origin = nvTracer_now();
+
+    return tracer;
+}
+
+void nvTracer_free(nvTracer *tracer) {
+    if (!tracer) return;
+
+    NV_FREE(tracer->events);
+    NV_FREE(tracer);
+}
+
+void nvTracer_clear(nvTracer *tracer) {
+    nv_atomic_store(&tracer->_reserved, 0);
+    nv_atomic_store(&tracer->dropped, 0);
+}
+
+nv_uint64 nvTracer_now() {
+    #ifdef NV_WINDOWS
+
+        LARGE_INTEGER counter, frequency;
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+
+        nv_uint64 seconds = (nv_uint64)(counter.QuadPart / frequency.QuadPart);
+        nv_uint64 remainder = (nv_uint64)(counter.QuadPart % frequency.QuadPart);
+
+        return seconds * 1000000000ULL + remainder * 1000000000ULL / (nv_uint64)frequency.QuadPart;
+
+    #else
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        return (nv_uint64)now.tv_sec * 1000000000ULL + (nv_uint64)now.tv_nsec;
+
+    #endif
+}
+
+void nvTracer_record(nvTracer *tracer, const char *name, nv_uint64 begin, nv_uint64 end, nv_uint32 items) {
+    if (_nv_trace_thread == 0)
+        _nv_trace_thread = nv_atomic_add(&_nv_trace_thread_counter, 1);
+
+    // Slots are claimed with one atomic add, so threads never wait on each other
+    nv_uint32 slot = nv_atomic_add(&tracer->_reserved, 1) - 1;
+
+    if (slot >= tracer->capacity) {
+        nv_atomic_add(&tracer->dropped, 1);
+        return;
+    }
+
+    nvTraceEvent *event = &tracer->events[slot];
+    event->name = name;
+    event->begin = begin - tracer->origin;
+    event->end = end - tracer->origin;
+    event->thread = _nv_trace_thread - 1;
+    event->items = items;
+}
+
+nv_uint32 nvTracer_get_count(nvTracer *tracer) {
+    nv_uint32 reserved = nv_atomic_load(&tracer->_reserved);
+    return (reserved < tracer->capacity) ? reserved : tracer->capacity;
+}
+
+static void _nvTracer_write_string(FILE *file, const char *string) {
+    fputc('"', file);
+
+    for (const char *c = string; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', file);
+        if ((unsigned char)*c < 0x20) continue;
+        fputc(*c, file);
+    }
+
+    fputc('"', file);
+}
+
+void nvTracer_write(nvTracer *tracer, FILE *file) {
+    nv_uint32 count = nvTracer_get_count(tracer);
+    nv_uint32 max_thread = 0;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Nova Physics\"}}");
+
+    for (nv_uint32 i = 0; i < count; i++) {
+        nvTraceEvent *event = &tracer->events[i];
+        if (event->thread > max_thread) max_thread = event->thread;
+
+        // Complete events with microsecond timestamps
+        fprintf(file, ",\n{\"name\":");
+        _nvTracer_write_string(file, event->name);
+        fprintf(
+            file,
+            ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+            event->items ? "range" : "phase",
+            event->thread,
+            (double)event->begin / 1000.0,
+            (double)(event->end - event->begin) / 1000.0
+        );
+
+        if (event->items) fprintf(file, ",\"args\":{\"items\":%u}", event->items);
+
+        fputc('}', file);
+    }
+
+    if (count > 0) {
+        for (nv_uint32 i = 0; i <= max_thread; i++) {
+            fprintf(
+                file,
+                ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}",
+                i,
+                i
+            );
+        }
+    }
+
+    fprintf(file, "\n],\"otherData\":{\"dropped\":%u}}\n", nv_atomic_load(&tracer->dropped));
+}
+
+bool nvTracer_save(nvTracer *tracer, const char *filename) {
+    FILE *file = fopen(filename, "w");
+    if (!file) return false;
+
+    nvTracer_write(tracer, file);
+
+    fclose(file);
+    return true;
+}
\ No newline at end of file
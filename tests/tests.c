@@ -8,6 +8,7 @@
 
 */
 
+#include <string.h>
 #include "unittest.h"
 
 
@@ -183,6 +184,1465 @@ void TEST__nvArray_remove(UnitTestSuite *test) {
 }
 
 
+/******************************************************************************
+
+                              nvTaskExecutor tests
+    
+******************************************************************************/
+
+static int count_task(void *data) {
+    nv_atomic_add((nv_uint32 *)data, 1);
+    return 0;
+}
+
+/* Wait until every executor thread is parked on its condition. */
+static bool wait_parked(nvTaskExecutor *task_executor) {
+    for (size_t i = 0; i < task_executor->data->size; i++) {
+        nvTaskExecutorData *data = task_executor->data->data[i];
+
+        size_t polls = 0;
+        while (!nv_atomic_load(&data->parked) && polls++ < 100000000)
+            nv_cpu_relax();
+
+        if (!nv_atomic_load(&data->parked)) return false;
+    }
+
+    return true;
+}
+
+void TEST__nvTaskExecutor_epochs(UnitTestSuite *test) {
+    nvTaskExecutorSettings settings = nvTaskExecutorSettings_DEFAULT;
+    settings.spin_count = 0;
+
+    // Threads park right away without spinning
+    nvTaskExecutor *task_executor = nvTaskExecutor_new_with_settings(2, settings);
+    nv_uint32 count = 0;
+    bool ok = true;
+
+    for (size_t round = 0; round < 20; round++) {
+        // Every other round goes through the park/unpark path
+        if (round % 2 == 0) ok = ok && wait_parked(task_executor);
+
+        for (size_t i = 0; i < task_executor->data->size; i++)
+            ok = ok && nvTaskExecutor_add_task_to(task_executor, count_task, &count, i);
+
+        nvTaskExecutor_wait_tasks(task_executor);
+
+        // Join must only return once every task published its epoch
+        ok = ok && nv_atomic_load(&task_executor->pending) == 0;
+        ok = ok && nv_atomic_load(&count) == (round + 1) * 2;
+        for (size_t i = 0; i < task_executor->data->size; i++) {
+            nvTaskExecutorData *data = task_executor->data->data[i];
+            ok = ok && nv_atomic_load(&data->done_epoch) == nv_atomic_load(&data->epoch);
+            ok = ok && data->spin == 0;
+        }
+    }
+
+    nvTaskExecutor_close(task_executor);
+    nvTaskExecutor_free(task_executor);
+
+    // Closing an executor whose threads never got a task must not hang
+    nvTaskExecutor *unused = nvTaskExecutor_new(3);
+    nvTaskExecutor_close(unused);
+    nvTaskExecutor_free(unused);
+
+    expect_true(ok, test);
+}
+
+
+/* Block an executor thread until the flag is set. */
+static int blocking_task(void *data) {
+    while (!nv_atomic_load((nv_uint32 *)data))
+        nv_cpu_relax();
+    return 0;
+}
+
+static void count_items(void *data, size_t start, size_t end) {
+    nv_uint32 *items = (nv_uint32 *)data;
+    for (size_t i = start; i < end; i++)
+        nv_atomic_add(&items[i], 1);
+}
+
+void TEST__nvTaskExecutor_busy_range(UnitTestSuite *test) {
+    nvTaskExecutor *task_executor = nvTaskExecutor_new(2);
+    nvTaskInterface interface = nvTaskExecutor_get_interface(task_executor);
+
+    // The second thread is busy with a task added outside the interface
+    nv_uint32 release = 0;
+    bool added = nvTaskExecutor_add_task_to(task_executor, blocking_task, &release, 1);
+
+    nv_uint32 items[64] = {0};
+    void *group = interface.enqueue_range(count_items, items, 64, 1, interface.context);
+
+    // The range of the busy thread was run on this thread and is already done
+    bool busy_done = true;
+    for (size_t i = 32; i < 64; i++)
+        busy_done = busy_done && nv_atomic_load(&items[i]) == 1;
+
+    nv_atomic_store(&release, 1);
+    interface.wait_group(group, interface.context);
+
+    bool once = true;
+    for (size_t i = 0; i < 64; i++)
+        once = once && items[i] == 1;
+
+    nvTaskExecutor_close(task_executor);
+    nvTaskExecutor_free(task_executor);
+
+    expect_true(added && busy_done && once, test);
+}
+
+/******************************************************************************
+
+                                 nvSpace tests
+    
+******************************************************************************/
+
+/* Create a small scene of boxes falling on the ground. */
+static nvSpace *create_test_space() {
+    nvSpace *space = nvSpace_new();
+
+    nvBody *ground = nvBody_new(
+        nvBodyType_STATIC,
+        nvRectShape_new(60.0, 5.0),
+        NV_VEC2(64.0, 60.0),
+        0.0,
+        nvMaterial_WOOD
+    );
+    nvSpace_add(space, ground);
+
+    for (size_t y = 0; y < 10; y++) {
+        for (size_t x = 0; x < 10; x++) {
+            nvBody *box = nvBody_new(
+                nvBodyType_DYNAMIC,
+                nvRectShape_new(1.0, 1.0),
+                NV_VEC2(50.0 + (nv_float)x * 1.5, 55.0 - (nv_float)y * 1.5),
+                0.0,
+                nvMaterial_WOOD
+            );
+            nvSpace_add(space, box);
+        }
+    }
+
+    return space;
+}
+
+void TEST__nvSpace_step_async(UnitTestSuite *test) {
+    nvSpace *space_sync = create_test_space();
+    nvSpace *space_async = create_test_space();
+
+    for (size_t i = 0; i < 30; i++) {
+        nvSpace_step(space_sync, 1.0 / 60.0, 8, 4, 4, 1);
+
+        nvSpace_step_async(space_async, 1.0 / 60.0, 8, 4, 4, 1);
+        nvSpace_step_wait(space_async);
+    }
+
+    // The view from the last step must stay intact while the next step is running
+    const nvSpaceView *view = nvSpace_get_view(space_async);
+    nvBody *last = space_async->bodies->data[space_async->bodies->size - 1];
+    nvVector2 view_position = nvSpaceView_get(view, last->id)->position;
+    nv_uint64 view_step = view->step;
+
+    nvSpace_step_async(space_async, 1.0 / 60.0, 8, 4, 4, 1);
+    bool view_intact = nvVector2_eq(nvSpaceView_get(view, last->id)->position, view_position);
+    nvSpace_step_wait(space_async);
+
+    nvSpace_step(space_sync, 1.0 / 60.0, 8, 4, 4, 1);
+
+    bool same = true;
+    for (size_t i = 0; i < space_sync->bodies->size; i++) {
+        nvBody *a = space_sync->bodies->data[i];
+        nvBody *b = space_async->bodies->data[i];
+        if (!nvVector2_eq(a->position, b->position) || a->angle != b->angle)
+            same = false;
+    }
+
+    expect_true(same && view_intact && view_step == 30, test);
+
+    nvSpace_free(space_sync);
+    nvSpace_free(space_async);
+}
+
+void TEST__nvSpaceView_query(UnitTestSuite *test) {
+    nvSpace *space = create_test_space();
+    space->capture_views = true;
+
+    // A large static body isn't binned into the query grid
+    nvSpace_add(space, nvBody_new(nvBodyType_STATIC, nvRectShape_new(100.0, 2.0), NV_VEC2(60.0, 30.0), 0.0, nvMaterial_CONCRETE));
+
+    for (size_t i = 0; i < 10; i++)
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    const nvSpaceView *view = nvSpace_get_view(space);
+    nvArray *found = nvArray_new();
+
+    // Queries see the same states in the same order as checking every state
+    bool same = view->_indexed && view->_large_count > 0;
+    for (size_t i = 0; i < 100 && same; i++) {
+        nv_float x = 20.0 + (nv_float)(i % 10) * 6.0;
+        nv_float y = 25.0 + (nv_float)(i / 10) * 4.0;
+        nvAABB aabb = {x, y, x + (nv_float)(i % 7), y + (nv_float)(i % 3)};
+        nvVector2 point = NV_VEC2(x + 0.3, y + 0.7);
+
+        found->size = 0;
+        size_t count = nvSpaceView_query_aabb(view, aabb, found);
+        size_t k = 0;
+        for (size_t j = 0; j < view->size; j++) {
+            if (!nv_collide_aabb_x_aabb(aabb, view->states[j].aabb)) continue;
+            if (k >= found->size || found->data[k] != &view->states[j]) same = false;
+            k++;
+        }
+        if (k != count || k != found->size) same = false;
+
+        found->size = 0;
+        count = nvSpaceView_query_point(view, point, found);
+        k = 0;
+        for (size_t j = 0; j < view->size; j++) {
+            if (!nv_collide_aabb_x_point(view->states[j].aabb, point)) continue;
+            if (k >= found->size || found->data[k] != &view->states[j]) same = false;
+            k++;
+        }
+        if (k != count || k != found->size) same = false;
+    }
+
+    expect_true(same, test);
+
+    nvArray_free(found);
+    nvSpace_free(space);
+}
+
+typedef struct {
+    size_t enqueued;
+    size_t items;
+} HostScheduler;
+
+static void *host_enqueue_range(
+    nvParallelForCallback callback,
+    void *data,
+    size_t count,
+    size_t min_range,
+    void *context
+) {
+    HostScheduler *scheduler = context;
+    scheduler->enqueued++;
+
+    // Run the ranges inline, in reverse order like a work-stealing scheduler might
+    for (size_t end = count; end > 0;) {
+        size_t start = (end > min_range) ? end - min_range : 0;
+        callback(data, start, end);
+        scheduler->items += end - start;
+        end = start;
+    }
+
+    return scheduler;
+}
+
+static void host_wait_group(void *group, void *context) {}
+
+void TEST__nvSpace_set_task_interface(UnitTestSuite *test) {
+    nvSpace *space_builtin = create_test_space();
+    nvSpace *space_host = create_test_space();
+
+    nvSpace_set_broadphase(space_builtin, nvBroadPhaseAlg_SHG);
+    nvSpace_set_broadphase(space_host, nvBroadPhaseAlg_SHG);
+
+    // Test space is small, don't let it fall back to serial stepping
+    space_builtin->parallel_body_threshold = 0;
+    space_host->parallel_body_threshold = 0;
+
+    nvSpace_enable_multithreading(space_builtin, 4);
+
+    HostScheduler scheduler = {0};
+    nvSpace_set_task_interface(space_host, (nvTaskInterface){
+        .enqueue_range = host_enqueue_range,
+        .wait_group = host_wait_group,
+        .worker_count = 4,
+        .context = &scheduler
+    });
+
+    for (size_t i = 0; i < 30; i++) {
+        nvSpace_step(space_builtin, 1.0 / 60.0, 8, 4, 4, 1);
+        nvSpace_step(space_host, 1.0 / 60.0, 8, 4, 4, 1);
+    }
+
+    bool same = true;
+    for (size_t i = 0; i < space_builtin->bodies->size; i++) {
+        nvBody *a = space_builtin->bodies->data[i];
+        nvBody *b = space_host->bodies->data[i];
+        if (!nvVector2_eq(a->position, b->position) || a->angle != b->angle)
+            same = false;
+    }
+
+    expect_true(
+        same &&
+        space_host->task_executor == NULL &&
+        scheduler.enqueued == 30 &&
+        scheduler.items == 30 * 4,
+        test
+    );
+
+    nvSpace_free(space_builtin);
+    nvSpace_free(space_host);
+}
+
+static nv_uint64 hash_space_state(nvSpace *space) {
+    // FNV-1a over the bit patterns of body states
+    nv_uint64 hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = space->bodies->data[i];
+        nv_float state[6] = {
+            body->position.x, body->position.y, body->angle,
+            body->linear_velocity.x, body->linear_velocity.y, body->angular_velocity
+        };
+
+        unsigned char *bytes = (unsigned char *)state;
+        for (size_t j = 0; j < sizeof(state); j++) {
+            hash ^= bytes[j];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    return hash;
+}
+
+void TEST__nvSpace_thread_count_determinism(UnitTestSuite *test) {
+    size_t thread_counts[4] = {0, 1, 2, 4};
+    nv_uint64 hashes[4];
+
+    for (size_t i = 0; i < 4; i++) {
+        nvSpace *space = create_test_space();
+        nvSpace_set_broadphase(space, nvBroadPhaseAlg_SHG);
+        space->parallel_body_threshold = 0;
+
+        if (thread_counts[i] > 0)
+            nvSpace_enable_multithreading(space, thread_counts[i]);
+
+        for (size_t j = 0; j < 120; j++)
+            nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+        hashes[i] = hash_space_state(space);
+
+        nvSpace_free(space);
+    }
+
+    expect_true(
+        hashes[0] == hashes[1] &&
+        hashes[0] == hashes[2] &&
+        hashes[0] == hashes[3],
+        test
+    );
+}
+
+void TEST__nvProfiler_worker_times(UnitTestSuite *test) {
+    nvSpace *space = create_test_space();
+    nvSpace_set_broadphase(space, nvBroadPhaseAlg_SHG);
+    space->parallel_body_threshold = 0;
+    nvSpace_enable_multithreading(space, 2);
+
+    nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    nvProfiler *profiler = &space->profiler;
+
+    // Worker times are only measured by profiled builds
+    #ifdef NV_PROFILE
+
+        double work = 0.0;
+        for (size_t i = 0; i < profiler->worker_count; i++)
+            work += profiler->worker_times[i];
+
+        expect_true(
+            profiler->worker_count > 0 &&
+            profiler->worker_count <= 2 &&
+            profiler->parallel_wall > 0.0 &&
+            profiler->parallel_wall <= profiler->step &&
+            nv_fabs(work - profiler->parallel_work) < 1e-9,
+            test
+        );
+
+    #else
+
+        expect_true(profiler->worker_count == 0, test);
+
+    #endif
+
+    nvSpace_free(space);
+}
+
+typedef struct {
+    size_t begins[nvProfilerPhase_COUNT];
+    size_t ends[nvProfilerPhase_COUNT];
+    bool nested;
+} HookCounts;
+
+static void count_phases(nvProfilerPhase phase, bool begin, void *user_data) {
+    HookCounts *counts = (HookCounts *)user_data;
+
+    if (begin) counts->begins[phase]++;
+    else counts->ends[phase]++;
+
+    // Every phase apart from the step itself should be inside the step
+    if (phase != nvProfilerPhase_STEP && counts->begins[nvProfilerPhase_STEP] == counts->ends[nvProfilerPhase_STEP])
+        counts->nested = false;
+}
+
+void TEST__nvSpace_set_profiler_hook(UnitTestSuite *test) {
+    nvSpace *space = create_test_space();
+
+    HookCounts counts = {.nested = true};
+    nvSpace_set_profiler_hook(space, count_phases, &counts);
+
+    for (size_t i = 0; i < 5; i++)
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 2);
+
+    #ifdef NV_PROFILE
+
+        bool balanced = true;
+        for (size_t i = 0; i < nvProfilerPhase_COUNT; i++)
+            if (counts.begins[i] != counts.ends[i]) balanced = false;
+
+        expect_true(
+            balanced &&
+            counts.nested &&
+            counts.ends[nvProfilerPhase_STEP] == 5 &&
+            counts.ends[nvProfilerPhase_NARROWPHASE] == 10,
+            test
+        );
+
+    #else
+
+        expect_true(counts.ends[nvProfilerPhase_STEP] == 0, test);
+
+    #endif
+
+    nvSpace_free(space);
+}
+
+void TEST__nvSpace_set_tracer(UnitTestSuite *test) {
+    nvSpace *space = create_test_space();
+    space->parallel_body_threshold = 0;
+    nvSpace_enable_multithreading(space, 2);
+
+    nvTracer *tracer = nvTracer_new(4096);
+    nvSpace_set_tracer(space, tracer);
+
+    for (size_t i = 0; i < 3; i++)
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    nvSpace_set_tracer(space, NULL);
+    nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    size_t steps = 0;
+    size_t ranges = 0;
+    bool ordered = true;
+
+    for (nv_uint32 i = 0; i < nvTracer_get_count(tracer); i++) {
+        nvTraceEvent *event = &tracer->events[i];
+        if (event->end < event->begin) ordered = false;
+        if (!strcmp(event->name, "Step")) steps++;
+        if (event->items > 0) ranges++;
+    }
+
+    // Trace of a step should be valid JSON as far as the brackets go
+    FILE *file = tmpfile();
+    nvTracer_write(tracer, file);
+    rewind(file);
+
+    int depth = 0;
+    bool balanced = true;
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        if (c == '{' || c == '[') depth++;
+        if (c == '}' || c == ']') depth--;
+        if (depth < 0) balanced = false;
+    }
+    fclose(file);
+
+    expect_true(
+        steps == 3 &&
+        ranges > 0 &&
+        ordered &&
+        tracer->dropped == 0 &&
+        balanced && depth == 0,
+        test
+    );
+
+    nvTracer_free(tracer);
+    nvSpace_free(space);
+}
+
+void TEST__nvSpace_step_budget(UnitTestSuite *test) {
+    nvSpace *space = create_test_space();
+
+    nvStepQuality full;
+    for (size_t i = 0; i < 5; i++)
+        full = nvSpace_step_budget(space, 1.0 / 60.0, 1e6, 8, 4, 4, 2);
+
+    // Nothing fits into a budget this small, the step falls back to the minimum
+    nvStepQuality minimum = nvSpace_step_budget(space, 1.0 / 60.0, 1e-9, 8, 4, 4, 2);
+
+    expect_true(
+        !full.degraded &&
+        full.quality == 1.0 &&
+        full.substeps == 2 &&
+        full.velocity_iters == 8 &&
+        minimum.degraded &&
+        minimum.over_budget &&
+        minimum.substeps == 1 &&
+        minimum.velocity_iters == 1 &&
+        minimum.constraint_iters == 1 &&
+        minimum.quality < full.quality &&
+        space->step_cost_model.samples == 6,
+        test
+    );
+
+    nvSpace_free(space);
+}
+
+void TEST__nvBody_sim_tier(UnitTestSuite *test) {
+    nvSpace *space = nvSpace_new();
+
+    nvBody *full = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(1.0, 1.0), NV_VEC2(0.0, 0.0), 0.0, nvMaterial_WOOD);
+    nvBody *slow = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(1.0, 1.0), NV_VEC2(100.0, 0.0), 0.0, nvMaterial_WOOD);
+    full->linear_damping = 0.0;
+    slow->linear_damping = 0.0;
+    nvSpace_add(space, full);
+    nvSpace_add(space, slow);
+
+    nvSpace_set_sim_tier_region(space, (nvAABB){50.0, -50.0, 150.0, 50.0}, 2);
+
+    // Tier 2 is first simulated on the third step
+    nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+    nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+    nvVector2 idle_position = slow->position;
+
+    for (size_t i = 0; i < 5; i++)
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    // After the seventh step the slow body has caught up with all the steps it missed
+    expect_true(
+        full->sim_tier == 0 &&
+        slow->sim_tier == 2 &&
+        idle_position.y == 0.0 &&
+        slow->position.y > 0.0 &&
+        nv_fabs(slow->linear_velocity.y - full->linear_velocity.y) < 1e-6,
+        test
+    );
+
+    nvSpace_free(space);
+}
+
+void TEST__nvBroadPhase_SHG_parking(UnitTestSuite *test) {
+    nvSpace *space = create_test_space();
+    nvSpace_enable_sleeping(space);
+
+    for (size_t i = 0; i < 400; i++)
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    size_t sleeping = 0;
+    bool parked = true;
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = space->bodies->data[i];
+        bool resting = body->type == nvBodyType_STATIC || body->is_sleeping;
+        if (body->is_sleeping) sleeping++;
+        if (resting != body->_shg_parked || resting == body->_shg_placed) parked = false;
+    }
+
+    // Parked bodies are never query sources, but pairs must be the same as brute-force
+    nvBroadPhase_brute_force(space);
+    size_t brute_force_pairs = space->broadphase_pairs->count;
+    nvBroadPhase_SHG(space);
+    size_t shg_pairs = space->broadphase_pairs->count;
+    size_t moving = space->_shg_moving->size;
+
+    // Parked bodies are only placed again when they are moved through the setters
+    nvBody *moved = NULL;
+    for (size_t i = 0; i < space->bodies->size && !moved; i++) {
+        nvBody *body = space->bodies->data[i];
+        if (body->is_sleeping) moved = body;
+    }
+
+    bool replaced = false;
+    if (moved) {
+        nvBody_set_position(moved, nvVector2_add(moved->position, NV_VEC2(20.0, -20.0)));
+        bool marked = moved->_shg_dirty && space->_shg_dirty->size == 1;
+
+        nvBroadPhase_SHG(space);
+        nvSHGRange range = nvSHG_get_range(space->shg, nvBody_get_aabb(moved));
+
+        replaced =
+            marked &&
+            space->_shg_dirty->size == 0 &&
+            moved->_shg_parked &&
+            moved->_shg_range.min_x == range.min_x &&
+            moved->_shg_range.min_y == range.min_y &&
+            space->_shg_moving->size == moving;
+    }
+
+    nvSpace_disable_sleeping(space);
+    nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    bool unparked = true;
+    for (size_t i = 0; i < space->bodies->size; i++) {
+        nvBody *body = space->bodies->data[i];
+        if (body->type == nvBodyType_DYNAMIC && (body->_shg_parked || !body->_shg_placed)) unparked = false;
+    }
+
+    expect_true(
+        sleeping > 0 &&
+        parked &&
+        moving == space->bodies->size - sleeping - 1 &&
+        shg_pairs == brute_force_pairs &&
+        replaced &&
+        unparked,
+        test
+    );
+
+    nvSpace_free(space);
+}
+
+void TEST__nvBroadPhase_query_aabb(UnitTestSuite *test) {
+    nvSpace *space = create_test_space();
+    nvSpace_enable_sleeping(space);
+
+    for (size_t i = 0; i < 400; i++)
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    nvArray *found = nvArray_new();
+    bool same = true;
+
+    // Query windows over sleeping and moving bodies must find what testing every body finds
+    for (size_t i = 0; i < 12; i++) {
+        nv_float x = 40.0 + (nv_float)i * 3.0;
+        nvAABB aabb = {x, 40.0 + (nv_float)i, x + 4.0 + (nv_float)i, 62.0};
+
+        nvArray_clear(found, NULL);
+        nvBroadPhase_query_aabb(space, aabb, found);
+
+        size_t expected = 0;
+        nv_uint32 last_id = 0;
+        for (size_t j = 0; j < space->bodies->size; j++) {
+            nvBody *body = space->bodies->data[j];
+            if (nv_collide_aabb_x_aabb(aabb, nvBody_get_aabb(body))) expected++;
+        }
+
+        for (size_t j = 0; j < found->size; j++) {
+            nvBody *body = found->data[j];
+            if (!nv_collide_aabb_x_aabb(aabb, nvBody_get_aabb(body))) same = false;
+            if (j > 0 && body->id <= last_id) same = false;
+            last_id = body->id;
+        }
+
+        if (found->size != expected || expected == 0) same = false;
+    }
+
+    // A fast body leaves the cells it was placed in several cells behind in one step
+    nvBody *fast = nvBody_new(nvBodyType_DYNAMIC, nvCircleShape_new(0.5), NV_VEC2(20.0, 20.0), 0.0, nvMaterial_WOOD);
+    nvSpace_add(space, fast);
+    fast->linear_velocity = NV_VEC2(600.0, 0.0);
+    nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    nvArray_clear(found, NULL);
+    nvBroadPhase_query_aabb(space, nvBody_get_aabb(fast), found);
+    if (found->size != 1 || found->data[0] != fast || fast->position.x < 29.0) same = false;
+
+    expect_true(same, test);
+
+    nvArray_free(found);
+    nvSpace_free(space);
+}
+
+void TEST__nvBody_pose_caches(UnitTestSuite *test) {
+    nvSpace *space = nvSpace_new();
+    space->gravity = nvVector2_zero;
+
+    nvBody *body = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(2.0, 2.0), NV_VEC2(0.0, 0.0), 0.0, nvMaterial_WOOD);
+    nvSpace_add(space, body);
+
+    nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    // Pose didn't change, caches of the last step are kept
+    bool kept = body->_cache_aabb && body->_cache_transform;
+
+    // Writing the pose directly still invalidates the caches
+    body->position = NV_VEC2(10.0, 0.0);
+    nvAABB aabb = nvBody_get_aabb(body);
+
+    expect_true(kept && aabb.min_x == 9.0 && aabb.max_x == 11.0, test);
+
+    nvSpace_free(space);
+}
+
+void TEST__nvSpace_presolve_reuse(UnitTestSuite *test) {
+    nvSpace *spaces[3];
+    nvBody *tops[3];
+
+    for (size_t m = 0; m < 3; m++) {
+        nvSpace *space = nvSpace_new();
+        space->presolve_reuse = (nvPresolveReuse)m;
+
+        nvSpace_add(space, nvBody_new(nvBodyType_STATIC, nvRectShape_new(20.0, 1.0), NV_VEC2(0.0, 0.0), 0.0, nvMaterial_CONCRETE));
+
+        for (size_t i = 0; i < 5; i++) {
+            tops[m] = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(1.0, 1.0), NV_VEC2(0.0, -1.0 - (nv_float)i), 0.0, nvMaterial_WOOD);
+            nvSpace_add(space, tops[m]);
+        }
+
+        for (size_t i = 0; i < 120; i++)
+            nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 4);
+
+        spaces[m] = space;
+    }
+
+    // A box sliding over a plank moves its contact point on the plank a little in every substep
+    nvSpace *space = nvSpace_new();
+    space->presolve_reuse = nvPresolveReuse_MEASURE;
+    nvSpace_set_SHG(space, (nvAABB){0.0, 0.0, 200.0, 200.0}, 2.0, 2.0);
+
+    nvSpace_add(space, nvBody_new(nvBodyType_STATIC, nvRectShape_new(40.0, 1.0), NV_VEC2(100.0, 100.0), 0.0, nvMaterial_CONCRETE));
+
+    nvBody *plank = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(16.0, 0.5), NV_VEC2(100.0, 99.25), 0.0, nvMaterial_ICE);
+    nvBody *box = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(2.0, 2.0), NV_VEC2(94.0, 98.0), 0.0, nvMaterial_ICE);
+    box->linear_velocity = NV_VEC2(8.0, 0.0);
+    nvSpace_add(space, plank);
+    nvSpace_add(space, box);
+
+    // Arms move less than the tolerance in one substep but more over a whole step
+    nv_float tolerance = NV_PRESOLVE_REUSE_ARM_TOLERANCE;
+    nv_float arm_drift = 0.0;
+    nv_float max_error = 0.0;
+    size_t reused = 0;
+
+    for (size_t i = 0; i < 60; i++) {
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 4);
+
+        reused += space->presolve_drift.contacts;
+        max_error = nv_fmax(max_error, space->presolve_drift.max_error);
+
+        for (size_t j = 0; j < space->_res_order->size; j++) {
+            nvResolution *res = space->_res_order->data[j];
+            if (res->_presolve_step != space->_step_count) continue;
+
+            for (size_t k = 0; k < res->contact_count; k++) {
+                nvContact *contact = &res->contacts[k];
+                arm_drift = nv_fmax(arm_drift, nvVector2_dist(contact->ra, contact->_presolve_ra));
+                arm_drift = nv_fmax(arm_drift, nvVector2_dist(contact->rb, contact->_presolve_rb));
+            }
+        }
+    }
+
+    /*
+        The normal of the plank's face doesn't turn, so an arm r moved by the
+        tolerance changes k = 1/ma + 1/mb + (ra x n)^2 / Ia + (rb x n)^2 / Ib
+        by at most (2 * |r| * tolerance + tolerance^2) / I per body.
+    */
+    nv_float box_arm = nv_sqrt(2.0);
+    nv_float plank_arm = nv_sqrt(8.0 * 8.0 + 0.25 * 0.25);
+    nv_float error_bound = (
+        (2.0 * box_arm * tolerance + tolerance * tolerance) / box->inertia +
+        (2.0 * plank_arm * tolerance + tolerance * tolerance) / plank->inertia
+    ) / (box->invmass + plank->invmass);
+
+    expect_true(
+        spaces[nvPresolveReuse_NONE]->presolve_drift.contacts == 0 &&
+        spaces[nvPresolveReuse_MEASURE]->presolve_drift.contacts > 0 &&
+        nvVector2_dist(tops[nvPresolveReuse_NONE]->position, tops[nvPresolveReuse_SUBSTEPS]->position) < 0.01 &&
+        nvVector2_dist(tops[nvPresolveReuse_SUBSTEPS]->position, tops[nvPresolveReuse_MEASURE]->position) == 0.0 &&
+        reused > 0 &&
+        arm_drift > 0.0 &&
+        arm_drift <= tolerance &&
+        max_error <= error_bound,
+        test
+    );
+
+    for (size_t m = 0; m < 3; m++)
+        nvSpace_free(spaces[m]);
+    nvSpace_free(space);
+}
+
+void TEST__nvPositionSolver_colors(UnitTestSuite *test) {
+    nvSpace *space = create_test_space();
+    space->position_correction = nvPositionCorrection_NGS;
+
+    for (size_t i = 0; i < 200; i++)
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    nvPositionSolver *solver = space->_position_solver;
+    bool prepared = nvPositionSolver_prepare(solver, space->_res_order);
+
+    // No dynamic body is moved by two contacts of the same colour
+    bool unique = true;
+    for (size_t i = 0; i < NV_POSITION_SOLVER_COLORS; i++) {
+        for (size_t j = solver->color_starts[i]; j < solver->color_starts[i + 1]; j++) {
+            for (size_t k = j + 1; k < solver->color_starts[i + 1]; k++) {
+                nv_uint32 bodies_j[2] = {solver->a[j], solver->b[j]};
+                nv_uint32 bodies_k[2] = {solver->a[k], solver->b[k]};
+
+                for (size_t m = 0; m < 4; m++) {
+                    nv_uint32 body = bodies_j[m / 2];
+                    if (body == bodies_k[m % 2] && !solver->is_static[body]) unique = false;
+                }
+            }
+        }
+    }
+
+    size_t contacts = solver->contact_count;
+    nvPositionSolver_finish(solver);
+
+    // Stack rests without sinking
+    nv_float max_depth = 0.0;
+    for (size_t i = 0; i < space->_res_order->size; i++) {
+        nvResolution *res = space->_res_order->data[i];
+        max_depth = nv_fmax(max_depth, res->depth);
+    }
+
+    expect_true(prepared && contacts > 0 && unique && max_depth < 0.1, test);
+
+    nvSpace_free(space);
+}
+
+void TEST__nvShockGraph_levels(UnitTestSuite *test) {
+    nvSpace *space = nvSpace_new();
+    space->shock_propagation_iters = 2;
+    nvSpace_set_SHG(space, (nvAABB){0.0, 0.0, 200.0, 200.0}, 2.0, 2.0);
+
+    nvBody *ground = nvBody_new(nvBodyType_STATIC, nvRectShape_new(40.0, 2.0), NV_VEC2(100.0, 151.0), 0.0, nvMaterial_CONCRETE);
+    nvSpace_add(space, ground);
+
+    // Added from the top down so the bottom-up order can't come from the IDs
+    nvBody *boxes[5];
+    for (size_t i = 0; i < 5; i++) {
+        boxes[4 - i] = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(1.0, 1.0), NV_VEC2(100.0, 145.5 + (nv_float)i), 0.0, nvMaterial_WOOD);
+        nvSpace_add(space, boxes[4 - i]);
+    }
+
+    for (size_t i = 0; i < 30; i++)
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    nvShockGraph *graph = space->_shock_graph;
+    bool built = nvShockGraph_build(graph, space->_res_order, space->gravity);
+
+    bool levels = graph->levels[ground->id] == 0;
+    for (size_t i = 0; i < 5; i++)
+        if (graph->levels[boxes[i]->id] != i + 1) levels = false;
+
+    // Resolutions go up the stack and the lower body of each one is fixed
+    bool ordered = graph->count == space->_res_order->size && graph->count == 5;
+    for (size_t k = 0; k < graph->count && ordered; k++) {
+        nvResolution *res = graph->order[k];
+        nvBody *lower = (graph->levels[res->a->id] < graph->levels[res->b->id]) ? res->a : res->b;
+        if (graph->levels[lower->id] != k || graph->fixed[k] != lower) ordered = false;
+    }
+
+    expect_true(built && levels && ordered, test);
+
+    nvSpace_free(space);
+}
+
+/**
+ * @brief Build a tower of boxes, settle it and measure how much it jitters.
+ */
+static void tower_jitter(size_t shock_iters, nv_float *travel, nv_float *speed, nv_float *drift) {
+    nvSpace *space = nvSpace_new();
+    space->shock_propagation_iters = shock_iters;
+    space->position_correction = nvPositionCorrection_NGS;
+    nvSpace_set_SHG(space, (nvAABB){0.0, 0.0, 200.0, 200.0}, 2.0, 2.0);
+
+    nvSpace_add(space, nvBody_new(nvBodyType_STATIC, nvRectShape_new(40.0, 2.0), NV_VEC2(100.0, 151.0), 0.0, nvMaterial_CONCRETE));
+
+    size_t count = 16;
+    nvBody *top = NULL;
+    for (size_t i = 0; i < count; i++) {
+        top = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(1.0, 1.0), NV_VEC2(100.0, 149.5 - (nv_float)i), 0.0, nvMaterial_WOOD);
+        nvSpace_add(space, top);
+    }
+
+    // Too few iterations for the tower to come to rest by itself
+    *travel = 0.0;
+    *speed = 0.0;
+    nv_float last_y = top->position.y;
+    for (size_t i = 0; i < 180; i++) {
+        nvSpace_step(space, 1.0 / 60.0, 6, 4, 4, 1);
+
+        if (i >= 60) {
+            *travel += nv_fabs(top->position.y - last_y);
+
+            for (size_t j = 1; j < space->bodies->size; j++) {
+                nvBody *body = space->bodies->data[j];
+                *speed += nvVector2_len(body->linear_velocity) / (nv_float)(120 * count);
+            }
+        }
+        last_y = top->position.y;
+    }
+
+    *drift = 0.0;
+    for (size_t j = 1; j < space->bodies->size; j++) {
+        nvBody *body = space->bodies->data[j];
+        *drift = nv_fmax(*drift, nv_fabs(body->position.x - 100.0));
+    }
+
+    nvSpace_free(space);
+}
+
+void TEST__nvShockGraph_tower(UnitTestSuite *test) {
+    nv_float travel, speed, drift;
+    nv_float shock_travel, shock_speed, shock_drift;
+    tower_jitter(0, &travel, &speed, &drift);
+    tower_jitter(2, &shock_travel, &shock_speed, &shock_drift);
+
+    // Every velocity iteration propagates shock at most
+    nv_float all_travel, all_speed, all_drift;
+    nv_float clamped_travel, clamped_speed, clamped_drift;
+    tower_jitter(6, &all_travel, &all_speed, &all_drift);
+    tower_jitter(10, &clamped_travel, &clamped_speed, &clamped_drift);
+    expect_true(clamped_travel == all_travel && clamped_drift == all_drift, test);
+
+    // Shock propagation settles the tower instead of letting it bounce
+    expect_true(
+        shock_travel < travel * 0.25 &&
+        shock_speed < speed * 0.5 &&
+        shock_drift < 0.5,
+        test
+    );
+}
+
+void TEST__nvParticleSystem_bed(UnitTestSuite *test) {
+    nvSpace *space = nvSpace_new();
+    nvSpace_set_SHG(space, (nvAABB){0.0, 0.0, 200.0, 200.0}, 2.0, 2.0);
+
+    nvMaterial wall = (nvMaterial){1.0, 0.0, 0.5};
+    nvSpace_add(space, nvBody_new(nvBodyType_STATIC, nvRectShape_new(24.0, 2.0), NV_VEC2(100.0, 151.0), 0.0, wall));
+    nvSpace_add(space, nvBody_new(nvBodyType_STATIC, nvRectShape_new(2.0, 20.0), NV_VEC2(89.0, 140.0), 0.0, wall));
+    nvSpace_add(space, nvBody_new(nvBodyType_STATIC, nvRectShape_new(2.0, 20.0), NV_VEC2(111.0, 140.0), 0.0, wall));
+
+    // Two boxes over a bed of particles, only the two-way coupled one is held up
+    nvParticleSystem *two_way = nvParticleSystem_new(0.1, wall);
+    nvParticleSystem *one_way = nvParticleSystem_new(0.1, wall);
+    one_way->coupling = nvParticleCoupling_ONE_WAY;
+    one_way->collision_category = 0b10;
+
+    nvBody *held = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(2.0, 2.0), NV_VEC2(94.0, 143.0), 0.0, wall);
+    nvBody *sunk = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(2.0, 2.0), NV_VEC2(106.0, 143.0), 0.0, wall);
+    held->collision_mask = 0b01;
+    sunk->collision_mask = 0b10;
+    held->collision_category = 0b01;
+    sunk->collision_category = 0b10;
+    two_way->collision_category = 0b01;
+    nvSpace_add(space, held);
+    nvSpace_add(space, sunk);
+
+    for (size_t y = 0; y < 10; y++) {
+        for (size_t x = 0; x < 45; x++) {
+            nvVector2 position = NV_VEC2(90.3 + (nv_float)x * 0.22, 149.8 - (nv_float)y * 0.22);
+            nvParticleSystem_add(two_way, position, nvVector2_zero);
+            nvParticleSystem_add(one_way, nvVector2_add(position, NV_VEC2(11.0, 0.0)), nvVector2_zero);
+        }
+    }
+
+    // The one-way bed is half outside the walls, those particles fall out of the kill bounds
+    space->kill_bounds = (nvAABB){0.0, 0.0, 200.0, 160.0};
+    nvSpace_add_particles(space, two_way);
+    nvSpace_add_particles(space, one_way);
+
+    // Single grains keep rearranging slowly in a settled bed, its centroid and surface don't move
+    nv_float centroid_min = NV_INF, centroid_max = -NV_INF;
+    nv_float surface_min = NV_INF, surface_max = -NV_INF;
+    nv_float speed_max = 0.0;
+
+    for (size_t i = 0; i < 240; i++) {
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+        if (i < 180) continue;
+
+        nv_float centroid = 0.0;
+        nv_float surface = NV_INF;
+        for (size_t j = 0; j < two_way->count; j++) {
+            centroid += two_way->position_y[j];
+            surface = nv_fmin(surface, two_way->position_y[j]);
+            speed_max = nv_fmax(speed_max, nvVector2_len(NV_VEC2(two_way->velocity_x[j], two_way->velocity_y[j])));
+        }
+        centroid /= (nv_float)two_way->count;
+
+        centroid_min = nv_fmin(centroid_min, centroid);
+        centroid_max = nv_fmax(centroid_max, centroid);
+        surface_min = nv_fmin(surface_min, surface);
+        surface_max = nv_fmax(surface_max, surface);
+    }
+
+    // Bed rests on the ground and nothing leaks through
+    bool resting = (
+        centroid_max - centroid_min < 0.01 &&
+        surface_max - surface_min < 0.05 &&
+        speed_max < 2.0
+    );
+    for (size_t i = 0; i < two_way->count; i++) {
+        if (two_way->position_y[i] > 150.0 - 0.1 + 0.02) resting = false;
+    }
+
+    expect_true(
+        two_way->count == 450 &&
+        one_way->count < 450 &&
+        resting &&
+        held->position.y < sunk->position.y - 0.5 &&
+        sunk->position.y > 149.0 - 0.1,
+        test
+    );
+
+    nvSpace_free(space);
+}
+
+void TEST__nvParticleSystem_wake(UnitTestSuite *test) {
+    nvSpace *space = nvSpace_new();
+    nvSpace_set_SHG(space, (nvAABB){0.0, 0.0, 200.0, 200.0}, 2.0, 2.0);
+    nvSpace_enable_sleeping(space);
+
+    nvMaterial material = (nvMaterial){1.0, 0.0, 0.5};
+
+    // Two boxes asleep in the air, particles fall on both but only the two-way coupled ones wake it up
+    nvBody *woken = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(2.0, 2.0), NV_VEC2(94.0, 140.0), 0.0, material);
+    nvBody *asleep = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(2.0, 2.0), NV_VEC2(106.0, 140.0), 0.0, material);
+    nvSpace_add(space, woken);
+    nvSpace_add(space, asleep);
+    nvBody_sleep(woken);
+    nvBody_sleep(asleep);
+
+    nvParticleSystem *two_way = nvParticleSystem_new(0.1, material);
+    nvParticleSystem *one_way = nvParticleSystem_new(0.1, material);
+    one_way->coupling = nvParticleCoupling_ONE_WAY;
+
+    for (size_t x = 0; x < 8; x++) {
+        nvVector2 position = NV_VEC2(93.3 + (nv_float)x * 0.2, 137.5);
+        nvParticleSystem_add(two_way, position, nvVector2_zero);
+        nvParticleSystem_add(one_way, nvVector2_add(position, NV_VEC2(12.0, 0.0)), nvVector2_zero);
+    }
+
+    nvSpace_add_particles(space, two_way);
+    nvSpace_add_particles(space, one_way);
+
+    for (size_t i = 0; i < 90; i++)
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    // The woken box falls with the particles on it
+    expect_true(
+        !woken->is_sleeping &&
+        woken->position.y > 140.0 + 1.0 &&
+        asleep->is_sleeping &&
+        asleep->position.y == 140.0,
+        test
+    );
+
+    nvSpace_free(space);
+}
+
+void TEST__nvSoftBody_cloth(UnitTestSuite *test) {
+    nvSpace *space = nvSpace_new();
+    nvSpace_set_SHG(space, (nvAABB){0.0, 0.0, 200.0, 200.0}, 2.0, 2.0);
+
+    nvMaterial cloth_mat = (nvMaterial){1.0, 0.0, 0.5};
+    nvBody *ground = nvBody_new(nvBodyType_STATIC, nvRectShape_new(24.0, 2.0), NV_VEC2(100.0, 151.0), 0.0, cloth_mat);
+    ground->collision_category = 0b100;
+    nvSpace_add(space, ground);
+
+    // A cloth hanging from its top corners and a strip lying on the ground holding up a box
+    nvSoftBody *hanging = nvSoftBody_new_cloth(NV_VEC2(92.0, 130.0), 16, 12, 0.5, 0.05, 0.0, cloth_mat);
+    nvSoftBody *strip = nvSoftBody_new_cloth(NV_VEC2(101.0, 149.0), 16, 1, 0.5, 0.05, 0.0, cloth_mat);
+    nvSoftBody_set_mass(hanging, 0, 0.0);
+    nvSoftBody_set_mass(hanging, 15, 0.0);
+    nvSpace_add_soft_body(space, hanging);
+    nvSpace_add_soft_body(space, strip);
+
+    // The box doesn't collide with the ground, only the cloth is under it
+    nvBody *box = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(1.0, 1.0), NV_VEC2(104.75, 144.0), 0.0, cloth_mat);
+    box->collision_mask = 0b01;
+    nvSpace_add(space, box);
+
+    for (size_t i = 0; i < 240; i++)
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    // No two links of a colour move the same point
+    bool colored = true;
+    for (size_t c = 0; c < NV_SOFT_BODY_COLORS; c++) {
+        for (size_t k = hanging->color_starts[c]; k < hanging->color_starts[c + 1]; k++) {
+            for (size_t j = k + 1; j < hanging->color_starts[c + 1]; j++) {
+                nv_uint32 a[2] = {hanging->link_a[k], hanging->link_b[k]};
+                nv_uint32 b[2] = {hanging->link_a[j], hanging->link_b[j]};
+
+                for (size_t m = 0; m < 4; m++) {
+                    nv_uint32 shared = a[m / 2];
+                    if (shared == b[m % 2]) colored = false;
+                }
+            }
+        }
+    }
+
+    nv_float stretch = 0.0;
+    for (size_t k = 0; k < hanging->link_count; k++) {
+        nv_uint32 a = hanging->link_a[k];
+        nv_uint32 b = hanging->link_b[k];
+        nv_float dx = hanging->position_x[b] - hanging->position_x[a];
+        nv_float dy = hanging->position_y[b] - hanging->position_y[a];
+        stretch = nv_fmax(stretch, nv_fabs(nv_sqrt(dx * dx + dy * dy) / hanging->rest_length[k] - 1.0));
+    }
+
+    bool lying = true;
+    for (size_t i = 0; i < strip->count; i++)
+        if (strip->position_y[i] > 150.0 - strip->radius + 0.02) lying = false;
+
+    expect_true(
+        colored &&
+        hanging->color_starts[NV_SOFT_BODY_COLORS + 1] == hanging->color_starts[NV_SOFT_BODY_COLORS] &&
+        stretch < 0.05 &&
+        hanging->position_x[0] == 92.0 && hanging->position_y[0] == 130.0 &&
+        hanging->position_y[16 * 11 + 8] > 130.0 + 5.5 * 0.5 &&
+        lying &&
+        box->position.y < 150.0 - 0.5 &&
+        box->position.y > 150.0 - 0.5 - 1.0,
+        test
+    );
+
+    nvSpace_free(space);
+}
+
+void TEST__nvArticulation_chain(UnitTestSuite *test) {
+    nvSpace *space = nvSpace_new();
+    space->position_correction = nvPositionCorrection_NGS;
+    nvSpace_set_SHG(space, (nvAABB){0.0, 0.0, 200.0, 200.0}, 2.0, 2.0);
+
+    nvBody *ground = nvBody_new(nvBodyType_STATIC, nvRectShape_new(40.0, 2.0), NV_VEC2(100.0, 151.0), 0.0, nvMaterial_CONCRETE);
+    nvSpace_add(space, ground);
+
+    // A chain hanging from a static root, swinging with a single iteration
+    nvBody *root = nvBody_new(nvBodyType_STATIC, nvRectShape_new(1.0, 1.0), NV_VEC2(90.0, 120.0), 0.0, nvMaterial_WOOD);
+    nvSpace_add(space, root);
+    nvArticulation *chain = nvArticulation_new(root);
+
+    nvBody *parent = root;
+    for (size_t i = 0; i < 8; i++) {
+        nvBody *link = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(2.0, 0.5), NV_VEC2(91.5 + (nv_float)i * 2.0, 120.0), 0.0, nvMaterial_WOOD);
+        link->collision_group = 1;
+        nvSpace_add(space, link);
+        nvArticulation_add_link(chain, parent, link, NV_VEC2(90.5 + (nv_float)i * 2.0, 120.0));
+        parent = link;
+    }
+    nvArticulation_set_limits(chain, 4, -0.1, 0.1);
+    nvSpace_add_articulation(space, chain);
+
+    // A free three-link body dropped on the ground
+    nvBody *torso = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(1.0, 2.0), NV_VEC2(110.0, 140.0), 0.0, nvMaterial_WOOD);
+    nvBody *left = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(2.0, 0.5), NV_VEC2(111.5, 139.5), 0.0, nvMaterial_WOOD);
+    nvBody *right = nvBody_new(nvBodyType_DYNAMIC, nvRectShape_new(2.0, 0.5), NV_VEC2(108.5, 139.5), 0.0, nvMaterial_WOOD);
+    torso->collision_group = left->collision_group = right->collision_group = 2;
+    nvSpace_add(space, torso);
+    nvSpace_add(space, left);
+    nvSpace_add(space, right);
+    nvArticulation *body = nvArticulation_new(torso);
+    nvArticulation_add_link(body, torso, left, NV_VEC2(110.5, 139.5));
+    nvArticulation_add_link(body, torso, right, NV_VEC2(109.5, 139.5));
+    nvSpace_add_articulation(space, body);
+
+    nv_float limit = 0.0;
+    for (size_t i = 0; i < 180; i++) {
+        nvSpace_step(space, 1.0 / 60.0, 1, 4, 1, 1);
+        limit = nv_fmax(limit, nv_fabs(chain->links[4].angle) - 0.1);
+    }
+
+    // Joints don't drift apart
+    nv_float separation = 0.0;
+    nvArticulation *arts[2] = {chain, body};
+    for (size_t k = 0; k < 2; k++) {
+        for (size_t i = 1; i < arts[k]->count; i++) {
+            nvArticulationLink *link = &arts[k]->links[i];
+            nvBody *a = arts[k]->links[link->parent].body;
+            nvBody *b = link->body;
+
+            nvVector2 joint_a = nvVector2_add(a->position, nvVector2_rotate(link->parent_anchor, a->angle));
+            nvVector2 joint_b = nvVector2_add(b->position, nvVector2_rotate(link->anchor, b->angle));
+            separation = nv_fmax(separation, nvVector2_len(nvVector2_sub(joint_a, joint_b)));
+        }
+    }
+
+    // Contacts stay in the batched position solver, only the link poses are synced
+    bool batched = space->_position_solver->contact_capacity > 0;
+
+    expect_true(
+        chain->count == 9 &&
+        batched &&
+        separation < 1e-4 &&
+        limit < 0.02 &&
+        chain->links[8].body->position.y > 120.0 + 4.0 &&
+        torso->position.y < 150.0 - 0.9 &&
+        torso->position.y > 150.0 - 1.5,
+        test
+    );
+
+    nvSpace_free(space);
+}
+
+void TEST__nvAllocTracker_categories(UnitTestSuite *test) {
+    #ifdef NV_TRACK_ALLOCATIONS
+
+        nvAllocStats bodies = nvAllocTracker_get(nvAllocCategory_BODIES);
+        nvAllocStats shapes = nvAllocTracker_get(nvAllocCategory_SHAPES);
+        nvAllocStats total = nvAllocTracker_get(nvAllocCategory_COUNT);
+
+        nvSpace *space = create_test_space();
+
+        nvAllocStats bodies_created = nvAllocTracker_get(nvAllocCategory_BODIES);
+        nvAllocStats shapes_created = nvAllocTracker_get(nvAllocCategory_SHAPES);
+
+        for (size_t i = 0; i < 5; i++)
+            nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 2);
+
+        nvAllocStats resolutions = nvAllocTracker_get(nvAllocCategory_RESOLUTIONS);
+
+        nvSpace_free(space);
+
+        nvAllocStats total_freed = nvAllocTracker_get(nvAllocCategory_COUNT);
+
+        expect_true(
+            nvAllocTracker_is_enabled() &&
+            bodies_created.current > bodies.current &&
+            shapes_created.current > shapes.current &&
+            resolutions.allocations > 0 &&
+            total_freed.current == total.current,
+            test
+        );
+
+    #else
+
+        nvAllocStats total = nvAllocTracker_get(nvAllocCategory_COUNT);
+        expect_true(!nvAllocTracker_is_enabled() && total.allocations == 0, test);
+
+    #endif
+}
+
+void TEST__nvReplication_roundtrip(UnitTestSuite *test) {
+    nvSpace *server = create_test_space();
+    nvSpace *client = create_test_space();
+    nvSpace_enable_sleeping(server);
+
+    nvReplicationEncoder *encoder = nvReplicationEncoder_new(server, nvReplicationSettings_DEFAULT);
+    nvReplicationDecoder *decoder = nvReplicationDecoder_new(nvReplicationSettings_DEFAULT);
+
+    nv_uint8 packet[8192];
+    size_t first_size = 0;
+    size_t last_size = 0;
+    bool decoded = true;
+
+    for (size_t i = 0; i < 600; i++) {
+        nvSpace_step(server, 1.0 / 60.0, 8, 4, 4, 1);
+
+        size_t size = nvReplicationEncoder_encode(encoder, packet, sizeof(packet));
+        if (i == 0) first_size = size;
+        last_size = size;
+
+        // Drop every third packet, the next one is encoded against an older baseline
+        if (i % 3 == 2) continue;
+
+        nv_uint32 sequence;
+        decoded = decoded && nvReplicationDecoder_decode(decoder, client, packet, size, &sequence);
+        nvReplicationEncoder_ack(encoder, sequence);
+    }
+
+    bool close = true;
+    for (size_t i = 0; i < server->bodies->size; i++) {
+        nvBody *a = server->bodies->data[i];
+        nvBody *b = client->bodies->data[i];
+
+        if (nvVector2_len(nvVector2_sub(a->position, b->position)) > 1.0 / 256.0 ||
+            a->is_sleeping != b->is_sleeping)
+            close = false;
+    }
+
+    // Once everything sleeps only the header is sent
+    expect_true(decoded && close && first_size > 0 && last_size < 16, test);
+
+    nvReplicationEncoder_free(encoder);
+    nvReplicationDecoder_free(decoder);
+    nvSpace_free(server);
+    nvSpace_free(client);
+}
+
+void TEST__nvShmExporter_write(UnitTestSuite *test) {
+    #if defined(NV_WINDOWS) || defined(NV_WEB)
+
+        // Shared memory export is POSIX only
+        expect_true(nvShmExporter_new("/nova_physics_test", 16, 16, 2) == NULL, test);
+
+    #else
+
+        nvSpace *space = create_test_space();
+        nvShmExporter *exporter = nvShmExporter_new("/nova_physics_test", 16, 64, 2);
+        nvShmReader *reader = nvShmReader_open("/nova_physics_test");
+
+        nvShmFrame frame;
+        nvShmBody bodies[16];
+        nvShmContact contacts[64];
+        bool empty = !nvShmReader_read(reader, &frame, bodies, contacts);
+
+        for (size_t i = 0; i < 3; i++) {
+            nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+            nvShmExporter_write(exporter, space);
+        }
+
+        bool read = nvShmReader_read(reader, &frame, bodies, contacts);
+        nvBody *body = space->bodies->data[5];
+
+        expect_true(
+            empty && read &&
+            frame.frame == 3 &&
+            frame.body_count == 16 &&
+            frame.total_bodies == space->bodies->size &&
+            bodies[5].id == body->id &&
+            bodies[5].position[0] == (float)body->position.x &&
+            (frame.sequence & 1) == 0,
+            test
+        );
+
+        nvShmReader_close(reader);
+        nvShmExporter_free(exporter);
+        nvSpace_free(space);
+
+    #endif
+}
+
+void TEST__nvScene_save_open(UnitTestSuite *test) {
+    nvSpace *space = create_test_space();
+
+    nvBody *ball = nvBody_new(
+        nvBodyType_DYNAMIC,
+        nvCircleShape_new(0.8),
+        NV_VEC2(40.0, 40.0),
+        0.0,
+        nvMaterial_WOOD
+    );
+    nvSpace_add(space, ball);
+    nvBody_set_mass(ball, 3.0);
+
+    nvSpace_add_constraint(space, nvHingeJoint_new(ball, NULL, NV_VEC2(40.0, 38.0)));
+    nvSpace_add_constraint(space, nvSpring_new(
+        space->bodies->data[1], space->bodies->data[2],
+        nvVector2_zero, nvVector2_zero,
+        2.0, 50.0, 1.0
+    ));
+
+    nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+
+    bool saved = nvScene_save(space, "nova_test_scene.bin", 1.0 / 60.0, 8, 4, 4, 1);
+    nvScene *scene = nvScene_open("nova_test_scene.bin");
+
+    nvSpace *loaded = nvSpace_new();
+    if (scene) nvScene_instantiate(scene, loaded);
+    nvScene_close(scene);
+    remove("nova_test_scene.bin");
+
+    bool same = saved && scene &&
+                loaded->bodies->size == space->bodies->size &&
+                loaded->constraints->size == space->constraints->size;
+
+    // A freshly loaded scene continues the simulation without resolution caches,
+    // so only compare the instantiated state itself
+    for (size_t i = 0; same && i < space->bodies->size; i++) {
+        nvBody *a = space->bodies->data[i];
+        nvBody *b = loaded->bodies->data[i];
+
+        same = a->id == b->id &&
+               a->shape->type == b->shape->type &&
+               nvVector2_eq(a->position, b->position) &&
+               a->angle == b->angle &&
+               nvVector2_eq(a->linear_velocity, b->linear_velocity) &&
+               a->mass == b->mass &&
+               a->inertia == b->inertia;
+    }
+
+    nvConstraint *hinge = loaded->constraints->data[0];
+    same = same &&
+           hinge->a == loaded->bodies->data[101] &&
+           hinge->b == NULL;
+
+    // A truncated file isn't a valid scene
+    FILE *file = fopen("nova_test_scene.bin", "wb");
+    nv_uint32 magic = NV_SCENE_MAGIC;
+    fwrite(&magic, sizeof(nv_uint32), 1, file);
+    fclose(file);
+    same = same && nvScene_open("nova_test_scene.bin") == NULL;
+    remove("nova_test_scene.bin");
+
+    expect_true(same, test);
+
+    nvSpace_free(space);
+    nvSpace_free(loaded);
+}
+
+
+static void recorded_callback(nvSpace *space, void *user_data) {
+    size_t *calls = user_data;
+    (*calls)++;
+
+    if (*calls == 15) nvBody_apply_impulse(space->bodies->data[5], NV_VEC2(0.0, -3.0), nvVector2_zero);
+    if (*calls == 25) nvSpace_kill(space, space->bodies->data[7]);
+}
+
+void TEST__nvRecorder_replay(UnitTestSuite *test) {
+    nvSpace *space = create_test_space();
+    nvRecorder *recorder = nvRecorder_new(space);
+
+    // Mutations from callbacks are replayed in the middle of their steps
+    size_t calls = 0;
+    space->callback_user_data = &calls;
+    space->before_collision = recorded_callback;
+
+    for (size_t i = 0; i < 40; i++) {
+        nvBody *box = space->bodies->data[1 + i % 50];
+
+        nvBody_apply_force(box, NV_VEC2(30.0, -50.0));
+        nvBody_apply_impulse(box, NV_VEC2(0.5, 0.0), NV_VEC2(0.1, 0.2));
+
+        if (i == 10) {
+            nvBody *ball = nvBody_new(
+                nvBodyType_DYNAMIC,
+                nvCircleShape_new(0.8),
+                NV_VEC2(55.0, 30.0),
+                0.0,
+                nvMaterial_WOOD
+            );
+            nvSpace_add(space, ball);
+            nvBody_set_linear_velocity(ball, NV_VEC2(0.0, 20.0));
+        }
+
+        if (i == 20) nvSpace_kill(space, space->bodies->data[60]);
+
+        nvSpace_step(space, 1.0 / 60.0, 8, 4, 4, 1);
+    }
+
+    bool saved = nvRecorder_save(recorder, "nova_test_recording.bin");
+    nvReplay *replay = nvReplay_open("nova_test_recording.bin");
+    remove("nova_test_recording.bin");
+
+    size_t steps = 0;
+    while (replay && nvReplay_step(replay)) steps++;
+
+    // Replay must end up in exactly the same state
+    bool same = saved && replay && !replay->error && replay->complete &&
+                steps == 40 && replay->step_count == 40 &&
+                replay->space->bodies->size == space->bodies->size;
+
+    for (size_t i = 0; same && i < space->bodies->size; i++) {
+        nvBody *body = space->bodies->data[i];
+        nvBody *replayed = replay->bodies[body->id];
+
+        same = replayed &&
+               nvVector2_eq(body->position, replayed->position) &&
+               body->angle == replayed->angle;
+    }
+
+    expect_true(same, test);
+
+    nvReplay_free(replay);
+    nvRecorder_free(recorder);
+    nvSpace_free(space);
+}
+
 int main(int argc, char *argv[]) {
     UnitTestSuite test = {.current = "", .total = 0, .fails = 0};
 
@@ -207,6 +1667,39 @@ int main(int argc, char *argv[]) {
     TEST(nvArray_pop)
     TEST(nvArray_remove)
 
+    TEST(nvTaskExecutor_epochs)
+    TEST(nvTaskExecutor_busy_range)
+
+    TEST(nvSpace_step_async)
+    TEST(nvSpaceView_query)
+    TEST(nvSpace_set_task_interface)
+    TEST(nvSpace_thread_count_determinism)
+    TEST(nvProfiler_worker_times)
+    TEST(nvSpace_set_profiler_hook)
+    TEST(nvSpace_set_tracer)
+    TEST(nvSpace_step_budget)
+    TEST(nvBody_sim_tier)
+    TEST(nvBroadPhase_SHG_parking)
+    TEST(nvBroadPhase_query_aabb)
+    TEST(nvBody_pose_caches)
+    TEST(nvSpace_presolve_reuse)
+    TEST(nvPositionSolver_colors)
+    TEST(nvShockGraph_levels)
+    TEST(nvShockGraph_tower)
+    TEST(nvParticleSystem_bed)
+    TEST(nvParticleSystem_wake)
+    TEST(nvSoftBody_cloth)
+    TEST(nvArticulation_chain)
+    TEST(nvAllocTracker_categories)
+
+    TEST(nvReplication_roundtrip)
+
+    TEST(nvShmExporter_write)
+
+    TEST(nvScene_save_open)
+
+    TEST(nvRecorder_replay)
+
     printf("total: %d\n", test.total);
     printf("fails: %d\n", test.fails);
 
@@ -0,0 +1,96 @@
+/*
+
+  This file is a part of the Nova Physics Engine
+  project and distributed under the MIT license.
+
+  Copyright © Kadir Aksoy
+  https://github.com/kadir014/nova-physics
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "novaphysics/novaphysics.h"
+
+
+/**
+ * @file shm_reader.c
+ * 
+ * @brief Reference reader for the shared-memory state exporter.
+ * 
+ * Maps the memory written by nvShmExporter and prints a summary of the
+ * latest frame a few times a second.
+ * 
+ * Build from the repository root:
+ *   gcc -O2 -Iinclude -o shm_reader tools/shm_reader.c <every .c file in src> -lm -lpthread
+ * 
+ * Usage:
+ *   ./shm_reader [name] [frames]
+ */
+
+
+static void sleep_ms(long ms) {
+    struct timespec t = {ms / 1000, (ms % 1000) * 1000000};
+    nanosleep(&t, NULL);
+}
+
+
+int main(int argc, char *argv[]) {
+    const char *name = (argc > 1) ? argv[1] : "/nova_physics";
+    long frames = (argc > 2) ? atol(argv[2]) : -1;
+
+    nvShmReader *reader = nvShmReader_open(name);
+    if (!reader) {
+        fprintf(stderr, "Can't open shared memory '%s'. Is the exporter running?\n", name);
+        return EXIT_FAILURE;
+    }
+
+    nvShmHeader *header = reader->header;
+    printf(
+        "Mapped '%s': %u slots, %u bodies, %u contacts per frame\n",
+        name,
+        header->slot_count,
+        header->max_bodies,
+        header->max_contacts
+    );
+
+    nvShmFrame frame;
+    nvShmBody *bodies = malloc(sizeof(nvShmBody) * header->max_bodies);
+    nvShmContact *contacts = malloc(sizeof(nvShmContact) * header->max_contacts);
+
+    nv_uint32 last_frame = 0;
+
+    while (frames != 0) {
+        if (!nvShmReader_read(reader, &frame, bodies, contacts) || frame.frame == last_frame) {
+            sleep_ms(10);
+            continue;
+        }
+
+        last_frame = frame.frame;
+
+        size_t sleeping = 0;
+        for (size_t i = 0; i < frame.body_count; i++)
+            if (bodies[i].is_sleeping) sleeping++;
+
+        printf(
+            "frame %u: %u/%u bodies (%zu sleeping), %u/%u contacts, step %.3f ms, broadphase %.3f ms, narrowphase %.3f ms\n",
+            frame.frame,
+            frame.body_count, frame.total_bodies,
+            sleeping,
+            frame.contact_count, frame.total_contacts,
+            frame.profiler.step * 1000.0,
+            frame.profiler.broadphase * 1000.0,
+            frame.profiler.narrowphase * 1000.0
+        );
+
+        if (frames > 0) frames--;
+        sleep_ms(250);
+    }
+
+    free(bodies);
+    free(contacts);
+    nvShmReader_close(reader);
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file